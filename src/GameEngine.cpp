@@ -19,11 +19,18 @@
 //--------------------------------------------------------------------------
 
 #include <ctime>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
 #include <SFML/OpenGL.hpp>
 
 //--------------------------------------------------------------------------
 
 #include "GameEngine.h"
+#include "logic/defines.h"
+#include "logic/TerrainGenerator.h"
+#include "ecs/Simulation.h"
+#include "ecs/Replay.h"
 #include "resources/ResourceLoader.h"
 #include "states/StateGameLoading.h"
 
@@ -32,6 +39,7 @@
 int GameEngine::run()
 {
     init();
+    m_clock.restart();
 
     while (m_pWindow->isOpen())
     {
@@ -39,8 +47,11 @@ int GameEngine::run()
         while (m_pWindow->pollEvent(event))
             handleEvents(event);
 
+        simulate();
+        jobs.runMainThreadJobs();
+
         m_pWindow->clear();
-        update();
+        render();
         m_pWindow->display();
     }
 
@@ -50,6 +61,78 @@ int GameEngine::run()
 
 //--------------------------------------------------------------------------
 
+int GameEngine::playReplay(const std::string & path)
+{
+    try
+    {
+        ecs::ReplayReader reader(path);
+        const ecs::ReplayHeader & header = reader.getHeader();
+        sf::Vector2i gridSize(header.gridWidth, header.gridHeight);
+        if (gridSize.x <= 0 || gridSize.y <= 0 || gridSize.x % CHUNK_SIZE != 0 || gridSize.y % CHUNK_SIZE != 0)
+            throw std::runtime_error("GameEngine - replay has invalid grid size");
+
+        // map isn't stored in replay, it's generated again from the seed
+        sf::Clock clock;
+        grid = std::make_shared<Grid>(gridSize);
+        terrainSeed = header.terrainSeed;
+        TerrainSettings settings;
+        settings.seed = header.terrainSeed;
+        TerrainGenerator(settings, *grid).generate(jobs);
+        grid->publishChanges();
+        sf::Time generationTime = clock.restart();
+
+        ecs::Simulation simulation(*grid, header.simulationSeed);
+        sf::Time slowestTick;
+        unsigned int hashes = 0u;
+        unsigned int mismatches = 0u;
+        auto simulateUntil = [&](uint32_t tick)
+        {
+            while (simulation.getTick() < tick)
+            {
+                sf::Clock tickClock;
+                simulation.step(jobs);
+                slowestTick = std::max(slowestTick, tickClock.getElapsedTime());
+            }
+        };
+
+        ecs::ReplayRecord record;
+        while (reader.next(record))
+        {
+            simulateUntil(record.tick);
+            switch (record.kind)
+            {
+            case ecs::ReplayRecord::Kind::COMMAND:
+                simulation.execute(record.command);
+                break;
+
+            case ecs::ReplayRecord::Kind::HASH:
+                ++hashes;
+                if (ecs::ReplayWriter::foldHash(simulation.computeHash()) != record.hash && mismatches++ == 0u)
+                    std::cout << "Replay: first state mismatch at tick " << record.tick << std::endl;
+                break;
+
+            case ecs::ReplayRecord::Kind::END:
+                break;
+            }
+        }
+
+        sf::Time simulationTime = clock.getElapsedTime();
+        uint32_t ticks = std::max(simulation.getTick(), 1u);
+        std::cout << "Replay: terrain generated in " << generationTime.asMilliseconds() << " ms, " << simulation.getTick() << " ticks simulated in "
+            << simulationTime.asMilliseconds() << " ms (" << static_cast<uint64_t>(ticks / std::max(simulationTime.asSeconds(), 0.001f)) << " ticks/s, "
+            << simulationTime.asSeconds() * 1000.f / ticks << " ms average, " << slowestTick.asSeconds() * 1000.f << " ms slowest tick), "
+            << hashes << " hashes checked, " << mismatches << " mismatches" << std::endl;
+        return mismatches == 0u ? 0 : 1;
+    }
+    catch (const std::runtime_error & error)
+    {
+        std::cout << error.what() << std::endl;
+        return 1;
+    }
+}
+
+//--------------------------------------------------------------------------
+
 void GameEngine::init()
 {
     // Restart seed
@@ -73,13 +156,20 @@ void GameEngine::init()
     paths.insert("fonts", fontsPaths);
     paths.insert("loading_screen", screens);
 
+    // Images are decoded on worker threads, textures are created on main thread in the original order
     auto& textures = resources.holder<sf::Texture>();
-    textures.load("screen", Resource::loadFromFile<sf::Texture>(screens->values.at(0)));
-    textures.load("screen", Resource::loadFromFile<sf::Texture>(screens->values.at(1)));
-    textures.load("screen", Resource::loadFromFile<sf::Texture>(screens->values.at(2)));
-    textures.load("screen", Resource::loadFromFile<sf::Texture>(screens->values.at(3)));
-    textures.load("screen", Resource::loadFromFile<sf::Texture>(screens->values.at(4)));
-    textures.load("screen", Resource::loadFromFile<sf::Texture>(screens->values.at(5)));
+    std::vector<logic::JobHandle> uploads;
+    for (std::size_t i = 0; i < 6; ++i)
+    {
+        auto image = std::make_shared<sf::Image>();
+        auto decode = jobs.schedule([image, path = screens->values.at(i)]() { image->loadFromFile(path); });
+
+        std::vector<logic::JobHandle> dependencies{ decode };
+        if (!uploads.empty())
+            dependencies.push_back(uploads.back());
+        uploads.push_back(jobs.scheduleMainThread([&textures, image]() { textures.load("screen", Resource::loadFromImage<sf::Texture>(*image)); }, dependencies));
+    }
+    jobs.wait(uploads);
 
     auto& fonts = resources.holder<sf::Font>();
     fonts.load("main", Resource::loadFromFile<sf::Font>(paths.node("fonts").key("main").value()));
@@ -131,10 +221,31 @@ void GameEngine::handleEvents(sf::Event& event)
 
 //--------------------------------------------------------------------------
 
-void GameEngine::update()
+void GameEngine::simulate()
+{
+    const sf::Time step = sf::microseconds(1000000 / SIMULATION_RATE);
+    m_accumulator += m_clock.restart();
+
+    // simulate all whole steps which elapsed since last frame, but not more than MAX_SIMULATION_STEPS
+    unsigned int steps = 0;
+    for (; m_accumulator >= step && steps < MAX_SIMULATION_STEPS; ++steps)
+    {
+        sf::Time stepTime = step;
+        machine.simulate(stepTime);
+        m_accumulator -= step;
+    }
+
+    // lag which can't be caught up is dropped, so slow frames slow down the game instead of making it run ahead
+    if (m_accumulator >= step)
+        m_accumulator = sf::microseconds(m_accumulator.asMicroseconds() % step.asMicroseconds());
+}
+
+//--------------------------------------------------------------------------
+
+void GameEngine::render()
 {
-    auto elapsed = m_clock.restart();
-    machine.update(elapsed);
+    const sf::Time step = sf::microseconds(1000000 / SIMULATION_RATE);
+    machine.render(m_accumulator / step);
 
     m_pWindow->setView(m_view);
 }
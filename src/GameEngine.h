@@ -19,6 +19,8 @@
 #pragma once
 
 #include <memory>
+#include <string>
+#include <cstdint>
 #include <vector>
 #include <utility>
 #include <SFML/Graphics.hpp>
@@ -26,6 +28,8 @@
 //--------------------------------------------------------------------------
 
 #include "StateMachine.h"
+#include "logic/Grid.h"
+#include "logic/JobSystem.h"
 #include "resources/ResourceManager.h"
 #include "resources/ResourcePaths.h"
 
@@ -39,18 +43,31 @@ public:
     void shutdown();
     int run();
 
+    /*!
+    * \brief Re-simulate replay without window as fast as possible and compare recorded state hashes
+    *
+    * \return 0 if all hashes matched, 1 otherwise
+    *
+    */
+    int playReplay(const std::string & path);
+
+    logic::JobSystem jobs;
     StateMachine machine;
     ResourceManager<MAIN_RESOURCES> resources;
     ResourcePaths paths;
+    std::shared_ptr<Grid> grid;     ///< map of current game, created by loading state
+    uint32_t terrainSeed{ 0u };     ///< seed of TerrainGenerator which generated grid
 
 private:
     void init();
     void handleEvents(sf::Event& event);
-    void update();
+    void simulate();
+    void render();
 
     std::unique_ptr<sf::RenderWindow> m_pWindow;
 
     sf::Clock m_clock;
+    sf::Time m_accumulator;     ///< elapsed time not simulated yet
     sf::View m_view = sf::View({ 0.f, 0.f, 800.f, 600.f });
     bool m_fullscreen = false;
 };
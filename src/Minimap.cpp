@@ -0,0 +1,283 @@
+/*
+ * TzarRemake
+ * Copyright (C) 2018
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <string>
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+//--------------------------------------------------------------------------
+
+#include "Minimap.h"
+
+//--------------------------------------------------------------------------
+
+namespace
+{
+    /*!
+    * \brief Color of terrain types, indexed by TerrainType
+    */
+    const sf::Color TERRAIN_COLOR[] =
+    {
+        sf::Color(56, 112, 40),     // GRASS
+        sf::Color(150, 140, 110),   // ROAD
+        sf::Color(84, 70, 36),      // FOREST_FLOOR
+        sf::Color(48, 88, 160),     // SHALLOW_WATER
+    };
+
+    static_assert(sizeof(TERRAIN_COLOR) / sizeof(TERRAIN_COLOR[0]) == static_cast<int>(TerrainType::COUNT), "Every TerrainType needs minimap color");
+
+    const sf::Color TREE_COLOR(24, 64, 16);
+    const sf::Color BUILDING_COLOR(176, 160, 140);
+    const sf::Color RESOURCE_COLOR(220, 200, 60);
+    const sf::Color OWN_UNIT_COLOR(255, 255, 255);
+    const sf::Color OTHER_UNIT_COLOR(220, 40, 40);
+    const sf::Color UNEXPLORED_COLOR(0, 0, 0);
+
+    /*!
+    * \brief Color of one tile of the chunk, unit dots are drawn over terrain and fog hides or darkens it
+    */
+    sf::Color tileColor(const GridChunk & chunk, unsigned int tile, uint64_t visible, uint64_t explored, uint64_t ownUnits, uint64_t otherUnits)
+    {
+        uint64_t bit = uint64_t(1) << tile;
+        if (ownUnits & bit)
+            return OWN_UNIT_COLOR;
+        if (!(explored & bit))
+            return UNEXPLORED_COLOR;
+        if (otherUnits & bit)
+            return OTHER_UNIT_COLOR;
+
+        sf::Color color;
+        switch (chunk.objType[tile])
+        {
+        case ObjectType::TREE: color = TREE_COLOR; break;
+        case ObjectType::BUILDING: color = BUILDING_COLOR; break;
+        case ObjectType::RESOURCE: color = RESOURCE_COLOR; break;
+        default: color = TERRAIN_COLOR[static_cast<int>(chunk.terrain[tile])]; break;
+        }
+
+        // explored tiles which are not visible now are shown darker
+        if (!(visible & bit))
+            color = sf::Color(color.r / 2, color.g / 2, color.b / 2);
+        return color;
+    }
+}
+
+//--------------------------------------------------------------------------
+
+Minimap::Minimap(sf::Vector2i gridSize, Detail detail) :
+    m_chunkGridSize{ gridSize.x / static_cast<int>(CHUNK_SIZE), gridSize.y / static_cast<int>(CHUNK_SIZE) },
+    m_detail{ detail },
+    m_texelsPerChunk{ detail == Detail::TILE ? CHUNK_SIZE : 1u }
+{
+    unsigned int width = m_chunkGridSize.x * m_texelsPerChunk;
+    unsigned int height = m_chunkGridSize.y * m_texelsPerChunk;
+    m_image.create(width, height, UNEXPLORED_COLOR);
+    if (!m_texture.create(width, height))
+        throw std::runtime_error("Minimap - Can't create texture " + std::to_string(width) + "x" + std::to_string(height));
+
+    std::size_t chunkCount = m_chunkGridSize.x*m_chunkGridSize.y;
+    m_chunks.resize(chunkCount);
+    m_ownUnits.resize(chunkCount);
+    m_otherUnits.resize(chunkCount);
+}
+
+//--------------------------------------------------------------------------
+
+void Minimap::invalidate(const GridChangeSet & changes)
+{
+    for (unsigned int chunkIndex : changes.dirtyChunks)
+        m_chunks[chunkIndex].dirty = true;
+}
+
+//--------------------------------------------------------------------------
+
+void Minimap::invalidateAll()
+{
+    for (ChunkState & state : m_chunks)
+        state.dirty = true;
+}
+
+//--------------------------------------------------------------------------
+
+void Minimap::update(const GridView & grid, const FogOfWar & fog, unsigned int player, const ecs::SpatialHash & units, ecs::World & world)
+{
+    assert(grid.getChunkGridSize() == m_chunkGridSize);
+
+    m_counters = Counters();
+    gatherUnits(fog, player, units, world);
+
+    // find chunks which look different than when they were drawn last time
+    m_changed.clear();
+    for (int chunkY = 0; chunkY < m_chunkGridSize.y; ++chunkY)
+    {
+        for (int chunkX = 0; chunkX < m_chunkGridSize.x; ++chunkX)
+        {
+            unsigned int chunkIndex = chunkX + chunkY*m_chunkGridSize.x;
+            uint64_t visible = chunkFog(fog, player, chunkX, chunkY, false);
+            uint64_t explored = chunkFog(fog, player, chunkX, chunkY, true);
+
+            ChunkState & state = m_chunks[chunkIndex];
+            if (!state.dirty && state.visible == visible && state.explored == explored &&
+                state.ownUnits == m_ownUnits[chunkIndex] && state.otherUnits == m_otherUnits[chunkIndex])
+                continue;
+
+            state.visible = visible;
+            state.explored = explored;
+            state.ownUnits = m_ownUnits[chunkIndex];
+            state.otherUnits = m_otherUnits[chunkIndex];
+            state.dirty = false;
+            rasterize(grid, chunkIndex, state);
+            m_changed.push_back(chunkIndex);
+        }
+    }
+    m_counters.rasterizedChunks = static_cast<unsigned int>(m_changed.size());
+
+    // neighbouring chunks of one chunk row are uploaded as one rectangle
+    for (std::size_t i = 0; i < m_changed.size(); ++i)
+    {
+        unsigned int firstChunk = m_changed[i];
+        unsigned int lastChunk = firstChunk;
+        while (i + 1 < m_changed.size() && m_changed[i + 1] == lastChunk + 1 && (lastChunk + 1) % m_chunkGridSize.x != 0)
+        {
+            ++lastChunk;
+            ++i;
+        }
+        upload(firstChunk, lastChunk);
+    }
+}
+
+//--------------------------------------------------------------------------
+
+void Minimap::gatherUnits(const FogOfWar & fog, unsigned int player, const ecs::SpatialHash & units, ecs::World & world)
+{
+    std::fill(m_ownUnits.begin(), m_ownUnits.end(), 0u);
+    std::fill(m_otherUnits.begin(), m_otherUnits.end(), 0u);
+
+    int gridWidth = m_chunkGridSize.x * static_cast<int>(CHUNK_SIZE);
+    int gridHeight = m_chunkGridSize.y * static_cast<int>(CHUNK_SIZE);
+    units.querySpans(sf::FloatRect(0.f, 0.f, static_cast<float>(gridWidth), static_cast<float>(gridHeight)), m_spans);
+    for (const ecs::SpatialHash::Span & span : m_spans)
+    {
+        for (std::size_t i = 0; i < span.count; ++i)
+        {
+            int x = std::min(std::max(static_cast<int>(span.positions[i].x), 0), gridWidth - 1);
+            int y = std::min(std::max(static_cast<int>(span.positions[i].y), 0), gridHeight - 1);
+            unsigned int chunkIndex = x / CHUNK_SIZE + (y / CHUNK_SIZE)*m_chunkGridSize.x;
+            uint64_t bit = uint64_t(1) << (x % CHUNK_SIZE + (y % CHUNK_SIZE)*CHUNK_SIZE);
+
+            const ecs::Owner * owner = world.get<ecs::Owner>(span.entities[i]);
+            if (owner != nullptr && owner->player == player)
+                m_ownUnits[chunkIndex] |= bit;
+            else if (fog.isVisible(player, x, y))
+                m_otherUnits[chunkIndex] |= bit;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------
+
+uint64_t Minimap::chunkFog(const FogOfWar & fog, unsigned int player, int chunkX, int chunkY, bool explored) const
+{
+    // chunk covers one byte of CHUNK_SIZE consecutive rows of the fog bitmap
+    int word = chunkX*CHUNK_SIZE / 64;
+    int shift = chunkX*CHUNK_SIZE % 64;
+    uint64_t mask = 0u;
+    for (unsigned int row = 0; row < CHUNK_SIZE; ++row)
+    {
+        int y = chunkY*CHUNK_SIZE + row;
+        const uint64_t * bits = explored ? fog.getExploredRow(player, y) : fog.getVisibleRow(player, y);
+        mask |= ((bits[word] >> shift) & 0xFFu) << (row*CHUNK_SIZE);
+    }
+    return mask;
+}
+
+//--------------------------------------------------------------------------
+
+void Minimap::rasterize(const GridView & grid, unsigned int chunkIndex, const ChunkState & state)
+{
+    const GridChunk & chunk = grid.chunk(chunkIndex);
+    unsigned int originX = (chunkIndex % m_chunkGridSize.x) * m_texelsPerChunk;
+    unsigned int originY = (chunkIndex / m_chunkGridSize.x) * m_texelsPerChunk;
+
+    if (m_detail == Detail::TILE)
+    {
+        for (unsigned int tile = 0; tile < CHUNK_TILES; ++tile)
+        {
+            sf::Color color = tileColor(chunk, tile, state.visible, state.explored, state.ownUnits, state.otherUnits);
+            m_image.setPixel(originX + tile % CHUNK_SIZE, originY + tile / CHUNK_SIZE, color);
+        }
+        return;
+    }
+
+    // low detail shows unit dots over whole chunk and average color of terrain otherwise
+    if (state.ownUnits != 0u)
+    {
+        m_image.setPixel(originX, originY, OWN_UNIT_COLOR);
+        return;
+    }
+    if (state.otherUnits != 0u)
+    {
+        m_image.setPixel(originX, originY, OTHER_UNIT_COLOR);
+        return;
+    }
+
+    unsigned int red = 0u, green = 0u, blue = 0u;
+    for (unsigned int tile = 0; tile < CHUNK_TILES; ++tile)
+    {
+        sf::Color color = tileColor(chunk, tile, state.visible, state.explored, 0u, 0u);
+        red += color.r;
+        green += color.g;
+        blue += color.b;
+    }
+    m_image.setPixel(originX, originY, sf::Color(red / CHUNK_TILES, green / CHUNK_TILES, blue / CHUNK_TILES));
+}
+
+//--------------------------------------------------------------------------
+
+void Minimap::upload(unsigned int firstChunk, unsigned int lastChunk)
+{
+    unsigned int x = (firstChunk % m_chunkGridSize.x) * m_texelsPerChunk;
+    unsigned int y = (firstChunk / m_chunkGridSize.x) * m_texelsPerChunk;
+    unsigned int width = (lastChunk - firstChunk + 1) * m_texelsPerChunk;
+    unsigned int height = m_texelsPerChunk;
+
+    // rows of the rectangle are not contiguous in the image, so they are packed before upload
+    std::size_t rowBytes = width * 4u;
+    std::size_t imageRowBytes = m_image.getSize().x * 4u;
+    m_staging.resize(rowBytes*height);
+    const sf::Uint8 * pixels = m_image.getPixelsPtr();
+    for (unsigned int row = 0; row < height; ++row)
+        std::memcpy(&m_staging[row*rowBytes], pixels + (y + row)*imageRowBytes + x*4u, rowBytes);
+
+    m_texture.update(m_staging.data(), width, height, x, y);
+    ++m_counters.uploadedRects;
+    m_counters.uploadedTexels += width*height;
+}
+
+//--------------------------------------------------------------------------
+
+void Minimap::draw(sf::RenderTarget& target, sf::RenderStates states) const
+{
+    states.transform *= getTransform();
+
+    sf::Sprite sprite(m_texture);
+    sprite.setScale(static_cast<float>(CHUNK_SIZE / m_texelsPerChunk), static_cast<float>(CHUNK_SIZE / m_texelsPerChunk));
+    target.draw(sprite, states);
+}
@@ -0,0 +1,156 @@
+/*
+ * TzarRemake
+ * Copyright (C) 2018
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <SFML/Graphics.hpp>
+
+//--------------------------------------------------------------------------
+
+#include "logic/Grid.h"
+#include "logic/FogOfWar.h"
+#include "ecs/World.h"
+#include "ecs/SpatialHash.h"
+
+//--------------------------------------------------------------------------
+
+/*!
+* \brief Minimap of terrain, fog of war and units, updated only where something changed
+*
+* Minimap keeps one texel per tile (or one texel per chunk for low detail) in an image and texture of the same size.
+* For every chunk it remembers visible and explored tiles of the player and tiles covered by unit dots, so update()
+* compares them with current state and rasterizes only chunks which differ or were reported as changed by the grid.
+* Changed chunks of one chunk row are merged into rectangles and only these rectangles are uploaded to the texture.
+*
+* Usage example:
+* \code
+* Minimap minimap(grid.getGridSize());
+* grid.subscribe(logic::Delegate<void(const GridChangeSet &)>::factory<Minimap, &Minimap::invalidate>(&minimap));
+* minimap.update(grid, fog, player, spatialHash, world);
+* window.draw(minimap);
+* \endcode
+*
+*/
+class Minimap : public sf::Drawable, public sf::Transformable
+{
+public:
+    /*!
+    * \brief Amount of tiles represented by one texel
+    */
+    enum class Detail
+    {
+        TILE,       ///< one texel per tile
+        CHUNK,      ///< one texel per chunk, average color of it's tiles
+    };
+
+    /*!
+    * \brief Work done by last update()
+    */
+    struct Counters
+    {
+        unsigned int rasterizedChunks{ 0u };    ///< amount of chunks drawn again into the image
+        unsigned int uploadedRects{ 0u };       ///< amount of calls of sf::Texture::update
+        unsigned int uploadedTexels{ 0u };      ///< amount of texels sent to the texture
+    };
+
+    /*!
+    * \brief Default constructor
+    *
+    * \param gridSize Size of the grid in tiles
+    * \param detail Amount of tiles represented by one texel
+    *
+    */
+    Minimap(sf::Vector2i gridSize, Detail detail = Detail::TILE);
+
+    /*!
+    * \brief Mark chunks changed by the grid, they are drawn again by next update()
+    */
+    void invalidate(const GridChangeSet & changes);
+
+    /*!
+    * \brief Mark all chunks, whole minimap is drawn again by next update()
+    */
+    void invalidateAll();
+
+    /*!
+    * \brief Draw again changed chunks and upload them to the texture
+    *
+    * \param grid Terrain and objects of the map
+    * \param fog Fog of war, tiles never seen by the player are black and tiles not visible now are darkened
+    * \param player Player whose fog and units are shown, units of other players are shown only on visible tiles
+    * \param units Index of unit positions rebuilt in this tick
+    * \param world World used to find owners of units
+    *
+    */
+    void update(const GridView & grid, const FogOfWar & fog, unsigned int player, const ecs::SpatialHash & units, ecs::World & world);
+
+    inline const sf::Texture & getTexture() const { return m_texture; }
+    inline const sf::Image & getImage() const { return m_image; }
+    inline const Counters & getCounters() const { return m_counters; }
+
+private:
+    /*!
+    * \brief State of the chunk used to draw it last time, every mask keeps one bit per tile in chunk order
+    */
+    struct ChunkState
+    {
+        uint64_t visible{ 0u };         ///< tiles visible to the player
+        uint64_t explored{ 0u };        ///< tiles explored by the player
+        uint64_t ownUnits{ 0u };        ///< tiles with units of the player
+        uint64_t otherUnits{ 0u };      ///< tiles with visible units of other players
+        bool dirty{ true };             ///< true if terrain of the chunk was changed
+    };
+
+    /*!
+    * \brief Fill masks of unit dots of every chunk from the spatial index
+    */
+    void gatherUnits(const FogOfWar & fog, unsigned int player, const ecs::SpatialHash & units, ecs::World & world);
+
+    /*!
+    * \brief Return 64 tile mask of the chunk taken from row major fog bitmap
+    */
+    uint64_t chunkFog(const FogOfWar & fog, unsigned int player, int chunkX, int chunkY, bool explored) const;
+
+    /*!
+    * \brief Draw tiles of the chunk into the image
+    */
+    void rasterize(const GridView & grid, unsigned int chunkIndex, const ChunkState & state);
+
+    /*!
+    * \brief Upload texels of chunks [firstChunk, lastChunk] of one chunk row to the texture
+    */
+    void upload(unsigned int firstChunk, unsigned int lastChunk);
+
+    virtual void draw(sf::RenderTarget& target, sf::RenderStates states) const;
+
+private:
+    sf::Vector2i m_chunkGridSize;               ///< amount of chunks in x and y direction
+    Detail m_detail;                            ///< amount of tiles represented by one texel
+    unsigned int m_texelsPerChunk;              ///< size of chunk in texels along one axis
+    sf::Image m_image;                          ///< texels of whole minimap
+    sf::Texture m_texture;                      ///< texels uploaded to the graphics card
+    std::vector<ChunkState> m_chunks;           ///< state used to draw every chunk
+    std::vector<uint64_t> m_ownUnits;           ///< tiles with units of the player gathered in current update
+    std::vector<uint64_t> m_otherUnits;         ///< tiles with units of other players gathered in current update
+    std::vector<unsigned int> m_changed;        ///< chunks drawn again in current update, sorted
+    std::vector<ecs::SpatialHash::Span> m_spans;    ///< helper for query of unit positions
+    std::vector<sf::Uint8> m_staging;           ///< texels of one rectangle sent to the texture
+    Counters m_counters;                        ///< work done by last update()
+};
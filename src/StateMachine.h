@@ -59,10 +59,18 @@ public:
             state->handleEvents(event);
     }
 
-    void update(sf::Time& delta)
+    void simulate(sf::Time& step)
     {
         for (auto &state : m_states)
-            state->update(delta);
+            state->simulate(step);
+
+        purge();
+    }
+
+    void render(float alpha)
+    {
+        for (auto &state : m_states)
+            state->render(alpha);
 
         purge();
     }
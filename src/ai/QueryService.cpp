@@ -0,0 +1,263 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//--------------------------------------------------------------------------
+
+#include "QueryService.h"
+
+//--------------------------------------------------------------------------
+
+#include <cstdlib>
+#include <algorithm>
+
+//--------------------------------------------------------------------------
+
+using namespace ai;
+
+//--------------------------------------------------------------------------
+
+constexpr std::size_t QueryService::MAX_BATCH_PATHS;
+constexpr float QueryService::DISTANCE_WEIGHT;
+constexpr unsigned int QueryService::MAX_EXPANDED;
+constexpr float QueryService::PATH_EPSILON;
+
+//--------------------------------------------------------------------------
+
+QueryService::QueryService(Grid & grid, logic::JobSystem & jobs) :
+	m_grid(grid),
+	m_jobs(jobs),
+	m_pathing(&grid, jobs)
+{
+	sf::Vector2i gridSize = grid.getGridSize();
+	m_cellGridSize.x = (gridSize.x + ecs::InfluenceMap::CELL_SIZE - 1) / ecs::InfluenceMap::CELL_SIZE;
+	m_cellGridSize.y = (gridSize.y + ecs::InfluenceMap::CELL_SIZE - 1) / ecs::InfluenceMap::CELL_SIZE;
+	std::size_t cellCount = static_cast<std::size_t>(m_cellGridSize.x*m_cellGridSize.y);
+	for (auto & layer : m_layers)
+		layer.assign(cellCount, 0.f);
+	m_total.assign(cellCount, 0.f);
+}
+
+//--------------------------------------------------------------------------
+
+QueryService::~QueryService()
+{
+	// running jobs write to members of the service
+	if (m_pathJob)
+		m_jobs.wait(m_pathJob);
+	if (m_cellJob)
+		m_jobs.wait(m_cellJob);
+}
+
+//--------------------------------------------------------------------------
+
+std::shared_ptr<const PathResult> QueryService::requestPath(sf::Vector2i startPos, sf::Vector2i targetPos, unsigned int unitSize)
+{
+	PathQuery query;
+	query.request.startPos = startPos;
+	query.request.targetPos = targetPos;
+	query.request.unitSize = unitSize;
+	query.request.epsilon = PATH_EPSILON;
+	query.request.maxExpanded = MAX_EXPANDED;
+	query.result = std::make_shared<PathResult>();
+	m_pendingPaths.push_back(query);
+	return query.result;
+}
+
+//--------------------------------------------------------------------------
+
+std::shared_ptr<const CellResult> QueryService::requestCell(uint8_t player, InfluenceGoal goal, sf::Vector2i origin)
+{
+	CellQuery query{ player, goal, origin, std::make_shared<CellResult>() };
+	m_pendingCells.push_back(query);
+	return query.result;
+}
+
+//--------------------------------------------------------------------------
+
+void QueryService::update(ecs::Simulation & simulation)
+{
+	if (m_pathJob && m_pathJob->finished)
+	{
+		const auto & paths = m_pathing.getResults();
+		for (std::size_t i = 0; i < m_runningPaths.size(); ++i)
+		{
+			m_runningPaths[i].result->path = paths[i];
+			m_runningPaths[i].result->ready = true;
+		}
+		m_runningPaths.clear();
+		m_pathJob.reset();
+		m_snapshot.reset();
+	}
+
+	if (m_cellJob && m_cellJob->finished)
+	{
+		for (std::size_t i = 0; i < m_runningCells.size(); ++i)
+			*m_runningCells[i].result = m_cellResults[i];
+		m_runningCells.clear();
+		m_cellJob.reset();
+		m_cellSnapshot.reset();
+	}
+
+	// queries whose results were already dropped by tasks aren't started at all
+	if (!m_pathJob)
+	{
+		std::vector<PathingBatch::Request> requests;
+		while (!m_pendingPaths.empty() && m_runningPaths.size() < MAX_BATCH_PATHS)
+		{
+			if (m_pendingPaths.front().result.use_count() > 1)
+			{
+				requests.push_back(m_pendingPaths.front().request);
+				m_runningPaths.push_back(m_pendingPaths.front());
+			}
+			m_pendingPaths.pop_front();
+		}
+
+		if (!requests.empty())
+		{
+			m_snapshot = m_grid.snapshot();
+			m_pathing.setGridView(m_snapshot.get());
+			m_pathJob = m_pathing.run(std::move(requests), true);
+		}
+	}
+
+	if (!m_cellJob)
+	{
+		while (!m_pendingCells.empty())
+		{
+			if (m_pendingCells.front().result.use_count() > 1)
+				m_runningCells.push_back(m_pendingCells.front());
+			m_pendingCells.pop_front();
+		}
+
+		if (!m_runningCells.empty())
+		{
+			copyInfluence(simulation.getInfluence());
+			m_cellSnapshot = m_grid.snapshot();
+			m_cellResults.resize(m_runningCells.size());
+			m_cellJob = m_jobs.scheduleBackground([this]()
+			{
+				for (std::size_t i = 0; i < m_runningCells.size(); ++i)
+					m_cellResults[i] = searchCell(m_runningCells[i]);
+			});
+		}
+	}
+
+	// without worker threads jobs are executed only by wait()
+	if (m_jobs.getQueueCount() == 1u)
+	{
+		if (m_pathJob)
+			m_jobs.wait(m_pathJob);
+		if (m_cellJob)
+			m_jobs.wait(m_cellJob);
+	}
+}
+
+//--------------------------------------------------------------------------
+
+void QueryService::copyInfluence(const ecs::InfluenceMap & influence)
+{
+	if (influence.getUpdateCount() == m_influenceUpdate)
+		return;
+
+	m_influenceUpdate = influence.getUpdateCount();
+	for (unsigned int layer = 0; layer < ecs::InfluenceMap::LAYER_COUNT; ++layer)
+		m_layers[layer] = influence.getLayer(layer);
+	m_total = influence.getTotalStrength();
+}
+
+//--------------------------------------------------------------------------
+
+CellResult QueryService::searchCell(const CellQuery & query) const
+{
+	CellResult best;
+	best.ready = true;
+
+	const std::vector<float> & own = m_layers[query.player];
+	const std::vector<float> & resources = m_layers[ecs::InfluenceMap::RESOURCE_LAYER];
+	sf::Vector2i originCell(query.origin.x / ecs::InfluenceMap::CELL_SIZE, query.origin.y / ecs::InfluenceMap::CELL_SIZE);
+	const GridView & grid = *m_cellSnapshot;
+
+	for (int y = 0; y < m_cellGridSize.y; ++y)
+	{
+		for (int x = 0; x < m_cellGridSize.x; ++x)
+		{
+			std::size_t cell = static_cast<std::size_t>(y*m_cellGridSize.x + x);
+			float threat = m_total[cell] - own[cell];
+
+			float score = 0.f;
+			bool matches = false;
+			switch (query.goal)
+			{
+			case InfluenceGoal::RESOURCES:
+				matches = resources[cell] > 0.f;
+				score = resources[cell] - threat;
+				break;
+			case InfluenceGoal::ENEMY:
+				matches = threat > 0.f;
+				score = threat;
+				break;
+			case InfluenceGoal::SAFETY:
+				matches = own[cell] > 0.f;
+				score = own[cell] - threat;
+				break;
+			}
+			if (!matches)
+				continue;
+
+			int distance = std::max(std::abs(x - originCell.x), std::abs(y - originCell.y));
+			score -= DISTANCE_WEIGHT*static_cast<float>(distance);
+			if (best.found && score <= best.score)
+				continue;
+
+			// targets must be free, otherwise path search would explore everything around them
+			sf::Vector2i tile;
+			if (findFreeTile(grid, sf::Vector2i(x, y), tile))
+			{
+				best.found = true;
+				best.score = score;
+				best.tile = tile;
+			}
+		}
+	}
+	return best;
+}
+
+//--------------------------------------------------------------------------
+
+bool QueryService::findFreeTile(const GridView & grid, sf::Vector2i cell, sf::Vector2i & tile)
+{
+	const int size = ecs::InfluenceMap::CELL_SIZE;
+	sf::Vector2i gridSize = grid.getGridSize();
+	int bestDistance = 0;
+	bool found = false;
+	for (int y = cell.y*size; y < std::min((cell.y + 1)*size, gridSize.y); ++y)
+	{
+		for (int x = cell.x*size; x < std::min((cell.x + 1)*size, gridSize.x); ++x)
+		{
+			// doubled distance from the center of the cell, which lies between tiles
+			int distance = std::abs(2*(x - cell.x*size) + 1 - size) + std::abs(2*(y - cell.y*size) + 1 - size);
+			if ((!found || distance < bestDistance) && !grid.isBlocked(grid.getIndex(x, y)))
+			{
+				found = true;
+				bestDistance = distance;
+				tile = sf::Vector2i(x, y);
+			}
+		}
+	}
+	return found;
+}
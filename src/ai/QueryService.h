@@ -0,0 +1,186 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <SFML/Graphics.hpp>
+
+//--------------------------------------------------------------------------
+
+#include "../ecs/Simulation.h"
+#include "../ecs/InfluenceMap.h"
+#include "../logic/Grid.h"
+#include "../logic/JobSystem.h"
+#include "../logic/PathingBatch.h"
+
+//--------------------------------------------------------------------------
+
+namespace ai
+{
+	/*!
+	* \brief Result of path query, path is valid when ready is true
+	*/
+	struct PathResult
+	{
+		bool ready{ false };					///< query is finished
+		std::vector<sf::Vector2i> path;			///< found path ordered from target to start, empty if target can't be reached
+	};
+
+	/*!
+	* \brief What is searched by cell query
+	*/
+	enum class InfluenceGoal : uint8_t
+	{
+		RESOURCES,		///< the most resources with the lowest threat
+		ENEMY,			///< the strongest concentration of enemies
+		SAFETY,			///< the most controlled cell
+	};
+
+	/*!
+	* \brief Result of cell query, tile and score are valid when ready and found are true
+	*/
+	struct CellResult
+	{
+		bool ready{ false };		///< query is finished
+		bool found{ false };		///< some cell matches the goal
+		sf::Vector2i tile;			///< free tile of the best cell, the closest one to its center
+		float score{ 0.f };			///< value of the goal in the best cell
+	};
+
+	//--------------------------------------------------------------------------
+
+	/*!
+	* \brief Asynchronous expensive queries of computer players
+	*
+	* Queries are collected during the tick and started in update() as one path batch and one influence job, both run as
+	* background jobs on data which can't change under them: paths are searched on GridSnapshot and cells are searched in
+	* a copy of influence layers taken when the map changes. Background jobs are executed only by workers, so they never
+	* delay the main thread, and path searches are limited to MAX_EXPANDED tiles. Results are written to returned objects
+	* only by update(), so tasks read them without locks. Query which is requested while previous batch runs waits for
+	* the next batch.
+	*
+	* Usage example:
+	* \code
+	* auto path = queries.requestPath(start, target);
+	* ...
+	* if (path->ready)
+	*     ;	// use path->path
+	* \endcode
+	*
+	*/
+	class QueryService
+	{
+	public:
+		static constexpr std::size_t MAX_BATCH_PATHS = 16;		///< path searches started together
+		static constexpr unsigned int MAX_EXPANDED = 8192u;		///< tiles expanded by one search, farther targets are unreachable
+		static constexpr float PATH_EPSILON = 1.5f;				///< weight of heuristic, paths of computer players needn't be the best
+		static constexpr float DISTANCE_WEIGHT = 0.05f;			///< score lost by every cell of distance from origin of cell query
+
+		QueryService(Grid & grid, logic::JobSystem & jobs);
+		~QueryService();
+
+		QueryService(const QueryService &) = delete;
+		QueryService & operator=(const QueryService &) = delete;
+
+		/*!
+		* \brief Request path of unit of given size between two tiles
+		*/
+		std::shared_ptr<const PathResult> requestPath(sf::Vector2i startPos, sf::Vector2i targetPos, unsigned int unitSize = 1u);
+
+		/*!
+		* \brief Request the best cell of influence map for the player, cells far from origin have lower score
+		*/
+		std::shared_ptr<const CellResult> requestCell(uint8_t player, InfluenceGoal goal, sf::Vector2i origin);
+
+		/*!
+		* \brief Publish results of finished jobs and start new jobs with pending queries
+		*
+		* Without worker threads jobs are executed here, on calling thread, so they are counted to time of the caller.
+		*
+		*/
+		void update(ecs::Simulation & simulation);
+
+		inline std::size_t getPendingPaths() const { return m_pendingPaths.size(); }
+		inline std::size_t getPendingCells() const { return m_pendingCells.size(); }
+
+	private:
+		/*!
+		* \brief Queued path query
+		*/
+		struct PathQuery
+		{
+			PathingBatch::Request request;
+			std::shared_ptr<PathResult> result;
+		};
+
+		/*!
+		* \brief Queued cell query
+		*/
+		struct CellQuery
+		{
+			uint8_t player;
+			InfluenceGoal goal;
+			sf::Vector2i origin;
+			std::shared_ptr<CellResult> result;
+		};
+
+		/*!
+		* \brief Copy layers of influence map if it was updated since the last copy
+		*/
+		void copyInfluence(const ecs::InfluenceMap & influence);
+
+		/*!
+		* \brief Search the best cell for the query in copied layers, called by job
+		*/
+		CellResult searchCell(const CellQuery & query) const;
+
+		/*!
+		* \brief Find free tile of the cell closest to its center
+		*
+		* \return False if all tiles of the cell are blocked
+		*
+		*/
+		static bool findFreeTile(const GridView & grid, sf::Vector2i cell, sf::Vector2i & tile);
+
+	private:
+		Grid & m_grid;										///< grid of the game, only its snapshots are read by jobs
+		logic::JobSystem & m_jobs;							///< runs all queries
+
+		PathingBatch m_pathing;								///< searches paths of the running batch
+		std::shared_ptr<const GridSnapshot> m_snapshot;		///< grid read by the running batch
+		std::deque<PathQuery> m_pendingPaths;				///< paths waiting for the next batch
+		std::vector<PathQuery> m_runningPaths;				///< paths of the running batch
+		logic::JobHandle m_pathJob;							///< job of the running batch
+
+		sf::Vector2i m_cellGridSize;						///< size of influence layers
+		std::vector<float> m_layers[ecs::InfluenceMap::LAYER_COUNT];	///< copy of layers of influence map
+		std::vector<float> m_total;							///< copy of total strength of all players
+		uint32_t m_influenceUpdate{ 0u };					///< update count of influence map when layers were copied
+		std::deque<CellQuery> m_pendingCells;				///< cell queries waiting for the next job
+		std::vector<CellQuery> m_runningCells;				///< cell queries of the running job
+		std::vector<CellResult> m_cellResults;				///< results written by the running job
+		std::shared_ptr<const GridSnapshot> m_cellSnapshot;	///< grid read by the running job of cell queries
+		logic::JobHandle m_cellJob;							///< running job of cell queries
+	};
+}
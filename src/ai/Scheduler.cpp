@@ -0,0 +1,147 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//--------------------------------------------------------------------------
+
+#include "Scheduler.h"
+#include "Tasks.h"
+
+//--------------------------------------------------------------------------
+
+#include <algorithm>
+
+//--------------------------------------------------------------------------
+
+using namespace ai;
+
+//--------------------------------------------------------------------------
+
+constexpr sf::Int64 Scheduler::DEFAULT_BUDGET;
+
+//--------------------------------------------------------------------------
+
+ComputerPlayer::ComputerPlayer(uint8_t player, sf::Vector2i home) :
+	m_player(player)
+{
+	std::vector<BuildOrderTask::Step> order{
+		{ 0u, 6u },
+		{ 30u * SIMULATION_RATE, 12u },
+		{ 90u * SIMULATION_RATE, 24u },
+		{ 180u * SIMULATION_RATE, 40u },
+	};
+	addTask(std::make_unique<BuildOrderTask>(home, std::move(order)));
+	addTask(std::make_unique<EconomyTask>(home));
+	addTask(std::make_unique<ArmyTask>());
+}
+
+//--------------------------------------------------------------------------
+
+void ComputerPlayer::addTask(std::unique_ptr<Task> task)
+{
+	m_tasks.push_back(std::move(task));
+	m_runnable.push_back(false);
+}
+
+//--------------------------------------------------------------------------
+
+unsigned int ComputerPlayer::run(Context & context, const sf::Clock & clock, sf::Time deadline)
+{
+	std::size_t runnable = 0u;
+	for (std::size_t i = 0; i < m_tasks.size(); ++i)
+	{
+		m_runnable[i] = m_tasks[i]->getWakeTick() <= context.tick;
+		runnable += m_runnable[i] ? 1u : 0u;
+	}
+
+	unsigned int resumes = 0u;
+	while (runnable > 0u && clock.getElapsedTime() < deadline)
+	{
+		if (m_next >= m_tasks.size())
+			m_next = 0u;
+		if (!m_runnable[m_next])
+		{
+			++m_next;
+			continue;
+		}
+
+		Task::Status status = m_tasks[m_next]->resume(context);
+		++resumes;
+		if (status == Task::Status::DONE)
+		{
+			// the next task moves to the index of removed one
+			m_tasks.erase(m_tasks.begin() + m_next);
+			m_runnable.erase(m_runnable.begin() + m_next);
+			--runnable;
+			continue;
+		}
+		if (status == Task::Status::WAITING)
+		{
+			m_runnable[m_next] = false;
+			--runnable;
+		}
+		++m_next;
+	}
+	return resumes;
+}
+
+//--------------------------------------------------------------------------
+
+Scheduler::Scheduler(Grid & grid, logic::JobSystem & jobs, sf::Time budget) :
+	m_budget(budget),
+	m_queries(grid, jobs)
+{
+}
+
+//--------------------------------------------------------------------------
+
+ComputerPlayer & Scheduler::addPlayer(uint8_t player, sf::Vector2i home)
+{
+	m_players.push_back(std::make_unique<ComputerPlayer>(player, home));
+	return *m_players.back();
+}
+
+//--------------------------------------------------------------------------
+
+void Scheduler::update(ecs::Simulation & simulation, std::vector<ecs::Command> & commands)
+{
+	sf::Clock clock;
+	std::size_t count = m_players.size();
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		sf::Time left = m_budget - clock.getElapsedTime();
+		if (left <= sf::Time::Zero)
+			break;
+
+		// every player gets equal part of time left, so time not used by previous players is shared by following ones
+		ComputerPlayer & player = *m_players[(m_firstPlayer + i) % count];
+		Context context{ player.getPlayer(), simulation.getTick(), simulation, m_queries, commands };
+		m_statistics.resumes += player.run(context, clock, clock.getElapsedTime() + left / static_cast<sf::Int64>(count - i));
+	}
+	if (count > 0u)
+		m_firstPlayer = (m_firstPlayer + 1u) % count;
+
+	// queries requested in this tick are started now and run while the frame is rendered
+	m_queries.update(simulation);
+
+	sf::Time time = clock.getElapsedTime();
+	++m_statistics.ticks;
+	m_statistics.overruns += time > m_budget ? 1u : 0u;
+	m_statistics.lastTime = time;
+	m_statistics.maxTime = std::max(m_statistics.maxTime, time);
+	m_statistics.totalTime += time;
+}
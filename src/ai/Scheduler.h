@@ -0,0 +1,148 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <SFML/System.hpp>
+
+//--------------------------------------------------------------------------
+
+#include "Task.h"
+#include "QueryService.h"
+#include "../ecs/Simulation.h"
+#include "../logic/JobSystem.h"
+
+//--------------------------------------------------------------------------
+
+namespace ai
+{
+	/*!
+	* \brief Tasks of one computer player
+	*/
+	class ComputerPlayer
+	{
+	public:
+		/*!
+		* \brief Create player with standard tasks: build order, economy and army control
+		*
+		* \param player Id of the player in simulation
+		* \param home Tile around which units are created
+		*
+		*/
+		ComputerPlayer(uint8_t player, sf::Vector2i home);
+
+		void addTask(std::unique_ptr<Task> task);
+
+		/*!
+		* \brief Resume tasks in round robin until all of them wait or the clock reaches deadline
+		*
+		* Task which was next when the deadline stopped the player is the first one in the next tick.
+		*
+		* \return Amount of resume() calls
+		*
+		*/
+		unsigned int run(Context & context, const sf::Clock & clock, sf::Time deadline);
+
+		inline uint8_t getPlayer() const { return m_player; }
+		inline std::size_t getTaskCount() const { return m_tasks.size(); }
+
+	private:
+		uint8_t m_player;								///< id of the player in simulation
+		std::vector<std::unique_ptr<Task>> m_tasks;		///< all unfinished tasks
+		std::vector<bool> m_runnable;					///< task can be resumed in current tick
+		std::size_t m_next{ 0u };						///< task resumed first
+	};
+
+	//--------------------------------------------------------------------------
+
+	/*!
+	* \brief Runs computer players within fixed time budget of every tick
+	*
+	* Budget is shared by all players: every player gets equal part of time which is left, so time not used by one player
+	* is used by the following ones, and the player who starts is rotated every tick. Tasks are resumed one piece at a time
+	* and stop when the part is spent, so amount of players doesn't change the time taken by one tick, it only makes
+	* their decisions slower. Commands issued by tasks are returned to caller, which sends them to lockstep.
+	*
+	* Usage example:
+	* \code
+	* ai::Scheduler scheduler(grid, jobs);
+	* scheduler.addPlayer(1u, home);
+	* ...
+	* simulation.step(jobs);
+	* scheduler.update(simulation, commands);
+	* \endcode
+	*
+	*/
+	class Scheduler
+	{
+	public:
+		static constexpr sf::Int64 DEFAULT_BUDGET = 1000;		///< microseconds per tick used by all players together
+
+		/*!
+		* \brief Statistics of time spent by computer players
+		*/
+		struct Statistics
+		{
+			unsigned int ticks{ 0u };		///< amount of update() calls
+			unsigned int resumes{ 0u };		///< amount of resumed tasks
+			unsigned int overruns{ 0u };	///< amount of ticks which took longer than budget
+			sf::Time lastTime;				///< time of the last update()
+			sf::Time maxTime;				///< the longest update()
+			sf::Time totalTime;				///< time of all updates
+		};
+
+		/*!
+		* \brief Default constructor
+		*
+		* \param grid Map of the game, it must outlive scheduler
+		* \param jobs Job system which runs queries
+		* \param budget Time of all players in one tick
+		*
+		*/
+		Scheduler(Grid & grid, logic::JobSystem & jobs, sf::Time budget = sf::microseconds(DEFAULT_BUDGET));
+
+		/*!
+		* \brief Add computer player with standard tasks
+		*/
+		ComputerPlayer & addPlayer(uint8_t player, sf::Vector2i home);
+
+		/*!
+		* \brief Run players for one tick, called after the tick was simulated
+		*
+		* \param commands Commands issued by players are appended here
+		*
+		*/
+		void update(ecs::Simulation & simulation, std::vector<ecs::Command> & commands);
+
+		inline const Statistics & getStatistics() const { return m_statistics; }
+		inline sf::Time getBudget() const { return m_budget; }
+		inline QueryService & getQueries() { return m_queries; }
+
+	private:
+		sf::Time m_budget;											///< time of all players in one tick
+		QueryService m_queries;										///< expensive queries of all players
+		std::vector<std::unique_ptr<ComputerPlayer>> m_players;	///< all computer players
+		std::size_t m_firstPlayer{ 0u };							///< player who starts the next tick
+		Statistics m_statistics;
+	};
+}
@@ -0,0 +1,95 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <vector>
+#include <cstdint>
+
+//--------------------------------------------------------------------------
+
+#include "../ecs/Simulation.h"
+
+//--------------------------------------------------------------------------
+
+namespace ai
+{
+	class QueryService;
+
+	/*!
+	* \brief Everything what task of computer player can read and change
+	*/
+	struct Context
+	{
+		uint8_t player;								///< computer player who runs the task
+		uint32_t tick;								///< current tick of the simulation
+		ecs::Simulation & simulation;				///< simulation, tasks only read it
+		QueryService & queries;						///< asynchronous path and influence queries
+		std::vector<ecs::Command> & commands;		///< commands issued by tasks, they are executed by lockstep
+	};
+
+	//--------------------------------------------------------------------------
+
+	/*!
+	* \brief Resumable part of logic of computer player
+	*
+	* Task is a state machine which does a small bounded piece of work in every resume() call and keeps its progress in
+	* members, so scheduler can stop it after any call when time budget of the tick is spent and continue in the next
+	* tick. Nothing expensive is computed inside resume(): paths and influence searches are requested from QueryService
+	* and the task waits for results in following resumes.
+	*
+	*/
+	class Task
+	{
+	public:
+		/*!
+		* \brief Result of resume() call
+		*/
+		enum class Status
+		{
+			RUNNING,		///< task has more work, it can be resumed again in the same tick
+			WAITING,		///< task waits for query or sleeps, it's resumed in the next tick or after wake tick
+			DONE,			///< task is finished and removed
+		};
+
+		virtual ~Task() = default;
+
+		/*!
+		* \brief Do next piece of work
+		*/
+		virtual Status resume(Context & context) = 0;
+
+		/*!
+		* \brief Name of the task used in statistics
+		*/
+		virtual const char * getName() const = 0;
+
+		inline uint32_t getWakeTick() const { return m_wakeTick; }
+
+	protected:
+		/*!
+		* \brief Don't resume the task for given amount of ticks, used together with returned Status::WAITING
+		*/
+		inline void sleep(const Context & context, uint32_t ticks) { m_wakeTick = context.tick + ticks; }
+
+	private:
+		uint32_t m_wakeTick{ 0u };		///< task isn't resumed before this tick
+	};
+}
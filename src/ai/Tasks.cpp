@@ -0,0 +1,300 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//--------------------------------------------------------------------------
+
+#include "Tasks.h"
+
+//--------------------------------------------------------------------------
+
+#include <cstdlib>
+#include <algorithm>
+
+//--------------------------------------------------------------------------
+
+using namespace ai;
+
+//--------------------------------------------------------------------------
+
+constexpr uint32_t BuildOrderTask::PRODUCTION_TICKS;
+constexpr uint32_t BuildOrderTask::CHECK_TICKS;
+constexpr unsigned int BuildOrderTask::TILES_PER_RESUME;
+constexpr int BuildOrderTask::MAX_RING;
+constexpr uint32_t EconomyTask::WORKER_RATIO;
+constexpr uint32_t EconomyTask::INTERVAL_TICKS;
+constexpr int EconomyTask::ARRIVED_DISTANCE;
+constexpr uint32_t ArmyTask::INTERVAL_TICKS;
+constexpr unsigned int ArmyTask::MIN_ARMY;
+constexpr float ArmyTask::RETREAT_RATIO;
+
+//--------------------------------------------------------------------------
+
+namespace
+{
+	inline bool isWorker(ecs::Entity entity)
+	{
+		return entity.index % EconomyTask::WORKER_RATIO == 0u;
+	}
+
+	inline sf::Vector2i toTile(const ecs::Position & position)
+	{
+		return sf::Vector2i(static_cast<int>(position.x), static_cast<int>(position.y));
+	}
+
+	inline int distance(sf::Vector2i first, sf::Vector2i second)
+	{
+		return std::max(std::abs(first.x - second.x), std::abs(first.y - second.y));
+	}
+
+	/*!
+	* \brief Issue move command of the player
+	*/
+	void issueMove(Context & context, sf::Vector2i target, const std::vector<ecs::Entity> & entities)
+	{
+		ecs::Command command;
+		command.type = ecs::Command::Type::MOVE;
+		command.player = context.player;
+		command.target = target;
+		command.entities = entities;
+		context.commands.push_back(std::move(command));
+	}
+}
+
+//--------------------------------------------------------------------------
+
+BuildOrderTask::BuildOrderTask(sf::Vector2i home, std::vector<Step> order) :
+	m_home(home),
+	m_order(std::move(order))
+{
+}
+
+//--------------------------------------------------------------------------
+
+Task::Status BuildOrderTask::resume(Context & context)
+{
+	if (m_stage == Stage::COUNT)
+	{
+		unsigned int wanted = 0u;
+		uint32_t nextStep = context.tick + CHECK_TICKS;
+		for (const Step & step : m_order)
+		{
+			if (step.tick <= context.tick)
+				wanted = step.units;
+			else
+				nextStep = std::min(nextStep, step.tick);
+		}
+
+		unsigned int owned = 0u;
+		uint8_t player = context.player;
+		context.simulation.getWorld().forEach<ecs::Owner>([&owned, player](std::size_t count, const ecs::Entity *, ecs::Owner * owner)
+		{
+			for (std::size_t i = 0; i < count; ++i)
+				owned += owner[i].player == player ? 1u : 0u;
+		});
+
+		if (owned >= wanted)
+		{
+			sleep(context, nextStep - context.tick);
+			return Status::WAITING;
+		}
+		m_stage = Stage::PLACE;
+		return Status::RUNNING;
+	}
+
+	const Grid & grid = context.simulation.getGrid();
+	sf::Vector2i gridSize = grid.getGridSize();
+	for (unsigned int i = 0; i < TILES_PER_RESUME; ++i)
+	{
+		sf::Vector2i tile = m_home;
+		if (m_ring > 0)
+		{
+			int side = m_ringTile / (2*m_ring);
+			int offset = m_ringTile % (2*m_ring);
+			switch (side)
+			{
+			case 0: tile += sf::Vector2i(-m_ring + offset, -m_ring); break;
+			case 1: tile += sf::Vector2i(m_ring, -m_ring + offset); break;
+			case 2: tile += sf::Vector2i(m_ring - offset, m_ring); break;
+			default: tile += sf::Vector2i(-m_ring, m_ring - offset); break;
+			}
+		}
+		nextTile();
+
+		if (tile.x >= 0 && tile.y >= 0 && tile.x < gridSize.x && tile.y < gridSize.y && !grid.isBlocked(grid.getIndex(tile.x, tile.y)))
+		{
+			ecs::Command command;
+			command.type = ecs::Command::Type::CREATE_UNIT;
+			command.player = context.player;
+			command.target = tile;
+			context.commands.push_back(std::move(command));
+
+			m_stage = Stage::COUNT;
+			sleep(context, PRODUCTION_TICKS);
+			return Status::WAITING;
+		}
+
+		// search wrapped around without finding free tile, all rings are probably occupied
+		if (m_ring == 0)
+		{
+			m_stage = Stage::COUNT;
+			sleep(context, CHECK_TICKS);
+			return Status::WAITING;
+		}
+	}
+	return Status::RUNNING;
+}
+
+//--------------------------------------------------------------------------
+
+void BuildOrderTask::nextTile()
+{
+	if (++m_ringTile >= std::max(1, 8*m_ring))
+	{
+		m_ringTile = 0;
+		m_ring = m_ring == MAX_RING ? 0 : m_ring + 1;
+	}
+}
+
+//--------------------------------------------------------------------------
+
+EconomyTask::EconomyTask(sf::Vector2i home) :
+	m_home(home)
+{
+}
+
+//--------------------------------------------------------------------------
+
+Task::Status EconomyTask::resume(Context & context)
+{
+	switch (m_stage)
+	{
+	case Stage::REQUEST:
+		m_target = context.queries.requestCell(context.player, InfluenceGoal::RESOURCES, m_home);
+		m_stage = Stage::TARGET;
+		return Status::WAITING;
+
+	case Stage::TARGET:
+	{
+		if (!m_target->ready)
+			return Status::WAITING;
+
+		m_workers.clear();
+		sf::Vector2i start;
+		if (m_target->found)
+		{
+			uint8_t player = context.player;
+			sf::Vector2i target = m_target->tile;
+			context.simulation.getWorld().forEach<ecs::Owner, ecs::Position, ecs::PathCursor>([this, player, target, &start](std::size_t count,
+				const ecs::Entity * entities, ecs::Owner * owner, ecs::Position * position, ecs::PathCursor * cursor)
+			{
+				for (std::size_t i = 0; i < count; ++i)
+				{
+					if (owner[i].player != player || !isWorker(entities[i]) || cursor[i].path.isValid() ||
+						distance(toTile(position[i]), target) < ARRIVED_DISTANCE)
+						continue;
+					if (m_workers.empty())
+						start = toTile(position[i]);
+					m_workers.push_back(entities[i]);
+				}
+			});
+		}
+		if (m_workers.empty())
+			break;
+
+		m_path = context.queries.requestPath(start, m_target->tile);
+		m_stage = Stage::PATH;
+		return Status::WAITING;
+	}
+
+	case Stage::PATH:
+		if (!m_path->ready)
+			return Status::WAITING;
+		if (!m_path->path.empty())
+			issueMove(context, m_target->tile, m_workers);
+		break;
+	}
+
+	m_stage = Stage::REQUEST;
+	m_target.reset();
+	m_path.reset();
+	sleep(context, INTERVAL_TICKS);
+	return Status::WAITING;
+}
+
+//--------------------------------------------------------------------------
+
+Task::Status ArmyTask::resume(Context & context)
+{
+	switch (m_stage)
+	{
+	case Stage::GATHER:
+	{
+		m_army.clear();
+		uint8_t player = context.player;
+		context.simulation.getWorld().forEach<ecs::Owner, ecs::Position>([this, player](std::size_t count, const ecs::Entity * entities,
+			ecs::Owner * owner, ecs::Position * position)
+		{
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				if (owner[i].player != player || isWorker(entities[i]))
+					continue;
+				if (m_army.empty())
+					m_leader = toTile(position[i]);
+				m_army.push_back(entities[i]);
+			}
+		});
+		if (m_army.size() < MIN_ARMY)
+			break;
+
+		m_retreat = false;
+		m_target = context.queries.requestCell(context.player, InfluenceGoal::ENEMY, m_leader);
+		m_stage = Stage::TARGET;
+		return Status::WAITING;
+	}
+
+	case Stage::TARGET:
+		if (!m_target->ready)
+			return Status::WAITING;
+		if (!m_target->found)
+			break;
+
+		if (!m_retreat && m_target->score > RETREAT_RATIO*static_cast<float>(m_army.size()))
+		{
+			m_retreat = true;
+			m_target = context.queries.requestCell(context.player, InfluenceGoal::SAFETY, m_leader);
+			return Status::WAITING;
+		}
+
+		m_path = context.queries.requestPath(m_leader, m_target->tile);
+		m_stage = Stage::PATH;
+		return Status::WAITING;
+
+	case Stage::PATH:
+		if (!m_path->ready)
+			return Status::WAITING;
+		if (!m_path->path.empty())
+			issueMove(context, m_target->tile, m_army);
+		break;
+	}
+
+	m_stage = Stage::GATHER;
+	m_target.reset();
+	m_path.reset();
+	sleep(context, INTERVAL_TICKS);
+	return Status::WAITING;
+}
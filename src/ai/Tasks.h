@@ -0,0 +1,159 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <SFML/Graphics.hpp>
+
+//--------------------------------------------------------------------------
+
+#include "Task.h"
+#include "QueryService.h"
+
+//--------------------------------------------------------------------------
+
+namespace ai
+{
+	/*!
+	* \brief Creates units near home of the player until amount of units required by build order is reached
+	*
+	* Free tiles are searched on growing square rings around home, at most TILES_PER_RESUME tiles in one resume, and
+	* search continues where the last unit was placed, so units issued before lockstep executes them get different tiles.
+	*
+	*/
+	class BuildOrderTask : public Task
+	{
+	public:
+		static constexpr uint32_t PRODUCTION_TICKS = SIMULATION_RATE;		///< ticks between two created units
+		static constexpr uint32_t CHECK_TICKS = 2u * SIMULATION_RATE;		///< ticks between checks when nothing has to be created
+		static constexpr unsigned int TILES_PER_RESUME = 64u;				///< tiles tested in one resume
+		static constexpr int MAX_RING = 16;									///< the farthest ring around home
+
+		/*!
+		* \brief Step of build order
+		*/
+		struct Step
+		{
+			uint32_t tick;			///< tick from which the step is active
+			unsigned int units;		///< amount of units which player wants to have
+		};
+
+		/*!
+		* \brief Default constructor
+		*
+		* \param home Tile around which units are created
+		* \param order Steps of build order sorted by tick
+		*
+		*/
+		BuildOrderTask(sf::Vector2i home, std::vector<Step> order);
+
+		virtual Status resume(Context & context) override;
+		virtual const char * getName() const override { return "build order"; }
+
+	private:
+		/*!
+		* \brief Move to the next tile of ring search
+		*/
+		void nextTile();
+
+	private:
+		enum class Stage
+		{
+			COUNT,		///< compare amount of units with build order
+			PLACE,		///< search free tile for the new unit
+		};
+
+		Stage m_stage{ Stage::COUNT };
+		sf::Vector2i m_home;			///< center of rings
+		std::vector<Step> m_order;		///< build order
+		int m_ring{ 0 };				///< ring of the next tested tile
+		int m_ringTile{ 0 };			///< index of the next tested tile on the ring
+	};
+
+	//--------------------------------------------------------------------------
+
+	/*!
+	* \brief Sends idle workers to the safest place with resources
+	*
+	* Every WORKER_RATIO-th unit (by entity index) is a worker. Target is searched by influence query and checked by
+	* path query from the first idle worker, so workers aren't sent to unreachable places.
+	*
+	*/
+	class EconomyTask : public Task
+	{
+	public:
+		static constexpr uint32_t WORKER_RATIO = 3u;						///< one of this many units is a worker
+		static constexpr uint32_t INTERVAL_TICKS = 3u * SIMULATION_RATE;	///< ticks between decisions
+		static constexpr int ARRIVED_DISTANCE = 4;							///< workers closer to target than this aren't sent
+
+		EconomyTask(sf::Vector2i home);
+
+		virtual Status resume(Context & context) override;
+		virtual const char * getName() const override { return "economy"; }
+
+	private:
+		enum class Stage
+		{
+			REQUEST,		///< request target cell
+			TARGET,			///< wait for target and request path
+			PATH,			///< wait for path and send workers
+		};
+
+		Stage m_stage{ Stage::REQUEST };
+		sf::Vector2i m_home;							///< origin of target search
+		std::shared_ptr<const CellResult> m_target;		///< queried target
+		std::shared_ptr<const PathResult> m_path;		///< queried path from the first worker to target
+		std::vector<ecs::Entity> m_workers;				///< idle workers sent to target
+	};
+
+	//--------------------------------------------------------------------------
+
+	/*!
+	* \brief Gathers units which aren't workers to army and attacks the strongest enemies or retreats when they are too strong
+	*/
+	class ArmyTask : public Task
+	{
+	public:
+		static constexpr uint32_t INTERVAL_TICKS = 5u * SIMULATION_RATE;	///< ticks between decisions
+		static constexpr unsigned int MIN_ARMY = 6u;						///< smaller army stays at home
+		static constexpr float RETREAT_RATIO = 1.5f;						///< army retreats from enemy stronger than this times army
+
+		virtual Status resume(Context & context) override;
+		virtual const char * getName() const override { return "army"; }
+
+	private:
+		enum class Stage
+		{
+			GATHER,			///< collect army and request enemy cell
+			TARGET,			///< wait for target and request path
+			PATH,			///< wait for path and move army
+		};
+
+		Stage m_stage{ Stage::GATHER };
+		std::vector<ecs::Entity> m_army;				///< units of army
+		sf::Vector2i m_leader;							///< tile of the first unit of army, start of path
+		std::shared_ptr<const CellResult> m_target;		///< queried target
+		std::shared_ptr<const PathResult> m_path;		///< queried path from leader to target
+		bool m_retreat{ false };						///< target is the safest cell instead of enemy
+	};
+}
@@ -0,0 +1,182 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <cassert>
+#include <utility>
+#include <stdexcept>
+
+//--------------------------------------------------------------------------
+
+#include "Components.h"
+
+//--------------------------------------------------------------------------
+
+namespace ecs
+{
+	/*!
+	* \brief Storage of all entities which have the same set of components
+	*
+	* Every component type of the archetype has it's own contiguous column, so systems can iterate over plain arrays.
+	* Row of the entity is the same in all columns. Removed row is filled with the last row, so columns never have holes.
+	*
+	*/
+	class Archetype
+	{
+	public:
+		explicit Archetype(ComponentMask mask) :
+			m_mask{ mask }
+		{
+		}
+
+		inline ComponentMask getMask() const { return m_mask; }
+		inline bool hasAll(ComponentMask mask) const { return (m_mask & mask) == mask; }
+		inline std::size_t size() const { return m_entities.size(); }
+		inline const Entity * entities() const { return m_entities.data(); }
+		inline Entity entity(uint32_t row) const { return m_entities[row]; }
+
+		/*!
+		* \brief Return first element of component column, archetype must contain the component
+		*/
+		template <typename C>
+		inline C * column()
+		{
+			assert(m_mask & componentBit(C::TYPE));
+			return std::get<std::vector<C>>(m_columns).data();
+		}
+
+		/*!
+		* \brief Add row with default components for the entity
+		*
+		* \return Index of added row
+		*
+		*/
+		uint32_t addRow(Entity entity)
+		{
+			forEachColumn([this](auto & column)
+			{
+				using C = typename std::decay_t<decltype(column)>::value_type;
+				if (m_mask & componentBit(C::TYPE))
+					column.emplace_back();
+			});
+			m_entities.push_back(entity);
+			return static_cast<uint32_t>(m_entities.size() - 1);
+		}
+
+		/*!
+		* \brief Remove row by moving the last row into it
+		*
+		* \return Entity which was moved into removed row, invalid handle if removed row was the last one
+		*
+		*/
+		Entity removeRow(uint32_t row)
+		{
+			uint32_t lastRow = static_cast<uint32_t>(m_entities.size() - 1);
+			forEachColumn([this, row, lastRow](auto & column)
+			{
+				using C = typename std::decay_t<decltype(column)>::value_type;
+				if (m_mask & componentBit(C::TYPE))
+				{
+					column[row] = column[lastRow];
+					column.pop_back();
+				}
+			});
+
+			Entity moved;
+			if (row != lastRow)
+			{
+				moved = m_entities[lastRow];
+				m_entities[row] = moved;
+			}
+			m_entities.pop_back();
+			return moved;
+		}
+
+		/*!
+		* \brief Copy all components which exist in both archetypes from row of other archetype
+		*/
+		void copyRow(Archetype & source, uint32_t sourceRow, uint32_t row)
+		{
+			ComponentMask shared = m_mask & source.m_mask;
+			forEachColumn([&source, sourceRow, row, shared](auto & column)
+			{
+				using C = typename std::decay_t<decltype(column)>::value_type;
+				if (shared & componentBit(C::TYPE))
+					column[row] = std::get<std::vector<C>>(source.m_columns)[sourceRow];
+			});
+		}
+
+		/*!
+		* \brief Save or load entities and all columns of the archetype
+		*/
+		template <typename Archive>
+		void serialize(Archive & archive)
+		{
+			archive.array(m_entities);
+			forEachColumn([this, &archive](auto & column)
+			{
+				using C = typename std::decay_t<decltype(column)>::value_type;
+				if (m_mask & componentBit(C::TYPE))
+					archive.array(column);
+			});
+
+			forEachColumn([this](auto & column)
+			{
+				using C = typename std::decay_t<decltype(column)>::value_type;
+				if ((m_mask & componentBit(C::TYPE)) && column.size() != m_entities.size())
+					throw std::runtime_error("Archetype - Loaded column doesn't match amount of entities");
+			});
+		}
+
+		inline void reserve(std::size_t capacity)
+		{
+			forEachColumn([this, capacity](auto & column)
+			{
+				using C = typename std::decay_t<decltype(column)>::value_type;
+				if (m_mask & componentBit(C::TYPE))
+					column.reserve(capacity);
+			});
+			m_entities.reserve(capacity);
+		}
+
+	private:
+		/*!
+		* \brief Call function for every column, also for columns of components which archetype doesn't have
+		*/
+		template <typename F>
+		inline void forEachColumn(F && function)
+		{
+			forEachColumn(function, std::make_index_sequence<std::tuple_size<ComponentColumns>::value>());
+		}
+
+		template <typename F, std::size_t... I>
+		inline void forEachColumn(F & function, std::index_sequence<I...>)
+		{
+			using expand = int[];
+			(void)expand{ 0, (function(std::get<I>(m_columns)), 0)... };
+		}
+
+	private:
+		ComponentMask m_mask;				///< component types stored in archetype
+		std::vector<Entity> m_entities;		///< entity of every row
+		ComponentColumns m_columns;			///< columns of components, only columns from mask are used
+	};
+}
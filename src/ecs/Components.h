@@ -0,0 +1,168 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+//--------------------------------------------------------------------------
+
+#include "../handlers/GenericHandler.h"
+
+//--------------------------------------------------------------------------
+
+namespace ecs
+{
+	using Entity = GenericHandler<20, 12, 1>;		///< handle of entity stored in World
+	using PathHandler = GenericHandler<20, 12, 2>;	///< handle of path followed by entity
+
+	/*!
+	* \brief Id of every component type, used as bit index in ComponentMask
+	*/
+	enum class ComponentType : uint8_t
+	{
+		POSITION,
+		VELOCITY,
+		PATH_CURSOR,
+		HEALTH,
+		OWNER,
+		ANIMATION,
+		PREVIOUS_POSITION,
+		SIGHT,
+		COUNT,
+	};
+
+	using ComponentMask = uint32_t;		///< set of component types, one bit per ComponentType
+
+	static_assert(static_cast<int>(ComponentType::COUNT) <= 32, "ComponentMask can't hold all component types");
+
+	//--------------------------------------------------------------------------
+
+	/*!
+	* \brief Position of the entity in grid coordinates
+	*/
+	struct Position
+	{
+		static constexpr ComponentType TYPE = ComponentType::POSITION;
+		float x{ 0.f };
+		float y{ 0.f };
+	};
+
+	/*!
+	* \brief Velocity of the entity in tiles per second
+	*/
+	struct Velocity
+	{
+		static constexpr ComponentType TYPE = ComponentType::VELOCITY;
+		float x{ 0.f };
+		float y{ 0.f };
+	};
+
+	/*!
+	* \brief Progress of the entity on it's path
+	*
+	* Paths are ordered from target to start like paths returned by PathingSystem, so waypoint counts down to 0.
+	*
+	*/
+	struct PathCursor
+	{
+		static constexpr ComponentType TYPE = ComponentType::PATH_CURSOR;
+		PathHandler path;			///< followed path, invalid if entity doesn't move
+		uint32_t waypoint{ 0u };	///< index of next waypoint
+		float speed{ 0.f };			///< move speed in tiles per second
+	};
+
+	struct Health
+	{
+		static constexpr ComponentType TYPE = ComponentType::HEALTH;
+		int16_t current{ 0 };
+		int16_t max{ 0 };
+	};
+
+	struct Owner
+	{
+		static constexpr ComponentType TYPE = ComponentType::OWNER;
+		uint8_t player{ 0u };
+	};
+
+	struct AnimationState
+	{
+		static constexpr ComponentType TYPE = ComponentType::ANIMATION;
+		uint16_t animation{ 0u };	///< id of played animation
+		uint16_t frame{ 0u };		///< current frame, wrapped by renderer to length of animation
+		float frameTime{ 0.f };		///< time elapsed in current frame in seconds
+	};
+
+	/*!
+	* \brief Position of the entity at the beginning of last simulation step, used to interpolate rendered position
+	*/
+	struct PreviousPosition
+	{
+		static constexpr ComponentType TYPE = ComponentType::PREVIOUS_POSITION;
+		float x{ 0.f };
+		float y{ 0.f };
+	};
+
+	/*!
+	* \brief Sight of the entity, tiles around it are revealed in fog of war of it's owner
+	*/
+	struct Sight
+	{
+		static constexpr ComponentType TYPE = ComponentType::SIGHT;
+		uint32_t radius{ 0u };		///< sight radius in tiles
+		int32_t viewer{ -1 };		///< id of viewer in FogOfWar, negative until FogSystem registers entity
+	};
+
+	// components are saved and hashed as raw bytes, so they can't have padding with undefined content
+	static_assert(sizeof(Sight) == sizeof(uint32_t) + sizeof(int32_t), "Sight can't have padding");
+
+	/*!
+	* \brief Columns of all component types in the same order as ComponentType
+	*/
+	using ComponentColumns = std::tuple<std::vector<Position>, std::vector<Velocity>, std::vector<PathCursor>, std::vector<Health>,
+		std::vector<Owner>, std::vector<AnimationState>, std::vector<PreviousPosition>,
+		std::vector<Sight>>;
+
+	static_assert(std::tuple_size<ComponentColumns>::value == static_cast<std::size_t>(ComponentType::COUNT), "ComponentColumns must hold every component type");
+
+	//--------------------------------------------------------------------------
+
+	/*!
+	* \brief Return mask of one component type
+	*/
+	constexpr ComponentMask componentBit(ComponentType type)
+	{
+		return ComponentMask(1u) << static_cast<uint8_t>(type);
+	}
+
+	/*!
+	* \brief Return mask of all listed component types
+	*/
+	template <typename... C>
+	constexpr ComponentMask componentMask()
+	{
+		ComponentMask mask = 0u;
+		using expand = int[];
+		(void)expand{ 0, (mask |= componentBit(C::TYPE), 0)... };
+		return mask;
+	}
+}
@@ -0,0 +1,326 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//--------------------------------------------------------------------------
+
+#include "InfluenceMap.h"
+
+//--------------------------------------------------------------------------
+
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define INFLUENCE_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+//--------------------------------------------------------------------------
+
+using namespace ecs;
+
+//--------------------------------------------------------------------------
+
+constexpr int InfluenceMap::CELL_SIZE;
+constexpr int InfluenceMap::RADIUS;
+constexpr float InfluenceMap::DECAY;
+constexpr std::size_t InfluenceMap::BAND_ROWS;
+constexpr unsigned int InfluenceMap::RESOURCE_LAYER;
+constexpr unsigned int InfluenceMap::LAYER_COUNT;
+
+//--------------------------------------------------------------------------
+
+namespace
+{
+	constexpr std::size_t TAPS = 2*InfluenceMap::RADIUS + 1;
+
+	/*!
+	* \brief Weighted sum of TAPS rows: out[x] = sum of weights[k]*in[k*tapStride + x]
+	*/
+	void convolveScalar(const float * in, std::size_t tapStride, const float * weights, float * out, std::size_t begin, std::size_t count)
+	{
+		for (std::size_t x = begin; x < count; ++x)
+		{
+			float sum = 0.f;
+			for (std::size_t k = 0; k < TAPS; ++k)
+				sum = sum + weights[k]*in[k*tapStride + x];
+			out[x] = sum;
+		}
+	}
+
+#ifdef INFLUENCE_X86_DISPATCH
+	/*!
+	* \brief convolveScalar() for 4 cells at once
+	*/
+	__attribute__((target("sse2")))
+	void convolveSSE(const float * in, std::size_t tapStride, const float * weights, float * out, std::size_t count)
+	{
+		std::size_t x = 0;
+		for (; x + 4 <= count; x += 4)
+		{
+			__m128 sum = _mm_setzero_ps();
+			for (std::size_t k = 0; k < TAPS; ++k)
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(in + k*tapStride + x)));
+			_mm_storeu_ps(out + x, sum);
+		}
+		convolveScalar(in, tapStride, weights, out, x, count);
+	}
+
+	/*!
+	* \brief convolveScalar() for 8 cells at once
+	*/
+	__attribute__((target("avx")))
+	void convolveAVX(const float * in, std::size_t tapStride, const float * weights, float * out, std::size_t count)
+	{
+		std::size_t x = 0;
+		for (; x + 8 <= count; x += 8)
+		{
+			__m256 sum = _mm256_setzero_ps();
+			for (std::size_t k = 0; k < TAPS; ++k)
+				sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[k]), _mm256_loadu_ps(in + k*tapStride + x)));
+			_mm256_storeu_ps(out + x, sum);
+		}
+		convolveScalar(in, tapStride, weights, out, x, count);
+	}
+
+	const bool hasSSE = __builtin_cpu_supports("sse2");
+	const bool hasAVX = __builtin_cpu_supports("avx");
+#endif
+
+	/*!
+	* \brief Call convolution of selected kernel
+	*/
+	void convolve(InfluenceMap::Kernel kernel, const float * in, std::size_t tapStride, const float * weights, float * out, std::size_t count)
+	{
+		switch (kernel)
+		{
+#ifdef INFLUENCE_X86_DISPATCH
+		case InfluenceMap::Kernel::AVX:
+			convolveAVX(in, tapStride, weights, out, count);
+			break;
+		case InfluenceMap::Kernel::SSE:
+			convolveSSE(in, tapStride, weights, out, count);
+			break;
+#endif
+		default:
+			convolveScalar(in, tapStride, weights, out, 0, count);
+			break;
+		}
+	}
+}
+
+//--------------------------------------------------------------------------
+
+InfluenceMap::InfluenceMap(sf::Vector2i gridSize) :
+	m_kernel{ Kernel::SCALAR },
+	m_cellGridSize{ (gridSize.x + CELL_SIZE - 1) / CELL_SIZE, (gridSize.y + CELL_SIZE - 1) / CELL_SIZE }
+{
+	if (!setKernel(Kernel::AVX))
+		setKernel(Kernel::SSE);
+
+	// weights are computed by multiplication instead of std::pow, so they are the same with every math library
+	m_weights[RADIUS] = 1.f;
+	for (int distance = 1; distance <= RADIUS; ++distance)
+	{
+		m_weights[RADIUS + distance] = m_weights[RADIUS + distance - 1]*DECAY;
+		m_weights[RADIUS - distance] = m_weights[RADIUS + distance];
+	}
+
+	std::size_t width = static_cast<std::size_t>(m_cellGridSize.x);
+	std::size_t height = static_cast<std::size_t>(m_cellGridSize.y);
+	m_sourceStride = width + 2*RADIUS;
+	for (unsigned int layer = 0; layer < LAYER_COUNT; ++layer)
+	{
+		m_sources[layer].assign(m_sourceStride*height, 0.f);
+		m_horizontal[layer].assign(width*(height + 2*RADIUS), 0.f);
+		m_layers[layer].assign(width*height, 0.f);
+		m_active[layer] = false;
+	}
+	m_total.assign(width*height, 0.f);
+	m_blurred.reserve(LAYER_COUNT);
+}
+
+//--------------------------------------------------------------------------
+
+bool InfluenceMap::setKernel(Kernel kernel)
+{
+	bool supported = (kernel == Kernel::SCALAR);
+#ifdef INFLUENCE_X86_DISPATCH
+	supported = supported || (kernel == Kernel::SSE && hasSSE) || (kernel == Kernel::AVX && hasAVX);
+#endif
+	if (supported)
+		m_kernel = kernel;
+	return supported;
+}
+
+//--------------------------------------------------------------------------
+
+void InfluenceMap::update(const GridView & grid, World & world, logic::JobSystem & jobs)
+{
+	bool wasActive[LAYER_COUNT];
+	std::copy(m_active, m_active + LAYER_COUNT, wasActive);
+
+	m_blurred.clear();
+	if (updateResources(grid))
+		m_blurred.push_back(RESOURCE_LAYER);
+
+	gatherUnits(world);
+	for (unsigned int player = 0; player < MAX_PLAYERS; ++player)
+	{
+		if (m_active[player])
+			m_blurred.push_back(player);
+		else if (wasActive[player])
+			std::fill(m_layers[player].begin(), m_layers[player].end(), 0.f);
+	}
+
+	blur(jobs);
+
+	std::fill(m_total.begin(), m_total.end(), 0.f);
+	for (unsigned int player = 0; player < MAX_PLAYERS; ++player)
+	{
+		if (!m_active[player])
+			continue;
+		const float * layer = m_layers[player].data();
+		for (std::size_t cell = 0; cell < m_total.size(); ++cell)
+			m_total[cell] += layer[cell];
+	}
+	++m_updateCount;
+}
+
+//--------------------------------------------------------------------------
+
+bool InfluenceMap::updateResources(const GridView & grid)
+{
+	sf::Vector2i gridSize = grid.getGridSize();
+	sf::Vector2i chunkGridSize = grid.getChunkGridSize();
+	std::size_t chunkCount = static_cast<std::size_t>(chunkGridSize.x*chunkGridSize.y);
+	if (m_chunkVersions.size() != chunkCount)
+	{
+		m_chunkVersions.assign(chunkCount, 0u);
+		m_resourcesCounted = false;
+	}
+
+	bool changed = false;
+	std::vector<float> & sources = m_sources[RESOURCE_LAYER];
+	for (unsigned int chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex)
+	{
+		uint32_t version = grid.getChunkVersion(chunkIndex);
+		if (m_resourcesCounted && m_chunkVersions[chunkIndex] == version)
+			continue;
+		m_chunkVersions[chunkIndex] = version;
+		changed = true;
+
+		// whole cells touching the chunk are counted again, so cells larger than chunk are counted correctly too
+		int chunkX = static_cast<int>(chunkIndex % chunkGridSize.x)*static_cast<int>(CHUNK_SIZE);
+		int chunkY = static_cast<int>(chunkIndex / chunkGridSize.x)*static_cast<int>(CHUNK_SIZE);
+		int endX = std::min(chunkX + static_cast<int>(CHUNK_SIZE), gridSize.x);
+		int endY = std::min(chunkY + static_cast<int>(CHUNK_SIZE), gridSize.y);
+		for (int cellY = chunkY / CELL_SIZE; cellY <= (endY - 1) / CELL_SIZE; ++cellY)
+		{
+			for (int cellX = chunkX / CELL_SIZE; cellX <= (endX - 1) / CELL_SIZE; ++cellX)
+			{
+				int count = 0;
+				int tileEndY = std::min((cellY + 1)*CELL_SIZE, gridSize.y);
+				int tileEndX = std::min((cellX + 1)*CELL_SIZE, gridSize.x);
+				for (int y = cellY*CELL_SIZE; y < tileEndY; ++y)
+				{
+					for (int x = cellX*CELL_SIZE; x < tileEndX; ++x)
+					{
+						if (grid.getObjectType(grid.getIndex(x, y)) == ObjectType::RESOURCE)
+							++count;
+					}
+				}
+				sources[cellY*m_sourceStride + RADIUS + cellX] = static_cast<float>(count);
+			}
+		}
+	}
+
+	m_resourcesCounted = true;
+	m_active[RESOURCE_LAYER] = true;
+	return changed;
+}
+
+//--------------------------------------------------------------------------
+
+void InfluenceMap::gatherUnits(World & world)
+{
+	for (unsigned int player = 0; player < MAX_PLAYERS; ++player)
+	{
+		if (m_active[player])
+			std::fill(m_sources[player].begin(), m_sources[player].end(), 0.f);
+		m_active[player] = false;
+	}
+
+	int lastX = m_cellGridSize.x - 1;
+	int lastY = m_cellGridSize.y - 1;
+	world.forEach<Owner, Position, Health>([this, lastX, lastY](std::size_t count, const Entity *, Owner * owner, Position * position,
+		Health * health)
+	{
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			if (owner[i].player >= MAX_PLAYERS || health[i].max <= 0 || health[i].current <= 0)
+				continue;
+
+			int cellX = std::max(0, std::min(static_cast<int>(position[i].x) / CELL_SIZE, lastX));
+			int cellY = std::max(0, std::min(static_cast<int>(position[i].y) / CELL_SIZE, lastY));
+			m_sources[owner[i].player][cellY*m_sourceStride + RADIUS + cellX] +=
+				static_cast<float>(health[i].current) / static_cast<float>(health[i].max);
+			m_active[owner[i].player] = true;
+		}
+	});
+}
+
+//--------------------------------------------------------------------------
+
+void InfluenceMap::blur(logic::JobSystem & jobs)
+{
+	if (m_blurred.empty())
+		return;
+
+	std::size_t width = static_cast<std::size_t>(m_cellGridSize.x);
+	std::size_t height = static_cast<std::size_t>(m_cellGridSize.y);
+	std::size_t bandCount = (height + BAND_ROWS - 1) / BAND_ROWS;
+	std::size_t taskCount = m_blurred.size()*bandCount;
+
+	// horizontal pass reads padded source rows, vertical pass reads rows of neighbour bands, so it waits for whole first pass
+	auto horizontal = jobs.parallelFor(0, taskCount, 1, [this, width, height, bandCount](std::size_t begin, std::size_t end)
+	{
+		for (std::size_t task = begin; task < end; ++task)
+		{
+			unsigned int layer = m_blurred[task / bandCount];
+			std::size_t firstRow = (task % bandCount)*BAND_ROWS;
+			std::size_t lastRow = std::min(firstRow + BAND_ROWS, height);
+			for (std::size_t row = firstRow; row < lastRow; ++row)
+			{
+				convolve(m_kernel, m_sources[layer].data() + row*m_sourceStride, 1, m_weights,
+					m_horizontal[layer].data() + (row + RADIUS)*width, width);
+			}
+		}
+	});
+	auto vertical = jobs.parallelFor(0, taskCount, 1, [this, width, height, bandCount](std::size_t begin, std::size_t end)
+	{
+		for (std::size_t task = begin; task < end; ++task)
+		{
+			unsigned int layer = m_blurred[task / bandCount];
+			std::size_t firstRow = (task % bandCount)*BAND_ROWS;
+			std::size_t lastRow = std::min(firstRow + BAND_ROWS, height);
+			for (std::size_t row = firstRow; row < lastRow; ++row)
+				convolve(m_kernel, m_horizontal[layer].data() + row*width, width, m_weights, m_layers[layer].data() + row*width, width);
+		}
+	}, { horizontal });
+	jobs.wait(vertical);
+}
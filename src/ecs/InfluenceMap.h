@@ -0,0 +1,181 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <SFML/Graphics.hpp>
+
+//--------------------------------------------------------------------------
+
+#include "World.h"
+#include "../logic/Grid.h"
+#include "../logic/JobSystem.h"
+
+//--------------------------------------------------------------------------
+
+namespace ecs
+{
+	/*!
+	* \brief Influence layers of the map used by AI opponents
+	*
+	* Map is divided into square cells of CELL_SIZE tiles. Every player has a strength layer: health fraction of every
+	* unit of the player is added to the cell of the unit and spread to RADIUS cells around with weight DECAY^distance.
+	* Resource layer spreads amount of RESOURCE tiles the same way. Threat and territory of the player are derived
+	* from strength layers, so every query is a constant time lookup and AI doesn't have to scan units.
+	*
+	* The spread is separable blur: horizontal pass and vertical pass, both computed as sum of weighted whole rows, so
+	* they are vectorized along rows and every band of rows is a separate job. Every kernel (scalar, SSE, AVX) performs
+	* the same IEEE operations in the same order, so layers are bit identical on every machine and AI decisions based on
+	* them don't break determinism of the simulation.
+	*
+	* Usage example:
+	* \code
+	* ecs::InfluenceMap influence(grid.getGridSize());
+	* influence.update(grid, world, jobs);
+	* float threat = influence.getThreat(player, tile);
+	* \endcode
+	*
+	*/
+	class InfluenceMap
+	{
+	public:
+		static constexpr int CELL_SIZE = 4;					///< size of cell side in tiles
+		static constexpr int RADIUS = 4;					///< distance in cells to which influence is spread
+		static constexpr float DECAY = 0.7f;				///< influence multiplier of every cell of distance
+		static constexpr std::size_t BAND_ROWS = 16;		///< rows of cells blurred by one job
+		static constexpr unsigned int RESOURCE_LAYER = MAX_PLAYERS;	///< index of resource layer, layers below are strength of players
+		static constexpr unsigned int LAYER_COUNT = MAX_PLAYERS + 1;
+
+		/*!
+		* \brief Id of implementation of the blur kernel
+		*/
+		enum class Kernel
+		{
+			SCALAR,
+			SSE,
+			AVX,
+		};
+
+		/*!
+		* \brief Default constructor, the fastest kernel supported by processor is selected
+		*
+		* \param gridSize Size of the map in tiles
+		*
+		*/
+		InfluenceMap(sf::Vector2i gridSize);
+
+		/*!
+		* \brief Recompute all layers
+		*
+		* Strength layers are recomputed from current units, resource layer only if version of some chunk has changed.
+		*
+		*/
+		void update(const GridView & grid, World & world, logic::JobSystem & jobs);
+
+		/*!
+		* \brief Select kernel, used to compare results of different kernels
+		*
+		* \return False if kernel is not supported by processor, selected kernel is not changed then
+		*
+		*/
+		bool setKernel(Kernel kernel);
+		inline Kernel getKernel() const { return m_kernel; }
+
+		/*!
+		* \brief Strength of units of the player around the tile
+		*/
+		inline float getStrength(unsigned int player, sf::Vector2i tile) const { return m_layers[player][getCellIndex(tile)]; }
+
+		/*!
+		* \brief Strength of units of all other players around the tile
+		*/
+		inline float getThreat(unsigned int player, sf::Vector2i tile) const
+		{
+			std::size_t cell = getCellIndex(tile);
+			return m_total[cell] - m_layers[player][cell];
+		}
+
+		/*!
+		* \brief Difference between strength of the player and threat, positive values mean the tile is controlled by the player
+		*/
+		inline float getTerritory(unsigned int player, sf::Vector2i tile) const
+		{
+			std::size_t cell = getCellIndex(tile);
+			return m_layers[player][cell] - (m_total[cell] - m_layers[player][cell]);
+		}
+
+		/*!
+		* \brief Amount of resources around the tile
+		*/
+		inline float getResourceValue(sf::Vector2i tile) const { return m_layers[RESOURCE_LAYER][getCellIndex(tile)]; }
+
+		/*!
+		* \brief Whole layer stored row by row, used to search the best cell
+		*/
+		inline const std::vector<float> & getLayer(unsigned int layer) const { return m_layers[layer]; }
+		inline const std::vector<float> & getTotalStrength() const { return m_total; }
+		inline sf::Vector2i getCellGridSize() const { return m_cellGridSize; }
+		inline uint32_t getUpdateCount() const { return m_updateCount; }
+
+	private:
+		inline std::size_t getCellIndex(sf::Vector2i tile) const
+		{
+			return static_cast<std::size_t>((tile.y / CELL_SIZE)*m_cellGridSize.x + tile.x / CELL_SIZE);
+		}
+
+		/*!
+		* \brief Count RESOURCE tiles of cells inside changed chunks
+		*
+		* \return True if any chunk has changed
+		*
+		*/
+		bool updateResources(const GridView & grid);
+
+		/*!
+		* \brief Add health fraction of every unit to cell of the unit in source layer of the owner
+		*/
+		void gatherUnits(World & world);
+
+		/*!
+		* \brief Blur sources of all layers in m_blurred
+		*/
+		void blur(logic::JobSystem & jobs);
+
+	private:
+		Kernel m_kernel;							///< selected kernel
+		sf::Vector2i m_cellGridSize;				///< size of the map in cells
+		std::size_t m_sourceStride;					///< row length of source layers, RADIUS padding cells on both sides
+		float m_weights[2*RADIUS + 1];				///< weights of cells from -RADIUS to RADIUS distance
+
+		std::vector<float> m_sources[LAYER_COUNT];	///< influence put into cells, rows padded with zeros
+		std::vector<float> m_horizontal[LAYER_COUNT];	///< sources after horizontal pass, RADIUS zero rows above and below
+		std::vector<float> m_layers[LAYER_COUNT];	///< final layers
+		std::vector<float> m_total;					///< sum of strength layers of all players
+		bool m_active[LAYER_COUNT];					///< layer has non zero sources
+		std::vector<unsigned int> m_blurred;		///< layers blurred by current update
+
+		std::vector<uint32_t> m_chunkVersions;		///< versions of chunks when resources were counted
+		bool m_resourcesCounted{ false };			///< resources were counted at least once
+		uint32_t m_updateCount{ 0u };				///< amount of update() calls, readers use it to detect changed layers
+	};
+}
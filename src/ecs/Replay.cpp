@@ -0,0 +1,174 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//--------------------------------------------------------------------------
+
+#include "Replay.h"
+
+//--------------------------------------------------------------------------
+
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+//--------------------------------------------------------------------------
+
+using namespace ecs;
+
+constexpr uint32_t ReplayWriter::FORMAT_VERSION;
+
+namespace
+{
+	constexpr char REPLAY_MAGIC[8] = "TZARRPL";
+	constexpr uint8_t KIND_END = 0xFE;				///< marker of END record, lower values are command types
+	constexpr uint8_t KIND_HASH = 0xFF;				///< marker of HASH record
+	constexpr std::size_t FLUSH_SIZE = 64u * 1024u;	///< size of buffered records which is written to the file
+}
+
+//--------------------------------------------------------------------------
+
+ReplayWriter::ReplayWriter(const std::string & path, ReplayHeader header) :
+	m_file(path, std::ios::binary | std::ios::trunc)
+{
+	if (!m_file)
+		throw std::runtime_error("ReplayWriter - can't open file " + path);
+
+	std::memcpy(header.magic, REPLAY_MAGIC, sizeof(header.magic));
+	header.formatVersion = FORMAT_VERSION;
+	header.reserved = 0u;
+	m_file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	m_buffer.reserve(FLUSH_SIZE + 1024u);
+}
+
+//--------------------------------------------------------------------------
+
+ReplayWriter::~ReplayWriter()
+{
+	if (!m_finished)
+		finish(m_lastTick);
+}
+
+//--------------------------------------------------------------------------
+
+void ReplayWriter::record(uint32_t tick, const Command & command)
+{
+	beginRecord(tick);
+	logic::ByteWriter writer(m_buffer);
+	writeCommand(writer, command);
+
+	if (m_buffer.size() >= FLUSH_SIZE)
+		flush();
+}
+
+//--------------------------------------------------------------------------
+
+void ReplayWriter::recordHash(uint32_t tick, uint64_t hash)
+{
+	beginRecord(tick);
+	logic::ByteWriter writer(m_buffer);
+	writer.writeByte(KIND_HASH);
+	writer.writeUint32(foldHash(hash));
+
+	if (m_buffer.size() >= FLUSH_SIZE)
+		flush();
+}
+
+//--------------------------------------------------------------------------
+
+void ReplayWriter::finish(uint32_t tick)
+{
+	if (m_finished)
+		return;
+
+	beginRecord(tick);
+	m_buffer.push_back(KIND_END);
+	flush();
+	m_file.close();
+	m_finished = true;
+}
+
+//--------------------------------------------------------------------------
+
+void ReplayWriter::beginRecord(uint32_t tick)
+{
+	if (m_finished)
+		throw std::runtime_error("ReplayWriter - replay is already finished");
+	if (tick < m_lastTick)
+		throw std::runtime_error("ReplayWriter - records must be written in order of ticks");
+
+	logic::ByteWriter(m_buffer).writeVarint(tick - m_lastTick);
+	m_lastTick = tick;
+}
+
+//--------------------------------------------------------------------------
+
+void ReplayWriter::flush()
+{
+	m_file.write(reinterpret_cast<const char *>(m_buffer.data()), static_cast<std::streamsize>(m_buffer.size()));
+	m_buffer.clear();
+}
+
+//--------------------------------------------------------------------------
+
+ReplayReader::ReplayReader(const std::string & path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		throw std::runtime_error("ReplayReader - can't open file " + path);
+
+	if (!file.read(reinterpret_cast<char *>(&m_header), sizeof(m_header)))
+		throw std::runtime_error("ReplayReader - file is too short " + path);
+	if (std::memcmp(m_header.magic, REPLAY_MAGIC, sizeof(m_header.magic)) != 0)
+		throw std::runtime_error("ReplayReader - file isn't replay " + path);
+	if (m_header.formatVersion != ReplayWriter::FORMAT_VERSION)
+		throw std::runtime_error("ReplayReader - unsupported replay version " + std::to_string(m_header.formatVersion));
+
+	m_data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	m_reader = logic::ByteReader(m_data.data(), m_data.size());
+}
+
+//--------------------------------------------------------------------------
+
+bool ReplayReader::next(ReplayRecord & record)
+{
+	if (m_finished)
+		return false;
+
+	m_tick += static_cast<uint32_t>(m_reader.readVarint());
+	record.tick = m_tick;
+	uint8_t kind = m_reader.peekByte();
+	if (kind == KIND_END)
+	{
+		m_reader.readByte();
+		record.kind = ReplayRecord::Kind::END;
+		m_finished = true;
+	}
+	else if (kind == KIND_HASH)
+	{
+		m_reader.readByte();
+		record.kind = ReplayRecord::Kind::HASH;
+		record.hash = m_reader.readUint32();
+	}
+	else
+	{
+		record.kind = ReplayRecord::Kind::COMMAND;
+		readCommand(m_reader, record.command);
+	}
+
+	return true;
+}
@@ -0,0 +1,184 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+
+//--------------------------------------------------------------------------
+
+#include "Simulation.h"
+
+//--------------------------------------------------------------------------
+
+namespace ecs
+{
+	/*!
+	* \brief Header at the beginning of every replay file
+	*/
+	struct ReplayHeader
+	{
+		char magic[8];						///< "TZARRPL" with terminating zero
+		uint32_t formatVersion;				///< version of file layout, see ReplayWriter::FORMAT_VERSION
+		uint32_t terrainSeed;				///< seed of TerrainGenerator which generated the map
+		int32_t gridWidth;					///< width of the map in tiles
+		int32_t gridHeight;					///< height of the map in tiles
+		uint32_t simulationSeed;			///< seed of the Simulation
+		uint32_t hashInterval;				///< amount of ticks between recorded state hashes
+		uint64_t reserved;					///< reserved for future use, always 0
+	};
+
+	static_assert(sizeof(ReplayHeader) == 40, "ReplayHeader must have the same size on every platform");
+
+	//--------------------------------------------------------------------------
+
+	/*!
+	* \brief One entry of the replay stream
+	*/
+	struct ReplayRecord
+	{
+		enum class Kind : uint8_t
+		{
+			COMMAND,		///< command executed before the step of the tick
+			HASH,			///< Simulation::computeHash() after the tick was simulated
+			END,			///< last simulated tick, always the last record
+		};
+
+		Kind kind{ Kind::END };
+		uint32_t tick{ 0u };				///< tick of the record
+		uint32_t hash{ 0u };				///< folded state hash (only HASH)
+		Command command;					///< recorded command (only COMMAND)
+	};
+
+	//--------------------------------------------------------------------------
+
+	/*!
+	* \brief Writes player commands and state hashes to compact replay stream
+	*
+	* Record starts with variable length tick difference to the previous record followed by command written by
+	* writeCommand() or HASH/END marker byte, so typical command takes few bytes. Hashes are folded to 32 bits, which is enough to detect desynchronization.
+	*
+	* Usage example:
+	* \code
+	* ecs::ReplayWriter writer("replay.rpl", header);
+	* writer.record(simulation.getTick(), command);
+	* simulation.execute(command);
+	* simulation.step(jobs);
+	* writer.recordHash(simulation.getTick(), simulation.computeHash());
+	* ...
+	* writer.finish(simulation.getTick());
+	* \endcode
+	*
+	*/
+	class ReplayWriter
+	{
+	public:
+		static constexpr uint32_t FORMAT_VERSION = 1;	///< increased with every change of file layout
+
+		/*!
+		* \brief Open file and write header, magic and formatVersion of the header are filled by writer
+		*
+		* \throw std::runtime_error if file can't be opened
+		*
+		*/
+		ReplayWriter(const std::string & path, ReplayHeader header);
+		~ReplayWriter();
+
+		/*!
+		* \brief Record command, tick can't be lower than tick of previous record
+		*/
+		void record(uint32_t tick, const Command & command);
+
+		/*!
+		* \brief Record state hash computed after tick was simulated
+		*/
+		void recordHash(uint32_t tick, uint64_t hash);
+
+		/*!
+		* \brief Write END record and close the file, called by destructor if it wasn't called before
+		*/
+		void finish(uint32_t tick);
+
+		/*!
+		* \brief Fold 64 bit hash to 32 bits stored in replay
+		*/
+		static uint32_t foldHash(uint64_t hash) { return static_cast<uint32_t>(hash ^ (hash >> 32)); }
+
+	private:
+		void beginRecord(uint32_t tick);
+		void flush();
+
+	private:
+		std::ofstream m_file;				///< replay file
+		std::vector<uint8_t> m_buffer;		///< records not written to the file yet
+		uint32_t m_lastTick{ 0u };			///< tick of the previous record
+		bool m_finished{ false };			///< END record was written
+	};
+
+	//--------------------------------------------------------------------------
+
+	/*!
+	* \brief Reads replay written by ReplayWriter
+	*
+	* Usage example:
+	* \code
+	* ecs::ReplayReader reader("replay.rpl");
+	* ecs::ReplayRecord record;
+	* while (reader.next(record))
+	* {
+	*     ...
+	* }
+	* \endcode
+	*
+	*/
+	class ReplayReader
+	{
+	public:
+		/*!
+		* \brief Read whole file and check header
+		*
+		* \throw std::runtime_error if file can't be read or it isn't replay of supported version
+		*
+		*/
+		ReplayReader(const std::string & path);
+
+		/*!
+		* \brief Read next record
+		*
+		* \return False if there are no more records (END record was already returned)
+		*
+		* \throw std::runtime_error if stream is truncated or corrupted
+		*
+		*/
+		bool next(ReplayRecord & record);
+
+		inline const ReplayHeader & getHeader() const { return m_header; }
+
+	private:
+		ReplayHeader m_header;				///< header of the file
+		std::vector<uint8_t> m_data;		///< records
+		logic::ByteReader m_reader{ nullptr, 0u };	///< reader of m_data
+		uint32_t m_tick{ 0u };				///< tick of the previous record
+		bool m_finished{ false };			///< END record was read
+	};
+}
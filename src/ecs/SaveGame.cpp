@@ -0,0 +1,617 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//--------------------------------------------------------------------------
+
+#include "SaveGame.h"
+#include "../logic/Archive.h"
+#include "../logic/MapFile.h"
+
+//--------------------------------------------------------------------------
+
+#include <cstdio>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
+
+//--------------------------------------------------------------------------
+
+using namespace ecs;
+
+constexpr uint32_t SaveGame::FORMAT_VERSION;
+constexpr uint32_t SaveGame::DELTA_FLAG;
+
+namespace
+{
+	const char SAVE_MAGIC[8] = "TZARSAV";
+
+	/*!
+	* \brief Saved bytes of every chunk: object types, terrain and height, clearance and bit planes are derived from them
+	*/
+	constexpr std::size_t GRID_CHUNK_BYTES = offsetof(GridChunk, clearance);
+
+	static_assert(offsetof(GridChunk, objType) == 0 && GRID_CHUNK_BYTES == 3 * CHUNK_TILES, "Saved tile layers must be the first fields of GridChunk");
+
+	constexpr std::size_t GRID_SECTION_HEADER = 3 * sizeof(uint32_t);					///< grid width, grid height and amount of chunks
+	constexpr std::size_t GRID_RECORD_BYTES = sizeof(uint32_t) + GRID_CHUNK_BYTES;		///< chunk index and it's tiles
+
+	/*!
+	* \brief Minimal amount of unchanged bytes which ends literal run of delta encoding
+	*/
+	constexpr std::size_t MIN_UNCHANGED_RUN = 4;
+
+	inline std::size_t paddedSize(std::size_t size)
+	{
+		return (size + 7u) & ~static_cast<std::size_t>(7u);
+	}
+
+	/*!
+	* \brief Checksum of data padded with zeros to 8 bytes
+	*/
+	uint64_t payloadChecksum(const uint8_t * data, std::size_t size)
+	{
+		uint64_t hash = MapFile::checksum(data, size);
+		std::size_t tail = size % sizeof(uint64_t);
+		if (tail != 0u)
+		{
+			uint64_t word = 0u;
+			std::memcpy(&word, data + size - tail, tail);
+			hash ^= word;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	void writeVarint(std::vector<uint8_t> & output, std::size_t value)
+	{
+		while (value >= 0x80u)
+		{
+			output.push_back(static_cast<uint8_t>(value | 0x80u));
+			value >>= 7;
+		}
+		output.push_back(static_cast<uint8_t>(value));
+	}
+
+	std::size_t readVarint(const uint8_t * payload, std::size_t size, std::size_t & position)
+	{
+		std::size_t value = 0u;
+		for (unsigned int shift = 0u; shift < 64u; shift += 7u)
+		{
+			if (position >= size)
+				break;
+			uint8_t byte = payload[position++];
+			value |= static_cast<std::size_t>(byte & 0x7Fu) << shift;
+			if ((byte & 0x80u) == 0u)
+				return value;
+		}
+		throw std::runtime_error("SaveGame - Broken delta encoding");
+	}
+
+	inline uint32_t readWord(const uint8_t * data)
+	{
+		uint32_t value;
+		std::memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	/*!
+	* \brief Read whole file into buffer aligned to 8 bytes
+	*/
+	std::size_t readFile(const std::string & path, std::vector<uint64_t> & buffer)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file)
+			throw std::runtime_error("SaveGame - Can't open file " + path);
+
+		std::size_t size = static_cast<std::size_t>(file.tellg());
+		buffer.assign((size + 7u) / 8u, 0u);
+		file.seekg(0);
+		if (!file.read(reinterpret_cast<char*>(buffer.data()), size))
+			throw std::runtime_error("SaveGame - Can't read file " + path);
+		return size;
+	}
+}
+
+//--------------------------------------------------------------------------
+
+SaveGame::SaveGame()
+{
+	m_thread = std::thread(&SaveGame::run, this);
+}
+
+//--------------------------------------------------------------------------
+
+SaveGame::~SaveGame()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wakeUp.notify_one();
+	m_thread.join();
+}
+
+//--------------------------------------------------------------------------
+
+void SaveGame::save(const std::string & path, const SimulationState & state, Mode mode)
+{
+	std::unique_ptr<Capture> capture;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_error)
+		{
+			std::exception_ptr error = m_error;
+			m_error = nullptr;
+			std::rethrow_exception(error);
+		}
+		capture = std::move(m_spare);
+	}
+
+	if (!capture)
+		capture.reset(new Capture());
+
+	// growing buffer while serializing would copy it, so it's reserved with some space for new entities
+	for (std::size_t i = 0; i < capture->sections.size(); ++i)
+	{
+		capture->sections[i].clear();
+		capture->sections[i].reserve(m_lastSizes[i] + m_lastSizes[i] / 8u);
+	}
+
+	capture->path = path;
+	capture->tick = state.tick;
+	capture->delta = mode == Mode::DELTA && m_hasBase;
+	capture->grid = state.grid->snapshot();
+
+	logic::OutputArchive entities(capture->sections[static_cast<std::size_t>(Section::ENTITIES)]);
+	state.world->serialize(entities);
+	logic::OutputArchive paths(capture->sections[static_cast<std::size_t>(Section::PATHS)]);
+	state.paths->serialize(paths);
+
+	std::ostringstream random;
+	random << *state.random;
+	std::string randomState = random.str();
+	capture->sections[static_cast<std::size_t>(Section::RANDOM)].assign(randomState.begin(), randomState.end());
+
+	for (std::size_t i = 0; i < capture->sections.size(); ++i)
+		m_lastSizes[i] = capture->sections[i].size();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.push_back(std::move(capture));
+		m_hasBase = true;
+	}
+	m_wakeUp.notify_one();
+}
+
+//--------------------------------------------------------------------------
+
+void SaveGame::flush()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle.wait(lock, [this]() { return m_queue.empty() && !m_busy; });
+	if (m_error)
+	{
+		std::exception_ptr error = m_error;
+		m_error = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+//--------------------------------------------------------------------------
+
+void SaveGame::load(const std::vector<std::string> & files, SimulationState & state)
+{
+	if (files.empty())
+		throw std::runtime_error("SaveGame - No file to load");
+
+	const GridView & gridView = *state.grid;
+	std::vector<uint8_t> tiles(gridView.getChunkGridSize().x*gridView.getChunkGridSize().y*GRID_CHUNK_BYTES);
+	std::array<std::vector<uint8_t>, static_cast<std::size_t>(Section::COUNT)> sections;
+	std::vector<uint8_t> decoded;
+	std::vector<uint64_t> buffer;
+	uint32_t tick = 0u;
+
+	for (std::size_t fileIndex = 0; fileIndex < files.size(); ++fileIndex)
+	{
+		const std::string & path = files[fileIndex];
+		std::size_t size = readFile(path, buffer);
+		const uint8_t * data = reinterpret_cast<const uint8_t*>(buffer.data());
+
+		SaveFileHeader header;
+		if (size < sizeof(header))
+			throw std::runtime_error("SaveGame - File is too small " + path);
+		std::memcpy(&header, data, sizeof(header));
+		if (std::memcmp(header.magic, SAVE_MAGIC, sizeof(SAVE_MAGIC)) != 0)
+			throw std::runtime_error("SaveGame - File is not a save " + path);
+		if (header.formatVersion != FORMAT_VERSION)
+			throw std::runtime_error("SaveGame - Unsupported format version " + std::to_string(header.formatVersion) + " of " + path);
+
+		bool delta = (header.flags & DELTA_FLAG) != 0u;
+		if (fileIndex == 0 && delta)
+			throw std::runtime_error("SaveGame - First loaded file must be full save " + path);
+		if (fileIndex > 0 && (!delta || header.baseTick != tick))
+			throw std::runtime_error("SaveGame - File doesn't continue previous save " + path);
+
+		std::size_t offset = sizeof(header);
+		unsigned int foundSections = 0u;
+		for (uint32_t i = 0; i < header.sectionCount; ++i)
+		{
+			SaveSectionHeader section;
+			if (size - offset < sizeof(section))
+				throw std::runtime_error("SaveGame - Truncated file " + path);
+			std::memcpy(&section, data + offset, sizeof(section));
+			offset += sizeof(section);
+
+			std::size_t padded = paddedSize(section.storedSize);
+			if (section.id >= static_cast<uint32_t>(Section::COUNT) || padded > size - offset)
+				throw std::runtime_error("SaveGame - Broken section header in " + path);
+			const uint8_t * payload = data + offset;
+			offset += padded;
+			if (payloadChecksum(payload, section.storedSize) != section.checksum)
+				throw std::runtime_error("SaveGame - Checksum doesn't match in " + path);
+
+			foundSections |= 1u << section.id;
+			Encoding encoding = static_cast<Encoding>(section.encoding);
+			if (static_cast<Section>(section.id) == Section::GRID)
+			{
+				if (encoding != Encoding::RAW)
+					throw std::runtime_error("SaveGame - Unknown encoding of grid in " + path);
+				decodeGrid(payload, section.storedSize, gridView, tiles);
+			}
+			else if (encoding == Encoding::RAW && section.rawSize == section.storedSize)
+			{
+				sections[section.id].assign(payload, payload + section.storedSize);
+			}
+			else if (encoding == Encoding::XOR_RUNS && delta)
+			{
+				decodeDelta(payload, section.storedSize, sections[section.id], section.rawSize, decoded);
+				sections[section.id].swap(decoded);
+			}
+			else
+			{
+				throw std::runtime_error("SaveGame - Unknown encoding of section in " + path);
+			}
+		}
+
+		if (foundSections != (1u << static_cast<uint32_t>(Section::COUNT)) - 1u)
+			throw std::runtime_error("SaveGame - Missing sections in " + path);
+		tick = header.tick;
+	}
+
+	// everything was read and verified, so state is changed only now
+	World world;
+	const std::vector<uint8_t> & entityBytes = sections[static_cast<std::size_t>(Section::ENTITIES)];
+	logic::InputArchive entities(entityBytes.data(), entityBytes.size());
+	world.serialize(entities);
+
+	PathStorage paths;
+	const std::vector<uint8_t> & pathBytes = sections[static_cast<std::size_t>(Section::PATHS)];
+	logic::InputArchive pathInput(pathBytes.data(), pathBytes.size());
+	paths.serialize(pathInput);
+
+	std::mt19937 random;
+	const std::vector<uint8_t> & randomBytes = sections[static_cast<std::size_t>(Section::RANDOM)];
+	std::istringstream randomInput(std::string(randomBytes.begin(), randomBytes.end()));
+	randomInput >> random;
+
+	if (!entities.finished() || !pathInput.finished() || randomInput.fail())
+		throw std::runtime_error("SaveGame - Section has unexpected size");
+
+	unsigned int chunkCount = gridView.getChunkGridSize().x*gridView.getChunkGridSize().y;
+	GridChunk chunk{};
+	for (unsigned int chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex)
+	{
+		std::memcpy(&chunk, &tiles[chunkIndex*GRID_CHUNK_BYTES], GRID_CHUNK_BYTES);
+		state.grid->replaceChunk(chunkIndex, chunk);
+	}
+	state.grid->publishChanges();
+
+	*state.world = std::move(world);
+	*state.paths = std::move(paths);
+	*state.random = random;
+	state.tick = tick;
+}
+
+//--------------------------------------------------------------------------
+
+void SaveGame::encodeDelta(const std::vector<uint8_t> & section, const std::vector<uint8_t> & base, std::vector<uint8_t> & output)
+{
+	output.clear();
+	const std::size_t size = section.size();
+	auto changed = [&section, &base](std::size_t i) -> uint8_t
+	{
+		return section[i] ^ (i < base.size() ? base[i] : 0u);
+	};
+
+	std::size_t i = 0;
+	while (i < size)
+	{
+		// unchanged bytes, compared by words where both buffers have them
+		std::size_t unchangedStart = i;
+		while (i + 8u <= size && i + 8u <= base.size() && std::memcmp(&section[i], &base[i], 8u) == 0)
+			i += 8u;
+		while (i < size && changed(i) == 0u)
+			++i;
+
+		// literal run ends with MIN_UNCHANGED_RUN unchanged bytes, shorter gaps are cheaper inside literal
+		std::size_t literalStart = i;
+		std::size_t unchangedRun = 0u;
+		while (i < size && unchangedRun < MIN_UNCHANGED_RUN)
+		{
+			unchangedRun = changed(i) == 0u ? unchangedRun + 1u : 0u;
+			++i;
+		}
+		std::size_t literalEnd = unchangedRun >= MIN_UNCHANGED_RUN ? i - unchangedRun : i;
+		i = literalEnd;
+
+		writeVarint(output, literalStart - unchangedStart);
+		writeVarint(output, literalEnd - literalStart);
+		for (std::size_t j = literalStart; j < literalEnd; ++j)
+			output.push_back(changed(j));
+	}
+}
+
+//--------------------------------------------------------------------------
+
+void SaveGame::decodeDelta(const uint8_t * payload, std::size_t size, const std::vector<uint8_t> & base, std::size_t rawSize,
+	std::vector<uint8_t> & output)
+{
+	output.assign(base.begin(), base.begin() + std::min(base.size(), rawSize));
+	output.resize(rawSize, 0u);
+
+	std::size_t position = 0u;
+	std::size_t read = 0u;
+	while (read < size)
+	{
+		std::size_t unchanged = readVarint(payload, size, read);
+		std::size_t literal = readVarint(payload, size, read);
+		if (unchanged > rawSize - position || literal > rawSize - position - unchanged || literal > size - read)
+			throw std::runtime_error("SaveGame - Delta doesn't fit section");
+
+		position += unchanged;
+		for (std::size_t i = 0; i < literal; ++i)
+			output[position + i] ^= payload[read + i];
+		position += literal;
+		read += literal;
+	}
+}
+
+//--------------------------------------------------------------------------
+
+void SaveGame::run()
+{
+	for (;;)
+	{
+		std::unique_ptr<Capture> capture;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wakeUp.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+			if (m_queue.empty())
+				return;
+			capture = std::move(m_queue.front());
+			m_queue.pop_front();
+			m_busy = true;
+		}
+
+		try
+		{
+			write(capture);
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_error)
+				m_error = std::current_exception();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_busy = false;
+		}
+		m_idle.notify_all();
+	}
+}
+
+//--------------------------------------------------------------------------
+
+void SaveGame::write(std::unique_ptr<Capture> & capture)
+{
+	bool delta = capture->delta && m_base && m_base->grid->getGridSize() == capture->grid->getGridSize();
+
+	std::vector<EncodedSection> sections;
+	encodeGrid(*capture->grid, delta ? m_base->grid.get() : nullptr, m_gridPayload);
+	sections.push_back(EncodedSection{ SaveSectionHeader{ static_cast<uint32_t>(Section::GRID), static_cast<uint32_t>(Encoding::RAW),
+		0u, 0u, 0u }, &m_gridPayload });
+
+	for (std::size_t i = static_cast<std::size_t>(Section::ENTITIES); i < static_cast<std::size_t>(Section::COUNT); ++i)
+	{
+		const std::vector<uint8_t> & raw = capture->sections[i];
+		EncodedSection section{ SaveSectionHeader{ static_cast<uint32_t>(i), static_cast<uint32_t>(Encoding::RAW), 0u, 0u, 0u }, &raw };
+		if (delta)
+		{
+			encodeDelta(raw, m_base->sections[i], m_deltas[i]);
+			section.header.encoding = static_cast<uint32_t>(Encoding::XOR_RUNS);
+			section.payload = &m_deltas[i];
+		}
+		section.header.rawSize = static_cast<uint32_t>(raw.size());
+		sections.push_back(section);
+	}
+	sections.front().header.rawSize = static_cast<uint32_t>(m_gridPayload.size());
+
+	for (auto & section : sections)
+	{
+		section.header.storedSize = static_cast<uint32_t>(section.payload->size());
+		section.header.checksum = payloadChecksum(section.payload->data(), section.payload->size());
+	}
+
+	SaveFileHeader header{};
+	std::memcpy(header.magic, SAVE_MAGIC, sizeof(SAVE_MAGIC));
+	header.formatVersion = FORMAT_VERSION;
+	header.flags = delta ? DELTA_FLAG : 0u;
+	header.tick = capture->tick;
+	header.baseTick = delta ? m_base->tick : capture->tick;
+	header.sectionCount = static_cast<uint32_t>(sections.size());
+	writeFile(capture->path, header, sections);
+
+	// base changes only when file was written, so next delta never depends on missing file
+	std::unique_ptr<Capture> previous = std::move(m_base);
+	m_base = std::move(capture);
+	if (previous)
+	{
+		previous->grid.reset();
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_spare = std::move(previous);
+	}
+}
+
+//--------------------------------------------------------------------------
+
+void SaveGame::encodeGrid(const GridView & grid, const GridView * base, std::vector<uint8_t> & output)
+{
+	unsigned int chunkCount = grid.getChunkGridSize().x*grid.getChunkGridSize().y;
+	output.resize(GRID_SECTION_HEADER);
+	output.reserve(GRID_SECTION_HEADER + chunkCount*GRID_RECORD_BYTES);
+
+	uint32_t changedChunks = 0u;
+	for (uint32_t chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex)
+	{
+		// snapshots share chunks which were not changed, so most of them are skipped without comparing tiles
+		const GridChunk & chunk = grid.chunk(chunkIndex);
+		if (base != nullptr)
+		{
+			const GridChunk & baseChunk = base->chunk(chunkIndex);
+			if (&baseChunk == &chunk || std::memcmp(&baseChunk, &chunk, GRID_CHUNK_BYTES) == 0)
+				continue;
+		}
+
+		const uint8_t * index = reinterpret_cast<const uint8_t*>(&chunkIndex);
+		const uint8_t * tiles = reinterpret_cast<const uint8_t*>(&chunk);
+		output.insert(output.end(), index, index + sizeof(chunkIndex));
+		output.insert(output.end(), tiles, tiles + GRID_CHUNK_BYTES);
+		++changedChunks;
+	}
+
+	uint32_t header[3] = { static_cast<uint32_t>(grid.getGridSize().x), static_cast<uint32_t>(grid.getGridSize().y), changedChunks };
+	std::memcpy(output.data(), header, sizeof(header));
+}
+
+//--------------------------------------------------------------------------
+
+void SaveGame::decodeGrid(const uint8_t * payload, std::size_t size, const GridView & grid, std::vector<uint8_t> & tiles)
+{
+	if (size < GRID_SECTION_HEADER)
+		throw std::runtime_error("SaveGame - Truncated grid section");
+
+	sf::Vector2i gridSize(static_cast<int>(readWord(payload)), static_cast<int>(readWord(payload + 4)));
+	uint32_t count = readWord(payload + 8);
+	if (gridSize != grid.getGridSize())
+		throw std::runtime_error("SaveGame - Saved grid has size " + std::to_string(gridSize.x) + "x" + std::to_string(gridSize.y));
+	if ((size - GRID_SECTION_HEADER) / GRID_RECORD_BYTES != count || (size - GRID_SECTION_HEADER) % GRID_RECORD_BYTES != 0u)
+		throw std::runtime_error("SaveGame - Grid section has unexpected size");
+
+	unsigned int chunkCount = grid.getChunkGridSize().x*grid.getChunkGridSize().y;
+	const uint8_t * record = payload + GRID_SECTION_HEADER;
+	for (uint32_t i = 0; i < count; ++i, record += GRID_RECORD_BYTES)
+	{
+		uint32_t chunkIndex = readWord(record);
+		if (chunkIndex >= chunkCount)
+			throw std::runtime_error("SaveGame - Chunk index out of grid");
+		std::memcpy(&tiles[chunkIndex*GRID_CHUNK_BYTES], record + sizeof(uint32_t), GRID_CHUNK_BYTES);
+	}
+}
+
+//--------------------------------------------------------------------------
+
+void SaveGame::writeFile(const std::string & path, const SaveFileHeader & header, const std::vector<EncodedSection> & sections)
+{
+	static const uint8_t PADDING[8] = {};
+	std::string temporary = path + ".tmp";
+
+#ifdef _WIN32
+	std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	for (const auto & section : sections)
+	{
+		std::size_t size = section.payload->size();
+		file.write(reinterpret_cast<const char*>(&section.header), sizeof(section.header));
+		file.write(reinterpret_cast<const char*>(section.payload->data()), size);
+		file.write(reinterpret_cast<const char*>(PADDING), paddedSize(size) - size);
+	}
+	file.close();
+	if (!file)
+		throw std::runtime_error("SaveGame - Can't write file " + temporary);
+	std::remove(path.c_str());
+#else
+	std::vector<iovec> buffers;
+	buffers.push_back(iovec{ const_cast<SaveFileHeader*>(&header), sizeof(header) });
+	for (const auto & section : sections)
+	{
+		std::size_t size = section.payload->size();
+		buffers.push_back(iovec{ const_cast<SaveSectionHeader*>(&section.header), sizeof(section.header) });
+		if (size > 0u)
+			buffers.push_back(iovec{ const_cast<uint8_t*>(section.payload->data()), size });
+		if (paddedSize(size) != size)
+			buffers.push_back(iovec{ const_cast<uint8_t*>(PADDING), paddedSize(size) - size });
+	}
+
+	int file = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (file < 0)
+		throw std::runtime_error("SaveGame - Can't create file " + temporary);
+
+	// writev can write less than requested, then remaining buffers are written again
+	std::size_t first = 0u;
+	while (first < buffers.size())
+	{
+		int count = static_cast<int>(std::min<std::size_t>(buffers.size() - first, IOV_MAX));
+		ssize_t written = ::writev(file, &buffers[first], count);
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			::close(file);
+			throw std::runtime_error("SaveGame - Can't write file " + temporary);
+		}
+
+		std::size_t remaining = static_cast<std::size_t>(written);
+		while (first < buffers.size() && remaining >= buffers[first].iov_len)
+			remaining -= buffers[first++].iov_len;
+		if (remaining > 0u)
+		{
+			buffers[first].iov_base = static_cast<uint8_t*>(buffers[first].iov_base) + remaining;
+			buffers[first].iov_len -= remaining;
+		}
+	}
+
+	if (::close(file) != 0)
+		throw std::runtime_error("SaveGame - Can't write file " + temporary);
+#endif
+
+	if (std::rename(temporary.c_str(), path.c_str()) != 0)
+		throw std::runtime_error("SaveGame - Can't replace file " + path);
+}
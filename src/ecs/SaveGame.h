@@ -0,0 +1,249 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <deque>
+#include <mutex>
+#include <array>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <exception>
+#include <condition_variable>
+
+//--------------------------------------------------------------------------
+
+#include "World.h"
+#include "Systems.h"
+#include "../logic/Grid.h"
+
+//--------------------------------------------------------------------------
+
+namespace ecs
+{
+	/*!
+	* \brief Header at the beginning of every save file
+	*/
+	struct SaveFileHeader
+	{
+		char magic[8];						///< "TZARSAV" with terminating zero
+		uint32_t formatVersion;				///< version of file layout, see SaveGame::FORMAT_VERSION
+		uint32_t flags;						///< SaveGame::DELTA_FLAG if file keeps only changes since base save
+		uint32_t tick;						///< simulation tick of saved state
+		uint32_t baseTick;					///< tick of save which this delta is based on, equal to tick for full save
+		uint32_t sectionCount;				///< amount of sections which follow the header
+		uint32_t reserved;					///< padding, always 0
+		uint64_t reserved2;					///< reserved for future use, always 0
+	};
+
+	static_assert(sizeof(SaveFileHeader) == 40, "SaveFileHeader must have the same size on every platform");
+
+	/*!
+	* \brief Header of one section of save file, payload follows it and is padded with zeros to 8 bytes
+	*/
+	struct SaveSectionHeader
+	{
+		uint32_t id;						///< SaveGame::Section of the payload
+		uint32_t encoding;					///< SaveGame::Encoding of the payload
+		uint32_t rawSize;					///< size of decoded section
+		uint32_t storedSize;				///< size of payload without padding
+		uint64_t checksum;					///< checksum of padded payload (see MapFile::checksum())
+	};
+
+	static_assert(sizeof(SaveSectionHeader) == 24, "SaveSectionHeader must have the same size on every platform");
+
+	//--------------------------------------------------------------------------
+
+	/*!
+	* \brief Objects which together make whole state of the simulation
+	*/
+	struct SimulationState
+	{
+		Grid * grid;						///< terrain and objects of the map
+		World * world;						///< all entities
+		PathStorage * paths;				///< paths followed by entities
+		std::mt19937 * random;				///< random generator of the simulation
+		uint32_t tick;						///< number of simulated ticks
+	};
+
+	//--------------------------------------------------------------------------
+
+	/*!
+	* \brief Binary snapshots of the simulation written in background
+	*
+	* save() copies state on calling thread and returns, encoding and writing are done by writer thread. Copy is cheap:
+	* grid is taken as GridSnapshot which shares chunks with the grid and entities and paths are serialized to flat
+	* buffers with one pass over their columns. Buffers of the capture which stopped being a base of deltas are reused,
+	* so regular saves don't allocate memory.
+	*
+	* File is a header and sections (grid, entities, paths, random generator). Delta save is based on the previous save
+	* of the same SaveGame: grid section keeps only chunks which differ from the base and other sections are XOR-ed
+	* with the base and stored as runs of unchanged bytes and literals. Whole file is written with one writev() call to
+	* temporary file, which replaces the target only when it was written completely.
+	*
+	* Usage example:
+	* \code
+	* ecs::SaveGame saveGame;
+	* ecs::SimulationState state{ &grid, &world, &paths, &random, tick };
+	* saveGame.save("autosave0.sav", state, ecs::SaveGame::Mode::FULL);
+	* ...
+	* saveGame.save("autosave1.sav", state, ecs::SaveGame::Mode::DELTA);
+	* saveGame.flush();
+	* ecs::SaveGame::load({ "autosave0.sav", "autosave1.sav" }, state);
+	* \endcode
+	*
+	*/
+	class SaveGame
+	{
+	public:
+		static constexpr uint32_t FORMAT_VERSION = 1;	///< increased with every change of file layout
+		static constexpr uint32_t DELTA_FLAG = 1;		///< SaveFileHeader::flags bit of delta saves
+
+		/*!
+		* \brief Id of section
+		*/
+		enum class Section : uint32_t
+		{
+			GRID,			///< changed chunks (all for full save): chunk index and tiles without derived data
+			ENTITIES,		///< World::serialize()
+			PATHS,			///< PathStorage::serialize()
+			RANDOM,			///< text state of random generator
+			COUNT,
+		};
+
+		/*!
+		* \brief Encoding of section payload
+		*/
+		enum class Encoding : uint32_t
+		{
+			RAW,			///< payload is the section
+			XOR_RUNS,		///< section XOR-ed with the same section of base save, stored as runs (see encodeDelta())
+		};
+
+		/*!
+		* \brief Kind of save
+		*/
+		enum class Mode
+		{
+			FULL,			///< save can be loaded alone
+			DELTA,			///< save keeps changes since previous save, full save is written if there is no previous one
+		};
+
+		SaveGame();
+		~SaveGame();
+
+		/*!
+		* \brief Copy state and queue writing of it to file
+		*
+		* \param path Path of written file
+		* \param state Saved state, it's not used after the function returns
+		* \param mode Kind of save
+		*
+		* Throws std::runtime_error if any previous save failed.
+		*
+		*/
+		void save(const std::string & path, const SimulationState & state, Mode mode);
+
+		/*!
+		* \brief Wait until all queued saves are written, throws std::runtime_error if any of them failed
+		*/
+		void flush();
+
+		/*!
+		* \brief Load full save and deltas based on it
+		*
+		* \param files Full save followed by deltas, every delta must be based on the previous file
+		* \param state Filled state, grid must have the same size as saved one, world and paths are replaced
+		*
+		* Throws std::runtime_error if any file can't be read, is damaged or doesn't continue previous one.
+		*
+		*/
+		static void load(const std::vector<std::string> & files, SimulationState & state);
+
+		/*!
+		* \brief Encode section as XOR with base, stored as varint pairs (unchanged bytes, literal bytes) and literals
+		*/
+		static void encodeDelta(const std::vector<uint8_t> & section, const std::vector<uint8_t> & base, std::vector<uint8_t> & output);
+
+		/*!
+		* \brief Decode section encoded with encodeDelta()
+		*/
+		static void decodeDelta(const uint8_t * payload, std::size_t size, const std::vector<uint8_t> & base, std::size_t rawSize,
+			std::vector<uint8_t> & output);
+
+	private:
+		/*!
+		* \brief State copied by save() and waiting for writer thread
+		*/
+		struct Capture
+		{
+			std::string path;											///< path of written file
+			uint32_t tick;												///< simulation tick of the state
+			bool delta;													///< true if state is written as delta of previous capture
+			std::shared_ptr<const GridSnapshot> grid;					///< grid at the moment of save
+			std::array<std::vector<uint8_t>, static_cast<std::size_t>(Section::COUNT)> sections;	///< serialized sections, grid section is empty
+		};
+
+		/*!
+		* \brief Encoded section waiting for writing
+		*/
+		struct EncodedSection
+		{
+			SaveSectionHeader header;				///< header of the section
+			const std::vector<uint8_t> * payload;	///< payload, owned by capture or writer
+		};
+
+		void run();
+		void write(std::unique_ptr<Capture> & capture);
+
+		/*!
+		* \brief Serialize tiles of changed chunks, all chunks if base is nullptr
+		*/
+		static void encodeGrid(const GridView & grid, const GridView * base, std::vector<uint8_t> & output);
+		static void decodeGrid(const uint8_t * payload, std::size_t size, const GridView & grid, std::vector<uint8_t> & tiles);
+
+		/*!
+		* \brief Write header and sections to file with one call and replace target file with it
+		*/
+		static void writeFile(const std::string & path, const SaveFileHeader & header, const std::vector<EncodedSection> & sections);
+
+	private:
+		std::thread m_thread;									///< writer thread
+		std::mutex m_mutex;										///< guards queue, busy flag and error
+		std::condition_variable m_wakeUp;						///< notified when capture is queued or writer stops
+		std::condition_variable m_idle;							///< notified when writer finished all queued captures
+		std::deque<std::unique_ptr<Capture>> m_queue;			///< captures waiting for writer thread
+		bool m_busy{ false };									///< true while writer thread processes capture
+		bool m_stop{ false };									///< true if writer thread must finish
+		std::exception_ptr m_error;								///< first error of writer thread, reported by save() or flush()
+		bool m_hasBase{ false };								///< true if any capture was queued, so delta can be written
+		std::unique_ptr<Capture> m_spare;						///< capture released by writer thread, reused to avoid allocations
+		std::array<std::size_t, static_cast<std::size_t>(Section::COUNT)> m_lastSizes{};	///< sizes of sections of the last capture
+
+		// used only by writer thread
+		std::unique_ptr<Capture> m_base;						///< previous capture, base of delta saves
+		std::vector<uint8_t> m_gridPayload;						///< encoded grid section
+		std::array<std::vector<uint8_t>, static_cast<std::size_t>(Section::COUNT)> m_deltas;	///< encoded delta sections
+	};
+}
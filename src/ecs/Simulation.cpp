@@ -0,0 +1,228 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//--------------------------------------------------------------------------
+
+#include "Simulation.h"
+#include "../logic/Archive.h"
+
+//--------------------------------------------------------------------------
+
+#include <cmath>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+
+//--------------------------------------------------------------------------
+
+using namespace ecs;
+
+constexpr float Simulation::TICK_TIME;
+constexpr float Simulation::UNIT_SPEED;
+constexpr uint32_t Simulation::UNIT_SIGHT;
+constexpr int16_t Simulation::UNIT_HEALTH;
+constexpr uint32_t Simulation::INFLUENCE_INTERVAL;
+
+//--------------------------------------------------------------------------
+
+void ecs::writeCommand(logic::ByteWriter & writer, const Command & command)
+{
+	writer.writeByte(static_cast<uint8_t>(command.type));
+	writer.writeByte(command.player);
+	writer.writeSigned(command.target.x);
+	writer.writeSigned(command.target.y);
+	writer.writeVarint(command.entities.size());
+	for (Entity entity : command.entities)
+	{
+		writer.writeVarint(entity.index);
+		writer.writeVarint(entity.counter);
+	}
+}
+
+//--------------------------------------------------------------------------
+
+void ecs::readCommand(logic::ByteReader & reader, Command & command)
+{
+	uint8_t type = reader.readByte();
+	if (type >= static_cast<uint8_t>(Command::Type::COUNT))
+		throw std::runtime_error("Command - unknown type " + std::to_string(type));
+
+	command.type = static_cast<Command::Type>(type);
+	command.player = reader.readByte();
+	command.target.x = reader.readSigned();
+	command.target.y = reader.readSigned();
+
+	// every entity takes at least two bytes, so corrupted count can't allocate too much memory
+	uint64_t count = reader.readVarint();
+	if (count > reader.getRemaining() / 2u)
+		throw std::runtime_error("Command - corrupted entity count");
+
+	command.entities.resize(static_cast<std::size_t>(count));
+	for (Entity & entity : command.entities)
+	{
+		entity.index = static_cast<uint32_t>(reader.readVarint());
+		entity.counter = static_cast<uint32_t>(reader.readVarint());
+	}
+}
+
+//--------------------------------------------------------------------------
+
+Simulation::Simulation(Grid & grid, uint32_t seed) :
+	m_grid(grid),
+	m_random{ seed },
+	m_spatialHash{ grid.getChunkGridSize() },
+	m_fog{ grid.getGridSize(), MAX_PLAYERS },
+	m_influence{ grid.getGridSize() },
+	m_pathing{ &grid },
+	m_planner{ m_pathing }
+{
+}
+
+//--------------------------------------------------------------------------
+
+void Simulation::execute(const Command & command)
+{
+	sf::Vector2i gridSize = m_grid.getGridSize();
+	if (command.target.x < 0 || command.target.y < 0 || command.target.x >= gridSize.x || command.target.y >= gridSize.y ||
+		command.player >= MAX_PLAYERS)
+		return;
+
+	switch (command.type)
+	{
+	case Command::Type::MOVE: move(command); break;
+	case Command::Type::STOP: stop(command); break;
+	case Command::Type::CREATE_UNIT: createUnit(command); break;
+	default: break;
+	}
+}
+
+//--------------------------------------------------------------------------
+
+void Simulation::step(logic::JobSystem & jobs)
+{
+	m_pathFollow.update(m_world, TICK_TIME);
+	m_steering.update(m_world, m_spatialHash);
+	m_movement.update(m_world, TICK_TIME, jobs);
+	m_animation.update(m_world, TICK_TIME, jobs);
+	m_health.update(m_world);
+	m_spatialHash.rebuild(m_world);
+	m_fogSystem.update(m_world, m_fog, jobs);
+	if (m_tick % INFLUENCE_INTERVAL == 0u)
+		m_influence.update(m_grid, m_world, jobs);
+	++m_tick;
+}
+
+//--------------------------------------------------------------------------
+
+uint64_t Simulation::computeHash()
+{
+	logic::HashArchive archive;
+	archive.value(m_tick);
+	m_world.serialize(archive);
+	m_paths.serialize(archive);
+
+	// next number of the copy depends on whole state of the generator
+	std::mt19937 random = m_random;
+	uint32_t next = static_cast<uint32_t>(random());
+	archive.value(next);
+	return archive.getHash();
+}
+
+//--------------------------------------------------------------------------
+
+SimulationState Simulation::getState()
+{
+	return SimulationState{ &m_grid, &m_world, &m_paths, &m_random, m_tick };
+}
+
+//--------------------------------------------------------------------------
+
+void Simulation::move(const Command & command)
+{
+	sf::Vector2i gridSize = m_grid.getGridSize();
+	m_moved.clear();
+	m_movedTiles.clear();
+	for (Entity entity : command.entities)
+	{
+		const Owner * owner = m_world.get<Owner>(entity);
+		const Position * position = m_world.get<Position>(entity);
+		if (owner == nullptr || position == nullptr || owner->player != command.player || m_world.get<PathCursor>(entity) == nullptr ||
+			m_world.get<Velocity>(entity) == nullptr)
+			continue;
+
+		int x = std::min(std::max(static_cast<int>(std::floor(position->x)), 0), gridSize.x - 1);
+		int y = std::min(std::max(static_cast<int>(std::floor(position->y)), 0), gridSize.y - 1);
+		m_moved.push_back(entity);
+		m_movedTiles.push_back(sf::Vector2i(x, y));
+	}
+	if (m_moved.empty())
+		return;
+
+	auto paths = m_planner.plan(m_movedTiles, command.target);
+	for (std::size_t i = 0; i < m_moved.size(); ++i)
+	{
+		PathCursor & cursor = *m_world.get<PathCursor>(m_moved[i]);
+		releasePath(cursor, *m_world.get<Velocity>(m_moved[i]));
+		if (paths[i].empty())
+			continue;
+
+		// paths are ordered from target to start, so the last waypoint is followed first
+		cursor.waypoint = static_cast<uint32_t>(paths[i].size() - 1);
+		cursor.path = m_paths.insert(std::move(paths[i]));
+	}
+}
+
+//--------------------------------------------------------------------------
+
+void Simulation::stop(const Command & command)
+{
+	for (Entity entity : command.entities)
+	{
+		const Owner * owner = m_world.get<Owner>(entity);
+		PathCursor * cursor = m_world.get<PathCursor>(entity);
+		Velocity * velocity = m_world.get<Velocity>(entity);
+		if (owner != nullptr && cursor != nullptr && velocity != nullptr && owner->player == command.player)
+			releasePath(*cursor, *velocity);
+	}
+}
+
+//--------------------------------------------------------------------------
+
+void Simulation::createUnit(const Command & command)
+{
+	if (m_grid.isBlocked(m_grid.getIndex(command.target.x, command.target.y)))
+		return;
+
+	float x = static_cast<float>(command.target.x) + 0.5f;
+	float y = static_cast<float>(command.target.y) + 0.5f;
+	PathCursor cursor;
+	cursor.speed = UNIT_SPEED;
+	m_world.create(Position{ x, y }, Velocity{}, cursor, Health{ UNIT_HEALTH, UNIT_HEALTH }, Owner{ command.player }, AnimationState{},
+		PreviousPosition{ x, y }, Sight{ UNIT_SIGHT, -1 });
+}
+
+//--------------------------------------------------------------------------
+
+void Simulation::releasePath(PathCursor & cursor, Velocity & velocity)
+{
+	if (cursor.path.isValid())
+		m_paths.erase(cursor.path);
+	cursor.path.invalidate();
+	cursor.waypoint = 0u;
+	velocity = Velocity();
+}
@@ -0,0 +1,175 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <vector>
+#include <random>
+#include <cstdint>
+#include <SFML/Graphics.hpp>
+
+//--------------------------------------------------------------------------
+
+#include "World.h"
+#include "Systems.h"
+#include "Steering.h"
+#include "SpatialHash.h"
+#include "SaveGame.h"
+#include "InfluenceMap.h"
+#include "../logic/Grid.h"
+#include "../logic/ByteStream.h"
+#include "../logic/FogOfWar.h"
+#include "../logic/JobSystem.h"
+#include "../logic/PathingSystem.h"
+#include "../logic/GroupMovePlanner.h"
+
+//--------------------------------------------------------------------------
+
+namespace ecs
+{
+	/*!
+	* \brief Order of the player, the only way how players change the simulation
+	*/
+	struct Command
+	{
+		enum class Type : uint8_t
+		{
+			MOVE,			///< entities move to target as a group
+			STOP,			///< entities stop and forget their paths
+			CREATE_UNIT,	///< new unit of the player is created on target tile
+			COUNT,
+		};
+
+		Type type{ Type::STOP };			///< kind of the order
+		uint8_t player{ 0u };				///< player who gave the order, only entities of this player are affected
+		sf::Vector2i target;				///< target tile
+		std::vector<Entity> entities;		///< ordered entities
+	};
+
+	/*!
+	* \brief Append compact encoding of the command (type byte followed by variable length operands)
+	*/
+	void writeCommand(logic::ByteWriter & writer, const Command & command);
+
+	/*!
+	* \brief Read command written by writeCommand()
+	*
+	* \throw std::runtime_error if data is truncated or isn't a valid command
+	*
+	*/
+	void readCommand(logic::ByteReader & reader, Command & command);
+
+	//--------------------------------------------------------------------------
+
+	/*!
+	* \brief Whole deterministic simulation of one game
+	*
+	* Simulation depends only on the grid, the seed and executed commands, so the same commands executed in the same
+	* ticks give the same state on every computer and with any amount of worker threads. State can be compared by
+	* computeHash().
+	*
+	* Usage example:
+	* \code
+	* ecs::Simulation simulation(grid, seed);
+	* simulation.execute(command);	// commands are executed before the step of the tick
+	* simulation.step(jobs);
+	* uint64_t hash = simulation.computeHash();
+	* \endcode
+	*
+	*/
+	class Simulation
+	{
+	public:
+		static constexpr float TICK_TIME = 1.f / SIMULATION_RATE;	///< simulated time of one tick in seconds
+		static constexpr float UNIT_SPEED = 2.f;					///< move speed of created units in tiles per second
+		static constexpr uint32_t UNIT_SIGHT = 6u;					///< sight radius of created units
+		static constexpr int16_t UNIT_HEALTH = 100;				///< health of created units
+		static constexpr uint32_t INFLUENCE_INTERVAL = 5u;			///< influence map is refreshed every this many ticks
+
+		/*!
+		* \brief Default constructor
+		*
+		* \param grid Map of the game, it must outlive simulation
+		* \param seed Seed of random generator of the simulation
+		*
+		*/
+		Simulation(Grid & grid, uint32_t seed);
+
+		/*!
+		* \brief Execute command in current tick, invalid commands and entities of other players are ignored
+		*/
+		void execute(const Command & command);
+
+		/*!
+		* \brief Simulate one tick
+		*/
+		void step(logic::JobSystem & jobs);
+
+		/*!
+		* \brief Hash of all entities, paths, random generator and number of the tick
+		*/
+		uint64_t computeHash();
+
+		/*!
+		* \brief Return pointers to state saved by SaveGame
+		*/
+		SimulationState getState();
+
+		inline uint32_t getTick() const { return m_tick; }
+		inline Grid & getGrid() { return m_grid; }
+		inline World & getWorld() { return m_world; }
+		inline PathStorage & getPaths() { return m_paths; }
+		inline const FogOfWar & getFog() const { return m_fog; }
+		inline const SpatialHash & getSpatialHash() const { return m_spatialHash; }
+		inline const InfluenceMap & getInfluence() const { return m_influence; }
+
+	private:
+		void move(const Command & command);
+		void stop(const Command & command);
+		void createUnit(const Command & command);
+
+		/*!
+		* \brief Release path followed by entity and stop it
+		*/
+		void releasePath(PathCursor & cursor, Velocity & velocity);
+
+	private:
+		Grid & m_grid;						///< map of the game
+		uint32_t m_tick{ 0u };				///< number of simulated ticks
+		std::mt19937 m_random;				///< random generator of the simulation
+		World m_world;						///< all simulated units and buildings
+		PathStorage m_paths;				///< paths followed by units
+		PathFollowSystem m_pathFollow{ m_paths };
+		SteeringSystem m_steering;
+		MovementSystem m_movement;
+		AnimationSystem m_animation;
+		HealthSystem m_health;
+		FogSystem m_fogSystem;
+		SpatialHash m_spatialHash;			///< unit positions after last step
+		FogOfWar m_fog;						///< visible and explored tiles of every player
+		InfluenceMap m_influence;			///< influence layers read by AI, derived from the state so it isn't hashed
+		PathingSystem m_pathing;			///< searches paths of move commands
+		GroupMovePlanner m_planner;			///< plans paths of moved groups
+
+		// helper data of move(), kept to avoid allocations
+		std::vector<Entity> m_moved;				///< entities which take part in move
+		std::vector<sf::Vector2i> m_movedTiles;		///< start tiles of moved entities
+	};
+}
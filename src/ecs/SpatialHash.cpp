@@ -0,0 +1,101 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//--------------------------------------------------------------------------
+
+#include "SpatialHash.h"
+
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+
+using namespace ecs;
+
+//--------------------------------------------------------------------------
+
+SpatialHash::SpatialHash(sf::Vector2i cellGridSize) :
+	m_cellGridSize{ cellGridSize }
+{
+	assert(cellGridSize.x > 0 && cellGridSize.y > 0);
+	m_cellStart.resize(cellGridSize.x*cellGridSize.y + 1, 0u);
+}
+
+//--------------------------------------------------------------------------
+
+void SpatialHash::rebuild(World & world)
+{
+	m_gatheredEntities.clear();
+	m_gatheredPositions.clear();
+	m_cellOfEntry.clear();
+	std::fill(m_cellStart.begin(), m_cellStart.end(), 0u);
+
+	// gather positions and count entities of every cell
+	world.forEach<Position>([this](std::size_t count, const Entity * entities, Position * position)
+	{
+		m_gatheredEntities.insert(m_gatheredEntities.end(), entities, entities + count);
+		m_gatheredPositions.insert(m_gatheredPositions.end(), position, position + count);
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			sf::Vector2i cell = cellOf(position[i].x, position[i].y);
+			uint32_t cellIndex = cell.y*m_cellGridSize.x + cell.x;
+			m_cellOfEntry.push_back(cellIndex);
+			++m_cellStart[cellIndex + 1];
+		}
+	});
+
+	// prefix sum gives first index of every cell
+	for (std::size_t i = 1; i < m_cellStart.size(); ++i)
+		m_cellStart[i] += m_cellStart[i - 1];
+
+	// scatter entities to their cells, cursor of cell starts at it's first index
+	std::size_t count = m_gatheredEntities.size();
+	m_entities.resize(count);
+	m_positions.resize(count);
+	m_cellCursor.assign(m_cellStart.begin(), m_cellStart.end() - 1);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		uint32_t target = m_cellCursor[m_cellOfEntry[i]]++;
+		m_entities[target] = m_gatheredEntities[i];
+		m_positions[target] = m_gatheredPositions[i];
+	}
+}
+
+//--------------------------------------------------------------------------
+
+void SpatialHash::querySpans(sf::FloatRect area, std::vector<Span> & spans) const
+{
+	spans.clear();
+	sf::Vector2i first = cellOf(area.left, area.top);
+	sf::Vector2i last = cellOf(area.left + area.width, area.top + area.height);
+	for (int y = first.y; y <= last.y; ++y)
+	{
+		uint32_t begin = m_cellStart[y*m_cellGridSize.x + first.x];
+		uint32_t end = m_cellStart[y*m_cellGridSize.x + last.x + 1];
+		if (begin != end)
+			spans.push_back(Span{ m_entities.data() + begin, m_positions.data() + begin, end - begin });
+	}
+}
+
+//--------------------------------------------------------------------------
+
+std::size_t SpatialHash::queryRadius(sf::Vector2f center, float radius, std::vector<Entity> & result) const
+{
+	result.clear();
+	forEachInRadius(center, radius, [&result](Entity entity, const Position &) { result.push_back(entity); });
+	return result.size();
+}
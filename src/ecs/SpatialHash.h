@@ -0,0 +1,143 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <vector>
+#include <algorithm>
+#include <SFML/Graphics.hpp>
+
+//--------------------------------------------------------------------------
+
+#include "World.h"
+#include "../logic/defines.h"
+
+//--------------------------------------------------------------------------
+
+namespace ecs
+{
+	/*!
+	* \brief Uniform grid index of entity positions with cells equal to grid chunks
+	*
+	* Entities are sorted by cell with counting sort in every rebuild(), so entities of one cell are stored next to each other
+	* and cells of one row of the index are stored next to each other too. Query of any rectangle touches one contiguous
+	* span per row of cells.
+	*
+	* Usage example:
+	* \code
+	* ecs::SpatialHash index(grid.getChunkGridSize());
+	* index.rebuild(world);
+	* index.forEachInRadius(sf::Vector2f(10.f, 12.f), 4.f, [](ecs::Entity entity, const ecs::Position & position) { ... });
+	* \endcode
+	*
+	*/
+	class SpatialHash
+	{
+	public:
+		/*!
+		* \brief Entities and their positions stored next to each other in the index
+		*/
+		struct Span
+		{
+			const Entity * entities;		///< first entity of span
+			const Position * positions;		///< position of first entity of span
+			std::size_t count;				///< amount of entities in span
+		};
+
+		/*!
+		* \brief Default constructor
+		*
+		* \param cellGridSize Amount of cells in x and y direction, equal to amount of chunks of the grid
+		*
+		*/
+		SpatialHash(sf::Vector2i cellGridSize);
+
+		/*!
+		* \brief Rebuild index from positions of all entities
+		*/
+		void rebuild(World & world);
+
+		/*!
+		* \brief Return spans of all cells touched by rectangle, one span for every row of cells
+		*
+		* \param area Rectangle in grid coordinates
+		* \param spans Vector which is cleared and filled with spans
+		*
+		*/
+		void querySpans(sf::FloatRect area, std::vector<Span> & spans) const;
+
+		/*!
+		* \brief Call function(Entity, const Position &) for every entity inside circle
+		*/
+		template <typename F>
+		void forEachInRadius(sf::Vector2f center, float radius, F function) const
+		{
+			sf::Vector2i first = cellOf(center.x - radius, center.y - radius);
+			sf::Vector2i last = cellOf(center.x + radius, center.y + radius);
+			float radiusSquared = radius*radius;
+			for (int y = first.y; y <= last.y; ++y)
+			{
+				std::size_t begin = m_cellStart[y*m_cellGridSize.x + first.x];
+				std::size_t end = m_cellStart[y*m_cellGridSize.x + last.x + 1];
+				for (std::size_t i = begin; i < end; ++i)
+				{
+					float dx = m_positions[i].x - center.x;
+					float dy = m_positions[i].y - center.y;
+					if (dx*dx + dy*dy <= radiusSquared)
+						function(m_entities[i], m_positions[i]);
+				}
+			}
+		}
+
+		/*!
+		* \brief Fill vector with all entities inside circle
+		*
+		* \return Amount of found entities
+		*
+		*/
+		std::size_t queryRadius(sf::Vector2f center, float radius, std::vector<Entity> & result) const;
+
+		inline std::size_t size() const { return m_entities.size(); }
+		inline sf::Vector2i getCellGridSize() const { return m_cellGridSize; }
+
+	private:
+		/*!
+		* \brief Return cell of position, positions outside of the grid are clamped to the border cells
+		*/
+		inline sf::Vector2i cellOf(float x, float y) const
+		{
+			int cellX = static_cast<int>(x) / static_cast<int>(CHUNK_SIZE);
+			int cellY = static_cast<int>(y) / static_cast<int>(CHUNK_SIZE);
+			return sf::Vector2i(std::min(std::max(cellX, 0), m_cellGridSize.x - 1), std::min(std::max(cellY, 0), m_cellGridSize.y - 1));
+		}
+
+	private:
+		sf::Vector2i m_cellGridSize;				///< amount of cells in x and y direction
+		std::vector<uint32_t> m_cellStart;			///< index of first entity of every cell, last value is amount of all entities
+		std::vector<Entity> m_entities;				///< entities sorted by cell
+		std::vector<Position> m_positions;			///< positions of sorted entities
+
+		// helper data of rebuild(), kept to avoid allocations
+		std::vector<uint32_t> m_cellOfEntry;		///< cell of every gathered entity
+		std::vector<uint32_t> m_cellCursor;			///< next free index of every cell during scatter
+		std::vector<Entity> m_gatheredEntities;		///< entities in order of archetypes
+		std::vector<Position> m_gatheredPositions;	///< positions in order of archetypes
+	};
+}
@@ -0,0 +1,400 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//--------------------------------------------------------------------------
+
+#include "Steering.h"
+
+//--------------------------------------------------------------------------
+
+#include <cmath>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define STEERING_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+//--------------------------------------------------------------------------
+
+using namespace ecs;
+
+//--------------------------------------------------------------------------
+
+constexpr std::size_t SteeringSystem::LANES;
+constexpr std::size_t SteeringSystem::MAX_NEIGHBORS;
+constexpr float SteeringSystem::NEIGHBOR_RADIUS;
+constexpr float SteeringSystem::SEPARATION_WEIGHT;
+constexpr float SteeringSystem::COHESION_WEIGHT;
+constexpr float SteeringSystem::COINCIDENT_DISTANCE;
+
+//--------------------------------------------------------------------------
+
+namespace
+{
+	constexpr std::size_t LANES = SteeringSystem::LANES;
+	constexpr std::size_t MAX_NEIGHBORS = SteeringSystem::MAX_NEIGHBORS;
+	constexpr std::size_t GROUP_NEIGHBORS = LANES*MAX_NEIGHBORS;	///< neighbour values of one group of units
+
+	/*!
+	* \brief Directions used to separate units standing at the same position, exact constants so every machine agrees
+	*/
+	constexpr float COINCIDENT_DIRECTIONS[8][2] =
+	{
+		{ 1.f, 0.f }, { 0.70710678f, 0.70710678f }, { 0.f, 1.f }, { -0.70710678f, 0.70710678f },
+		{ -1.f, 0.f }, { -0.70710678f, -0.70710678f }, { 0.f, -1.f }, { 0.70710678f, -0.70710678f },
+	};
+
+	/*!
+	* \brief Pointers to SoA arrays passed to kernels
+	*/
+	struct KernelData
+	{
+		const float * desiredX;
+		const float * desiredY;
+		const float * maxSpeed;
+		const float * cohesion;
+		const float * offsetX;
+		const float * offsetY;
+		const float * used;
+		float * velocityX;
+		float * velocityY;
+		std::size_t groupCount;
+	};
+
+	/*!
+	* \brief Reference kernel, SIMD kernels below are the same code written for 4 and 8 lanes
+	*
+	* Empty neighbour slots are masked by used flag, offsets of used slots are never zero. Masked values are replaced with +0
+	* and all sums are accumulated in neighbour order, so vector kernels give bit
+	* identical results. Code must be compiled without contraction into fused multiply-add.
+	*
+	*/
+	void steerScalar(const KernelData & data)
+	{
+		const float radiusSquared = SteeringSystem::NEIGHBOR_RADIUS*SteeringSystem::NEIGHBOR_RADIUS;
+		for (std::size_t group = 0; group < data.groupCount; ++group)
+		{
+			for (std::size_t lane = 0; lane < LANES; ++lane)
+			{
+				std::size_t unit = group*LANES + lane;
+				float separationX = 0.f;
+				float separationY = 0.f;
+				float centerX = 0.f;
+				float centerY = 0.f;
+				float count = 0.f;
+				for (std::size_t k = 0; k < MAX_NEIGHBORS; ++k)
+				{
+					std::size_t neighbor = group*GROUP_NEIGHBORS + k*LANES + lane;
+					float dx = data.offsetX[neighbor];
+					float dy = data.offsetY[neighbor];
+					float distanceSquared = dx*dx + dy*dy;
+					bool inside = data.used[neighbor] > 0.f && distanceSquared < radiusSquared;
+
+					// separation falls with distance, dx/d^2 is unit direction divided by distance
+					float inverse = inside ? 1.f / distanceSquared : 0.f;
+					separationX += dx*inverse;
+					separationY += dy*inverse;
+					centerX -= inside ? dx : 0.f;
+					centerY -= inside ? dy : 0.f;
+					count += inside ? 1.f : 0.f;
+				}
+
+				float cohesionX = (count > 0.f) ? centerX / count : 0.f;
+				float cohesionY = (count > 0.f) ? centerY / count : 0.f;
+				float velocityX = (data.desiredX[unit] + SteeringSystem::SEPARATION_WEIGHT*separationX) + data.cohesion[unit] * cohesionX;
+				float velocityY = (data.desiredY[unit] + SteeringSystem::SEPARATION_WEIGHT*separationY) + data.cohesion[unit] * cohesionY;
+
+				float speedSquared = velocityX*velocityX + velocityY*velocityY;
+				if (speedSquared > data.maxSpeed[unit] * data.maxSpeed[unit])
+				{
+					float scale = data.maxSpeed[unit] / std::sqrt(speedSquared);
+					velocityX = velocityX*scale;
+					velocityY = velocityY*scale;
+				}
+				data.velocityX[unit] = velocityX;
+				data.velocityY[unit] = velocityY;
+			}
+		}
+	}
+
+#ifdef STEERING_X86_DISPATCH
+	/*!
+	* \brief steerScalar() for 4 units at once
+	*/
+	__attribute__((target("sse2")))
+	void steerSSE(const KernelData & data)
+	{
+		const __m128 radiusSquared = _mm_set1_ps(SteeringSystem::NEIGHBOR_RADIUS*SteeringSystem::NEIGHBOR_RADIUS);
+		const __m128 separationWeight = _mm_set1_ps(SteeringSystem::SEPARATION_WEIGHT);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.f);
+		for (std::size_t group = 0; group < data.groupCount; ++group)
+		{
+			for (std::size_t half = 0; half < LANES; half += 4)
+			{
+				std::size_t unit = group*LANES + half;
+				__m128 separationX = zero;
+				__m128 separationY = zero;
+				__m128 centerX = zero;
+				__m128 centerY = zero;
+				__m128 count = zero;
+				for (std::size_t k = 0; k < MAX_NEIGHBORS; ++k)
+				{
+					std::size_t neighbor = group*GROUP_NEIGHBORS + k*LANES + half;
+					__m128 dx = _mm_loadu_ps(data.offsetX + neighbor);
+					__m128 dy = _mm_loadu_ps(data.offsetY + neighbor);
+					__m128 distanceSquared = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+					__m128 inside = _mm_and_ps(_mm_cmpgt_ps(_mm_loadu_ps(data.used + neighbor), zero), _mm_cmplt_ps(distanceSquared, radiusSquared));
+
+					__m128 inverse = _mm_and_ps(_mm_div_ps(one, distanceSquared), inside);
+					separationX = _mm_add_ps(separationX, _mm_mul_ps(dx, inverse));
+					separationY = _mm_add_ps(separationY, _mm_mul_ps(dy, inverse));
+					centerX = _mm_sub_ps(centerX, _mm_and_ps(dx, inside));
+					centerY = _mm_sub_ps(centerY, _mm_and_ps(dy, inside));
+					count = _mm_add_ps(count, _mm_and_ps(one, inside));
+				}
+
+				__m128 hasNeighbors = _mm_cmpgt_ps(count, zero);
+				__m128 cohesionX = _mm_and_ps(_mm_div_ps(centerX, count), hasNeighbors);
+				__m128 cohesionY = _mm_and_ps(_mm_div_ps(centerY, count), hasNeighbors);
+				__m128 cohesion = _mm_loadu_ps(data.cohesion + unit);
+				__m128 velocityX = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(data.desiredX + unit), _mm_mul_ps(separationWeight, separationX)), _mm_mul_ps(cohesion, cohesionX));
+				__m128 velocityY = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(data.desiredY + unit), _mm_mul_ps(separationWeight, separationY)), _mm_mul_ps(cohesion, cohesionY));
+
+				__m128 maxSpeed = _mm_loadu_ps(data.maxSpeed + unit);
+				__m128 speedSquared = _mm_add_ps(_mm_mul_ps(velocityX, velocityX), _mm_mul_ps(velocityY, velocityY));
+				__m128 tooFast = _mm_cmpgt_ps(speedSquared, _mm_mul_ps(maxSpeed, maxSpeed));
+				__m128 scale = _mm_div_ps(maxSpeed, _mm_sqrt_ps(speedSquared));
+				velocityX = _mm_or_ps(_mm_and_ps(tooFast, _mm_mul_ps(velocityX, scale)), _mm_andnot_ps(tooFast, velocityX));
+				velocityY = _mm_or_ps(_mm_and_ps(tooFast, _mm_mul_ps(velocityY, scale)), _mm_andnot_ps(tooFast, velocityY));
+				_mm_storeu_ps(data.velocityX + unit, velocityX);
+				_mm_storeu_ps(data.velocityY + unit, velocityY);
+			}
+		}
+	}
+
+	/*!
+	* \brief steerScalar() for 8 units at once
+	*/
+	__attribute__((target("avx")))
+	void steerAVX(const KernelData & data)
+	{
+		const __m256 radiusSquared = _mm256_set1_ps(SteeringSystem::NEIGHBOR_RADIUS*SteeringSystem::NEIGHBOR_RADIUS);
+		const __m256 separationWeight = _mm256_set1_ps(SteeringSystem::SEPARATION_WEIGHT);
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.f);
+		for (std::size_t group = 0; group < data.groupCount; ++group)
+		{
+			std::size_t unit = group*LANES;
+			__m256 separationX = zero;
+			__m256 separationY = zero;
+			__m256 centerX = zero;
+			__m256 centerY = zero;
+			__m256 count = zero;
+			for (std::size_t k = 0; k < MAX_NEIGHBORS; ++k)
+			{
+				std::size_t neighbor = group*GROUP_NEIGHBORS + k*LANES;
+				__m256 dx = _mm256_loadu_ps(data.offsetX + neighbor);
+				__m256 dy = _mm256_loadu_ps(data.offsetY + neighbor);
+				__m256 distanceSquared = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+				__m256 inside = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(data.used + neighbor), zero, _CMP_GT_OQ), _mm256_cmp_ps(distanceSquared, radiusSquared, _CMP_LT_OQ));
+
+				__m256 inverse = _mm256_and_ps(_mm256_div_ps(one, distanceSquared), inside);
+				separationX = _mm256_add_ps(separationX, _mm256_mul_ps(dx, inverse));
+				separationY = _mm256_add_ps(separationY, _mm256_mul_ps(dy, inverse));
+				centerX = _mm256_sub_ps(centerX, _mm256_and_ps(dx, inside));
+				centerY = _mm256_sub_ps(centerY, _mm256_and_ps(dy, inside));
+				count = _mm256_add_ps(count, _mm256_and_ps(one, inside));
+			}
+
+			__m256 hasNeighbors = _mm256_cmp_ps(count, zero, _CMP_GT_OQ);
+			__m256 cohesionX = _mm256_and_ps(_mm256_div_ps(centerX, count), hasNeighbors);
+			__m256 cohesionY = _mm256_and_ps(_mm256_div_ps(centerY, count), hasNeighbors);
+			__m256 cohesion = _mm256_loadu_ps(data.cohesion + unit);
+			__m256 velocityX = _mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(data.desiredX + unit), _mm256_mul_ps(separationWeight, separationX)), _mm256_mul_ps(cohesion, cohesionX));
+			__m256 velocityY = _mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(data.desiredY + unit), _mm256_mul_ps(separationWeight, separationY)), _mm256_mul_ps(cohesion, cohesionY));
+
+			__m256 maxSpeed = _mm256_loadu_ps(data.maxSpeed + unit);
+			__m256 speedSquared = _mm256_add_ps(_mm256_mul_ps(velocityX, velocityX), _mm256_mul_ps(velocityY, velocityY));
+			__m256 tooFast = _mm256_cmp_ps(speedSquared, _mm256_mul_ps(maxSpeed, maxSpeed), _CMP_GT_OQ);
+			__m256 scale = _mm256_div_ps(maxSpeed, _mm256_sqrt_ps(speedSquared));
+			velocityX = _mm256_blendv_ps(velocityX, _mm256_mul_ps(velocityX, scale), tooFast);
+			velocityY = _mm256_blendv_ps(velocityY, _mm256_mul_ps(velocityY, scale), tooFast);
+			_mm256_storeu_ps(data.velocityX + unit, velocityX);
+			_mm256_storeu_ps(data.velocityY + unit, velocityY);
+		}
+	}
+
+	const bool hasSSE = __builtin_cpu_supports("sse2");
+	const bool hasAVX = __builtin_cpu_supports("avx");
+#endif
+}
+
+//--------------------------------------------------------------------------
+
+SteeringSystem::SteeringSystem() :
+	m_kernel{ Kernel::SCALAR }
+{
+	if (!setKernel(Kernel::AVX))
+		setKernel(Kernel::SSE);
+}
+
+//--------------------------------------------------------------------------
+
+bool SteeringSystem::setKernel(Kernel kernel)
+{
+	bool supported = (kernel == Kernel::SCALAR);
+#ifdef STEERING_X86_DISPATCH
+	supported = supported || (kernel == Kernel::SSE && hasSSE) || (kernel == Kernel::AVX && hasAVX);
+#endif
+	if (supported)
+		m_kernel = kernel;
+	return supported;
+}
+
+//--------------------------------------------------------------------------
+
+void SteeringSystem::update(World & world, const SpatialHash & neighbors)
+{
+	std::size_t unitCount = gather(world, neighbors);
+	if (unitCount == 0)
+		return;
+
+	KernelData data{ m_desiredX.data(), m_desiredY.data(), m_maxSpeed.data(), m_cohesion.data(), m_offsetX.data(), m_offsetY.data(),
+		m_used.data(), m_velocityX.data(), m_velocityY.data(), (unitCount + LANES - 1) / LANES };
+
+	switch (m_kernel)
+	{
+#ifdef STEERING_X86_DISPATCH
+	case Kernel::AVX:
+		steerAVX(data);
+		break;
+	case Kernel::SSE:
+		steerSSE(data);
+		break;
+#endif
+	default:
+		steerScalar(data);
+		break;
+	}
+
+	scatter(world);
+}
+
+//--------------------------------------------------------------------------
+
+std::size_t SteeringSystem::gather(World & world, const SpatialHash & neighbors)
+{
+	std::size_t unitCount = 0;
+	world.forEach<Position, Velocity, PathCursor>([&unitCount](std::size_t count, const Entity *, Position *, Velocity *, PathCursor *)
+	{
+		unitCount += count;
+	});
+
+	// padding units have no neighbours and no speed, so kernels compute zero for them
+	std::size_t paddedCount = (unitCount + LANES - 1) / LANES * LANES;
+	for (auto column : { &m_desiredX, &m_desiredY, &m_maxSpeed, &m_cohesion, &m_velocityX, &m_velocityY })
+		column->assign(paddedCount, 0.f);
+	for (auto column : { &m_offsetX, &m_offsetY, &m_used })
+		column->assign(paddedCount*MAX_NEIGHBORS, 0.f);
+
+	std::size_t unit = 0;
+	world.forEach<Position, Velocity, PathCursor>([this, &unit, &neighbors](std::size_t count, const Entity * entities, Position * position,
+		Velocity * velocity, PathCursor * cursor)
+	{
+		for (std::size_t i = 0; i < count; ++i, ++unit)
+		{
+			m_desiredX[unit] = velocity[i].x;
+			m_desiredY[unit] = velocity[i].y;
+			m_maxSpeed[unit] = cursor[i].speed;
+			m_cohesion[unit] = cursor[i].path.isValid() ? COHESION_WEIGHT : 0.f;
+
+			std::size_t first = unit / LANES * GROUP_NEIGHBORS + unit % LANES;
+			// spans are scanned directly and slots are filled in scan order; when all slots are used, only units standing at
+			// the same position are still taken and they replace the last neighbours, otherwise stacks inside crowds never separate
+			std::size_t found = 0;
+			std::size_t replaced = MAX_NEIGHBORS;
+			bool stacked[MAX_NEIGHBORS] = {};
+			float x = position[i].x;
+			float y = position[i].y;
+			neighbors.querySpans(sf::FloatRect(x - NEIGHBOR_RADIUS, y - NEIGHBOR_RADIUS, 2.f*NEIGHBOR_RADIUS, 2.f*NEIGHBOR_RADIUS), m_spans);
+			for (std::size_t span = 0; span < m_spans.size() && replaced > 0; ++span)
+			{
+				const SpatialHash::Span & cells = m_spans[span];
+				for (std::size_t j = 0; j < cells.count && replaced > 0; ++j)
+				{
+					float dx = x - cells.positions[j].x;
+					float dy = y - cells.positions[j].y;
+					bool coincident = (dx == 0.f && dy == 0.f);
+					if (cells.entities[j] == entities[i])
+						continue;
+
+					std::size_t slot;
+					if (found < MAX_NEIGHBORS)
+					{
+						if (dx*dx + dy*dy >= NEIGHBOR_RADIUS*NEIGHBOR_RADIUS)
+							continue;
+						slot = found++;
+					}
+					else
+					{
+						if (!coincident)
+							continue;
+						while (replaced > 0 && stacked[replaced - 1])
+							--replaced;
+						if (replaced == 0)
+							continue;
+						slot = --replaced;
+					}
+
+					if (coincident)
+					{
+						// the same direction for both units of the pair, unit with lower index goes forward
+						uint32_t index = entities[i].index;
+						uint32_t other = cells.entities[j].index;
+						const float * direction = COINCIDENT_DIRECTIONS[(index ^ other) % 8u];
+						float sign = (index < other) ? COINCIDENT_DISTANCE : -COINCIDENT_DISTANCE;
+						dx = direction[0] * sign;
+						dy = direction[1] * sign;
+					}
+					stacked[slot] = coincident;
+					m_offsetX[first + slot*LANES] = dx;
+					m_offsetY[first + slot*LANES] = dy;
+					m_used[first + slot*LANES] = 1.f;
+				}
+			}
+		}
+	});
+	return unitCount;
+}
+
+//--------------------------------------------------------------------------
+
+void SteeringSystem::scatter(World & world)
+{
+	std::size_t unit = 0;
+	// the same query as in gather(), so archetypes are visited in the same order
+	world.forEach<Position, Velocity, PathCursor>([this, &unit](std::size_t count, const Entity *, Position *, Velocity * velocity, PathCursor *)
+	{
+		for (std::size_t i = 0; i < count; ++i, ++unit)
+		{
+			velocity[i].x = m_velocityX[unit];
+			velocity[i].y = m_velocityY[unit];
+		}
+	});
+}
@@ -0,0 +1,121 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <vector>
+#include <cstddef>
+
+//--------------------------------------------------------------------------
+
+#include "World.h"
+#include "SpatialHash.h"
+
+//--------------------------------------------------------------------------
+
+namespace ecs
+{
+	/*!
+	* \brief Local avoidance of units which follow paths
+	*
+	* Velocity written by PathFollowSystem is the desired velocity. Steering adds separation from neighbours closer than
+	* NEIGHBOR_RADIUS and, for units which have path, cohesion towards centroid of neighbours, then clamps speed to speed of
+	* PathCursor. Neighbours are read from SpatialHash built after previous step, at most MAX_NEIGHBORS per unit. Neighbour
+	* standing at exactly the same position is pushed away in one of 8 fixed directions chosen from entity indices, and both
+	* units get opposite directions, so stacked units separate deterministically.
+	*
+	* All inputs are gathered into SoA arrays, units are processed in groups of LANES with one unit per SIMD lane, and new
+	* velocities are written back in one pass. Every kernel (scalar, SSE, AVX) performs the same IEEE operations in the same
+	* order for every unit, so all of them produce bit identical velocities and simulation stays deterministic on every
+	* machine.
+	*
+	*/
+	class SteeringSystem
+	{
+	public:
+		static constexpr std::size_t LANES = 8;				///< units processed together, width of AVX register
+		static constexpr std::size_t MAX_NEIGHBORS = 8;		///< maximum amount of neighbours taken into account
+		static constexpr float NEIGHBOR_RADIUS = 1.5f;		///< neighbours closer than this distance (in tiles) are avoided
+		static constexpr float SEPARATION_WEIGHT = 0.6f;	///< weight of separation force
+		static constexpr float COHESION_WEIGHT = 0.3f;		///< weight of cohesion force of units which follow path
+		static constexpr float COINCIDENT_DISTANCE = 0.25f;	///< distance assumed for neighbour standing at the same position
+
+		/*!
+		* \brief Id of implementation of the steering kernel
+		*/
+		enum class Kernel
+		{
+			SCALAR,
+			SSE,
+			AVX,
+		};
+
+		/*!
+		* \brief Default constructor, the fastest kernel supported by processor is selected
+		*/
+		SteeringSystem();
+
+		/*!
+		* \brief Compute new velocities of all entities with Position, Velocity and PathCursor
+		*/
+		void update(World & world, const SpatialHash & neighbors);
+
+		/*!
+		* \brief Select kernel, used to compare results of different kernels
+		*
+		* \return False if kernel is not supported by processor, selected kernel is not changed then
+		*
+		*/
+		bool setKernel(Kernel kernel);
+		inline Kernel getKernel() const { return m_kernel; }
+
+	private:
+		/*!
+		* \brief Copy positions, desired velocities and neighbours of all units to SoA arrays
+		*
+		* \return Amount of gathered units
+		*
+		*/
+		std::size_t gather(World & world, const SpatialHash & neighbors);
+
+		/*!
+		* \brief Write computed velocities back to Velocity columns
+		*/
+		void scatter(World & world);
+
+	private:
+		Kernel m_kernel;					///< selected kernel
+
+		// SoA arrays of all units, padded to multiple of LANES
+		std::vector<float> m_desiredX;		///< x of velocity computed by path following
+		std::vector<float> m_desiredY;		///< y of velocity computed by path following
+		std::vector<float> m_maxSpeed;		///< speed of the unit
+		std::vector<float> m_cohesion;		///< weight of cohesion, 0 for units without path
+		std::vector<float> m_velocityX;		///< x of steered velocity
+		std::vector<float> m_velocityY;		///< y of steered velocity
+
+		// neighbour slots, MAX_NEIGHBORS rows of LANES values for every group of units
+		std::vector<float> m_offsetX;		///< x of vector from neighbour to the unit
+		std::vector<float> m_offsetY;		///< y of vector from neighbour to the unit
+		std::vector<float> m_used;			///< 1 for slots which hold neighbour, 0 for empty slots
+
+		std::vector<SpatialHash::Span> m_spans;	///< helper vector of neighbour queries
+	};
+}
@@ -0,0 +1,237 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//--------------------------------------------------------------------------
+
+#include "Systems.h"
+
+//--------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+
+//--------------------------------------------------------------------------
+
+#include "../logic/defines.h"
+
+//--------------------------------------------------------------------------
+
+using namespace ecs;
+
+//--------------------------------------------------------------------------
+
+constexpr float AnimationSystem::FRAME_TIME;
+
+//--------------------------------------------------------------------------
+
+void MovementSystem::update(World & world, float deltaTime, logic::JobSystem & jobs)
+{
+	m_jobs.clear();
+	world.forEach<Position, Velocity>([this, deltaTime, &jobs](std::size_t count, const Entity *, Position * position, Velocity * velocity)
+	{
+		// plain loop over two contiguous columns, compiler vectorizes it
+		m_jobs.push_back(jobs.parallelFor(0, count, PARALLEL_GRAIN, [deltaTime, position, velocity](std::size_t begin, std::size_t end)
+		{
+			for (std::size_t i = begin; i < end; ++i)
+			{
+				position[i].x += velocity[i].x * deltaTime;
+				position[i].y += velocity[i].y * deltaTime;
+			}
+		}));
+	});
+	jobs.wait(m_jobs);
+}
+
+//--------------------------------------------------------------------------
+
+void PathFollowSystem::update(World & world, float deltaTime)
+{
+	world.forEach<Position, Velocity, PathCursor>([this, deltaTime](std::size_t count, const Entity *, Position * position, Velocity * velocity,
+		PathCursor * cursor)
+	{
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const std::vector<sf::Vector2i> * path = m_paths.get(cursor[i].path);
+			if (path == nullptr)
+			{
+				velocity[i] = Velocity();
+				continue;
+			}
+
+			// waypoint is reached if it can be reached in this tick
+			sf::Vector2i waypoint = (*path)[cursor[i].waypoint];
+			float dx = static_cast<float>(waypoint.x) + 0.5f - position[i].x;
+			float dy = static_cast<float>(waypoint.y) + 0.5f - position[i].y;
+			float distance = std::sqrt(dx*dx + dy*dy);
+			float step = cursor[i].speed * deltaTime;
+			if (distance <= step)
+			{
+				if (cursor[i].waypoint == 0u)
+				{
+					position[i].x += dx;
+					position[i].y += dy;
+					velocity[i] = Velocity();
+					m_paths.erase(cursor[i].path);
+					cursor[i].path.invalidate();
+					continue;
+				}
+				--cursor[i].waypoint;
+			}
+
+			if (distance > 0.f)
+			{
+				velocity[i].x = dx / distance * cursor[i].speed;
+				velocity[i].y = dy / distance * cursor[i].speed;
+			}
+		}
+	});
+}
+
+//--------------------------------------------------------------------------
+
+void AnimationSystem::update(World & world, float deltaTime, logic::JobSystem & jobs)
+{
+	m_jobs.clear();
+	world.forEach<AnimationState>([this, deltaTime, &jobs](std::size_t count, const Entity *, AnimationState * animation)
+	{
+		m_jobs.push_back(jobs.parallelFor(0, count, PARALLEL_GRAIN, [deltaTime, animation](std::size_t begin, std::size_t end)
+		{
+			for (std::size_t i = begin; i < end; ++i)
+			{
+				animation[i].frameTime += deltaTime;
+				while (animation[i].frameTime >= FRAME_TIME)
+				{
+					animation[i].frameTime -= FRAME_TIME;
+					++animation[i].frame;
+				}
+			}
+		}));
+	});
+	jobs.wait(m_jobs);
+}
+
+//--------------------------------------------------------------------------
+
+void RenderSystem::storePositions(World & world)
+{
+	world.forEach<Position, PreviousPosition>([](std::size_t count, const Entity *, Position * position, PreviousPosition * previous)
+	{
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			previous[i].x = position[i].x;
+			previous[i].y = position[i].y;
+		}
+	});
+}
+
+//--------------------------------------------------------------------------
+
+void RenderSystem::render(World & world, sf::RenderTarget & target, float alpha)
+{
+	m_vertices.clear();
+	auto addQuad = [this](float x, float y)
+	{
+		// entity is drawn as half tile square centered on it's position
+		float left = (x - 0.25f) * TILE_PIXELS;
+		float top = (y - 0.25f) * TILE_PIXELS;
+		float size = 0.5f * TILE_PIXELS;
+		m_vertices.append(sf::Vertex(sf::Vector2f(left, top)));
+		m_vertices.append(sf::Vertex(sf::Vector2f(left + size, top)));
+		m_vertices.append(sf::Vertex(sf::Vector2f(left + size, top + size)));
+		m_vertices.append(sf::Vertex(sf::Vector2f(left, top + size)));
+	};
+
+	world.forEach<Position>([&](std::size_t count, const Entity * entities, Position * position)
+	{
+		// all entities of one call share archetype, so component of the first entity is the beginning of whole column
+		const PreviousPosition * previous = world.get<PreviousPosition>(entities[0]);
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			if (previous != nullptr)
+				addQuad(previous[i].x + (position[i].x - previous[i].x) * alpha, previous[i].y + (position[i].y - previous[i].y) * alpha);
+			else
+				addQuad(position[i].x, position[i].y);
+		}
+	});
+
+	target.draw(m_vertices);
+}
+
+//--------------------------------------------------------------------------
+
+unsigned int HealthSystem::update(World & world)
+{
+	m_dead.clear();
+	world.forEach<Health>([this](std::size_t count, const Entity * entities, Health * health)
+	{
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			// entities created from component mask have zero max health until they are initialized
+			if (health[i].max > 0 && health[i].current <= 0)
+				m_dead.push_back(entities[i]);
+		}
+	});
+
+	for (auto entity : m_dead)
+		world.destroy(entity);
+	return static_cast<unsigned int>(m_dead.size());
+}
+
+//--------------------------------------------------------------------------
+
+void FogSystem::update(World & world, FogOfWar & fog, logic::JobSystem & jobs)
+{
+	++m_updateCount;
+	world.forEach<Position, Owner, Sight>([this, &fog](std::size_t count, const Entity *, Position * position, Owner * owner, Sight * sight)
+	{
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			sf::Vector2i tile(static_cast<int>(std::floor(position[i].x)), static_cast<int>(std::floor(position[i].y)));
+
+			// viewer can't change player, so new one is created when entity changes owner and old one is removed below
+			if (sight[i].viewer >= 0 && fog.getViewerPlayer(sight[i].viewer) != owner[i].player)
+				sight[i].viewer = -1;
+
+			if (sight[i].viewer < 0)
+			{
+				sight[i].viewer = static_cast<int32_t>(fog.addViewer(owner[i].player, tile, sight[i].radius));
+				if (m_lastSeen.size() <= static_cast<std::size_t>(sight[i].viewer))
+					m_lastSeen.resize(sight[i].viewer + 1, 0u);
+				m_viewers.push_back(sight[i].viewer);
+			}
+			else
+			{
+				fog.moveViewer(sight[i].viewer, tile);
+				fog.setViewerRadius(sight[i].viewer, sight[i].radius);
+			}
+			m_lastSeen[sight[i].viewer] = m_updateCount;
+		}
+	});
+
+	// viewers which weren't visited belong to destroyed entities or were replaced after owner change
+	auto removed = std::remove_if(m_viewers.begin(), m_viewers.end(), [this, &fog](int32_t viewer)
+	{
+		if (m_lastSeen[viewer] == m_updateCount)
+			return false;
+		fog.removeViewer(viewer);
+		return true;
+	});
+	m_viewers.erase(removed, m_viewers.end());
+
+	fog.update(jobs);
+}
@@ -0,0 +1,148 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+//--------------------------------------------------------------------------
+
+#include "World.h"
+#include "../handlers/SlotMap.h"
+#include "../logic/JobSystem.h"
+#include "../logic/FogOfWar.h"
+
+//--------------------------------------------------------------------------
+
+namespace ecs
+{
+	using PathStorage = SlotMap<std::vector<sf::Vector2i>, PathHandler>;	///< paths followed by entities
+
+	constexpr std::size_t PARALLEL_GRAIN = 4096;	///< amount of entities processed by one job of parallel systems
+
+	/*!
+	* \brief Integrate positions of all moving entities, columns are split between jobs
+	*/
+	class MovementSystem
+	{
+	public:
+		void update(World & world, float deltaTime, logic::JobSystem & jobs);
+
+	private:
+		std::vector<logic::JobHandle> m_jobs;	///< jobs of current update
+	};
+
+	/*!
+	* \brief Steer entities with PathCursor towards their next waypoint
+	*
+	* Velocity is directed to the center of next waypoint tile. When waypoint is reached cursor moves to the next one,
+	* after the last waypoint velocity is zeroed and path is released from storage.
+	*
+	*/
+	class PathFollowSystem
+	{
+	public:
+		PathFollowSystem(PathStorage & paths) : m_paths(paths) {}
+
+		void update(World & world, float deltaTime);
+
+	private:
+		PathStorage & m_paths;		///< storage of followed paths
+	};
+
+	/*!
+	* \brief Advance frames of all animated entities, columns are split between jobs
+	*/
+	class AnimationSystem
+	{
+	public:
+		static constexpr float FRAME_TIME = 0.1f;	///< duration of one animation frame in seconds
+
+		void update(World & world, float deltaTime, logic::JobSystem & jobs);
+
+	private:
+		std::vector<logic::JobHandle> m_jobs;	///< jobs of current update
+	};
+
+	/*!
+	* \brief Draw entities on positions interpolated between two simulation steps
+	*
+	* storePositions() must be called before every simulation step. Entities without PreviousPosition are drawn on their
+	* current position.
+	*
+	*/
+	class RenderSystem
+	{
+	public:
+		/*!
+		* \brief Remember positions of all entities before they are changed by simulation step
+		*/
+		void storePositions(World & world);
+
+		/*!
+		* \brief Draw all entities with position
+		*
+		* \param alpha Part of simulation step elapsed since last step
+		*
+		*/
+		void render(World & world, sf::RenderTarget & target, float alpha);
+
+	private:
+		sf::VertexArray m_vertices{ sf::Quads };	///< quad of every drawn entity
+	};
+
+	/*!
+	* \brief Destroy entities which health dropped to zero
+	*
+	* Entities with zero max health have default constructed Health component which wasn't initialized yet, they are
+	* never destroyed.
+	*
+	*/
+	class HealthSystem
+	{
+	public:
+		/*!
+		* \return Amount of destroyed entities
+		*/
+		unsigned int update(World & world);
+
+	private:
+		std::vector<Entity> m_dead;		///< helper list of entities destroyed after iteration
+	};
+
+	/*!
+	* \brief Keep viewers of FogOfWar in sync with entities which have Position, Owner and Sight
+	*
+	* Viewer is moved only when entity enters another tile or it's sight radius changes, viewers of destroyed entities
+	* are removed. Fog is updated at the end, so only bands touched by changed viewers are recomputed.
+	*
+	*/
+	class FogSystem
+	{
+	public:
+		void update(World & world, FogOfWar & fog, logic::JobSystem & jobs);
+
+	private:
+		std::vector<int32_t> m_viewers;			///< ids of all registered viewers
+		std::vector<uint32_t> m_lastSeen;		///< update in which viewer was last seen, indexed by viewer id
+		uint32_t m_updateCount{ 0u };			///< amount of executed updates
+	};
+}
@@ -0,0 +1,94 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//--------------------------------------------------------------------------
+
+#include "World.h"
+
+//--------------------------------------------------------------------------
+
+using namespace ecs;
+
+//--------------------------------------------------------------------------
+
+Entity World::create(ComponentMask mask)
+{
+	uint32_t archetype = findArchetype(mask);
+	Entity entity = m_entities.insert(EntityRecord{ archetype, static_cast<uint32_t>(m_archetypes[archetype].size()) });
+	m_archetypes[archetype].addRow(entity);
+	return entity;
+}
+
+//--------------------------------------------------------------------------
+
+void World::destroy(Entity entity)
+{
+	const EntityRecord * record = m_entities.get(entity);
+	if (record == nullptr)
+		return;
+
+	removeRow(*record);
+	m_entities.erase(entity);
+}
+
+//--------------------------------------------------------------------------
+
+ComponentMask World::getMask(Entity entity) const
+{
+	const EntityRecord * record = m_entities.get(entity);
+	return record != nullptr ? m_archetypes[record->archetype].getMask() : 0u;
+}
+
+//--------------------------------------------------------------------------
+
+uint32_t World::findArchetype(ComponentMask mask)
+{
+	// amount of archetypes is small, so linear search is faster than any map
+	for (uint32_t i = 0u; i < m_archetypes.size(); ++i)
+	{
+		if (m_archetypes[i].getMask() == mask)
+			return i;
+	}
+	m_archetypes.emplace_back(mask);
+	return static_cast<uint32_t>(m_archetypes.size() - 1);
+}
+
+//--------------------------------------------------------------------------
+
+void World::changeMask(Entity entity, ComponentMask mask)
+{
+	EntityRecord * record = m_entities.get(entity);
+	assert(record != nullptr);
+	if (m_archetypes[record->archetype].getMask() == mask)
+		return;
+
+	uint32_t archetype = findArchetype(mask);
+	uint32_t row = m_archetypes[archetype].addRow(entity);
+	m_archetypes[archetype].copyRow(m_archetypes[record->archetype], record->row, row);
+	removeRow(*record);
+	*record = EntityRecord{ archetype, row };
+}
+
+//--------------------------------------------------------------------------
+
+void World::removeRow(const EntityRecord & record)
+{
+	Entity moved = m_archetypes[record.archetype].removeRow(record.row);
+	if (moved.isValid())
+		m_entities.get(moved)->row = record.row;
+}
@@ -0,0 +1,194 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <vector>
+#include <cassert>
+
+//--------------------------------------------------------------------------
+
+#include "Archetype.h"
+#include "../handlers/SlotMap.h"
+
+//--------------------------------------------------------------------------
+
+namespace ecs
+{
+	/*!
+	* \brief Storage of all simulated entities
+	*
+	* Entities are grouped in archetypes by their set of components, so systems iterate over contiguous component columns
+	* instead of visiting objects one by one. Adding or removing component moves entity to other archetype, handles of
+	* entities stay valid.
+	*
+	* Usage example:
+	* \code
+	* ecs::World world;
+	* ecs::Entity unit = world.create(ecs::Position{ 4.f, 2.f }, ecs::Velocity{}, ecs::Health{ 100, 100 });
+	* world.forEach<ecs::Position, ecs::Velocity>([dt](std::size_t count, const ecs::Entity *, ecs::Position * position, ecs::Velocity * velocity)
+	* {
+	*	for (std::size_t i = 0; i < count; ++i)
+	*		position[i].x += velocity[i].x * dt;
+	* });
+	* \endcode
+	*
+	*/
+	class World
+	{
+	public:
+		/*!
+		* \brief Create entity with default components of all types from mask
+		*/
+		Entity create(ComponentMask mask);
+
+		/*!
+		* \brief Create entity with given components
+		*/
+		template <typename... C>
+		Entity create(const C &... components)
+		{
+			Entity entity = create(componentMask<C...>());
+			using expand = int[];
+			(void)expand{ 0, (*get<C>(entity) = components, 0)... };
+			return entity;
+		}
+
+		/*!
+		* \brief Destroy entity, can't be called from forEach()
+		*/
+		void destroy(Entity entity);
+
+		inline bool isAlive(Entity entity) const { return m_entities.contains(entity); }
+		inline std::size_t size() const { return m_entities.size(); }
+
+		/*!
+		* \brief Return set of components of the entity, 0 if entity is destroyed
+		*/
+		ComponentMask getMask(Entity entity) const;
+
+		/*!
+		* \brief Return component of the entity or nullptr if entity is destroyed or doesn't have this component
+		*
+		* Pointer is valid until any entity is created, destroyed or changes it's components.
+		*
+		*/
+		template <typename C>
+		C * get(Entity entity)
+		{
+			const EntityRecord * record = m_entities.get(entity);
+			if (record == nullptr || !m_archetypes[record->archetype].hasAll(componentBit(C::TYPE)))
+				return nullptr;
+			return &m_archetypes[record->archetype].column<C>()[record->row];
+		}
+
+		/*!
+		* \brief Add component to the entity or overwrite it if entity has it already
+		*/
+		template <typename C>
+		void add(Entity entity, const C & component = C())
+		{
+			changeMask(entity, getMask(entity) | componentBit(C::TYPE));
+			*get<C>(entity) = component;
+		}
+
+		/*!
+		* \brief Remove component from the entity
+		*/
+		template <typename C>
+		void remove(Entity entity)
+		{
+			changeMask(entity, getMask(entity) & ~componentBit(C::TYPE));
+		}
+
+		/*!
+		* \brief Call function for every archetype which has all listed components
+		*
+		* Function is called with amount of entities, their handles and column of every listed component:
+		* function(std::size_t count, const Entity * entities, C * column...). Entities can't be created, destroyed or changed
+		* inside the function, but components can be modified.
+		*
+		*/
+		template <typename... C, typename F>
+		void forEach(F && function)
+		{
+			const ComponentMask mask = componentMask<C...>();
+			for (auto & archetype : m_archetypes)
+			{
+				if (archetype.size() > 0u && archetype.hasAll(mask))
+					function(archetype.size(), archetype.entities(), archetype.column<C>()...);
+			}
+		}
+
+		/*!
+		* \brief Save or load all entities and their components
+		*
+		* Loading replaces whole content of the world, handles of entities saved before are valid after loading.
+		*
+		*/
+		template <typename Archive>
+		void serialize(Archive & archive)
+		{
+			if (Archive::LOADING)
+				m_archetypes.clear();
+
+			uint32_t archetypeCount = static_cast<uint32_t>(m_archetypes.size());
+			archive.value(archetypeCount);
+			for (uint32_t i = 0u; i < archetypeCount; ++i)
+			{
+				ComponentMask mask = Archive::LOADING ? 0u : m_archetypes[i].getMask();
+				archive.value(mask);
+				if (Archive::LOADING)
+					m_archetypes.emplace_back(mask);
+				m_archetypes[i].serialize(archive);
+			}
+			m_entities.serialize(archive);
+		}
+
+	private:
+		/*!
+		* \brief Position of entity inside archetypes
+		*/
+		struct EntityRecord
+		{
+			uint32_t archetype;		///< index of archetype
+			uint32_t row;			///< row inside archetype
+		};
+
+		/*!
+		* \brief Return index of archetype with given mask, archetype is created if it doesn't exist
+		*/
+		uint32_t findArchetype(ComponentMask mask);
+
+		/*!
+		* \brief Move entity to archetype with given mask, components present in both archetypes are kept
+		*/
+		void changeMask(Entity entity, ComponentMask mask);
+
+		/*!
+		* \brief Remove row of entity from it's archetype and update record of the entity moved into this row
+		*/
+		void removeRow(const EntityRecord & record);
+
+	private:
+		std::vector<Archetype> m_archetypes;			///< all archetypes, never removed so indexes are stable
+		SlotMap<EntityRecord, Entity> m_entities;		///< position of every entity
+	};
+}
@@ -48,16 +48,21 @@ struct GenericHandler
         index = INVALID;
     }
 
-    bool isValid()
+    bool isValid() const
     {
         return index != INVALID;
     }
 
-    inline bool operator==(GenericHandler&& rhs) noexcept
+    inline bool operator==(const GenericHandler& rhs) const noexcept
     {
         return index == rhs.index && counter == rhs.counter;
     }
 
+    inline bool operator!=(const GenericHandler& rhs) const noexcept
+    {
+        return !(*this == rhs);
+    }
+
     uint32_t index : indexBits;
     uint32_t counter : counterBits;
 };
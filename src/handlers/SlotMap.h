@@ -0,0 +1,253 @@
+/*
+ * TzarRemake
+ * Copyright (C) 2018
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <string>
+#include <utility>
+#include <stdexcept>
+
+//--------------------------------------------------------------------------
+
+#include "GenericHandler.h"
+
+//--------------------------------------------------------------------------
+
+/*!
+* \brief Dense container of objects addressed by generational handles
+*
+* Objects are kept in one contiguous vector, so iteration touches only live objects. Handle points to a slot, which
+* keeps position of the object inside dense vector and counter increased every time object of the slot is erased.
+* Erasing moves the last object into the hole, only slot of moved object is updated, so handles of all other
+* objects stay valid. Handle of erased object is detected by counter mismatch, also after slot was reused.
+*
+* Usage example:
+* \code
+* using UnitHandler = GenericHandler<20, 12, 1>;
+* SlotMap<Unit, UnitHandler> units;
+* UnitHandler handle = units.insert(Unit());
+* if (Unit * unit = units.get(handle))
+*     unit->update();
+* units.erase(handle);
+* \endcode
+*
+*/
+template <typename T, typename Handler>
+class SlotMap
+{
+public:
+    using iterator = typename std::vector<T>::iterator;
+    using const_iterator = typename std::vector<T>::const_iterator;
+
+    /*!
+    * \brief Insert object and return handle to it
+    */
+    template <typename... Args>
+    Handler emplace(Args&&... args)
+    {
+        uint32_t slotIndex;
+        if (m_freeHead != Handler::INVALID)
+        {
+            slotIndex = m_freeHead;
+            m_freeHead = m_slots[slotIndex].dataIndex;
+        }
+        else
+        {
+            // last index is reserved for invalid handle
+            assert(m_slots.size() < static_cast<std::size_t>(Handler::INVALID));
+            slotIndex = static_cast<uint32_t>(m_slots.size());
+            m_slots.push_back(Slot{ 0u, 0u });
+        }
+
+        Slot & slot = m_slots[slotIndex];
+        slot.dataIndex = static_cast<uint32_t>(m_data.size());
+        m_data.emplace_back(std::forward<Args>(args)...);
+        m_dataSlot.push_back(slotIndex);
+
+        Handler handle;
+        handle.index = slotIndex;
+        handle.counter = slot.counter;
+        return handle;
+    }
+
+    inline Handler insert(const T & object) { return emplace(object); }
+    inline Handler insert(T && object) { return emplace(std::move(object)); }
+
+    /*!
+    * \brief Erase object, handle and all it's copies become stale
+    *
+    * \return False if handle was already stale
+    *
+    */
+    bool erase(Handler handle)
+    {
+        if (!contains(handle))
+            return false;
+
+        Slot & slot = m_slots[handle.index];
+        uint32_t dataIndex = slot.dataIndex;
+        uint32_t lastIndex = static_cast<uint32_t>(m_data.size() - 1);
+        if (dataIndex != lastIndex)
+        {
+            // move last object into the hole and update it's slot
+            m_data[dataIndex] = std::move(m_data[lastIndex]);
+            m_dataSlot[dataIndex] = m_dataSlot[lastIndex];
+            m_slots[m_dataSlot[dataIndex]].dataIndex = dataIndex;
+        }
+        m_data.pop_back();
+        m_dataSlot.pop_back();
+
+        // counter wraps in it's bit field, stale handles are detected as long as slot is not reused 2^counterBits times
+        Handler next;
+        next.counter = slot.counter + 1u;
+        slot.counter = next.counter;
+        slot.dataIndex = m_freeHead;
+        m_freeHead = handle.index;
+        return true;
+    }
+
+    /*!
+    * \brief Return true if handle points to live object
+    */
+    inline bool contains(Handler handle) const
+    {
+        return handle.isValid() && handle.index < m_slots.size() && m_slots[handle.index].counter == handle.counter &&
+            m_slots[handle.index].dataIndex < m_data.size() && m_dataSlot[m_slots[handle.index].dataIndex] == handle.index;
+    }
+
+    /*!
+    * \brief Return pointer to object or nullptr if handle is stale
+    */
+    inline T * get(Handler handle) { return contains(handle) ? &m_data[m_slots[handle.index].dataIndex] : nullptr; }
+    inline const T * get(Handler handle) const { return contains(handle) ? &m_data[m_slots[handle.index].dataIndex] : nullptr; }
+
+    /*!
+    * \brief Return handle of object placed at specified position of dense storage
+    */
+    inline Handler handleAt(std::size_t dataIndex) const
+    {
+        Handler handle;
+        handle.index = m_dataSlot[dataIndex];
+        handle.counter = m_slots[handle.index].counter;
+        return handle;
+    }
+
+    /*!
+    * \brief Remove all objects, all handles become stale
+    */
+    void clear()
+    {
+        while (!m_data.empty())
+            erase(handleAt(m_data.size() - 1));
+    }
+
+    /*!
+    * \brief Save or load whole state of the container, handles saved before are valid after loading
+    *
+    * \param archive logic::OutputArchive or logic::InputArchive, objects must be trivially copyable or vectors of them
+    *
+    */
+    template <typename Archive>
+    void serialize(Archive & archive)
+    {
+        archive.array(m_data);
+        archive.array(m_dataSlot);
+        archive.array(m_slots);
+        archive.value(m_freeHead);
+        validate();
+    }
+
+    inline void reserve(std::size_t capacity)
+    {
+        m_data.reserve(capacity);
+        m_dataSlot.reserve(capacity);
+        m_slots.reserve(capacity);
+    }
+
+    inline std::size_t size() const { return m_data.size(); }
+    inline bool empty() const { return m_data.empty(); }
+    inline T * data() { return m_data.data(); }
+    inline const T * data() const { return m_data.data(); }
+    inline iterator begin() { return m_data.begin(); }
+    inline iterator end() { return m_data.end(); }
+    inline const_iterator begin() const { return m_data.begin(); }
+    inline const_iterator end() const { return m_data.end(); }
+
+private:
+    /*!
+    * \brief Throw std::runtime_error if any index of loaded state points outside of it's vector or free list is broken
+    *
+    * Every object must have it's own slot pointing back to it, and free list must visit every other slot exactly once.
+    *
+    */
+    void validate() const
+    {
+        if (m_data.size() != m_dataSlot.size())
+            throw std::runtime_error("SlotMap - Loaded objects and slots don't match");
+        if (m_slots.size() > static_cast<std::size_t>(Handler::INVALID) || m_data.size() > m_slots.size())
+            throw std::runtime_error("SlotMap - Loaded slots exceed handle range");
+
+        std::vector<bool> used(m_slots.size(), false);
+        for (std::size_t dataIndex = 0; dataIndex < m_dataSlot.size(); ++dataIndex)
+        {
+            uint32_t slotIndex = m_dataSlot[dataIndex];
+            if (slotIndex >= m_slots.size() || m_slots[slotIndex].dataIndex != dataIndex)
+                throw std::runtime_error("SlotMap - Loaded object " + std::to_string(dataIndex) + " has invalid slot");
+            used[slotIndex] = true;
+        }
+
+        // counter must survive round trip through handle, otherwise handles of the slot never match
+        for (const Slot & slot : m_slots)
+        {
+            Handler handle;
+            handle.counter = slot.counter;
+            if (handle.counter != slot.counter)
+                throw std::runtime_error("SlotMap - Loaded slot counter exceeds handle range");
+        }
+
+        // slots of the free list are marked as used too, so cycles and slots of live objects are found
+        std::size_t freeCount = 0;
+        for (uint32_t slotIndex = m_freeHead; slotIndex != Handler::INVALID; slotIndex = m_slots[slotIndex].dataIndex)
+        {
+            if (slotIndex >= m_slots.size() || used[slotIndex])
+                throw std::runtime_error("SlotMap - Loaded free list is broken");
+            used[slotIndex] = true;
+            ++freeCount;
+        }
+        if (freeCount != m_slots.size() - m_data.size())
+            throw std::runtime_error("SlotMap - Loaded free list doesn't contain all free slots");
+    }
+
+private:
+    struct Slot
+    {
+        uint32_t dataIndex;     ///< position of object in dense storage, or next free slot if slot is not used
+        uint32_t counter;       ///< generation of the slot, increased when object is erased
+    };
+
+    std::vector<T> m_data;                          ///< dense storage of live objects
+    std::vector<uint32_t> m_dataSlot;               ///< slot index of every object in dense storage
+    std::vector<Slot> m_slots;                      ///< all slots, used and free
+    uint32_t m_freeHead{ Handler::INVALID };        ///< first free slot, INVALID if there is none
+};
@@ -0,0 +1,245 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+//--------------------------------------------------------------------------
+
+namespace logic
+{
+	/*!
+	* \brief Archive which appends raw bytes of serialized values to vector
+	*
+	* Classes implement one template serialize(Archive &) function which is used with both OutputArchive and InputArchive,
+	* so saved and loaded fields can't get out of sync. Values must be trivially copyable, vectors are stored as their
+	* size followed by elements. Bytes are written in native byte order.
+	*
+	* Usage example:
+	* \code
+	* template <typename Archive>
+	* void Unit::serialize(Archive & archive)
+	* {
+	*	archive.value(m_health);
+	*	archive.array(m_path);
+	* }
+	*
+	* std::vector<uint8_t> bytes;
+	* logic::OutputArchive output(bytes);
+	* unit.serialize(output);
+	* \endcode
+	*
+	*/
+	class OutputArchive
+	{
+	public:
+		static constexpr bool LOADING = false;	///< true if archive fills serialized objects
+
+		explicit OutputArchive(std::vector<uint8_t> & bytes) :
+			m_bytes(bytes)
+		{
+		}
+
+		template <typename T>
+		void value(T & value)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "OutputArchive can store only trivially copyable values");
+			append(&value, sizeof(T));
+		}
+
+		template <typename T>
+		void array(std::vector<T> & values)
+		{
+			uint32_t size = static_cast<uint32_t>(values.size());
+			value(size);
+			elements(values, std::is_trivially_copyable<T>());
+		}
+
+	private:
+		template <typename T>
+		void elements(std::vector<T> & values, std::true_type)
+		{
+			if (!values.empty())
+				append(values.data(), values.size()*sizeof(T));
+		}
+
+		template <typename T>
+		void elements(std::vector<std::vector<T>> & values, std::false_type)
+		{
+			for (auto & element : values)
+				array(element);
+		}
+
+		void append(const void * data, std::size_t size)
+		{
+			const uint8_t * bytes = static_cast<const uint8_t*>(data);
+			m_bytes.insert(m_bytes.end(), bytes, bytes + size);
+		}
+
+	private:
+		std::vector<uint8_t> & m_bytes;		///< serialized bytes
+	};
+
+	//--------------------------------------------------------------------------
+
+	/*!
+	* \brief Archive which reads values written by OutputArchive
+	*
+	* Reading past the end of data throws std::runtime_error, so truncated or damaged data never leaves object with
+	* uninitialized memory.
+	*
+	*/
+	class InputArchive
+	{
+	public:
+		static constexpr bool LOADING = true;	///< true if archive fills serialized objects
+
+		InputArchive(const uint8_t * data, std::size_t size) :
+			m_data{ data }, m_size{ size }
+		{
+		}
+
+		template <typename T>
+		void value(T & value)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "InputArchive can read only trivially copyable values");
+			read(&value, sizeof(T));
+		}
+
+		template <typename T>
+		void array(std::vector<T> & values)
+		{
+			uint32_t size = 0u;
+			value(size);
+			// every element takes at least it's size, or size of it's own element count for nested vectors
+			const std::size_t minElementSize = std::is_trivially_copyable<T>::value ? sizeof(T) : sizeof(uint32_t);
+			if (size > (m_size - m_position) / minElementSize)
+				throw std::runtime_error("InputArchive - Array of " + std::to_string(size) + " elements exceeds data");
+			values.resize(size);
+			elements(values, std::is_trivially_copyable<T>());
+		}
+
+		/*!
+		* \brief Return true if all bytes were read
+		*/
+		inline bool finished() const { return m_position == m_size; }
+
+	private:
+		template <typename T>
+		void elements(std::vector<T> & values, std::true_type)
+		{
+			if (!values.empty())
+				read(values.data(), values.size()*sizeof(T));
+		}
+
+		template <typename T>
+		void elements(std::vector<std::vector<T>> & values, std::false_type)
+		{
+			for (auto & element : values)
+				array(element);
+		}
+
+		void read(void * data, std::size_t size)
+		{
+			if (size > m_size - m_position)
+				throw std::runtime_error("InputArchive - Unexpected end of data");
+			std::memcpy(data, m_data + m_position, size);
+			m_position += size;
+		}
+
+	private:
+		const uint8_t * m_data;			///< serialized bytes
+		std::size_t m_size;				///< amount of serialized bytes
+		std::size_t m_position{ 0u };	///< amount of already read bytes
+	};
+
+	//--------------------------------------------------------------------------
+
+	/*!
+	* \brief Archive which computes hash of serialized values without storing them
+	*
+	* Hash is equal for equal sequences of serialized values, so it can be used to compare state of two simulations
+	* which should be identical.
+	*
+	*/
+	class HashArchive
+	{
+	public:
+		static constexpr bool LOADING = false;	///< true if archive fills serialized objects
+
+		template <typename T>
+		void value(T & value)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "HashArchive can hash only trivially copyable values");
+			add(&value, sizeof(T));
+		}
+
+		template <typename T>
+		void array(std::vector<T> & values)
+		{
+			uint32_t size = static_cast<uint32_t>(values.size());
+			value(size);
+			elements(values, std::is_trivially_copyable<T>());
+		}
+
+		inline uint64_t getHash() const { return m_hash; }
+
+	private:
+		template <typename T>
+		void elements(std::vector<T> & values, std::true_type)
+		{
+			if (!values.empty())
+				add(values.data(), values.size()*sizeof(T));
+		}
+
+		template <typename T>
+		void elements(std::vector<std::vector<T>> & values, std::false_type)
+		{
+			for (auto & element : values)
+				array(element);
+		}
+
+		/*!
+		* \brief FNV-1a over 64 bit words, remaining bytes are mixed one by one
+		*/
+		void add(const void * data, std::size_t size)
+		{
+			const uint8_t * bytes = static_cast<const uint8_t*>(data);
+			std::size_t i = 0;
+			for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+			{
+				uint64_t word;
+				std::memcpy(&word, bytes + i, sizeof(word));
+				m_hash = (m_hash ^ word) * 1099511628211ull;
+			}
+			for (; i < size; ++i)
+				m_hash = (m_hash ^ bytes[i]) * 1099511628211ull;
+		}
+
+	private:
+		uint64_t m_hash{ 14695981039346656037ull };		///< hash of all added values
+	};
+}
@@ -0,0 +1,227 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//--------------------------------------------------------------------------
+
+#include "BlockedAreaTable.h"
+
+//--------------------------------------------------------------------------
+
+#include <algorithm>
+
+//--------------------------------------------------------------------------
+
+namespace
+{
+	/*!
+	* \brief Return amount of set bits in the word
+	*/
+	inline unsigned int popCount(uint64_t word)
+	{
+#ifdef __GNUC__
+		return static_cast<unsigned int>(__builtin_popcountll(word));
+#else
+		unsigned int count = 0u;
+		for (; word != 0u; word &= word - 1u)
+			++count;
+		return count;
+#endif
+	}
+
+	/*!
+	* \brief Return mask of chunk word bits of tile columns [0,columns)
+	*/
+	inline uint64_t columnMask(int columns)
+	{
+		return ((uint64_t(1u) << columns) - 1u) * 0x0101010101010101ull;
+	}
+
+	/*!
+	* \brief Return mask of chunk word bits of tile rows [0,rows), rows must be lower than CHUNK_SIZE
+	*/
+	inline uint64_t rowMask(int rows)
+	{
+		return (uint64_t(1u) << (rows*CHUNK_SIZE)) - 1u;
+	}
+}
+
+//--------------------------------------------------------------------------
+
+BlockedAreaTable::BlockedAreaTable(Grid & grid, GridPlane plane) :
+	m_grid{ &grid },
+	m_plane{ plane },
+	m_gridSize{ grid.getGridSize() },
+	m_chunkGridSize{ grid.getChunkGridSize() }
+{
+	unsigned int chunkCount = m_chunkGridSize.x*m_chunkGridSize.y;
+	m_words.resize(chunkCount);
+	m_chunkSums.resize((m_chunkGridSize.x + 1)*(m_chunkGridSize.y + 1));
+	m_columnSums.resize(m_chunkGridSize.x*(m_chunkGridSize.y + 1)*CHUNK_SIZE);
+	m_rowSums.resize(m_chunkGridSize.y*(m_chunkGridSize.x + 1)*CHUNK_SIZE);
+	rebuild();
+
+	m_subscriptionId = grid.subscribe(logic::Delegate<void(const GridChangeSet &)>::factory<BlockedAreaTable, &BlockedAreaTable::onGridChanged>(this));
+}
+
+//--------------------------------------------------------------------------
+
+BlockedAreaTable::~BlockedAreaTable()
+{
+	m_grid->unsubscribe(m_subscriptionId);
+}
+
+//--------------------------------------------------------------------------
+
+unsigned int BlockedAreaTable::countTiles(sf::IntRect area) const
+{
+	int left = std::max(area.left, 0);
+	int top = std::max(area.top, 0);
+	int right = std::min(area.left + area.width, m_gridSize.x);
+	int bottom = std::min(area.top + area.height, m_gridSize.y);
+	if (left >= right || top >= bottom)
+		return 0u;
+
+	return prefix(right, bottom) - prefix(left, bottom) - prefix(right, top) + prefix(left, top);
+}
+
+//--------------------------------------------------------------------------
+
+void BlockedAreaTable::rebuild()
+{
+	for (unsigned int i = 0; i < m_words.size(); ++i)
+		m_words[i] = m_grid->getChunkBits(m_plane, i);
+
+	// entry of the first chunk row (column) is always 0, every next entry adds one chunk
+	for (int chunkX = 0; chunkX < m_chunkGridSize.x; ++chunkX)
+	{
+		for (int column = 1; column < static_cast<int>(CHUNK_SIZE); ++column)
+		{
+			uint32_t sum = 0u;
+			for (int chunkY = 0; chunkY <= m_chunkGridSize.y; ++chunkY)
+			{
+				m_columnSums[columnIndex(chunkX, chunkY, column)] = sum;
+				if (chunkY < m_chunkGridSize.y)
+					sum += popCount(m_words[chunkY*m_chunkGridSize.x + chunkX] & columnMask(column));
+			}
+		}
+	}
+
+	for (int chunkY = 0; chunkY < m_chunkGridSize.y; ++chunkY)
+	{
+		for (int row = 1; row < static_cast<int>(CHUNK_SIZE); ++row)
+		{
+			uint32_t sum = 0u;
+			for (int chunkX = 0; chunkX <= m_chunkGridSize.x; ++chunkX)
+			{
+				m_rowSums[rowIndex(chunkX, chunkY, row)] = sum;
+				if (chunkX < m_chunkGridSize.x)
+					sum += popCount(m_words[chunkY*m_chunkGridSize.x + chunkX] & rowMask(row));
+			}
+		}
+	}
+
+	buildChunkSums();
+}
+
+//--------------------------------------------------------------------------
+
+void BlockedAreaTable::onGridChanged(const GridChangeSet & changes)
+{
+	// every changed chunk updates one chunk column and one chunk row, for many chunks it's cheaper to compute everything
+	unsigned int stripCost = static_cast<unsigned int>(changes.dirtyChunks.size())*(m_chunkGridSize.x + m_chunkGridSize.y);
+	if (stripCost > static_cast<unsigned int>(m_chunkGridSize.x*m_chunkGridSize.y))
+	{
+		rebuild();
+		return;
+	}
+
+	bool changed = false;
+	for (unsigned int chunkIndex : changes.dirtyChunks)
+	{
+		uint64_t word = m_grid->getChunkBits(m_plane, chunkIndex);
+		if (word == m_words[chunkIndex])
+			continue;
+
+		updateStrips(chunkIndex, m_words[chunkIndex], word);
+		m_words[chunkIndex] = word;
+		changed = true;
+	}
+
+	if (changed)
+		buildChunkSums();
+}
+
+//--------------------------------------------------------------------------
+
+void BlockedAreaTable::updateStrips(unsigned int chunkIndex, uint64_t oldWord, uint64_t newWord)
+{
+	int chunkX = chunkIndex % m_chunkGridSize.x;
+	int chunkY = chunkIndex / m_chunkGridSize.x;
+
+	// sums are unsigned, adding negative difference wraps around to the right value
+	for (int column = 1; column < static_cast<int>(CHUNK_SIZE); ++column)
+	{
+		uint32_t difference = popCount(newWord & columnMask(column)) - popCount(oldWord & columnMask(column));
+		for (int y = chunkY + 1; difference != 0u && y <= m_chunkGridSize.y; ++y)
+			m_columnSums[columnIndex(chunkX, y, column)] += difference;
+	}
+
+	for (int row = 1; row < static_cast<int>(CHUNK_SIZE); ++row)
+	{
+		uint32_t difference = popCount(newWord & rowMask(row)) - popCount(oldWord & rowMask(row));
+		for (int x = chunkX + 1; difference != 0u && x <= m_chunkGridSize.x; ++x)
+			m_rowSums[rowIndex(x, chunkY, row)] += difference;
+	}
+}
+
+//--------------------------------------------------------------------------
+
+void BlockedAreaTable::buildChunkSums()
+{
+	int width = m_chunkGridSize.x + 1;
+	std::fill(m_chunkSums.begin(), m_chunkSums.begin() + width, 0u);
+	for (int y = 1; y <= m_chunkGridSize.y; ++y)
+	{
+		uint32_t rowSum = 0u;
+		m_chunkSums[y*width] = 0u;
+		for (int x = 1; x <= m_chunkGridSize.x; ++x)
+		{
+			rowSum += popCount(m_words[(y - 1)*m_chunkGridSize.x + x - 1]);
+			m_chunkSums[y*width + x] = m_chunkSums[(y - 1)*width + x] + rowSum;
+		}
+	}
+}
+
+//--------------------------------------------------------------------------
+
+uint32_t BlockedAreaTable::prefix(int x, int y) const
+{
+	int chunkX = x / CHUNK_SIZE;
+	int chunkY = y / CHUNK_SIZE;
+	int column = x % CHUNK_SIZE;
+	int row = y % CHUNK_SIZE;
+
+	uint32_t sum = m_chunkSums[chunkY*(m_chunkGridSize.x + 1) + chunkX];
+	if (column != 0)
+		sum += m_columnSums[columnIndex(chunkX, chunkY, column)];
+	if (row != 0)
+		sum += m_rowSums[rowIndex(chunkX, chunkY, row)];
+	if (column != 0 && row != 0)
+		sum += popCount(m_words[chunkY*m_chunkGridSize.x + chunkX] & columnMask(column) & rowMask(row));
+	return sum;
+}
@@ -0,0 +1,119 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <vector>
+#include <cstdint>
+#include <SFML/Graphics.hpp>
+
+//--------------------------------------------------------------------------
+
+#include "Grid.h"
+
+//--------------------------------------------------------------------------
+
+/*!
+* \brief Summed-area table of tiles set on one grid plane, answers count of set tiles in any rectangle with four lookups
+*
+* Amount of set tiles in [0,x) x [0,y) is sum of four parts: whole chunks above and left of the chunk containing (x,y)
+* (summed-area table of chunk counts), columns left of x in chunks above (prefix sums of every chunk column), rows above
+* y in chunks left (prefix sums of every chunk row) and tiles of the chunk itself (one masked word). Count in rectangle
+* is combination of four such prefixes, so its cost doesn't depend on size of the rectangle, and placement of huge
+* buildings or long walls can be checked on every mouse move.
+*
+* Edit of a chunk changes only prefix sums of its chunk column and chunk row, table of chunk counts is rebuilt once per
+* change set. Table is updated from change sets published by the grid, so it describes state after the last
+* Grid::publishChanges().
+*
+* Usage example:
+* \code
+* BlockedAreaTable blockedAreas(grid);
+* bool canPlace = blockedAreas.isAreaClear(sf::IntRect(mouseTile.x, mouseTile.y, 40, 3));
+* \endcode
+*
+*/
+class BlockedAreaTable
+{
+public:
+	/*!
+	* \brief Default constructor
+	*
+	* \param grid Counted grid, table subscribes to it's change sets so it must outlive the table
+	* \param plane Counted bit plane
+	*
+	*/
+	BlockedAreaTable(Grid & grid, GridPlane plane = GridPlane::BLOCKED);
+	~BlockedAreaTable();
+
+	BlockedAreaTable(const BlockedAreaTable &) = delete;
+	BlockedAreaTable & operator=(const BlockedAreaTable &) = delete;
+
+	/*!
+	* \brief Count set tiles inside area, parts of area outside of the grid are ignored
+	*/
+	unsigned int countTiles(sf::IntRect area) const;
+
+	/*!
+	* \brief Check if none of tiles inside area is set, parts of area outside of the grid are ignored
+	*/
+	inline bool isAreaClear(sf::IntRect area) const { return countTiles(area) == 0u; }
+
+	/*!
+	* \brief Compute all sums again from the grid
+	*/
+	void rebuild();
+
+private:
+	/*!
+	* \brief Update sums of changed chunks
+	*/
+	void onGridChanged(const GridChangeSet & changes);
+
+	/*!
+	* \brief Add difference between old and new word of the chunk to prefix sums of it's chunk column and chunk row
+	*/
+	void updateStrips(unsigned int chunkIndex, uint64_t oldWord, uint64_t newWord);
+
+	/*!
+	* \brief Compute summed-area table of chunk counts
+	*/
+	void buildChunkSums();
+
+	/*!
+	* \brief Return amount of set tiles in [0,x) x [0,y)
+	*/
+	uint32_t prefix(int x, int y) const;
+
+	inline std::size_t columnIndex(int chunkX, int chunkY, int column) const { return (chunkX*(m_chunkGridSize.y + 1) + chunkY)*CHUNK_SIZE + column; }
+	inline std::size_t rowIndex(int chunkX, int chunkY, int row) const { return (chunkY*(m_chunkGridSize.x + 1) + chunkX)*CHUNK_SIZE + row; }
+
+private:
+	Grid * m_grid;								///< counted grid
+	GridPlane m_plane;							///< counted plane
+	unsigned int m_subscriptionId;				///< id of subscription to grid change sets
+	sf::Vector2i m_gridSize;					///< size of the grid in tiles
+	sf::Vector2i m_chunkGridSize;				///< amount of chunks in x and y direction
+
+	std::vector<uint64_t> m_words;				///< words of the plane at the last update, one per chunk
+	std::vector<uint32_t> m_chunkSums;			///< set tiles in chunks [0,x) x [0,y), (chunkGridSize.x + 1) x (chunkGridSize.y + 1) entries
+	std::vector<uint32_t> m_columnSums;			///< set tiles of chunk column x in chunk rows [0,y) and tile columns [0,c) of the chunk
+	std::vector<uint32_t> m_rowSums;			///< set tiles of chunk row y in chunk columns [0,x) and tile rows [0,r) of the chunk
+};
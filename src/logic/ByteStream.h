@@ -0,0 +1,147 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+
+//--------------------------------------------------------------------------
+
+namespace logic
+{
+	/*!
+	* \brief Appends compact, byte order independent values to vector
+	*
+	* Unsigned numbers are stored as variable length integers (7 bits per byte, lowest bits first), so small numbers take
+	* one byte. Signed numbers are zigzag encoded first, so small negative numbers are small too. Used by streams which
+	* are sent over network or stored in files, where size matters more than speed of random access.
+	*
+	* Usage example:
+	* \code
+	* std::vector<uint8_t> bytes;
+	* logic::ByteWriter writer(bytes);
+	* writer.writeVarint(tick);
+	* writer.writeSigned(position.x);
+	* \endcode
+	*
+	*/
+	class ByteWriter
+	{
+	public:
+		explicit ByteWriter(std::vector<uint8_t> & bytes) :
+			m_bytes(bytes)
+		{
+		}
+
+		inline void writeByte(uint8_t value) { m_bytes.push_back(value); }
+
+		void writeUint32(uint32_t value)
+		{
+			for (unsigned i = 0; i < 4; ++i)
+				m_bytes.push_back(static_cast<uint8_t>(value >> (i * 8)));
+		}
+
+		void writeVarint(uint64_t value)
+		{
+			while (value >= 0x80u)
+			{
+				m_bytes.push_back(static_cast<uint8_t>(value | 0x80u));
+				value >>= 7;
+			}
+			m_bytes.push_back(static_cast<uint8_t>(value));
+		}
+
+		inline void writeSigned(int32_t value) { writeVarint((static_cast<uint32_t>(value) << 1) ^ (value < 0 ? ~0u : 0u)); }
+
+	private:
+		std::vector<uint8_t> & m_bytes;		///< destination of written values
+	};
+
+	//--------------------------------------------------------------------------
+
+	/*!
+	* \brief Reads values written by ByteWriter
+	*
+	* Reader doesn't own the data. Reading past the end or malformed number throws std::runtime_error, so truncated
+	* or corrupted stream can't be read as valid values.
+	*
+	*/
+	class ByteReader
+	{
+	public:
+		ByteReader(const uint8_t * data, std::size_t size) :
+			m_data(data),
+			m_size(size)
+		{
+		}
+
+		uint8_t readByte()
+		{
+			if (m_offset >= m_size)
+				throw std::runtime_error("ByteReader - data is truncated");
+			return m_data[m_offset++];
+		}
+
+		uint8_t peekByte() const
+		{
+			if (m_offset >= m_size)
+				throw std::runtime_error("ByteReader - data is truncated");
+			return m_data[m_offset];
+		}
+
+		uint32_t readUint32()
+		{
+			uint32_t value = 0u;
+			for (unsigned i = 0; i < 4; ++i)
+				value |= static_cast<uint32_t>(readByte()) << (i * 8);
+			return value;
+		}
+
+		uint64_t readVarint()
+		{
+			uint64_t value = 0u;
+			for (unsigned shift = 0; shift < 64; shift += 7)
+			{
+				uint8_t byte = readByte();
+				value |= static_cast<uint64_t>(byte & 0x7Fu) << shift;
+				if ((byte & 0x80u) == 0u)
+					return value;
+			}
+			throw std::runtime_error("ByteReader - corrupted number");
+		}
+
+		int32_t readSigned()
+		{
+			uint64_t value = readVarint();
+			return static_cast<int32_t>(static_cast<uint32_t>(value >> 1) ^ (0u - static_cast<uint32_t>(value & 1u)));
+		}
+
+		inline std::size_t getRemaining() const { return m_size - m_offset; }
+		inline bool isEnd() const { return m_offset == m_size; }
+
+	private:
+		const uint8_t * m_data;				///< read data
+		std::size_t m_size;					///< size of the data
+		std::size_t m_offset{ 0u };			///< offset of the next byte
+	};
+}
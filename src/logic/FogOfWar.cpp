@@ -0,0 +1,239 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//--------------------------------------------------------------------------
+
+#include "FogOfWar.h"
+
+//--------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+//--------------------------------------------------------------------------
+
+constexpr unsigned int FogOfWar::MAX_SIGHT_RADIUS;
+
+//--------------------------------------------------------------------------
+
+FogOfWar::FogOfWar(sf::Vector2i gridSize, unsigned int playerCount) :
+	m_gridSize{ gridSize }
+{
+	m_wordsPerRow = (gridSize.x + 63) / 64;
+	m_bandCount = (gridSize.y + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+	m_players.resize(playerCount);
+	for (auto & player : m_players)
+	{
+		player.visible.resize(m_wordsPerRow*gridSize.y, 0u);
+		player.explored.resize(m_wordsPerRow*gridSize.y, 0u);
+		player.bandViewers.resize(m_bandCount);
+		player.bandDirty.resize(m_bandCount, false);
+	}
+
+	// stamps are precomputed once, tile is inside circle if it's center is not further than radius + 0.5
+	m_circleHalfWidth.resize(MAX_SIGHT_RADIUS + 1);
+	for (unsigned int radius = 0u; radius <= MAX_SIGHT_RADIUS; ++radius)
+	{
+		float limit = (radius + 0.5f)*(radius + 0.5f);
+		for (unsigned int dy = 0u; dy <= radius; ++dy)
+			m_circleHalfWidth[radius].push_back(static_cast<uint8_t>(std::sqrt(limit - static_cast<float>(dy*dy))));
+	}
+}
+
+//--------------------------------------------------------------------------
+
+unsigned int FogOfWar::addViewer(unsigned int player, sf::Vector2i position, unsigned int radius)
+{
+	assert(player < m_players.size() && radius <= MAX_SIGHT_RADIUS);
+
+	unsigned int viewerId;
+	if (!m_freeViewers.empty())
+	{
+		viewerId = m_freeViewers.back();
+		m_freeViewers.pop_back();
+	}
+	else
+	{
+		viewerId = static_cast<unsigned int>(m_viewers.size());
+		m_viewers.emplace_back();
+	}
+
+	Viewer & viewer = m_viewers[viewerId];
+	viewer.position = position;
+	viewer.radius = radius;
+	viewer.player = player;
+	viewer.alive = true;
+	addToBand(viewerId);
+	markDirty(viewer);
+	return viewerId;
+}
+
+//--------------------------------------------------------------------------
+
+void FogOfWar::moveViewer(unsigned int viewerId, sf::Vector2i position)
+{
+	Viewer & viewer = m_viewers[viewerId];
+	if (viewer.position == position)
+		return;
+
+	markDirty(viewer);
+	removeFromBand(viewerId);
+	viewer.position = position;
+	addToBand(viewerId);
+	markDirty(viewer);
+}
+
+//--------------------------------------------------------------------------
+
+void FogOfWar::setViewerRadius(unsigned int viewerId, unsigned int radius)
+{
+	assert(radius <= MAX_SIGHT_RADIUS);
+	Viewer & viewer = m_viewers[viewerId];
+	if (viewer.radius == radius)
+		return;
+
+	// the bigger circle covers all changed tiles
+	viewer.radius = std::max(viewer.radius, radius);
+	markDirty(viewer);
+	viewer.radius = radius;
+}
+
+//--------------------------------------------------------------------------
+
+void FogOfWar::removeViewer(unsigned int viewerId)
+{
+	Viewer & viewer = m_viewers[viewerId];
+	markDirty(viewer);
+	removeFromBand(viewerId);
+	viewer.alive = false;
+	m_freeViewers.push_back(viewerId);
+}
+
+//--------------------------------------------------------------------------
+
+void FogOfWar::update(logic::JobSystem & jobs)
+{
+	jobs.wait(jobs.parallelFor(0, m_players.size(), 1, [this](std::size_t begin, std::size_t end)
+	{
+		for (std::size_t player = begin; player < end; ++player)
+			updatePlayer(m_players[player]);
+	}));
+}
+
+//--------------------------------------------------------------------------
+
+void FogOfWar::updatePlayer(PlayerFog & player) const
+{
+	// viewers placed this amount of bands away can reach the band
+	const int reach = static_cast<int>((MAX_SIGHT_RADIUS + CHUNK_SIZE - 1) / CHUNK_SIZE);
+
+	for (auto band : player.dirtyBands)
+	{
+		int firstRow = band*CHUNK_SIZE;
+		int lastRow = std::min(firstRow + static_cast<int>(CHUNK_SIZE), m_gridSize.y) - 1;
+		std::fill(player.visible.begin() + firstRow*m_wordsPerRow, player.visible.begin() + (lastRow + 1)*m_wordsPerRow, 0u);
+
+		int firstBand = std::max(static_cast<int>(band) - reach, 0);
+		int lastBand = std::min(static_cast<int>(band) + reach, static_cast<int>(m_bandCount) - 1);
+		for (int viewerBand = firstBand; viewerBand <= lastBand; ++viewerBand)
+		{
+			for (auto viewerId : player.bandViewers[viewerBand])
+				stamp(m_viewers[viewerId], player.visible, firstRow, lastRow);
+		}
+
+		for (unsigned int i = firstRow*m_wordsPerRow; i < (lastRow + 1)*m_wordsPerRow; ++i)
+			player.explored[i] |= player.visible[i];
+		player.bandDirty[band] = false;
+	}
+	player.dirtyBands.clear();
+}
+
+//--------------------------------------------------------------------------
+
+void FogOfWar::markDirty(const Viewer & viewer)
+{
+	PlayerFog & player = m_players[viewer.player];
+	int firstBand = std::max(viewer.position.y - static_cast<int>(viewer.radius), 0) / static_cast<int>(CHUNK_SIZE);
+	int lastBand = std::min(viewer.position.y + static_cast<int>(viewer.radius), m_gridSize.y - 1) / static_cast<int>(CHUNK_SIZE);
+	for (int band = firstBand; band <= lastBand; ++band)
+	{
+		if (!player.bandDirty[band])
+		{
+			player.bandDirty[band] = true;
+			player.dirtyBands.push_back(band);
+		}
+	}
+}
+
+//--------------------------------------------------------------------------
+
+void FogOfWar::addToBand(unsigned int viewerId)
+{
+	Viewer & viewer = m_viewers[viewerId];
+	int row = std::min(std::max(viewer.position.y, 0), m_gridSize.y - 1);
+	viewer.band = row / CHUNK_SIZE;
+
+	auto & viewers = m_players[viewer.player].bandViewers[viewer.band];
+	viewer.bandSlot = static_cast<unsigned int>(viewers.size());
+	viewers.push_back(viewerId);
+}
+
+//--------------------------------------------------------------------------
+
+void FogOfWar::removeFromBand(unsigned int viewerId)
+{
+	Viewer & viewer = m_viewers[viewerId];
+	auto & viewers = m_players[viewer.player].bandViewers[viewer.band];
+
+	// last viewer of the band takes slot of removed one
+	viewers[viewer.bandSlot] = viewers.back();
+	m_viewers[viewers.back()].bandSlot = viewer.bandSlot;
+	viewers.pop_back();
+}
+
+//--------------------------------------------------------------------------
+
+void FogOfWar::stamp(const Viewer & viewer, std::vector<uint64_t> & visible, int firstRow, int lastRow) const
+{
+	const std::vector<uint8_t> & halfWidth = m_circleHalfWidth[viewer.radius];
+	int radius = static_cast<int>(viewer.radius);
+	int top = std::max(viewer.position.y - radius, firstRow);
+	int bottom = std::min(viewer.position.y + radius, lastRow);
+	for (int y = top; y <= bottom; ++y)
+	{
+		int width = halfWidth[std::abs(y - viewer.position.y)];
+		int left = std::max(viewer.position.x - width, 0);
+		int right = std::min(viewer.position.x + width, m_gridSize.x - 1);
+		if (left > right)
+			continue;
+
+		// whole span of the row is set with one mask per touched word
+		uint64_t * row = &visible[y*m_wordsPerRow];
+		int firstWord = left / 64;
+		int lastWord = right / 64;
+		for (int word = firstWord; word <= lastWord; ++word)
+		{
+			int from = (word == firstWord) ? left % 64 : 0;
+			int to = (word == lastWord) ? right % 64 : 63;
+			uint64_t mask = (to - from == 63) ? ~uint64_t(0u) : (((uint64_t(1u) << (to - from + 1)) - 1u) << from);
+			row[word] |= mask;
+		}
+	}
+}
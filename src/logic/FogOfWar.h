@@ -0,0 +1,156 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <vector>
+#include <cstdint>
+#include <SFML/Graphics.hpp>
+
+//--------------------------------------------------------------------------
+
+#include "defines.h"
+#include "JobSystem.h"
+
+//--------------------------------------------------------------------------
+
+/*!
+* \brief Visible and explored tiles of every player
+*
+* Every row of the grid is stored as 64 tile words, so one circle stamp row is OR-ed into at most a few words. Map is
+* divided into bands of CHUNK_SIZE rows. When viewer moves or changes sight radius, only bands touched by it's old and
+* new circle are marked dirty. update() clears dirty bands and OR-s stamps of viewers which reach them, so cost of the
+* update depends on amount of changed viewers, not on the map area. Layers of players are independent, so every player
+* is updated by separate job.
+*
+* Usage example:
+* \code
+* FogOfWar fog(grid.getGridSize(), MAX_PLAYERS);
+* unsigned int viewer = fog.addViewer(0, sf::Vector2i(10, 10), 6);
+* fog.moveViewer(viewer, sf::Vector2i(11, 10));
+* fog.update(jobs);
+* bool visible = fog.isVisible(0, 12, 10);
+* \endcode
+*
+*/
+class FogOfWar
+{
+public:
+	static constexpr unsigned int MAX_SIGHT_RADIUS = 2 * CHUNK_SIZE;	///< the biggest supported sight radius in tiles
+
+	/*!
+	* \brief Default constructor
+	*
+	* \param gridSize Size of the grid in tiles
+	* \param playerCount Amount of players
+	*
+	*/
+	FogOfWar(sf::Vector2i gridSize, unsigned int playerCount);
+
+	/*!
+	* \brief Add viewer which reveals circle around it's position
+	*
+	* \return Id of viewer
+	*
+	*/
+	unsigned int addViewer(unsigned int player, sf::Vector2i position, unsigned int radius);
+
+	void moveViewer(unsigned int viewer, sf::Vector2i position);
+	void setViewerRadius(unsigned int viewer, unsigned int radius);
+	void removeViewer(unsigned int viewer);
+
+	inline unsigned int getViewerPlayer(unsigned int viewer) const { return m_viewers[viewer].player; }
+
+	/*!
+	* \brief Recompute visibility of all dirty bands and add visible tiles to explored tiles
+	*
+	* \param jobs Job system which updates players in parallel, function returns when all of them are finished
+	*
+	*/
+	void update(logic::JobSystem & jobs);
+
+	inline bool isVisible(unsigned int player, int x, int y) const { return testBit(m_players[player].visible, x, y); }
+	inline bool isExplored(unsigned int player, int x, int y) const { return testBit(m_players[player].explored, x, y); }
+
+	/*!
+	* \brief Return words of one row of visible tiles, bit i of word j is tile x = j*64 + i
+	*/
+	inline const uint64_t * getVisibleRow(unsigned int player, int y) const { return &m_players[player].visible[y*m_wordsPerRow]; }
+	inline const uint64_t * getExploredRow(unsigned int player, int y) const { return &m_players[player].explored[y*m_wordsPerRow]; }
+	inline unsigned int getWordsPerRow() const { return m_wordsPerRow; }
+
+private:
+	/*!
+	* \brief Single source of visibility
+	*/
+	struct Viewer
+	{
+		sf::Vector2i position;		///< tile of the viewer
+		unsigned int radius;		///< sight radius in tiles
+		unsigned int player;		///< owner of the viewer
+		unsigned int band;			///< band of the viewer position
+		unsigned int bandSlot;		///< index of viewer in list of viewers of the band
+		bool alive;					///< false if viewer was removed and id can be reused
+	};
+
+	/*!
+	* \brief Fog data of one player
+	*/
+	struct PlayerFog
+	{
+		std::vector<uint64_t> visible;						///< currently visible tiles
+		std::vector<uint64_t> explored;						///< tiles which were ever visible
+		std::vector<std::vector<unsigned int>> bandViewers;	///< viewers placed in every band
+		std::vector<bool> bandDirty;						///< true if band must be recomputed
+		std::vector<unsigned int> dirtyBands;				///< list of dirty bands
+	};
+
+	inline bool testBit(const std::vector<uint64_t> & bits, int x, int y) const
+	{
+		return (bits[y*m_wordsPerRow + x / 64] >> (x % 64)) & 1u;
+	}
+
+	/*!
+	* \brief Mark all bands touched by circle of the viewer as dirty
+	*/
+	void markDirty(const Viewer & viewer);
+
+	void addToBand(unsigned int viewerId);
+	void removeFromBand(unsigned int viewerId);
+
+	/*!
+	* \brief Recompute dirty bands of one player, it reads only shared viewers so players can be updated in parallel
+	*/
+	void updatePlayer(PlayerFog & player) const;
+
+	/*!
+	* \brief OR rows of viewer circle which are inside [firstRow, lastRow] into visible tiles
+	*/
+	void stamp(const Viewer & viewer, std::vector<uint64_t> & visible, int firstRow, int lastRow) const;
+
+private:
+	sf::Vector2i m_gridSize;								///< size of the grid in tiles
+	unsigned int m_wordsPerRow;								///< amount of 64 tile words in one row
+	unsigned int m_bandCount;								///< amount of bands
+	std::vector<PlayerFog> m_players;						///< fog of every player
+	std::vector<Viewer> m_viewers;							///< all viewers, removed ones are reused
+	std::vector<unsigned int> m_freeViewers;				///< ids of removed viewers
+	std::vector<std::vector<uint8_t>> m_circleHalfWidth;	///< half width of circle row for every radius and row offset
+};
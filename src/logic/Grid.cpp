@@ -17,19 +17,192 @@
 */
 
 #include "Grid.h"
+#include "MapFile.h"
 
 //--------------------------------------------------------------------------
 
-Grid::Grid(sf::Vector2i & gridSize) :
-	m_gridSize{gridSize}
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <atomic>
+
+//--------------------------------------------------------------------------
+
+namespace
+{
+	/*!
+	* \brief Return amount of set bits in the word
+	*/
+	inline unsigned int popCount(uint64_t word)
+	{
+#ifdef __GNUC__
+		return static_cast<unsigned int>(__builtin_popcountll(word));
+#else
+		unsigned int count = 0u;
+		for (; word != 0u; word &= word - 1u)
+			++count;
+		return count;
+#endif
+	}
+}
+
+//--------------------------------------------------------------------------
+
+GridView::GridView(sf::Vector2i gridSize) :
+	m_gridSize{ gridSize }
 {
 	// check if gridSize and chunkSize fit
-	assert( ((gridSize.x % m_chunkSize.x) == 0) && ((gridSize.y % m_chunkSize.y) == 0) );
+	assert(((gridSize.x % m_chunkSize.x) == 0) && ((gridSize.y % m_chunkSize.y) == 0));
 	m_chunkGridSize.x = gridSize.x / m_chunkSize.x;
 	m_chunkGridSize.y = gridSize.y / m_chunkSize.y;
 	m_chunkSizeN = m_chunkSize.x*m_chunkSize.y;
+}
 
-	m_objType.resize(gridSize.x*gridSize.y);
+//--------------------------------------------------------------------------
+
+int GridView::getMinMoveCost() const
+{
+	int minCost = std::numeric_limits<int>::max();
+	for (int i = 0; i < static_cast<int>(TerrainType::COUNT); ++i)
+	{
+		if (m_terrainCount[i] > 0u)
+			minCost = std::min(minCost, TERRAIN_MOVE_COST[i]);
+	}
+	return minCost;
+}
+
+//--------------------------------------------------------------------------
+
+bool GridView::isAreaClear(sf::IntRect area, GridPlane plane) const
+{
+	if (!clipArea(area))
+		return true;
+
+	int firstChunkX = area.left / m_chunkSize.x;
+	int lastChunkX = (area.left + area.width - 1) / m_chunkSize.x;
+	int firstChunkY = area.top / m_chunkSize.y;
+	int lastChunkY = (area.top + area.height - 1) / m_chunkSize.y;
+
+	for (int chunkY = firstChunkY; chunkY <= lastChunkY; ++chunkY)
+	{
+		int top = std::max(area.top - chunkY*m_chunkSize.y, 0);
+		int bottom = std::min(area.top + area.height - chunkY*m_chunkSize.y, m_chunkSize.y);
+		for (int chunkX = firstChunkX; chunkX <= lastChunkX; ++chunkX)
+		{
+			int left = std::max(area.left - chunkX*m_chunkSize.x, 0);
+			int right = std::min(area.left + area.width - chunkX*m_chunkSize.x, m_chunkSize.x);
+			if (getChunkBits(plane, chunkY*m_chunkGridSize.x + chunkX) & chunkMask(left, top, right - left, bottom - top))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+//--------------------------------------------------------------------------
+
+unsigned int GridView::countTiles(sf::IntRect area, GridPlane plane) const
+{
+	if (!clipArea(area))
+		return 0u;
+
+	int firstChunkX = area.left / m_chunkSize.x;
+	int lastChunkX = (area.left + area.width - 1) / m_chunkSize.x;
+	int firstChunkY = area.top / m_chunkSize.y;
+	int lastChunkY = (area.top + area.height - 1) / m_chunkSize.y;
+
+	unsigned int count = 0u;
+	for (int chunkY = firstChunkY; chunkY <= lastChunkY; ++chunkY)
+	{
+		int top = std::max(area.top - chunkY*m_chunkSize.y, 0);
+		int bottom = std::min(area.top + area.height - chunkY*m_chunkSize.y, m_chunkSize.y);
+		for (int chunkX = firstChunkX; chunkX <= lastChunkX; ++chunkX)
+		{
+			int left = std::max(area.left - chunkX*m_chunkSize.x, 0);
+			int right = std::min(area.left + area.width - chunkX*m_chunkSize.x, m_chunkSize.x);
+			count += popCount(getChunkBits(plane, chunkY*m_chunkGridSize.x + chunkX) & chunkMask(left, top, right - left, bottom - top));
+		}
+	}
+
+	return count;
+}
+
+//--------------------------------------------------------------------------
+
+uint64_t GridView::chunkMask(int left, int top, int width, int height)
+{
+	// bits of one row are repeated for every row of the rectangle
+	uint64_t rowMask = ((uint64_t(1u) << width) - 1u) << left;
+
+	uint64_t mask = 0u;
+	for (int y = top; y < top + height; ++y)
+		mask |= rowMask << (y*CHUNK_SIZE);
+	return mask;
+}
+
+//--------------------------------------------------------------------------
+
+bool GridView::clipArea(sf::IntRect & area) const
+{
+	int left = std::max(area.left, 0);
+	int top = std::max(area.top, 0);
+	int right = std::min(area.left + area.width, m_gridSize.x);
+	int bottom = std::min(area.top + area.height, m_gridSize.y);
+	if (left >= right || top >= bottom)
+		return false;
+
+	area = sf::IntRect(left, top, right - left, bottom - top);
+	return true;
+}
+
+//--------------------------------------------------------------------------
+
+Grid::Grid(sf::Vector2i & gridSize) :
+	GridView(gridSize)
+{
+	unsigned int chunkCount = m_chunkGridSize.x*m_chunkGridSize.y;
+
+	// all chunks start as empty grass
+	GridChunk emptyChunk;
+	std::fill(std::begin(emptyChunk.objType), std::end(emptyChunk.objType), ObjectType::NONE);
+	std::fill(std::begin(emptyChunk.terrain), std::end(emptyChunk.terrain), TerrainType::GRASS);
+	std::fill(std::begin(emptyChunk.height), std::end(emptyChunk.height), 0u);
+	std::fill(std::begin(emptyChunk.clearance), std::end(emptyChunk.clearance), 0u);
+	std::fill(std::begin(emptyChunk.planes), std::end(emptyChunk.planes), 0u);
+	emptyChunk.version = 0u;
+	emptyChunk.reserved = 0u;
+	m_chunks.reserve(chunkCount);
+	for (unsigned int i = 0u; i < chunkCount; ++i)
+		m_chunks.push_back(std::make_shared<GridChunk>(emptyChunk));
+	m_terrainCount[static_cast<int>(TerrainType::GRASS)] = gridSize.x*gridSize.y;
+
+	// compute clearance of empty grid
+	m_clearanceDirty.resize(chunkCount, false);
+	m_chunkChanged.resize(chunkCount, false);
+	m_chunkMapped.resize(chunkCount, false);
+	for (int i = chunkCount - 1; i >= 0; --i)
+		computeChunkClearance(i);
+}
+
+//--------------------------------------------------------------------------
+
+Grid::Grid(const std::shared_ptr<const MapFile> & map) :
+	GridView(map->getGridSize())
+{
+	unsigned int chunkCount = m_chunkGridSize.x*m_chunkGridSize.y;
+
+	// chunks share ownership of the mapping, so use count counts owners of the whole file and not of the chunk (map of one
+	// chunk released by caller has use count 1); mapped chunks are flagged instead and writableChunk() always clones them
+	m_chunks.reserve(chunkCount);
+	for (unsigned int i = 0u; i < chunkCount; ++i)
+		m_chunks.push_back(std::shared_ptr<GridChunk>(map, const_cast<GridChunk*>(map->getChunks() + i)));
+	for (int i = 0; i < static_cast<int>(TerrainType::COUNT); ++i)
+		m_terrainCount[i] = map->getHeader().terrainCount[i];
+
+	// clearance is stored in the file
+	m_clearanceDirty.resize(chunkCount, false);
+	m_chunkChanged.resize(chunkCount, false);
+	m_chunkMapped.resize(chunkCount, true);
 }
 
 //--------------------------------------------------------------------------
@@ -37,3 +210,291 @@ Grid::Grid(sf::Vector2i & gridSize) :
 Grid::~Grid()
 {
 }
+
+//--------------------------------------------------------------------------
+
+void Grid::setObjectType(unsigned int index, ObjectType type)
+{
+	unsigned int chunkIndex = index / CHUNK_TILES;
+	unsigned int tile = index % CHUNK_TILES;
+	markChanged(chunkIndex);
+	markClearanceDirty(chunkIndex);
+
+	GridChunk & chunk = writableChunk(chunkIndex);
+	chunk.objType[tile] = type;
+
+	// keep bit planes in sync with object types
+	uint64_t bit = uint64_t(1u) << tile;
+	auto setBit = [&](GridPlane plane, bool value)
+	{
+		if (value)
+			chunk.planes[static_cast<int>(plane)] |= bit;
+		else
+			chunk.planes[static_cast<int>(plane)] &= ~bit;
+	};
+	setBit(GridPlane::BLOCKED, type != ObjectType::NONE);
+	setBit(GridPlane::UNIT, type == ObjectType::UNIT);
+	setBit(GridPlane::TREE, type == ObjectType::TREE);
+	setBit(GridPlane::BUILDING, type == ObjectType::BUILDING);
+}
+
+//--------------------------------------------------------------------------
+
+void Grid::setTerrainType(unsigned int index, TerrainType type)
+{
+	unsigned int chunkIndex = index / CHUNK_TILES;
+	markChanged(chunkIndex);
+
+	GridChunk & chunk = writableChunk(chunkIndex);
+	--m_terrainCount[static_cast<int>(chunk.terrain[index % CHUNK_TILES])];
+	++m_terrainCount[static_cast<int>(type)];
+	chunk.terrain[index % CHUNK_TILES] = type;
+}
+
+//--------------------------------------------------------------------------
+
+void Grid::setHeight(unsigned int index, uint8_t height)
+{
+	unsigned int chunkIndex = index / CHUNK_TILES;
+	markChanged(chunkIndex);
+	writableChunk(chunkIndex).height[index % CHUNK_TILES] = height;
+}
+
+//--------------------------------------------------------------------------
+
+void Grid::replaceChunk(unsigned int chunkIndex, const GridChunk & chunk)
+{
+	markChanged(chunkIndex);
+	markClearanceDirty(chunkIndex);
+
+	GridChunk & target = writableChunk(chunkIndex);
+	std::fill(std::begin(target.planes), std::end(target.planes), 0u);
+	for (unsigned int tile = 0u; tile < CHUNK_TILES; ++tile)
+	{
+		--m_terrainCount[static_cast<int>(target.terrain[tile])];
+		++m_terrainCount[static_cast<int>(chunk.terrain[tile])];
+		target.objType[tile] = chunk.objType[tile];
+		target.terrain[tile] = chunk.terrain[tile];
+		target.height[tile] = chunk.height[tile];
+
+		uint64_t bit = uint64_t(1u) << tile;
+		ObjectType type = chunk.objType[tile];
+		if (type != ObjectType::NONE)
+			target.planes[static_cast<int>(GridPlane::BLOCKED)] |= bit;
+		if (type == ObjectType::UNIT)
+			target.planes[static_cast<int>(GridPlane::UNIT)] |= bit;
+		if (type == ObjectType::TREE)
+			target.planes[static_cast<int>(GridPlane::TREE)] |= bit;
+		if (type == ObjectType::BUILDING)
+			target.planes[static_cast<int>(GridPlane::BUILDING)] |= bit;
+	}
+}
+
+//--------------------------------------------------------------------------
+
+void Grid::setObjectType(sf::IntRect area, ObjectType type)
+{
+	if (!clipArea(area))
+		return;
+
+	for (int y = area.top; y < area.top + area.height; ++y)
+	{
+		for (int x = area.left; x < area.left + area.width; ++x)
+			setObjectType(getIndex(x, y), type);
+	}
+}
+
+//--------------------------------------------------------------------------
+
+bool Grid::placeFootprint(sf::IntRect area, ObjectType type)
+{
+	assert(type != ObjectType::NONE);
+
+	sf::IntRect clipped = area;
+	if (!clipArea(clipped) || clipped.width != area.width || clipped.height != area.height)
+		return false;
+	if (!isAreaClear(area))
+		return false;
+
+	setObjectType(area, type);
+	return true;
+}
+
+//--------------------------------------------------------------------------
+
+void Grid::removeFootprint(sf::IntRect area)
+{
+	setObjectType(area, ObjectType::NONE);
+}
+
+//--------------------------------------------------------------------------
+
+const GridChangeSet & Grid::publishChanges()
+{
+	updateClearance();
+
+	std::sort(m_changes.dirtyChunks.begin(), m_changes.dirtyChunks.end());
+	for (auto chunkIndex : m_changes.dirtyChunks)
+		m_chunkChanged[chunkIndex] = false;
+
+	// keep capacity of both change sets, so publishing don't allocate memory
+	m_changes.tick = m_tick;
+	std::swap(m_published, m_changes);
+	m_changes.dirtyChunks.clear();
+	++m_tick;
+	m_snapshot.reset();
+
+	for (auto & subscriber : m_subscribers)
+		subscriber.second(m_published);
+
+	return m_published;
+}
+
+//--------------------------------------------------------------------------
+
+std::shared_ptr<const GridSnapshot> Grid::snapshot()
+{
+	auto snapshot = m_snapshot.lock();
+	if (snapshot)
+		return snapshot;
+
+	updateClearance();
+	snapshot = std::make_shared<const GridSnapshot>(*this, m_tick);
+	m_snapshot = snapshot;
+	return snapshot;
+}
+
+//--------------------------------------------------------------------------
+
+unsigned int Grid::subscribe(logic::Delegate<void(const GridChangeSet &)> listener)
+{
+	m_subscribers.emplace_back(m_nextSubscriptionId, listener);
+	return m_nextSubscriptionId++;
+}
+
+//--------------------------------------------------------------------------
+
+void Grid::unsubscribe(unsigned int subscriptionId)
+{
+	auto it = std::find_if(m_subscribers.begin(), m_subscribers.end(),
+		[subscriptionId](const std::pair<unsigned int, logic::Delegate<void(const GridChangeSet &)>> & subscriber) { return subscriber.first == subscriptionId; });
+	if (it != m_subscribers.end())
+		m_subscribers.erase(it);
+}
+
+//--------------------------------------------------------------------------
+
+void Grid::updateClearance()
+{
+	// chunks on the right and bottom side have higher indexes, so they are computed first
+	std::sort(m_clearanceDirtyList.begin(), m_clearanceDirtyList.end(), std::greater<unsigned int>());
+	for (auto chunkIndex : m_clearanceDirtyList)
+	{
+		// left and top neighbours of changed chunk may get new clearance without any own change, consumers keyed
+		// by chunk version have to see them too
+		if (computeChunkClearance(chunkIndex))
+			markChanged(chunkIndex);
+		m_clearanceDirty[chunkIndex] = false;
+	}
+	m_clearanceDirtyList.clear();
+}
+
+//--------------------------------------------------------------------------
+
+GridChunk & Grid::writableChunk(unsigned int chunkIndex)
+{
+	std::shared_ptr<GridChunk> & chunk = m_chunks[chunkIndex];
+	if (chunk.use_count() > 1 || m_chunkMapped[chunkIndex])
+	{
+		chunk = std::make_shared<GridChunk>(*chunk);
+		m_chunkMapped[chunkIndex] = false;
+	}
+	else
+	{
+		// snapshot released on another thread must finish all reads before chunk is changed
+		std::atomic_thread_fence(std::memory_order_acquire);
+	}
+	return *chunk;
+}
+
+//--------------------------------------------------------------------------
+
+void Grid::markClearanceDirty(unsigned int chunkIndex)
+{
+	int chunkX = chunkIndex % m_chunkGridSize.x;
+	int chunkY = chunkIndex / m_chunkGridSize.x;
+
+	// MAX_CLEARANCE is not bigger than chunk size, so change can't reach further than neighbour chunks
+	for (int y = std::max(chunkY - 1, 0); y <= chunkY; ++y)
+	{
+		for (int x = std::max(chunkX - 1, 0); x <= chunkX; ++x)
+		{
+			unsigned int index = y*m_chunkGridSize.x + x;
+			if (!m_clearanceDirty[index])
+			{
+				m_clearanceDirty[index] = true;
+				m_clearanceDirtyList.push_back(index);
+			}
+		}
+	}
+}
+
+//--------------------------------------------------------------------------
+
+bool Grid::computeChunkClearance(unsigned int chunkIndex)
+{
+	int originX = (chunkIndex % m_chunkGridSize.x)*m_chunkSize.x;
+	int originY = (chunkIndex / m_chunkGridSize.x)*m_chunkSize.y;
+
+	// tiles outside of the grid are treated as occupied
+	auto clearanceAt = [this](int x, int y) -> unsigned int
+	{
+		if (x >= m_gridSize.x || y >= m_gridSize.y)
+			return 0u;
+		return getClearance(getIndex(x, y));
+	};
+
+	// compute all values first, chunk is cloned only if clearance really changed
+	uint8_t clearance[CHUNK_TILES];
+	const GridChunk & chunk = *m_chunks[chunkIndex];
+	for (int y = m_chunkSize.y - 1; y >= 0; --y)
+	{
+		for (int x = m_chunkSize.x - 1; x >= 0; --x)
+		{
+			unsigned int tile = x + y*m_chunkSize.x;
+			if ((chunk.planes[static_cast<int>(GridPlane::BLOCKED)] >> tile) & 1u)
+			{
+				clearance[tile] = 0u;
+				continue;
+			}
+
+			// neighbours inside the chunk are taken from values computed above
+			auto localClearance = [&](int localX, int localY) -> unsigned int
+			{
+				if (localX < m_chunkSize.x && localY < m_chunkSize.y)
+					return clearance[localX + localY*m_chunkSize.x];
+				return clearanceAt(originX + localX, originY + localY);
+			};
+			unsigned int value = std::min(localClearance(x + 1, y), std::min(localClearance(x, y + 1), localClearance(x + 1, y + 1))) + 1u;
+			clearance[tile] = static_cast<uint8_t>(std::min(value, MAX_CLEARANCE));
+		}
+	}
+
+	if (std::equal(std::begin(clearance), std::end(clearance), std::begin(chunk.clearance)))
+		return false;
+	std::copy(std::begin(clearance), std::end(clearance), std::begin(writableChunk(chunkIndex).clearance));
+	return true;
+}
+
+//--------------------------------------------------------------------------
+
+void Grid::markChanged(unsigned int chunkIndex)
+{
+	if (!m_chunkChanged[chunkIndex])
+	{
+		m_chunkChanged[chunkIndex] = true;
+		m_changes.dirtyChunks.push_back(chunkIndex);
+		++writableChunk(chunkIndex).version;
+	}
+	m_snapshot.reset();
+}
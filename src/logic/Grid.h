@@ -21,46 +21,263 @@
 //--------------------------------------------------------------------------
 
 #include <vector>
+#include <memory>
+#include <cstdint>
+#include <type_traits>
 #include <SFML/Graphics.hpp>
 
 //--------------------------------------------------------------------------
 
 #include "defines.h"
+#include "Delegate.h"
 #include <cassert>
 
 //--------------------------------------------------------------------------
 
-enum class TerrainType
+enum class TerrainType : uint8_t
 {
-	
+	GRASS,
+	ROAD,
+	FOREST_FLOOR,
+	SHALLOW_WATER,
+	COUNT,
 };
 
+/*!
+* \brief Cost of entering tile with given terrain type, indexed by TerrainType
+*/
+constexpr int TERRAIN_MOVE_COST[] =
+{
+	10,		// GRASS
+	7,		// ROAD
+	15,		// FOREST_FLOOR
+	25,		// SHALLOW_WATER
+};
+
+static_assert(sizeof(TERRAIN_MOVE_COST) / sizeof(TERRAIN_MOVE_COST[0]) == static_cast<int>(TerrainType::COUNT), "Every TerrainType needs move cost");
+
 //--------------------------------------------------------------------------
 
-enum class ObjectType
+enum class ObjectType : uint8_t
 {
 	NONE,
 	UNIT,
 	TREE,
 	BUILDING,
+	RESOURCE,
+	COUNT,
 };
 
 //--------------------------------------------------------------------------
 
-class Grid
+/*!
+* \brief Id of bit planes derived from object types of tiles
+*
+* Every plane keeps one bit per tile. Tiles are packed 64 per word in chunk order, so one word holds
+* all tiles of one chunk and bit (x + y*CHUNK_SIZE) of the word is tile (x,y) of the chunk.
+*
+*/
+enum class GridPlane
 {
-public:
-	Grid(sf::Vector2i & gridSize);
-	~Grid();
+	BLOCKED,	///< tile is occupied by any object
+	UNIT,		///< tile is occupied by unit
+	TREE,		///< tile is occupied by tree
+	BUILDING,	///< tile is occupied by building
+	COUNT,
+};
 
+constexpr unsigned int CHUNK_TILES = CHUNK_SIZE*CHUNK_SIZE;
+
+static_assert(CHUNK_TILES == 64, "Grid bit planes expect exactly one 64 bit word per chunk");
+
+//--------------------------------------------------------------------------
+
+/*!
+* \brief All changes of the grid made during one simulation tick
+*/
+struct GridChangeSet
+{
+	unsigned int tick{ 0u };					///< number of the tick which made changes
+	std::vector<unsigned int> dirtyChunks;		///< indexes of changed chunks (chunk_x + chunk_y*chunkGridSize.x), sorted
+};
+
+//--------------------------------------------------------------------------
+
+/*!
+* \brief All tile layers of one chunk
+*
+* Grid keeps chunks in shared blocks, so snapshots of the grid can share chunks which were not changed since
+* snapshot was taken. Tiles inside chunk are ordered row by row (x + y*CHUNK_SIZE).
+*
+*/
+struct GridChunk
+{
+	ObjectType objType[CHUNK_TILES];							///< object type of tiles
+	TerrainType terrain[CHUNK_TILES];							///< terrain type of tiles
+	uint8_t height[CHUNK_TILES];								///< height of tiles
+	uint8_t clearance[CHUNK_TILES];								///< clearance of tiles (see GridView::getClearance())
+	uint64_t planes[static_cast<int>(GridPlane::COUNT)];		///< bit planes derived from object types
+	uint32_t version;											///< version of the chunk, increased in every tick which changed the chunk
+	uint32_t reserved;											///< always 0, chunks are stored in map files byte by byte (see MapFile)
+};
+
+static_assert(std::is_trivially_copyable<GridChunk>::value && std::is_standard_layout<GridChunk>::value, "GridChunk must be plain data to be mapped from file");
+
+//--------------------------------------------------------------------------
+
+/*!
+* \brief Read only access to tiles of the grid
+*
+* This is common base of Grid and GridSnapshot, so code which only reads tiles (like PathingSystem) can work
+* on live grid as well as on snapshot taken by another thread.
+*
+*/
+class GridView
+{
+public:
 	inline sf::Vector2i getGridSize() const { return m_gridSize; }
 	inline sf::Vector2i getChunkSize() const { return m_chunkSize; }
 	inline sf::Vector2i getChunkGridSize() const { return m_chunkGridSize; }
 	inline int getChunkSizeN() const { return m_chunkSizeN; }
-	inline ObjectType getObjectType(unsigned int index) const { return m_objType[index]; }
+	inline ObjectType getObjectType(unsigned int index) const { return chunk(index / CHUNK_TILES).objType[index % CHUNK_TILES]; }
+	inline TerrainType getTerrainType(unsigned int index) const { return chunk(index / CHUNK_TILES).terrain[index % CHUNK_TILES]; }
+	inline uint8_t getHeight(unsigned int index) const { return chunk(index / CHUNK_TILES).height[index % CHUNK_TILES]; }
 
-private:
-	std::vector<ObjectType> m_objType;		///< object type
+	/*!
+	* \brief Return all layers of the chunk
+	*
+	* \param chunkIndex Index of the chunk (chunk_x + chunk_y*chunkGridSize.x)
+	*
+	*/
+	inline const GridChunk & chunk(unsigned int chunkIndex) const { return *m_chunks[chunkIndex]; }
+
+	/*!
+	* \brief Return cost of entering the tile which depends on it's terrain type
+	*
+	* \param index Index of the tile (see getIndex())
+	*
+	*/
+	inline int getMoveCost(unsigned int index) const { return TERRAIN_MOVE_COST[static_cast<int>(getTerrainType(index))]; }
+
+	/*!
+	* \brief Return lowest move cost of all terrain types which are present on the grid
+	*
+	* This value multiplied by distance in tiles is never higher than real cost of moving between two tiles.
+	*
+	*/
+	int getMinMoveCost() const;
+
+	/*!
+	* \brief Return version of the chunk, which is increased in every tick which changed the chunk
+	*
+	* \param chunkIndex Index of the chunk (chunk_x + chunk_y*chunkGridSize.x)
+	*
+	*/
+	inline uint32_t getChunkVersion(unsigned int chunkIndex) const { return chunk(chunkIndex).version; }
+
+	/*!
+	* \brief Return index of the tile inside chunk ordered tile containers
+	*
+	* Tiles are stored chunk by chunk, so all tiles of one chunk are placed next to each other in memory.
+	*
+	* \param gridPosition_x X position of the tile in grid coordinates
+	* \param gridPosition_y Y position of the tile in grid coordinates
+	*
+	*/
+	inline unsigned int getIndex(int gridPosition_x, int gridPosition_y) const
+	{
+		return (gridPosition_x / m_chunkSize.x + (gridPosition_y / m_chunkSize.y)*m_chunkGridSize.x)*m_chunkSizeN + (gridPosition_x % m_chunkSize.x) +
+			(gridPosition_y % m_chunkSize.y)*m_chunkSize.x;
+	}
+
+	/*!
+	* \brief Return true if tile is occupied by any object
+	*
+	* \param index Index of the tile (see getIndex())
+	*
+	*/
+	inline bool isBlocked(unsigned int index) const { return isSet(GridPlane::BLOCKED, index); }
+
+	/*!
+	* \brief Return bit of the tile on specified plane
+	*
+	* \param plane Id of bit plane
+	* \param index Index of the tile (see getIndex())
+	*
+	*/
+	inline bool isSet(GridPlane plane, unsigned int index) const
+	{
+		return (getChunkBits(plane, index / CHUNK_TILES) >> (index % CHUNK_TILES)) & 1u;
+	}
+
+	/*!
+	* \brief Return word which holds bits of all tiles of the chunk on specified plane
+	*
+	* \param plane Id of bit plane
+	* \param chunkIndex Index of the chunk (chunk_x + chunk_y*chunkGridSize.x)
+	*
+	*/
+	inline uint64_t getChunkBits(GridPlane plane, unsigned int chunkIndex) const { return chunk(chunkIndex).planes[static_cast<int>(plane)]; }
+
+	/*!
+	* \brief Check if none of tiles inside area is set on specified plane
+	*
+	* Every chunk touched by area is checked with single word test. This can be used to validate placement
+	* of buildings or any other footprint. Parts of area outside of the grid are ignored.
+	*
+	* \param area Checked area in grid coordinates
+	* \param plane Id of bit plane
+	*
+	*/
+	bool isAreaClear(sf::IntRect area, GridPlane plane = GridPlane::BLOCKED) const;
+
+	/*!
+	* \brief Count tiles inside area which are set on specified plane
+	*
+	* \param area Checked area in grid coordinates, parts of area outside of the grid are ignored
+	* \param plane Id of bit plane
+	*
+	*/
+	unsigned int countTiles(sf::IntRect area, GridPlane plane = GridPlane::BLOCKED) const;
+
+	/*!
+	* \brief Return mask of chunk word bits covering tiles from rectangle inside chunk
+	*
+	* \param left X position of the first column inside chunk
+	* \param top Y position of the first row inside chunk
+	* \param width Amount of columns
+	* \param height Amount of rows
+	*
+	*/
+	static uint64_t chunkMask(int left, int top, int width, int height);
+
+	/*!
+	* \brief Return clearance of the tile
+	*
+	* Clearance is the size of the largest free square which top left corner is placed on the tile, capped
+	* at MAX_CLEARANCE. Unit of size N can stand on the tile only if clearance is not lower than N. Occupied tiles
+	* have clearance equal 0. On live grid value is valid only after Grid::updateClearance() was called for last
+	* changes, snapshots always have valid clearance.
+	*
+	* \param index Index of the tile (see getIndex())
+	*
+	*/
+	inline unsigned int getClearance(unsigned int index) const { return chunk(index / CHUNK_TILES).clearance[index % CHUNK_TILES]; }
+
+protected:
+	GridView(sf::Vector2i gridSize);
+	GridView(const GridView & view) = default;
+	GridView & operator=(const GridView & view) = default;
+	~GridView() = default;
+
+	/*!
+	* \brief Clip area to grid bounds, return false if nothing is left
+	*/
+	bool clipArea(sf::IntRect & area) const;
+
+protected:
+	std::vector<std::shared_ptr<GridChunk>> m_chunks;						///< all chunks, possibly shared with snapshots
+	unsigned int m_terrainCount[static_cast<int>(TerrainType::COUNT)]{};	///< amount of tiles of every terrain type
 
 	sf::Vector2i m_gridSize;											///< size of the grid in grid coordinates (amount of tiles in x and y direction in all grid)
 	sf::Vector2i m_chunkSize{ sf::Vector2i(CHUNK_SIZE,CHUNK_SIZE) };	///< size of the chunk in grid coordinates (amount of tiles in x and y direction in chunk)
@@ -68,3 +285,207 @@ private:
 	int m_chunkSizeN;													///< amount of tiles in chunk
 };
 
+//--------------------------------------------------------------------------
+
+/*!
+* \brief Immutable view of the grid at the end of one tick
+*
+* Snapshot shares chunks with the grid, so taking it costs only copying of chunk pointers. Grid never changes chunk
+* which is shared with snapshot, it clones it first. Because of that snapshot can be read by any thread without locks
+* while main thread changes the grid.
+*
+*/
+class GridSnapshot final : public GridView
+{
+public:
+	GridSnapshot(const GridView & view, unsigned int tick) :
+		GridView(view), m_tick{ tick }
+	{
+	}
+
+	/*!
+	* \brief Return number of the tick which state is kept by snapshot
+	*/
+	inline unsigned int getTick() const { return m_tick; }
+
+private:
+	unsigned int m_tick;	///< number of the tick
+};
+
+//--------------------------------------------------------------------------
+
+class MapFile;
+
+class Grid : public GridView
+{
+public:
+	Grid(sf::Vector2i & gridSize);
+
+	/*!
+	* \brief Create grid which reads chunks directly from mapped map file
+	*
+	* Nothing is parsed or copied, grid shares every chunk with the file like with a snapshot, so chunk is cloned only
+	* when it's changed first time. File is kept mapped as long as any chunk of grid or snapshot uses it.
+	*
+	* \param map Opened map file (see MapFile::open())
+	*
+	*/
+	Grid(const std::shared_ptr<const MapFile> & map);
+	~Grid();
+
+	/*!
+	* \brief Set type of object which occupy the tile
+	*
+	* \param index Index of the tile (see getIndex())
+	* \param type New object type
+	*
+	*/
+	void setObjectType(unsigned int index, ObjectType type);
+
+	/*!
+	* \brief Set terrain type of the tile
+	*
+	* \param index Index of the tile (see getIndex())
+	* \param type New terrain type
+	*
+	*/
+	void setTerrainType(unsigned int index, TerrainType type);
+
+	/*!
+	* \brief Set height of the tile
+	*
+	* \param index Index of the tile (see getIndex())
+	* \param height New height
+	*
+	*/
+	void setHeight(unsigned int index, uint8_t height);
+
+	/*!
+	* \brief Replace object types, terrain and heights of all tiles of the chunk
+	*
+	* Bit planes are derived from object types of new chunk, it's clearance and planes are ignored.
+	*
+	* \param chunkIndex Index of the chunk (chunk_x + chunk_y*chunkGridSize.x)
+	* \param chunk New content of the chunk
+	*
+	*/
+	void replaceChunk(unsigned int chunkIndex, const GridChunk & chunk);
+
+	/*!
+	* \brief Set type of object on all tiles inside area
+	*
+	* \param area Changed area in grid coordinates, parts of area outside of the grid are ignored
+	* \param type New object type
+	*
+	*/
+	void setObjectType(sf::IntRect area, ObjectType type);
+
+	/*!
+	* \brief Occupy all tiles of footprint by the object if none of them is occupied already
+	*
+	* \param area Footprint of the object in grid coordinates
+	* \param type Type of object, can't be ObjectType::NONE
+	*
+	* \return False if footprint is not fully inside the grid or any of it's tiles is occupied, grid is not changed then
+	*
+	*/
+	bool placeFootprint(sf::IntRect area, ObjectType type);
+
+	/*!
+	* \brief Free all tiles of footprint
+	*
+	* \param area Footprint of removed object in grid coordinates
+	*
+	*/
+	void removeFootprint(sf::IntRect area);
+
+	/*!
+	* \brief Finish current tick and publish all changes made during it
+	*
+	* Clearance of changed chunks is updated and all subscribers are notified with one change set. Change set is
+	* published every tick, also when nothing was changed.
+	*
+	* \return Published change set, valid until next call
+	*
+	*/
+	const GridChangeSet & publishChanges();
+
+	/*!
+	* \brief Take immutable view of current state of the grid
+	*
+	* Clearance is updated before snapshot is taken. Snapshot is reused by all callers until the grid is changed,
+	* so taking it many times during one tick is cheap.
+	*
+	*/
+	std::shared_ptr<const GridSnapshot> snapshot();
+
+	/*!
+	* \brief Register function called with every published change set
+	*
+	* \param listener Delegate called from publishChanges()
+	*
+	* \return Id which can be used to unsubscribe
+	*
+	*/
+	unsigned int subscribe(logic::Delegate<void(const GridChangeSet &)> listener);
+
+	/*!
+	* \brief Remove function registered with subscribe()
+	*/
+	void unsubscribe(unsigned int subscriptionId);
+
+	/*!
+	* \brief Return number of current tick, which is increased by publishChanges()
+	*/
+	inline unsigned int getTick() const { return m_tick; }
+
+	/*!
+	* \brief Recompute clearance of chunks affected by changes since last update
+	*
+	* Change of the tile can only affect clearance of tiles inside it's own chunk and chunks on the left, top
+	* and top left side, so only these chunks are recomputed.
+	*
+	*/
+	void updateClearance();
+
+private:
+	/*!
+	* \brief Return chunk which can be changed
+	*
+	* Chunk shared with any snapshot or read from mapped map file is cloned first, so snapshots never see changes and
+	* read only mapping is never written.
+	*
+	*/
+	GridChunk & writableChunk(unsigned int chunkIndex);
+
+	/*!
+	* \brief Mark chunk and chunks which clearance depends on it as outdated
+	*/
+	void markClearanceDirty(unsigned int chunkIndex);
+
+	/*!
+	* \brief Recompute clearance of all tiles of the chunk, chunks on the right and bottom side must be up to date
+	*
+	* \return True if clearance of any tile has changed
+	*
+	*/
+	bool computeChunkClearance(unsigned int chunkIndex);
+
+	/*!
+	* \brief Add chunk to changes of current tick
+	*/
+	void markChanged(unsigned int chunkIndex);
+
+private:
+	std::vector<bool> m_clearanceDirty;										///< chunks which clearance is outdated
+	std::vector<unsigned int> m_clearanceDirtyList;							///< indexes of chunks which clearance is outdated
+
+	std::vector<bool> m_chunkChanged;										///< chunks changed in current tick
+	std::vector<bool> m_chunkMapped;										///< chunks which still point into mapped map file
+	GridChangeSet m_changes;												///< changes of current tick
+	GridChangeSet m_published;												///< last published changes
+	unsigned int m_tick{ 0u };												///< number of current tick
+	unsigned int m_nextSubscriptionId{ 0u };								///< id given to next subscriber
+	std::vector<std::pair<unsigned int, logic::Delegate<void(const GridChangeSet &)>>> m_subscribers;	///< listeners of published changes
+	std::weak_ptr<const GridSnapshot> m_snapshot;							///< last taken snapshot, valid if grid wasn't changed since then
+};
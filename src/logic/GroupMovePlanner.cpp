@@ -0,0 +1,258 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//--------------------------------------------------------------------------
+
+#include "GroupMovePlanner.h"
+
+//--------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+#include <limits>
+
+//--------------------------------------------------------------------------
+
+constexpr unsigned int GroupMovePlanner::REPAIR_MAX_EXPANDED;
+constexpr int GroupMovePlanner::MAX_SLOT_SHIFT;
+
+//--------------------------------------------------------------------------
+
+GroupMovePlanner::GroupMovePlanner(PathingSystem & pathing) :
+	m_pathing{ pathing }
+{
+}
+
+//--------------------------------------------------------------------------
+
+std::vector<std::vector<sf::Vector2i>> GroupMovePlanner::plan(const std::vector<sf::Vector2i> & unitPositions, sf::Vector2i targetPos, unsigned int unitSize)
+{
+	std::vector<std::vector<sf::Vector2i>> paths(unitPositions.size());
+	if (unitPositions.empty())
+		return paths;
+
+	++m_stats.groups;
+	m_stats.units += unitPositions.size();
+
+	// unit closest to the center of the group leads, so followers have the shortest way to their slots
+	sf::Vector2f center;
+	for (auto & pos : unitPositions)
+		center += sf::Vector2f(pos);
+	center /= static_cast<float>(unitPositions.size());
+
+	unsigned int leader = 0u;
+	float leaderDistance = std::numeric_limits<float>::max();
+	for (unsigned int i = 0u; i < unitPositions.size(); ++i)
+	{
+		sf::Vector2f diff = sf::Vector2f(unitPositions[i]) - center;
+		float distance = diff.x*diff.x + diff.y*diff.y;
+		if (distance < leaderDistance)
+		{
+			leaderDistance = distance;
+			leader = i;
+		}
+	}
+
+	paths[leader] = search(unitPositions[leader], targetPos, unitSize, 0u);
+	if (paths[leader].empty())
+		return paths;
+	std::vector<sf::Vector2i> leaderPath(paths[leader].rbegin(), paths[leader].rend());
+
+	std::vector<sf::Vector2i> offsets = formationOffsets(unitPositions.size(), unitSize);
+	std::vector<unsigned int> slots = assignSlots(unitPositions, leader, offsets);
+	std::vector<sf::Vector2i> usedTargets{ targetPos };
+	for (unsigned int i = 0u; i < unitPositions.size(); ++i)
+	{
+		if (i == leader)
+			continue;
+
+		sf::Vector2i offset = offsets[slots[i]];
+		sf::Vector2i slotTarget = targetPos + offset;
+		if (!findSlotTarget(slotTarget, unitSize, usedTargets))
+			continue;
+
+		usedTargets.push_back(slotTarget);
+		paths[i] = followLeader(unitPositions[i], offset, slotTarget, leaderPath, unitSize);
+	}
+
+	return paths;
+}
+
+//--------------------------------------------------------------------------
+
+std::vector<sf::Vector2i> GroupMovePlanner::formationOffsets(unsigned int count, unsigned int unitSize) const
+{
+	// slots are placed on square block centered on the leader, the closest ones are used first
+	int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(count))));
+	int rows = (static_cast<int>(count) + columns - 1) / columns;
+	int spacing = static_cast<int>(unitSize);
+
+	std::vector<sf::Vector2i> offsets;
+	offsets.reserve(columns*rows);
+	for (int y = 0; y < rows; ++y)
+	{
+		for (int x = 0; x < columns; ++x)
+			offsets.emplace_back((x - columns / 2)*spacing, (y - rows / 2)*spacing);
+	}
+
+	std::stable_sort(offsets.begin(), offsets.end(), [](const sf::Vector2i & a, const sf::Vector2i & b)
+	{
+		return a.x*a.x + a.y*a.y < b.x*b.x + b.y*b.y;
+	});
+	offsets.resize(count);
+	return offsets;
+}
+
+//--------------------------------------------------------------------------
+
+std::vector<unsigned int> GroupMovePlanner::assignSlots(const std::vector<sf::Vector2i> & unitPositions, unsigned int leader, const std::vector<sf::Vector2i> & offsets) const
+{
+	// greedy assignment of the closest pairs of unit position and slot, both relative to the leader
+	std::vector<std::tuple<int, unsigned int, unsigned int>> pairs;
+	pairs.reserve(unitPositions.size()*offsets.size());
+	for (unsigned int unit = 0u; unit < unitPositions.size(); ++unit)
+	{
+		if (unit == leader)
+			continue;
+
+		sf::Vector2i relative = unitPositions[unit] - unitPositions[leader];
+		for (unsigned int slot = 1u; slot < offsets.size(); ++slot)
+		{
+			sf::Vector2i diff = relative - offsets[slot];
+			pairs.emplace_back(diff.x*diff.x + diff.y*diff.y, unit, slot);
+		}
+	}
+	std::sort(pairs.begin(), pairs.end());
+
+	std::vector<unsigned int> slots(unitPositions.size(), 0u);
+	std::vector<bool> unitAssigned(unitPositions.size(), false);
+	std::vector<bool> slotAssigned(offsets.size(), false);
+	for (auto & pair : pairs)
+	{
+		unsigned int unit = std::get<1>(pair);
+		unsigned int slot = std::get<2>(pair);
+		if (unitAssigned[unit] || slotAssigned[slot])
+			continue;
+
+		slots[unit] = slot;
+		unitAssigned[unit] = true;
+		slotAssigned[slot] = true;
+	}
+	return slots;
+}
+
+//--------------------------------------------------------------------------
+
+bool GroupMovePlanner::findSlotTarget(sf::Vector2i & slotPos, unsigned int unitSize, const std::vector<sf::Vector2i> & usedTargets) const
+{
+	int size = static_cast<int>(unitSize);
+	auto isAvailable = [&](sf::Vector2i pos)
+	{
+		if (!isFree(pos, unitSize))
+			return false;
+		return std::none_of(usedTargets.begin(), usedTargets.end(), [&](const sf::Vector2i & used)
+		{
+			return std::abs(used.x - pos.x) < size && std::abs(used.y - pos.y) < size;
+		});
+	};
+
+	// check rings of tiles around the slot, starting with the slot itself
+	for (int distance = 0; distance <= MAX_SLOT_SHIFT; ++distance)
+	{
+		for (int y = -distance; y <= distance; ++y)
+		{
+			int step = (y == -distance || y == distance) ? 1 : std::max(2 * distance, 1);
+			for (int x = -distance; x <= distance; x += step)
+			{
+				sf::Vector2i pos(slotPos.x + x, slotPos.y + y);
+				if (isAvailable(pos))
+				{
+					slotPos = pos;
+					return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+//--------------------------------------------------------------------------
+
+std::vector<sf::Vector2i> GroupMovePlanner::followLeader(sf::Vector2i unitPos, sf::Vector2i offset, sf::Vector2i slotTarget,
+	const std::vector<sf::Vector2i> & leaderPath, unsigned int unitSize)
+{
+	// path is built from start to target and reversed at the end
+	std::vector<sf::Vector2i> path{ unitPos };
+	for (unsigned int i = 0u; i < leaderPath.size(); ++i)
+	{
+		sf::Vector2i pos = path.back();
+		sf::Vector2i next = (i + 1u == leaderPath.size()) ? slotTarget : leaderPath[i] + offset;
+		if (next == pos || !isFree(next, unitSize))
+			continue;
+
+		if (std::abs(next.x - pos.x) <= 1 && std::abs(next.y - pos.y) <= 1)
+		{
+			path.push_back(next);
+			continue;
+		}
+
+		// bypass blocked part of shifted path or join it from unit position
+		auto repair = search(pos, next, unitSize, REPAIR_MAX_EXPANDED);
+		if (repair.empty())
+		{
+			++m_stats.failedRepairs;
+			auto full = search(pos, slotTarget, unitSize, 0u);
+			if (full.empty())
+				return full;
+
+			path.insert(path.end(), full.rbegin() + 1, full.rend());
+			break;
+		}
+		++m_stats.localRepairs;
+		path.insert(path.end(), repair.rbegin() + 1, repair.rend());
+	}
+
+	std::reverse(path.begin(), path.end());
+	return path;
+}
+
+//--------------------------------------------------------------------------
+
+std::vector<sf::Vector2i> GroupMovePlanner::search(sf::Vector2i startPos, sf::Vector2i targetPos, unsigned int unitSize, unsigned int maxExpanded)
+{
+	if (maxExpanded == 0u)
+		++m_stats.fullSearches;
+
+	auto path = m_pathing.findPath(startPos, targetPos, PF_ALGORITHM::A_STAR_HEAP, unitSize, 1.f, maxExpanded);
+	m_stats.expandedTiles += m_pathing.getExpandedCount();
+	return path;
+}
+
+//--------------------------------------------------------------------------
+
+bool GroupMovePlanner::isFree(sf::Vector2i pos, unsigned int unitSize) const
+{
+	const GridView * grid = m_pathing.getGridView();
+	sf::Vector2i gridSize = grid->getGridSize();
+	if (pos.x < 0 || pos.y < 0 || pos.x >= gridSize.x || pos.y >= gridSize.y)
+		return false;
+
+	// clearance already covers all tiles of the footprint
+	return grid->getClearance(grid->getIndex(pos.x, pos.y)) >= unitSize;
+}
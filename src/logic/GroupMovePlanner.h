@@ -0,0 +1,136 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+//--------------------------------------------------------------------------
+
+#include "PathingSystem.h"
+
+//--------------------------------------------------------------------------
+
+/*!
+* \brief Plans paths for the group of units ordered to move to the same target
+*
+* Only one full search is made for the leader of the group (unit closest to the center of the group). Every other unit gets
+* slot in the formation and follows leader path shifted by slot offset. Tiles of shifted path which are blocked are bypassed
+* with short local searches limited by REPAIR_MAX_EXPANDED, full search is made for the unit only if local search fails.
+*
+* Usage example:
+* \code
+* GroupMovePlanner planner(pathing);
+* auto paths = planner.plan(selectedPositions, sf::Vector2i(120, 80));
+* \endcode
+*
+*/
+class GroupMovePlanner
+{
+public:
+	static constexpr unsigned int REPAIR_MAX_EXPANDED = 64u;	///< maximum amount of tiles expanded by one local repair
+	static constexpr int MAX_SLOT_SHIFT = 4;					///< maximum distance of slot moved from blocked tile at the target
+
+	/*!
+	* \brief Counters of work made by planner since construction or last resetStats()
+	*/
+	struct Stats
+	{
+		unsigned int groups{ 0u };			///< amount of planned groups
+		unsigned int units{ 0u };			///< amount of planned units
+		unsigned int fullSearches{ 0u };	///< amount of searches without expansion limit
+		unsigned int localRepairs{ 0u };	///< amount of successful local repairs
+		unsigned int failedRepairs{ 0u };	///< amount of local repairs which reached expansion limit
+		unsigned int expandedTiles{ 0u };	///< amount of tiles expanded by all searches
+	};
+
+	/*!
+	* \brief Default constructor
+	*
+	* \param pathing Path finding system used for all searches, it's grid view is used to check tiles
+	*
+	*/
+	GroupMovePlanner(PathingSystem & pathing);
+
+	/*!
+	* \brief Plan paths for all units of the group
+	*
+	* \param unitPositions Positions of units
+	* \param targetPos Target position of the group, leader ends there and other units around it
+	* \param unitSize Size of every unit in tiles
+	*
+	* \return Path of every unit in the same order as positions, paths are ordered from target to start like paths
+	* returned by PathingSystem. Path is empty if unit can't reach it's slot
+	*
+	*/
+	std::vector<std::vector<sf::Vector2i>> plan(const std::vector<sf::Vector2i> & unitPositions, sf::Vector2i targetPos, unsigned int unitSize = 1u);
+
+	inline const Stats & getStats() const { return m_stats; }
+	inline void resetStats() { m_stats = Stats(); }
+
+private:
+	/*!
+	* \brief Return offsets of formation slots relative to the leader, first slot belongs to the leader
+	*/
+	std::vector<sf::Vector2i> formationOffsets(unsigned int count, unsigned int unitSize) const;
+
+	/*!
+	* \brief Assign slots to units, so units keep their placement relative to the leader
+	*
+	* \return Index of slot for every unit
+	*
+	*/
+	std::vector<unsigned int> assignSlots(const std::vector<sf::Vector2i> & unitPositions, unsigned int leader, const std::vector<sf::Vector2i> & offsets) const;
+
+	/*!
+	* \brief Find free tile for the slot at the target, nearest to the slot position and not used by other slot
+	*
+	* \return False if there is no free tile in MAX_SLOT_SHIFT distance
+	*
+	*/
+	bool findSlotTarget(sf::Vector2i & slotPos, unsigned int unitSize, const std::vector<sf::Vector2i> & usedTargets) const;
+
+	/*!
+	* \brief Build path of the unit which follows leader path shifted by slot offset
+	*
+	* \param leaderPath Path of the leader ordered from start to target
+	*
+	*/
+	std::vector<sf::Vector2i> followLeader(sf::Vector2i unitPos, sf::Vector2i offset, sf::Vector2i slotTarget, const std::vector<sf::Vector2i> & leaderPath,
+		unsigned int unitSize);
+
+	/*!
+	* \brief Search path and update counters
+	*
+	* \param maxExpanded Expansion limit of the search, 0 for full search
+	*
+	*/
+	std::vector<sf::Vector2i> search(sf::Vector2i startPos, sf::Vector2i targetPos, unsigned int unitSize, unsigned int maxExpanded);
+
+	/*!
+	* \brief Return true if unit can stand on the tile
+	*/
+	bool isFree(sf::Vector2i pos, unsigned int unitSize) const;
+
+private:
+	PathingSystem & m_pathing;		///< path finding system used for all searches
+	Stats m_stats;					///< counters of planned work
+};
@@ -0,0 +1,282 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//--------------------------------------------------------------------------
+
+#include "JobSystem.h"
+
+//--------------------------------------------------------------------------
+
+namespace logic
+{
+	namespace
+	{
+		thread_local unsigned int t_queueIndex = 0u;	///< queue owned by current thread
+	}
+
+	//--------------------------------------------------------------------------
+
+	JobSystem::JobSystem(unsigned int workerCount) :
+		m_mainThreadId{ std::this_thread::get_id() }
+	{
+		for (unsigned int i = 0u; i <= workerCount; ++i)
+			m_queues.push_back(std::make_unique<WorkQueue>());
+		for (unsigned int i = 1u; i <= workerCount; ++i)
+			m_workers.emplace_back(&JobSystem::workerLoop, this, i);
+	}
+
+	//--------------------------------------------------------------------------
+
+	JobSystem::~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+			m_stop = true;
+		}
+		m_wakeUp.notify_all();
+		for (auto & worker : m_workers)
+			worker.join();
+	}
+
+	//--------------------------------------------------------------------------
+
+	unsigned int JobSystem::defaultWorkerCount()
+	{
+		unsigned int cores = std::thread::hardware_concurrency();
+		return cores > 1u ? cores - 1u : 0u;
+	}
+
+	//--------------------------------------------------------------------------
+
+	JobHandle JobSystem::schedule(std::function<void()> function, const std::vector<JobHandle> & dependencies)
+	{
+		return create(std::move(function), dependencies, false, false);
+	}
+
+	//--------------------------------------------------------------------------
+
+	JobHandle JobSystem::scheduleMainThread(std::function<void()> function, const std::vector<JobHandle> & dependencies)
+	{
+		return create(std::move(function), dependencies, true, false);
+	}
+
+	//--------------------------------------------------------------------------
+
+	JobHandle JobSystem::scheduleBackground(std::function<void()> function, const std::vector<JobHandle> & dependencies)
+	{
+		return create(std::move(function), dependencies, false, !m_workers.empty());
+	}
+
+	//--------------------------------------------------------------------------
+
+	void JobSystem::wait(const JobHandle & job)
+	{
+		bool mainThread = std::this_thread::get_id() == m_mainThreadId;
+		while (!job->finished.load(std::memory_order_acquire))
+		{
+			if (mainThread && runMainThreadJobs() > 0u)
+				continue;
+			if (!tryRunJob(t_queueIndex))
+				std::this_thread::yield();
+		}
+
+		if (job->exception)
+			std::rethrow_exception(job->exception);
+	}
+
+	//--------------------------------------------------------------------------
+
+	void JobSystem::wait(const std::vector<JobHandle> & jobs)
+	{
+		for (auto & job : jobs)
+			wait(job);
+	}
+
+	//--------------------------------------------------------------------------
+
+	unsigned int JobSystem::runMainThreadJobs()
+	{
+		unsigned int count = 0u;
+		while (true)
+		{
+			JobHandle job;
+			{
+				std::lock_guard<std::mutex> lock(m_mainThreadQueue.mutex);
+				if (m_mainThreadQueue.jobs.empty())
+					break;
+				job = std::move(m_mainThreadQueue.jobs.front());
+				m_mainThreadQueue.jobs.pop_front();
+			}
+			execute(job);
+			++count;
+		}
+		return count;
+	}
+
+	//--------------------------------------------------------------------------
+
+	unsigned int JobSystem::currentQueue()
+	{
+		return t_queueIndex;
+	}
+
+	//--------------------------------------------------------------------------
+
+	JobHandle JobSystem::create(std::function<void()> function, const std::vector<JobHandle> & dependencies, bool mainThread, bool background)
+	{
+		auto job = std::make_shared<Job>();
+		job->function = std::move(function);
+		job->mainThread = mainThread;
+		job->background = background;
+
+		// one extra dependency is held until all real dependencies are registered, so job can't start too early
+		job->pendingDependencies.store(static_cast<int>(dependencies.size()) + 1, std::memory_order_relaxed);
+		for (auto & dependency : dependencies)
+		{
+			std::lock_guard<std::mutex> lock(dependency->mutex);
+			if (dependency->finished.load(std::memory_order_relaxed))
+				job->pendingDependencies.fetch_sub(1, std::memory_order_relaxed);
+			else
+				dependency->continuations.push_back(job);
+		}
+
+		if (job->pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			submit(job);
+		return job;
+	}
+
+	//--------------------------------------------------------------------------
+
+	void JobSystem::submit(const JobHandle & job)
+	{
+		if (job->mainThread)
+		{
+			std::lock_guard<std::mutex> lock(m_mainThreadQueue.mutex);
+			m_mainThreadQueue.jobs.push_back(job);
+			return;
+		}
+
+		WorkQueue & queue = job->background ? m_backgroundQueue : *m_queues[t_queueIndex];
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.jobs.push_back(job);
+			m_readyJobs.fetch_add(1u, std::memory_order_release);
+		}
+
+		// empty critical section makes sure that worker which checked m_readyJobs is already waiting for notification
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+		}
+		m_wakeUp.notify_one();
+	}
+
+	//--------------------------------------------------------------------------
+
+	void JobSystem::execute(const JobHandle & job)
+	{
+		try
+		{
+			job->function();
+		}
+		catch (...)
+		{
+			job->exception = std::current_exception();
+		}
+		job->function = nullptr;
+
+		std::vector<JobHandle> continuations;
+		{
+			std::lock_guard<std::mutex> lock(job->mutex);
+			job->finished.store(true, std::memory_order_release);
+			continuations.swap(job->continuations);
+		}
+
+		for (auto & continuation : continuations)
+		{
+			if (continuation->pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				submit(continuation);
+		}
+	}
+
+	//--------------------------------------------------------------------------
+
+	bool JobSystem::tryRunJob(unsigned int queueIndex)
+	{
+		JobHandle job;
+
+		// the newest job from own queue
+		{
+			WorkQueue & queue = *m_queues[queueIndex];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.jobs.empty())
+			{
+				job = std::move(queue.jobs.back());
+				queue.jobs.pop_back();
+				m_readyJobs.fetch_sub(1u, std::memory_order_relaxed);
+			}
+		}
+
+		// the oldest job stolen from other queues
+		for (unsigned int i = 1u; !job && i < m_queues.size(); ++i)
+		{
+			WorkQueue & queue = *m_queues[(queueIndex + i) % m_queues.size()];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.jobs.empty())
+			{
+				job = std::move(queue.jobs.front());
+				queue.jobs.pop_front();
+				m_readyJobs.fetch_sub(1u, std::memory_order_relaxed);
+			}
+		}
+
+		// background jobs are the last choice of workers, main thread never takes them
+		if (!job && queueIndex != 0u)
+		{
+			std::lock_guard<std::mutex> lock(m_backgroundQueue.mutex);
+			if (!m_backgroundQueue.jobs.empty())
+			{
+				job = std::move(m_backgroundQueue.jobs.front());
+				m_backgroundQueue.jobs.pop_front();
+				m_readyJobs.fetch_sub(1u, std::memory_order_relaxed);
+			}
+		}
+
+		if (!job)
+			return false;
+
+		execute(job);
+		return true;
+	}
+
+	//--------------------------------------------------------------------------
+
+	void JobSystem::workerLoop(unsigned int queueIndex)
+	{
+		t_queueIndex = queueIndex;
+		while (true)
+		{
+			if (tryRunJob(queueIndex))
+				continue;
+
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			m_wakeUp.wait(lock, [this]() { return m_stop || m_readyJobs.load(std::memory_order_acquire) > 0u; });
+			if (m_stop)
+				break;
+		}
+	}
+}
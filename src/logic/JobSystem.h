@@ -0,0 +1,211 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//--------------------------------------------------------------------------
+
+namespace logic
+{
+	/*!
+	* \brief Single unit of work scheduled in JobSystem
+	*/
+	struct Job
+	{
+		std::function<void()> function;						///< work of the job
+		std::atomic<int> pendingDependencies{ 1 };			///< unfinished dependencies, job is ready when it drops to 0
+		std::atomic<bool> finished{ false };				///< true when function was executed
+		bool mainThread{ false };							///< true if job must be executed on main thread
+		bool background{ false };							///< true if job is executed only by worker threads
+		std::mutex mutex;									///< guards continuations and finished flag changes
+		std::vector<std::shared_ptr<Job>> continuations;	///< jobs which wait for this job
+		std::exception_ptr exception;						///< exception thrown by function, rethrown by JobSystem::wait()
+	};
+
+	using JobHandle = std::shared_ptr<Job>;
+
+	//--------------------------------------------------------------------------
+
+	/*!
+	* \brief Work stealing scheduler of short jobs
+	*
+	* Every worker thread and main thread have their own deque of ready jobs. Owner takes jobs from the back of it's deque
+	* (the newest ones, which data is still in cache), idle threads steal from the front of other deques. Job can depend
+	* on other jobs, it's queued when all of them are finished. Jobs which call SFML or OpenGL are scheduled with
+	* scheduleMainThread() and executed only by runMainThreadJobs() or wait() called on main thread. Long jobs which nobody
+	* waits for in the current frame are scheduled with scheduleBackground() and executed only by workers, so main thread
+	* waiting for short jobs never picks them up.
+	*
+	* Only one JobSystem should exist, because queue index of the thread is kept in thread local variable.
+	*
+	* Usage example:
+	* \code
+	* logic::JobSystem jobs;
+	* auto decode = jobs.schedule([&]() { image.loadFromFile("file.bmp"); });
+	* auto upload = jobs.scheduleMainThread([&]() { texture.loadFromImage(image); }, { decode });
+	* auto update = jobs.parallelFor(0, count, 1024, [&](std::size_t begin, std::size_t end) { ... });
+	* jobs.wait({ upload, update });
+	* \endcode
+	*
+	*/
+	class JobSystem
+	{
+	public:
+		/*!
+		* \brief Default constructor
+		*
+		* \param workerCount Amount of worker threads, with 0 workers all jobs are executed by wait() on calling thread
+		*
+		*/
+		JobSystem(unsigned int workerCount = defaultWorkerCount());
+		~JobSystem();
+
+		JobSystem(const JobSystem &) = delete;
+		JobSystem & operator=(const JobSystem &) = delete;
+
+		/*!
+		* \brief Return amount of workers which uses all cores together with main thread
+		*/
+		static unsigned int defaultWorkerCount();
+
+		/*!
+		* \brief Schedule job executed on any thread after all dependencies are finished
+		*/
+		JobHandle schedule(std::function<void()> function, const std::vector<JobHandle> & dependencies = {});
+
+		/*!
+		* \brief Schedule job executed on main thread after all dependencies are finished
+		*/
+		JobHandle scheduleMainThread(std::function<void()> function, const std::vector<JobHandle> & dependencies = {});
+
+		/*!
+		* \brief Schedule job executed by worker thread after all dependencies are finished
+		*
+		* Without workers it's an ordinary job executed by wait().
+		*
+		*/
+		JobHandle scheduleBackground(std::function<void()> function, const std::vector<JobHandle> & dependencies = {});
+
+		/*!
+		* \brief Split range into parts of grainSize elements and process them in parallel
+		*
+		* \param function Called as function(std::size_t begin, std::size_t end) for every part
+		*
+		* \return Job finished when all parts are finished
+		*
+		*/
+		template <typename F>
+		JobHandle parallelFor(std::size_t begin, std::size_t end, std::size_t grainSize, F function, const std::vector<JobHandle> & dependencies = {})
+		{
+			std::vector<JobHandle> parts;
+			for (std::size_t partBegin = begin; partBegin < end; partBegin += grainSize)
+			{
+				std::size_t partEnd = std::min(partBegin + grainSize, end);
+				parts.push_back(schedule([function, partBegin, partEnd]() { function(partBegin, partEnd); }, dependencies));
+			}
+			return schedule([]() {}, parts.empty() ? dependencies : parts);
+		}
+
+		/*!
+		* \brief Execute other jobs until job is finished
+		*
+		* Exception thrown by the job is rethrown here.
+		*
+		*/
+		void wait(const JobHandle & job);
+		void wait(const std::vector<JobHandle> & jobs);
+
+		/*!
+		* \brief Execute all ready main thread jobs, must be called on main thread
+		*
+		* \return Amount of executed jobs
+		*
+		*/
+		unsigned int runMainThreadJobs();
+
+		/*!
+		* \brief Return amount of queues, which is amount of workers and one queue of main thread
+		*/
+		inline unsigned int getQueueCount() const { return static_cast<unsigned int>(m_queues.size()); }
+
+		/*!
+		* \brief Return queue index of calling thread, 0 for main thread and threads not owned by JobSystem
+		*
+		* Can be used to select per thread scratch data inside jobs.
+		*
+		*/
+		static unsigned int currentQueue();
+
+	private:
+		/*!
+		* \brief Deque of ready jobs owned by one thread
+		*/
+		struct WorkQueue
+		{
+			std::mutex mutex;
+			std::deque<JobHandle> jobs;
+		};
+
+		JobHandle create(std::function<void()> function, const std::vector<JobHandle> & dependencies, bool mainThread, bool background);
+
+		/*!
+		* \brief Put ready job to queue of calling thread, to main thread queue or to background queue
+		*/
+		void submit(const JobHandle & job);
+
+		/*!
+		* \brief Execute job, mark it as finished and submit continuations which became ready
+		*/
+		void execute(const JobHandle & job);
+
+		/*!
+		* \brief Execute one job from own queue, stolen from other queue or, for workers, from background queue
+		*
+		* \return False if there was no ready job
+		*
+		*/
+		bool tryRunJob(unsigned int queueIndex);
+
+		void workerLoop(unsigned int queueIndex);
+
+	private:
+		std::vector<std::unique_ptr<WorkQueue>> m_queues;	///< queue of main thread and queues of workers
+		WorkQueue m_mainThreadQueue;						///< jobs which must be executed on main thread
+		WorkQueue m_backgroundQueue;						///< jobs executed only by workers when they have nothing else
+		std::vector<std::thread> m_workers;					///< worker threads
+		std::thread::id m_mainThreadId;						///< id of thread which created JobSystem
+
+		std::mutex m_sleepMutex;							///< guards sleeping of idle workers
+		std::condition_variable m_wakeUp;					///< wakes idle workers when job is submitted
+		std::atomic<unsigned int> m_readyJobs{ 0u };		///< amount of jobs in worker, main thread and background deques
+		bool m_stop{ false };								///< true when workers should exit
+	};
+}
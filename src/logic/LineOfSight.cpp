@@ -0,0 +1,217 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//--------------------------------------------------------------------------
+
+#include "LineOfSight.h"
+
+//--------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+//--------------------------------------------------------------------------
+
+constexpr unsigned int LineOfSight::BATCH_LANES;
+
+namespace
+{
+	constexpr int NEVER = std::numeric_limits<int>::max();		///< time of crossing which doesn't happen before target
+	constexpr int CHUNK_SIDE = static_cast<int>(CHUNK_SIZE);
+
+	/*!
+	* \brief Return bit of the tile in chunk word or 0 if tile is not inside the chunk
+	*/
+	inline uint64_t tileBit(sf::Vector2i tile, sf::Vector2i chunkPos)
+	{
+		sf::Vector2i local = tile - chunkPos*CHUNK_SIDE;
+		if (local.x < 0 || local.y < 0 || local.x >= CHUNK_SIDE || local.y >= CHUNK_SIDE)
+			return 0u;
+		return uint64_t(1u) << (local.x + local.y*CHUNK_SIDE);
+	}
+}
+
+//--------------------------------------------------------------------------
+
+LineOfSight::LineOfSight(const GridView * originGrid) :
+	m_originGrid{ originGrid }
+{
+}
+
+//--------------------------------------------------------------------------
+
+bool LineOfSight::test(sf::Vector2i from, sf::Vector2i to)
+{
+	uint8_t visible;
+	SightQuery query{ from, to };
+	testBatch(&query, 1u, &visible);
+	return visible != 0u;
+}
+
+//--------------------------------------------------------------------------
+
+void LineOfSight::testBatch(const SightQuery * queries, std::size_t count, uint8_t * visible)
+{
+	Ray rays[BATCH_LANES];
+	for (std::size_t first = 0; first < count; first += BATCH_LANES)
+	{
+		unsigned int lanes = static_cast<unsigned int>(std::min<std::size_t>(BATCH_LANES, count - first));
+		for (unsigned int lane = 0u; lane < lanes; ++lane)
+			initRay(rays[lane], queries[first + lane].from, queries[first + lane].to);
+		m_counters.rays += lanes;
+
+		for (unsigned int lane = 0u; lane < lanes; ++lane)
+		{
+			RayState state;
+			do
+			{
+				state = advance(rays[lane]);
+			} while (state == RayState::WALKING);
+			visible[first + lane] = (state == RayState::VISIBLE) ? 1u : 0u;
+		}
+	}
+}
+
+//--------------------------------------------------------------------------
+
+void LineOfSight::initRay(Ray & ray, sf::Vector2i from, sf::Vector2i to) const
+{
+	assert(from.x >= 0 && from.y >= 0 && from.x < m_originGrid->getGridSize().x && from.y < m_originGrid->getGridSize().y);
+	assert(to.x >= 0 && to.y >= 0 && to.x < m_originGrid->getGridSize().x && to.y < m_originGrid->getGridSize().y);
+
+	ray.tile = from;
+	ray.from = from;
+	ray.to = to;
+	ray.step = sf::Vector2i((to.x > from.x) - (to.x < from.x), (to.y > from.y) - (to.y < from.y));
+	ray.dx = std::abs(to.x - from.x);
+	ray.dy = std::abs(to.y - from.y);
+	ray.scaleX = std::max(ray.dx, 1);
+	ray.scaleY = std::max(ray.dy, 1);
+	setCrossed(ray, 0, 0);
+}
+
+//--------------------------------------------------------------------------
+
+void LineOfSight::setCrossed(Ray & ray, int crossedX, int crossedY) const
+{
+	ray.crossedX = crossedX;
+	ray.crossedY = crossedY;
+	ray.nextX = (crossedX < ray.dx) ? (2 * crossedX + 1)*ray.scaleY : NEVER;
+	ray.nextY = (crossedY < ray.dy) ? (2 * crossedY + 1)*ray.scaleX : NEVER;
+}
+
+//--------------------------------------------------------------------------
+
+LineOfSight::RayState LineOfSight::advance(Ray & ray)
+{
+	if (ray.tile == ray.to)
+	{
+		++m_counters.visible;
+		return RayState::VISIBLE;
+	}
+
+	sf::Vector2i chunkPos(ray.tile.x / CHUNK_SIDE, ray.tile.y / CHUNK_SIDE);
+	unsigned int chunkIndex = chunkPos.x + chunkPos.y*m_originGrid->getChunkGridSize().x;
+	uint64_t trees = m_originGrid->getChunkBits(GridPlane::TREE, chunkIndex);
+	uint64_t buildings = m_originGrid->getChunkBits(GridPlane::BUILDING, chunkIndex);
+
+	// first and last tile never block the ray
+	uint64_t endpoints = tileBit(ray.from, chunkPos) | tileBit(ray.to, chunkPos);
+	trees &= ~endpoints;
+	buildings &= ~endpoints;
+
+	if ((trees | buildings) == 0u)
+	{
+		// time of crossing the last border of the chunk on both axes
+		int leftX = (ray.step.x > 0) ? (chunkPos.x + 1)*CHUNK_SIDE - ray.tile.x : ray.tile.x - chunkPos.x*CHUNK_SIDE + 1;
+		int leftY = (ray.step.y > 0) ? (chunkPos.y + 1)*CHUNK_SIDE - ray.tile.y : ray.tile.y - chunkPos.y*CHUNK_SIDE + 1;
+		int exitX = (ray.crossedX + leftX <= ray.dx) ? ray.nextX + 2 * (leftX - 1)*ray.scaleY : NEVER;
+		int exitY = (ray.crossedY + leftY <= ray.dy) ? ray.nextY + 2 * (leftY - 1)*ray.scaleX : NEVER;
+		int exit = std::min(exitX, exitY);
+
+		++m_counters.skippedChunks;
+		if (exit == NEVER)
+		{
+			// target is inside this chunk
+			++m_counters.visible;
+			return RayState::VISIBLE;
+		}
+
+		// all crossings up to the exit happen together, only crossings on the other axis need to be counted
+		int crossedX = (exitX == exit) ? ray.crossedX + leftX : (exit >= ray.nextX) ? ray.crossedX + (exit - ray.nextX) / (2 * ray.scaleY) + 1 : ray.crossedX;
+		int crossedY = (exitY == exit) ? ray.crossedY + leftY : (exit >= ray.nextY) ? ray.crossedY + (exit - ray.nextY) / (2 * ray.scaleX) + 1 : ray.crossedY;
+		ray.tile.x += (crossedX - ray.crossedX)*ray.step.x;
+		ray.tile.y += (crossedY - ray.crossedY)*ray.step.y;
+		setCrossed(ray, crossedX, crossedY);
+		return RayState::WALKING;
+	}
+
+	// tile entered from previous chunk wasn't checked yet, so the walk starts with current tile
+	++m_counters.walkedChunks;
+	const sf::Vector2i origin = chunkPos*CHUNK_SIDE;
+	const uint64_t blocking = trees | buildings;
+	RayState state = RayState::WALKING;
+	unsigned int walkedTiles = 0u;
+	while (true)
+	{
+		if (ray.tile == ray.to)
+		{
+			++m_counters.visible;
+			state = RayState::VISIBLE;
+			break;
+		}
+
+		unsigned int localX = static_cast<unsigned int>(ray.tile.x - origin.x);
+		unsigned int localY = static_cast<unsigned int>(ray.tile.y - origin.y);
+		if (localX >= CHUNK_SIZE || localY >= CHUNK_SIZE)
+			break;
+
+		++walkedTiles;
+		uint64_t bit = uint64_t(1u) << (localX + localY*CHUNK_SIZE);
+		if (blocking & bit)
+		{
+			++((trees & bit) ? m_counters.treeHits : m_counters.buildingHits);
+			state = RayState::BLOCKED;
+			break;
+		}
+		stepTile(ray);
+	}
+	m_counters.walkedTiles += walkedTiles;
+	return state;
+}
+
+//--------------------------------------------------------------------------
+
+void LineOfSight::stepTile(Ray & ray) const
+{
+	int nextX = ray.nextX;
+	int nextY = ray.nextY;
+	if (nextX <= nextY)
+	{
+		ray.tile.x += ray.step.x;
+		++ray.crossedX;
+		ray.nextX = (ray.crossedX < ray.dx) ? nextX + 2 * ray.scaleY : NEVER;
+	}
+	if (nextY <= nextX)
+	{
+		ray.tile.y += ray.step.y;
+		++ray.crossedY;
+		ray.nextY = (ray.crossedY < ray.dy) ? nextY + 2 * ray.scaleX : NEVER;
+	}
+}
@@ -0,0 +1,167 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <SFML/Graphics.hpp>
+
+//--------------------------------------------------------------------------
+
+#include "Grid.h"
+
+//--------------------------------------------------------------------------
+
+/*!
+* \brief Single "can A see B" test
+*/
+struct SightQuery
+{
+	sf::Vector2i from;		///< tile of the observer
+	sf::Vector2i to;		///< tile of the observed object
+};
+
+//--------------------------------------------------------------------------
+
+/*!
+* \brief Batched line of sight tests against trees and buildings
+*
+* Ray goes from center of the observer tile to center of the target tile and visits every tile it passes (when it passes
+* exactly through corner of tiles it goes diagonally). Ray is blocked if any visited tile other than the first and the last
+* one is set on GridPlane::TREE or GridPlane::BUILDING, so units can see buildings standing next to them.
+*
+* Walk uses integer DDA, so result is exact and doesn't depend on float rounding. Chunk words of both planes are read once
+* per visited chunk; if chunk has no blocking tiles the whole chunk is passed in one step. Rays are prepared in batches of
+* BATCH_LANES with branch free setup and then walked one by one.
+*
+* Like PathingSystem, every thread needs it's own instance.
+*
+* Usage example:
+* \code
+* LineOfSight sight(grid.snapshot().get());
+* std::vector<uint8_t> visible(queries.size());
+* sight.testBatch(queries.data(), queries.size(), visible.data());
+* \endcode
+*
+*/
+class LineOfSight
+{
+public:
+	static constexpr unsigned int BATCH_LANES = 8;		///< amount of rays prepared together
+
+	/*!
+	* \brief Statistics of all tests since last reset
+	*/
+	struct Counters
+	{
+		uint64_t rays{ 0u };			///< amount of tested rays
+		uint64_t visible{ 0u };			///< amount of rays which reached target
+		uint64_t treeHits{ 0u };		///< amount of rays blocked by tree
+		uint64_t buildingHits{ 0u };	///< amount of rays blocked by building
+		uint64_t skippedChunks{ 0u };	///< amount of chunks passed in one step
+		uint64_t walkedChunks{ 0u };	///< amount of chunks walked tile by tile
+		uint64_t walkedTiles{ 0u };		///< amount of tiles visited in walked chunks
+	};
+
+	LineOfSight(const GridView * originGrid);
+
+	/*!
+	* \brief Change grid on which rays are tested, usually to the newest GridSnapshot
+	*/
+	inline void setGridView(const GridView * originGrid) { m_originGrid = originGrid; }
+	inline const GridView * getGridView() const { return m_originGrid; }
+
+	/*!
+	* \brief Test single ray
+	*
+	* \param from Tile of the observer, must be inside the grid
+	* \param to Tile of the target, must be inside the grid
+	*
+	* \return True if target can be seen from observer tile
+	*
+	*/
+	bool test(sf::Vector2i from, sf::Vector2i to);
+
+	/*!
+	* \brief Test many rays
+	*
+	* \param queries Tested rays, all tiles must be inside the grid
+	* \param count Amount of rays
+	* \param visible Buffer of at least count elements, 1 is written for every visible target and 0 for every blocked one
+	*
+	*/
+	void testBatch(const SightQuery * queries, std::size_t count, uint8_t * visible);
+
+	inline const Counters & getCounters() const { return m_counters; }
+	inline void resetCounters() { m_counters = Counters(); }
+
+private:
+	/*!
+	* \brief State of one walked ray
+	*
+	* Crossings of tile borders are ordered by time scaled by 2*dx*dy: i-th vertical border is crossed at (2i+1)*dy and j-th
+	* horizontal border at (2j+1)*dx. Zero deltas are replaced with 1 in scales, which keeps order of crossings on other axis.
+	*
+	*/
+	struct Ray
+	{
+		sf::Vector2i tile;		///< current tile
+		sf::Vector2i from;		///< first tile of the ray
+		sf::Vector2i to;		///< last tile of the ray
+		sf::Vector2i step;		///< direction of the ray on both axes (-1, 0 or 1)
+		int dx;					///< amount of vertical borders crossed by the ray
+		int dy;					///< amount of horizontal borders crossed by the ray
+		int scaleX;				///< dx but at least 1
+		int scaleY;				///< dy but at least 1
+		int crossedX;			///< amount of vertical borders crossed so far
+		int crossedY;			///< amount of horizontal borders crossed so far
+		int nextX;				///< time of crossing next vertical border
+		int nextY;				///< time of crossing next horizontal border
+	};
+
+	enum class RayState
+	{
+		WALKING,
+		VISIBLE,
+		BLOCKED,
+	};
+
+	void initRay(Ray & ray, sf::Vector2i from, sf::Vector2i to) const;
+
+	/*!
+	* \brief Move ray out of it's current chunk, or until it reaches target or blocking tile
+	*/
+	RayState advance(Ray & ray);
+
+	/*!
+	* \brief Move ray to the next tile
+	*/
+	void stepTile(Ray & ray) const;
+
+	/*!
+	* \brief Set crossing times of the ray after given amount of crossed borders
+	*/
+	void setCrossed(Ray & ray, int crossedX, int crossedY) const;
+
+private:
+	const GridView * m_originGrid;	///< grid on which rays are tested
+	Counters m_counters;			///< statistics of all tests
+};
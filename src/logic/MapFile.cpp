@@ -0,0 +1,270 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//--------------------------------------------------------------------------
+
+#include "MapFile.h"
+
+//--------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//--------------------------------------------------------------------------
+
+constexpr uint32_t MapFile::FORMAT_VERSION;
+
+namespace
+{
+	const char MAP_MAGIC[8] = "TZARMAP";
+
+	/*!
+	* \brief Tile described by one color of converted image
+	*/
+	struct PaletteEntry
+	{
+		uint8_t red;
+		uint8_t green;
+		uint8_t blue;
+		TerrainType terrain;
+		ObjectType object;
+	};
+
+	const PaletteEntry MAP_PALETTE[] =
+	{
+		{ 0, 128, 0, TerrainType::GRASS, ObjectType::NONE },
+		{ 128, 128, 128, TerrainType::ROAD, ObjectType::NONE },
+		{ 96, 64, 32, TerrainType::FOREST_FLOOR, ObjectType::NONE },
+		{ 0, 0, 255, TerrainType::SHALLOW_WATER, ObjectType::NONE },
+		{ 0, 255, 0, TerrainType::FOREST_FLOOR, ObjectType::TREE },
+		{ 255, 0, 0, TerrainType::GRASS, ObjectType::BUILDING },
+		{ 255, 255, 0, TerrainType::GRASS, ObjectType::RESOURCE },
+	};
+}
+
+//--------------------------------------------------------------------------
+
+MapFile::~MapFile()
+{
+	if (m_data == nullptr)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(m_data);
+#else
+	munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+}
+
+//--------------------------------------------------------------------------
+
+std::shared_ptr<const MapFile> MapFile::open(const std::string & path, bool verifyChecksum)
+{
+	std::shared_ptr<MapFile> map(new MapFile());
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("MapFile - Failed to open " + path);
+
+	LARGE_INTEGER size;
+	HANDLE mapping = nullptr;
+	if (GetFileSizeEx(file, &size) && size.QuadPart >= static_cast<LONGLONG>(sizeof(MapFileHeader)))
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	// view keeps mapping alive, so both handles can be closed
+	if (mapping != nullptr)
+	{
+		map->m_data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		map->m_size = static_cast<std::size_t>(size.QuadPart);
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+	if (map->m_data == nullptr)
+		throw std::runtime_error("MapFile - Failed to map " + path);
+#else
+	int file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		throw std::runtime_error("MapFile - Failed to open " + path);
+
+	struct stat status;
+	void * data = MAP_FAILED;
+	if (fstat(file, &status) == 0 && status.st_size >= static_cast<off_t>(sizeof(MapFileHeader)))
+		data = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+
+	// mapping stays valid after file is closed
+	::close(file);
+	if (data == MAP_FAILED)
+		throw std::runtime_error("MapFile - Failed to map " + path);
+	map->m_data = static_cast<const uint8_t*>(data);
+	map->m_size = static_cast<std::size_t>(status.st_size);
+#endif
+
+	map->validate(path, verifyChecksum);
+	return map;
+}
+
+//--------------------------------------------------------------------------
+
+void MapFile::validate(const std::string & path, bool verifyChecksum) const
+{
+	const MapFileHeader & header = getHeader();
+	if (std::memcmp(header.magic, MAP_MAGIC, sizeof(MAP_MAGIC)) != 0)
+		throw std::runtime_error("MapFile - " + path + " is not a map file");
+	if (header.formatVersion != FORMAT_VERSION || header.chunkRecordSize != sizeof(GridChunk))
+		throw std::runtime_error("MapFile - " + path + " has unsupported format version " + std::to_string(header.formatVersion));
+
+	if (header.gridWidth <= 0 || header.gridHeight <= 0 || header.gridWidth % CHUNK_SIZE != 0 || header.gridHeight % CHUNK_SIZE != 0)
+		throw std::runtime_error("MapFile - " + path + " has invalid grid size");
+
+	std::size_t chunkCount = static_cast<std::size_t>(header.gridWidth / CHUNK_SIZE)*static_cast<std::size_t>(header.gridHeight / CHUNK_SIZE);
+	if (m_size != sizeof(MapFileHeader) + chunkCount*sizeof(GridChunk))
+		throw std::runtime_error("MapFile - " + path + " is truncated");
+
+	if (verifyChecksum && checksum(getChunks(), chunkCount*sizeof(GridChunk)) != header.checksum)
+		throw std::runtime_error("MapFile - " + path + " is corrupted, checksum doesn't match");
+
+	// records are used without parsing, so values which index tables and planes read instead of object types are checked
+	// even without checksum
+	uint32_t terrainCount[static_cast<int>(TerrainType::COUNT)] = {};
+	const GridChunk * chunks = getChunks();
+	for (std::size_t i = 0; i < chunkCount; ++i)
+	{
+		uint64_t planes[static_cast<int>(GridPlane::COUNT)] = {};
+		for (unsigned int tile = 0u; tile < CHUNK_TILES; ++tile)
+		{
+			ObjectType type = chunks[i].objType[tile];
+			TerrainType terrain = chunks[i].terrain[tile];
+			if (type >= ObjectType::COUNT || terrain >= TerrainType::COUNT)
+				throw std::runtime_error("MapFile - " + path + " has invalid tile in chunk " + std::to_string(i));
+			++terrainCount[static_cast<int>(terrain)];
+
+			uint64_t bit = uint64_t(1u) << tile;
+			planes[static_cast<int>(GridPlane::BLOCKED)] |= (type != ObjectType::NONE) ? bit : 0u;
+			planes[static_cast<int>(GridPlane::UNIT)] |= (type == ObjectType::UNIT) ? bit : 0u;
+			planes[static_cast<int>(GridPlane::TREE)] |= (type == ObjectType::TREE) ? bit : 0u;
+			planes[static_cast<int>(GridPlane::BUILDING)] |= (type == ObjectType::BUILDING) ? bit : 0u;
+		}
+		if (std::memcmp(planes, chunks[i].planes, sizeof(planes)) != 0)
+			throw std::runtime_error("MapFile - " + path + " has bit planes which don't match object types in chunk " + std::to_string(i));
+	}
+	if (std::memcmp(terrainCount, header.terrainCount, sizeof(terrainCount)) != 0)
+		throw std::runtime_error("MapFile - " + path + " has terrain counts which don't match tiles");
+}
+
+//--------------------------------------------------------------------------
+
+void MapFile::save(const GridView & grid, const std::string & path)
+{
+	sf::Vector2i chunkGridSize = grid.getChunkGridSize();
+	std::vector<GridChunk> chunks(chunkGridSize.x*chunkGridSize.y);
+
+	MapFileHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, MAP_MAGIC, sizeof(MAP_MAGIC));
+	header.formatVersion = FORMAT_VERSION;
+	header.chunkRecordSize = sizeof(GridChunk);
+	header.gridWidth = grid.getGridSize().x;
+	header.gridHeight = grid.getGridSize().y;
+
+	// versions of live grid have no meaning in the file
+	for (std::size_t i = 0; i < chunks.size(); ++i)
+	{
+		chunks[i] = grid.chunk(static_cast<unsigned int>(i));
+		chunks[i].version = 0u;
+		chunks[i].reserved = 0u;
+		for (auto terrain : chunks[i].terrain)
+			++header.terrainCount[static_cast<int>(terrain)];
+	}
+	header.checksum = checksum(chunks.data(), chunks.size()*sizeof(GridChunk));
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(chunks.data()), chunks.size()*sizeof(GridChunk));
+	if (!file)
+		throw std::runtime_error("MapFile - Failed to write " + path);
+}
+
+//--------------------------------------------------------------------------
+
+void MapFile::convertImage(const std::string & imagePath, const std::string & heightPath, const std::string & outputPath)
+{
+	sf::Image image;
+	if (!image.loadFromFile(imagePath))
+		throw std::runtime_error("MapFile - Failed to load " + imagePath);
+
+	sf::Vector2i gridSize(static_cast<int>(image.getSize().x), static_cast<int>(image.getSize().y));
+	if (gridSize.x == 0 || gridSize.y == 0 || gridSize.x % CHUNK_SIZE != 0 || gridSize.y % CHUNK_SIZE != 0)
+		throw std::runtime_error("MapFile - Size of " + imagePath + " must be multiple of " + std::to_string(CHUNK_SIZE));
+
+	sf::Image heights;
+	if (!heightPath.empty() && (!heights.loadFromFile(heightPath) || heights.getSize() != image.getSize()))
+		throw std::runtime_error("MapFile - Failed to load " + heightPath + " or it's size is different than size of " + imagePath);
+
+	Grid grid(gridSize);
+	for (int y = 0; y < gridSize.y; ++y)
+	{
+		for (int x = 0; x < gridSize.x; ++x)
+		{
+			sf::Color color = image.getPixel(x, y);
+			const PaletteEntry * entry = std::find_if(std::begin(MAP_PALETTE), std::end(MAP_PALETTE), [color](const PaletteEntry & candidate)
+			{
+				return candidate.red == color.r && candidate.green == color.g && candidate.blue == color.b;
+			});
+			if (entry == std::end(MAP_PALETTE))
+				throw std::runtime_error("MapFile - Unknown color of tile " + std::to_string(x) + "," + std::to_string(y) + " in " + imagePath);
+
+			unsigned int index = grid.getIndex(x, y);
+			grid.setTerrainType(index, entry->terrain);
+			if (entry->object != ObjectType::NONE)
+				grid.setObjectType(index, entry->object);
+			if (!heightPath.empty())
+				grid.setHeight(index, heights.getPixel(x, y).r);
+		}
+	}
+
+	save(*grid.snapshot(), outputPath);
+}
+
+//--------------------------------------------------------------------------
+
+uint64_t MapFile::checksum(const void * data, std::size_t size)
+{
+	const uint64_t * words = static_cast<const uint64_t*>(data);
+	uint64_t hash = 14695981039346656037ull;
+	for (std::size_t i = 0; i < size / sizeof(uint64_t); ++i)
+	{
+		hash ^= words[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
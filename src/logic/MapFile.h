@@ -0,0 +1,139 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <memory>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <SFML/Graphics.hpp>
+
+//--------------------------------------------------------------------------
+
+#include "Grid.h"
+
+//--------------------------------------------------------------------------
+
+/*!
+* \brief Header placed at the beginning of every map file
+*
+* Header is followed by GridChunk records of all chunks in chunk order (chunk_x + chunk_y*chunkGridSize.x). Records are
+* stored exactly as they are kept in memory, so file is valid only for builds with the same GridChunk layout and byte order.
+*
+*/
+struct MapFileHeader
+{
+	char magic[8];											///< always "TZARMAP"
+	uint32_t formatVersion;									///< version of the format, see MapFile::FORMAT_VERSION
+	uint32_t chunkRecordSize;								///< sizeof(GridChunk) of the program which wrote the file
+	int32_t gridWidth;										///< width of the grid in tiles
+	int32_t gridHeight;										///< height of the grid in tiles
+	uint32_t terrainCount[static_cast<int>(TerrainType::COUNT)];	///< amount of tiles of every terrain type
+	uint64_t checksum;										///< checksum of all chunk records (see MapFile::checksum())
+	uint8_t reserved[16];									///< always 0, keeps chunk records aligned
+};
+
+static_assert(sizeof(MapFileHeader) % 8 == 0, "Chunk records must be 8 bytes aligned");
+
+//--------------------------------------------------------------------------
+
+/*!
+* \brief Binary map file mapped into memory
+*
+* Opening the file maps it read only and checks the header and tiles, chunk records are never copied. Grid created from the file
+* reads records directly and clones only chunks which are changed (see Grid::Grid(const std::shared_ptr<const MapFile> &)).
+*
+* Usage example:
+* \code
+* MapFile::save(*grid.snapshot(), "maps/test.map");
+* auto map = MapFile::open("maps/test.map");
+* Grid loaded(map);
+* \endcode
+*
+*/
+class MapFile
+{
+public:
+	static constexpr uint32_t FORMAT_VERSION = 1u;	///< version written to new files, other versions can't be opened
+
+	~MapFile();
+	MapFile(const MapFile &) = delete;
+	MapFile & operator=(const MapFile &) = delete;
+
+	/*!
+	* \brief Map file into memory
+	*
+	* \param path Path to the map file
+	* \param verifyChecksum If false then checksum of chunk records is not computed, tiles are checked anyway
+	*
+	* \return Opened file, throws std::runtime_error if file can't be mapped, has wrong format or checksum doesn't match
+	*
+	*/
+	static std::shared_ptr<const MapFile> open(const std::string & path, bool verifyChecksum = true);
+
+	/*!
+	* \brief Write all chunks of the grid to map file
+	*
+	* Clearance of the grid must be up to date, so snapshot of the grid is usually saved. Throws std::runtime_error
+	* if file can't be written.
+	*
+	*/
+	static void save(const GridView & grid, const std::string & path);
+
+	/*!
+	* \brief Convert image to map file
+	*
+	* Every pixel of the image is one tile and it's color selects terrain and object type (see MAP_PALETTE in MapFile.cpp).
+	* Heights are taken from red channel of height image, all tiles have height 0 if it's empty. Throws std::runtime_error
+	* if images can't be loaded, have wrong size or contain unknown color.
+	*
+	* \param imagePath Path to the image with terrain and objects
+	* \param heightPath Path to the height image of the same size, can be empty
+	* \param outputPath Path to the written map file
+	*
+	*/
+	static void convertImage(const std::string & imagePath, const std::string & heightPath, const std::string & outputPath);
+
+	/*!
+	* \brief Compute checksum of data, FNV-1a over 64 bit words
+	*
+	* \param data Checked data, must be 8 bytes aligned
+	* \param size Size of data in bytes, must be multiple of 8
+	*
+	*/
+	static uint64_t checksum(const void * data, std::size_t size);
+
+	inline const MapFileHeader & getHeader() const { return *reinterpret_cast<const MapFileHeader*>(m_data); }
+	inline sf::Vector2i getGridSize() const { return sf::Vector2i(getHeader().gridWidth, getHeader().gridHeight); }
+	inline const GridChunk * getChunks() const { return reinterpret_cast<const GridChunk*>(m_data + sizeof(MapFileHeader)); }
+
+private:
+	MapFile() = default;
+
+	/*!
+	* \brief Throw std::runtime_error if header, size or tiles of the file are invalid
+	*/
+	void validate(const std::string & path, bool verifyChecksum) const;
+
+private:
+	const uint8_t * m_data{ nullptr };		///< first byte of mapped file
+	std::size_t m_size{ 0u };				///< size of mapped file in bytes
+};
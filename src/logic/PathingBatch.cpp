@@ -0,0 +1,79 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//--------------------------------------------------------------------------
+
+#include "PathingBatch.h"
+
+//--------------------------------------------------------------------------
+
+constexpr std::size_t PathingBatch::REQUESTS_PER_JOB;
+
+//--------------------------------------------------------------------------
+
+PathingBatch::PathingBatch(const GridView * grid, logic::JobSystem & jobs) :
+	m_jobs{ jobs }
+{
+	for (unsigned int i = 0u; i < jobs.getQueueCount(); ++i)
+		m_pathing.push_back(std::make_unique<PathingSystem>(grid));
+}
+
+//--------------------------------------------------------------------------
+
+void PathingBatch::setGridView(const GridView * grid)
+{
+	assert(!m_running || m_running->finished);
+	for (auto & pathing : m_pathing)
+		pathing->setGridView(grid);
+}
+
+//--------------------------------------------------------------------------
+
+logic::JobHandle PathingBatch::run(std::vector<Request> requests, bool background)
+{
+	assert(!m_running || m_running->finished);
+	m_requests = std::move(requests);
+	m_results.clear();
+	m_results.resize(m_requests.size());
+
+	auto search = [this](std::size_t begin, std::size_t end)
+	{
+		PathingSystem & pathing = *m_pathing[logic::JobSystem::currentQueue()];
+		for (std::size_t i = begin; i < end; ++i)
+		{
+			const Request & request = m_requests[i];
+			m_results[i] = pathing.findPath(request.startPos, request.targetPos, request.algorithm, request.unitSize, request.epsilon,
+				request.maxExpanded);
+		}
+	};
+
+	if (!background)
+	{
+		m_running = m_jobs.parallelFor(0, m_requests.size(), REQUESTS_PER_JOB, search);
+		return m_running;
+	}
+
+	std::vector<logic::JobHandle> parts;
+	for (std::size_t begin = 0; begin < m_requests.size(); begin += REQUESTS_PER_JOB)
+	{
+		std::size_t end = std::min(begin + REQUESTS_PER_JOB, m_requests.size());
+		parts.push_back(m_jobs.scheduleBackground([search, begin, end]() { search(begin, end); }));
+	}
+	m_running = m_jobs.schedule([]() {}, parts);
+	return m_running;
+}
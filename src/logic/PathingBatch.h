@@ -0,0 +1,97 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <vector>
+#include <memory>
+#include <SFML/Graphics.hpp>
+
+//--------------------------------------------------------------------------
+
+#include "PathingSystem.h"
+#include "JobSystem.h"
+
+//--------------------------------------------------------------------------
+
+/*!
+* \brief Runs many path searches in parallel on JobSystem
+*
+* PathingSystem keeps search state inside, so batch has one PathingSystem for every queue of JobSystem and every job
+* uses the one of the thread which executes it. Grid view must not change while batch is running, so it should be
+* GridSnapshot when the grid is modified at the same time.
+*
+* Usage example:
+* \code
+* PathingBatch batch(snapshot.get(), engine.jobs);
+* auto job = batch.run(requests);
+* ...
+* engine.jobs.wait(job);
+* auto & paths = batch.getResults();
+* \endcode
+*
+*/
+class PathingBatch
+{
+public:
+	/*!
+	* \brief Single path search
+	*/
+	struct Request
+	{
+		sf::Vector2i startPos;									///< starting position of path
+		sf::Vector2i targetPos;									///< target position of path
+		unsigned int unitSize{ 1u };							///< size of the unit in tiles
+		PF_ALGORITHM algorithm{ PF_ALGORITHM::A_STAR_HEAP };	///< used algorithm
+		float epsilon{ 1.f };									///< weight of heuristic (see PathingSystem::findPath())
+		unsigned int maxExpanded{ 0u };							///< limit of expanded tiles, 0 means no limit
+	};
+
+	static constexpr std::size_t REQUESTS_PER_JOB = 4;	///< amount of searches made by one job
+
+	PathingBatch(const GridView * grid, logic::JobSystem & jobs);
+
+	/*!
+	* \brief Change grid used by next batches, can't be called while batch is running
+	*/
+	void setGridView(const GridView * grid);
+
+	/*!
+	* \brief Start all searches, only one batch can run at the same time
+	*
+	* \param background Searches are background jobs (see JobSystem::scheduleBackground()), used when nobody waits for them
+	*
+	* \return Job which is finished when all paths are found
+	*
+	*/
+	logic::JobHandle run(std::vector<Request> requests, bool background = false);
+
+	/*!
+	* \brief Return paths of last batch in order of requests, valid after job returned by run() is finished
+	*/
+	inline const std::vector<std::vector<sf::Vector2i>> & getResults() const { return m_results; }
+
+private:
+	logic::JobSystem & m_jobs;									///< job system which runs searches
+	std::vector<std::unique_ptr<PathingSystem>> m_pathing;		///< path finding system of every job queue
+	std::vector<Request> m_requests;							///< requests of current batch
+	std::vector<std::vector<sf::Vector2i>> m_results;			///< paths found by current batch
+	logic::JobHandle m_running;									///< job of current batch
+};
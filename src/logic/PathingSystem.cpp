@@ -23,22 +23,17 @@
 //--------------------------------------------------------------------------
 
 #include <iostream>
+#include <algorithm>
+#include <limits>
 
 //--------------------------------------------------------------------------
 
-Grid * PathingSystem::CostTile::originGrid = nullptr;
-
-//--------------------------------------------------------------------------
-
-PathingSystem::PathingSystem(Grid * originGrid) :
+PathingSystem::PathingSystem(const GridView * originGrid) :
 	m_originGrid{originGrid}
 {
-	testVector.reserve(100000000);
-
 	m_gridSize = originGrid->getGridSize();
 	m_chunkGridSize = originGrid->getChunkGridSize();
 	m_chunkSizeN = originGrid->getChunkSizeN();
-	CostTile::originGrid = originGrid;
 
 	// create all CostTiles   
 	m_costTileGrid.reserve(originGrid->getGridSize().x*originGrid->getGridSize().y);
@@ -96,10 +91,24 @@ PathingSystem::~PathingSystem()
 
 //--------------------------------------------------------------------------
 
-std::vector<sf::Vector2i> PathingSystem::findPath(sf::Vector2i startPos, sf::Vector2i targetPos, PF_ALGORITHM algorithm)
+void PathingSystem::setGridView(const GridView * originGrid)
+{
+	assert(originGrid->getGridSize() == m_gridSize);
+	m_originGrid = originGrid;
+}
+
+//--------------------------------------------------------------------------
+
+std::vector<sf::Vector2i> PathingSystem::findPath(sf::Vector2i startPos, sf::Vector2i targetPos, PF_ALGORITHM algorithm, unsigned int unitSize, float epsilon,
+	unsigned int maxExpanded)
 {
-	//return std::move(testVector);
-	return std::move(testVector);
+	assert(unitSize > 0u && unitSize <= MAX_CLEARANCE);
+	assert(epsilon >= 1.f);
+
+	// distance in tiles multiplied by the lowest move cost is admissible heuristic, epsilon inflates it for faster
+	// search which result is at most epsilon times more expensive than the best path
+	float heuristicScale = epsilon * static_cast<float>(m_originGrid->getMinMoveCost());
+
 	// check if target tile is not stationary occupied
 	sf::Vector2i startPosition = startPos;
 	sf::Vector2i targetPosition = targetPos;
@@ -111,15 +120,17 @@ std::vector<sf::Vector2i> PathingSystem::findPath(sf::Vector2i startPos, sf::Vec
 	ctStart->m_hCost = 0;
 	ctTarget->m_gCost = 0;
 	ctTarget->m_hCost = 0;
+	m_expandedCount = 0u;
 
 	switch (algorithm)
 	{
 		case PF_ALGORITHM::A_STAR_HEAP:
 		{
 			m_openSet->add(ctStart); 	// add starting tile to openSet
-			while (m_openSet->size() > 0)
+			while (m_openSet->size() > 0 && (maxExpanded == 0u || m_expandedCount < maxExpanded))
 			{
 				// remove the tile, which has lowest cost, from openSet and put it into closeSet
+				++m_expandedCount;
 				CostTile * currentTile = m_openSet->front();
 				m_closeSet->insert(currentTile);
 				m_openSet->remove(0);
@@ -138,27 +149,30 @@ std::vector<sf::Vector2i> PathingSystem::findPath(sf::Vector2i startPos, sf::Vec
 					// cleanup open and close sets
 					m_openSet->cleanup();
 					m_closeSet->cleanup();
-					return std::move(vec);
+					return vec;
 				}
 
 				// get all neighbours of current node
-				getNeighbours(currentTile);
+				getNeighbours(currentTile, m_costTileGrid);
+				unsigned int blockedNeighbours = getBlockedNeighbours(currentTile);
 				for (unsigned int i = 0; i < m_neighbours->size(); ++i)
 				{
 					CostTile * n = m_neighbours->get(i);
-					// check if node is occupied or if it is on the closeSet already
-					if (m_originGrid->getObjectType(getIndex(n->m_x, n->m_y)) != ObjectType::NONE || m_closeSet->find(n) == true)
+					// check if node is too tight for the unit or if it is on the closeSet already, clearance is read only
+					// for units larger than one tile
+					if (isNeighbourBlocked(blockedNeighbours, currentTile, n) || (unitSize > 1u && m_originGrid->getClearance(getIndex(n->m_x, n->m_y)) < unitSize) ||
+						m_closeSet->find(n) == true)
 						continue;
 
-					// calculate new movement cost (distance from start) for node
-					int newMovCostToNeigh = ManHDistance(currentTile, n) + currentTile->m_gCost;
+					// calculate new movement cost (distance from start) for node, cost depends on terrain of entered tile
+					int newMovCostToNeigh = m_originGrid->getMoveCost(getIndex(n->m_x, n->m_y)) + currentTile->m_gCost;
 
 					// check if new movement cost is lower than before or if node is not in openSet
 					// if true, then put node inside openSet with new gCost and hCost and add it's parrent as currentNode
 					if (newMovCostToNeigh < n->m_gCost || !m_openSet->find(n))
 					{
 						n->m_gCost = newMovCostToNeigh;
-						n->m_hCost = ManHDistance(n, ctTarget);
+						n->m_hCost = static_cast<int>(ManHDistance(n, ctTarget) * heuristicScale);
 						n->m_parentTile = currentTile;
 						m_openSet->add(n);
 					}
@@ -172,76 +186,125 @@ std::vector<sf::Vector2i> PathingSystem::findPath(sf::Vector2i startPos, sf::Vec
 		}
 		case PF_ALGORITHM::A_STAR_HEAP_BIDIRECTIONAL:
 		{
-			//CostTile * ctStart2 = &m_costTileGrid2[getIndex(targetPosition)];
-			//CostTile * ctTarget2 = &m_costTileGrid2[getIndex(startPosition)];
-
-			//ctStart2->m_gCost = 0;
-			//ctStart2->m_hCost = 0;
-			//ctTarget2->m_gCost = 0;
-			//ctTarget2->m_hCost = 0;
-
-			//m_openSet->add(ctStart); 	// add starting tile to openSet
-			//m_openSet2->add(ctStart2); 	// add starting tile to openSet
-
-			//while (m_openSet->size() > 0 && m_openSet2->size() > 0)
-			//{
-			//	//--------------- direction 1
-			//	CostTile * currentTile = m_openSet->front();
-
-			//	// remove the tile, which has lowest cost, from openSet and put it into closeSet
-			//	m_closeSet->insert(m_openSet->front());
-			//	m_openSet->remove(0);
-			//	m_closeSet2->insert(m_openSet2->front());
-			//	m_openSet2->remove(0);
-
-			//	// check if current node is target node
-			//	if (m_closeSet2->find(currentTile))
-			//	{
-			//		std::vector<sf::Vector2i> vec;
-			//		CostTile * currentTile2 = &m_costTileGrid2[getIndex(currentTile->m_x, currentTile->m_y)]; // get same tile in 2nd direction
-
-			//		while ( !(currentTile2 == ctStart) )
-			//		{
-			//			vec.emplace_back(currentTile->m_x, currentTile->m_y);
-			//			currentTile = currentTile->m_parentTile;
-			//		}
-
-			//		while (!(currentTile == ctStart))
-			//		{
-			//			vec.emplace_back(currentTile->m_x, currentTile->m_y);
-			//			currentTile = currentTile->m_parentTile;
-			//		}
-			//		vec.emplace_back(currentTile->m_x, currentTile->m_y);
-			//		return std::move(vec);
-			//	}
-
-
-			//	// get all neighbours of current node
-			//	getNeighbours(currentTile);
-			//	for (unsigned int i = 0; i < m_neighbours->size(); ++i)
-			//	{
-			//		CostTile * n = m_neighbours->get(i);
-			//		// check if node is occupied or if it is on the closeSet already
-			//		if (m_originGrid->getObjectType(getIndex(n->m_x, n->m_y)) != ObjectType::NONE || m_closeSet->find(n) == true)
-			//			continue;
-
-			//		// calculate new movement cost (distance from start) for node
-			//		int newMovCostToNeigh = ManHDistance(currentTile, n) + currentTile->m_gCost;
-
-			//		// check if new movement cost is lower than before or if node is not in openSet
-			//		// if true, then put node inside openSet with new gCost and hCost and add it's parrent as currentNode
-			//		if (newMovCostToNeigh < n->m_gCost || !m_openSet->find(n))
-			//		{
-			//			n->m_gCost = newMovCostToNeigh;
-			//			n->m_hCost = ManHDistance(n, ctTarget);
-			//			n->m_parentTile = currentTile;
-			//			m_openSet->add(n);
-			//		}
-			//	}
-
-			//	//--------------- direction 2
-			//}
-			break;
+			// second direction searches from target tile to starting tile on it's own grid of cost tiles
+			CostTile * ctStart2 = &m_costTileGrid2[getIndex(targetPosition)];
+			CostTile * ctTarget2 = &m_costTileGrid2[getIndex(startPosition)];
+
+			ctStart2->m_gCost = 0;
+			ctStart2->m_hCost = 0;
+
+			// tiles too tight for the unit can't be entered, so path can't end on them
+			if (m_originGrid->getClearance(getIndex(targetPosition)) < unitSize && ctStart != ctTarget)
+				break;
+
+			m_openSet->add(ctStart); 	// add starting tile to openSet
+			m_openSet2->add(ctStart2); 	// add target tile to openSet of second direction
+
+			CostTile * meetTile = nullptr;							///< tile where both directions have met with lowest total cost
+			int bestCost = std::numeric_limits<int>::max();		///< total cost of the path going through meetTile
+			bool forward = true;
+
+			while (m_openSet->size() > 0 && m_openSet2->size() > 0)
+			{
+				// with consistent heuristic no path cheaper than bestCost can exist if lowest fCost of any direction is not lower
+				if (m_openSet->front()->fCost() >= bestCost || m_openSet2->front()->fCost() >= bestCost)
+					break;
+
+				// path found so far may be not the best one, so nothing is returned when limit is reached
+				if (maxExpanded != 0u && m_expandedCount >= maxExpanded)
+				{
+					meetTile = nullptr;
+					break;
+				}
+				++m_expandedCount;
+
+				// expand both directions in turns
+				std::vector<CostTile> & costTileGrid = forward ? m_costTileGrid : m_costTileGrid2;
+				std::vector<CostTile> & otherCostTileGrid = forward ? m_costTileGrid2 : m_costTileGrid;
+				logic::BinaryHeapTiles<CostTile*> & openSet = forward ? *m_openSet : *m_openSet2;
+				logic::CloseSet<CostTile*> & closeSet = forward ? *m_closeSet : *m_closeSet2;
+				logic::BinaryHeapTiles<CostTile*> & otherOpenSet = forward ? *m_openSet2 : *m_openSet;
+				logic::CloseSet<CostTile*> & otherCloseSet = forward ? *m_closeSet2 : *m_closeSet;
+				CostTile * directionTarget = forward ? ctTarget : ctTarget2;
+				bool isForward = forward;
+				forward = !forward;
+
+				// remove the tile, which has lowest cost, from openSet and put it into closeSet
+				CostTile * currentTile = openSet.front();
+				closeSet.insert(currentTile);
+				openSet.remove(0);
+
+				// get all neighbours of current node
+				getNeighbours(currentTile, costTileGrid);
+				unsigned int blockedNeighbours = getBlockedNeighbours(currentTile);
+				for (unsigned int i = 0; i < m_neighbours->size(); ++i)
+				{
+					CostTile * n = m_neighbours->get(i);
+					// check if node is too tight for the unit or if it is on the closeSet already, second direction ends on
+					// starting tile which don't have to be free
+					bool tooTight = isNeighbourBlocked(blockedNeighbours, currentTile, n) ||
+						(unitSize > 1u && m_originGrid->getClearance(getIndex(n->m_x, n->m_y)) < unitSize);
+					if ((tooTight && n != directionTarget) || closeSet.find(n) == true)
+						continue;
+
+					// calculate new movement cost for node, second direction walks path backward so it pays for leaving
+					// tile which is the same as entering it in the first direction
+					CostTile * enteredTile = isForward ? n : currentTile;
+					int newMovCostToNeigh = m_originGrid->getMoveCost(getIndex(enteredTile->m_x, enteredTile->m_y)) + currentTile->m_gCost;
+
+					if (newMovCostToNeigh < n->m_gCost || !openSet.find(n))
+					{
+						n->m_gCost = newMovCostToNeigh;
+						n->m_hCost = static_cast<int>(ManHDistance(n, directionTarget) * heuristicScale);
+						n->m_parentTile = currentTile;
+						openSet.add(n);
+
+						// check if tile was already reached by other direction
+						CostTile * otherTile = &otherCostTileGrid[getIndex(n->m_x, n->m_y)];
+						if ((otherOpenSet.find(otherTile) || otherCloseSet.find(otherTile)) && n->m_gCost + otherTile->m_gCost < bestCost)
+						{
+							bestCost = n->m_gCost + otherTile->m_gCost;
+							meetTile = &m_costTileGrid[getIndex(n->m_x, n->m_y)];
+						}
+					}
+				}
+
+				// starting tile is the target tile
+				if (currentTile == directionTarget && currentTile->m_gCost < bestCost)
+				{
+					bestCost = currentTile->m_gCost;
+					meetTile = &m_costTileGrid[getIndex(currentTile->m_x, currentTile->m_y)];
+				}
+			}
+
+			std::vector<sf::Vector2i> vec;
+			if (meetTile != nullptr)
+			{
+				// part of the path from target to meeting tile
+				CostTile * currentTile = &m_costTileGrid2[getIndex(meetTile->m_x, meetTile->m_y)];
+				while (!(currentTile == ctStart2))
+				{
+					vec.emplace_back(currentTile->m_x, currentTile->m_y);
+					currentTile = currentTile->m_parentTile;
+				}
+				vec.emplace_back(currentTile->m_x, currentTile->m_y);
+				std::reverse(vec.begin(), vec.end());
+
+				// part of the path from meeting tile to start
+				currentTile = meetTile;
+				while (!(currentTile == ctStart))
+				{
+					currentTile = currentTile->m_parentTile;
+					vec.emplace_back(currentTile->m_x, currentTile->m_y);
+				}
+			}
+
+			// cleanup open and close sets of both directions
+			m_openSet->cleanup();
+			m_closeSet->cleanup();
+			m_openSet2->cleanup();
+			m_closeSet2->cleanup();
+			return vec;
 		}
 	}
 	
@@ -251,7 +314,7 @@ std::vector<sf::Vector2i> PathingSystem::findPath(sf::Vector2i startPos, sf::Vec
 
 //--------------------------------------------------------------------------
 
-void PathingSystem::getNeighbours(CostTile *node)
+void PathingSystem::getNeighbours(CostTile *node, std::vector<CostTile> & costTileGrid)
 {
 	m_neighbours->reset();
 	for (int y = -1; y <= 1; ++y)
@@ -264,7 +327,7 @@ void PathingSystem::getNeighbours(CostTile *node)
 			int checkY = node->m_y + y;
 			if (checkX >= 0 && checkX < m_gridSize.x && checkY >= 0 && checkY < m_gridSize.y)
 			{
-				m_neighbours->push_back(&m_costTileGrid[getIndex(checkX, checkY)]);
+				m_neighbours->push_back(&costTileGrid[getIndex(checkX, checkY)]);
 			}
 		}
 	}
@@ -308,3 +371,35 @@ PathingSystem::CostTile & PathingSystem::CostTile::operator=(const CostTile & ti
 	m_parentTile = tile.m_parentTile;
 	return *this;
 }
+
+//--------------------------------------------------------------------------
+
+unsigned int PathingSystem::getBlockedNeighbours(const CostTile * node) const
+{
+	int nodeX = static_cast<int>(node->m_x);
+	int nodeY = static_cast<int>(node->m_y);
+	int localX = nodeX % m_chunkSize.x;
+	int localY = nodeY % m_chunkSize.y;
+
+	// node is not on the chunk border, so every row of 3 tiles is one shift of the chunk word
+	if (localX > 0 && localX < m_chunkSize.x - 1 && localY > 0 && localY < m_chunkSize.y - 1)
+	{
+		uint64_t word = m_originGrid->getChunkBits(GridPlane::BLOCKED, getIndex(nodeX, nodeY) / CHUNK_TILES);
+		word >>= (localX - 1) + (localY - 1)*m_chunkSize.x;
+		return static_cast<unsigned int>((word & 7u) | ((word >> m_chunkSize.x) & 7u) << 3 | ((word >> 2*m_chunkSize.x) & 7u) << 6);
+	}
+
+	// tiles may belong to up to 4 chunks, tiles outside of the grid are never neighbours so they are left clear
+	unsigned int mask = 0u;
+	for (int y = -1; y <= 1; ++y)
+	{
+		for (int x = -1; x <= 1; ++x)
+		{
+			int checkX = nodeX + x;
+			int checkY = nodeY + y;
+			if (checkX >= 0 && checkX < m_gridSize.x && checkY >= 0 && checkY < m_gridSize.y && m_originGrid->isBlocked(getIndex(checkX, checkY)))
+				mask |= 1u << ((y + 1)*3 + x + 1);
+		}
+	}
+	return mask;
+}
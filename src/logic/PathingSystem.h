@@ -46,9 +46,23 @@ enum class PF_ALGORITHM
 class PathingSystem
 {
 public:
-	PathingSystem(Grid * originGrid);
+	PathingSystem(const GridView * originGrid);
 	~PathingSystem();
 
+	/*!
+	* \brief Change grid on which paths are searched
+	*
+	* New grid must have the same size as the grid passed to constructor. Usually it's the newest GridSnapshot taken
+	* from the Grid, so searches can run on another thread while the Grid is modified.
+	*
+	*/
+	void setGridView(const GridView * originGrid);
+
+	/*!
+	* \brief Return grid on which paths are searched
+	*/
+	inline const GridView * getGridView() const { return m_originGrid; }
+
 	/*!
 	* \brief Finds best path vector between two positions on the map
 	*
@@ -56,14 +70,30 @@ public:
 	* PF_ALGORITHM enum class. Function does not perform bounding check for start and target position in Release mode. 
 	* User must ensure that this positions are inside main grid map.
 	*
+	* Units bigger than one tile are placed on tiles with their top left corner. Tile is accepted only if it's clearance
+	* is not lower than unit size, so path never goes through gaps which are too tight for the unit. Clearance of the grid
+	* must be up to date (see Grid::publishChanges() and Grid::updateClearance()).
+	*
+	* Cost of every step is move cost of entered tile (see Grid::getMoveCost()). Epsilon higher than 1 turns search into
+	* weighted A*, which expands less tiles and returns path at most epsilon times more expensive than the best one.
+	*
 	* \param startPos Starting position of path
 	* \param targetPos Target position of path
 	* \param algorithm ID of algorithm used in path finding
+	* \param unitSize Size of the unit in tiles (unit occupies unitSize x unitSize tiles), can't be bigger than MAX_CLEARANCE
+	* \param epsilon Weight of heuristic, 1 gives the best path
+	* \param maxExpanded Maximum amount of expanded tiles, search fails with empty path when it's reached. 0 means no limit
 	*
 	* \return Path vector including starting and target position
 	*
 	*/
-	std::vector<sf::Vector2i> findPath(sf::Vector2i startPos, sf::Vector2i targetPos, PF_ALGORITHM algorithm);
+	std::vector<sf::Vector2i> findPath(sf::Vector2i startPos, sf::Vector2i targetPos, PF_ALGORITHM algorithm, unsigned int unitSize = 1u, float epsilon = 1.f,
+		unsigned int maxExpanded = 0u);
+
+	/*!
+	* \brief Return amount of tiles expanded by last search
+	*/
+	inline unsigned int getExpandedCount() const { return m_expandedCount; }
 
 	class CostTile
 	{
@@ -108,7 +138,6 @@ public:
 		//CostTile * m_parentTile{ nullptr };	///< pointer to parent tile
 
 	public:
-		static Grid * originGrid;			///< pointer to original grid
 		unsigned int m_x, m_y;				///< x,y position on the grid
 		int m_gCost{ 0 };					///< distance to start tile
 		int m_hCost{ 0 };					///< distance to target tile
@@ -165,11 +194,35 @@ private:
 
 	/*!
 	* \brief Set up neighbour vector
+	*
+	* \param node Tile which neighbours are searched
+	* \param costTileGrid Grid of cost tiles from which neighbours are taken
+	*
+	*/
+	void getNeighbours(CostTile *node, std::vector<CostTile> & costTileGrid);
+
+	/*!
+	* \brief Return mask of occupied tiles around the node
+	*
+	* Tiles are taken from BLOCKED plane of the grid, so if the node is not on the chunk border all 9 tiles are
+	* read from one word. Bit (y + 1)*3 + (x + 1) is set if tile at offset x,y from the node is occupied.
+	*
+	* \param node Tile which neighbours are checked
+	*
 	*/
-	void getNeighbours(CostTile *node);
+	unsigned int getBlockedNeighbours(const CostTile * node) const;
+
+	/*!
+	* \brief Check bit of the neighbour in mask returned by getBlockedNeighbours()
+	*/
+	static bool isNeighbourBlocked(unsigned int blockedNeighbours, const CostTile * node, const CostTile * neighbour)
+	{
+		return (blockedNeighbours >> ((neighbour->m_y + 1u - node->m_y)*3u + (neighbour->m_x + 1u - node->m_x))) & 1u;
+	}
 
 private:
-	const Grid * m_originGrid;											///< pointer to original grid
+	unsigned int m_expandedCount{ 0u };									///< amount of tiles expanded by last search
+	const GridView * m_originGrid;										///< pointer to original grid
 
 	sf::Vector2i m_gridSize;											///< size of the grid in grid coordinates (amount of tiles in x and y direction in all grid)
 	sf::Vector2i m_chunkSize{ sf::Vector2i(CHUNK_SIZE,CHUNK_SIZE) };	///< size of the chunk in grid coordinates (amount of tiles in x and y direction in chunk)
@@ -184,8 +237,5 @@ private:
 	std::unique_ptr<logic::CloseSet<CostTile*>> m_closeSet2;			///< close set for cost tiles used for bidirectional algorithm
 
 	std::unique_ptr<logic::LogicArrayPtr<CostTile*>> m_neighbours;			///< vector of all neighbours
-
-
-	std::vector<sf::Vector2i> testVector;	//--
 };
 
@@ -0,0 +1,427 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//--------------------------------------------------------------------------
+
+#include "RectangleMap.h"
+
+//--------------------------------------------------------------------------
+
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+
+//--------------------------------------------------------------------------
+
+namespace
+{
+	constexpr int CHUNK_SIDE = static_cast<int>(CHUNK_SIZE);	///< size of the chunk as signed value used in coordinate math
+
+	/*!
+	* \brief Return index of the lowest set bit, word can't be 0
+	*/
+	inline unsigned int lowestBit(uint64_t word)
+	{
+#ifdef __GNUC__
+		return static_cast<unsigned int>(__builtin_ctzll(word));
+#else
+		unsigned int index = 0u;
+		for (; (word & 1u) == 0u; word >>= 1)
+			++index;
+		return index;
+#endif
+	}
+}
+
+//--------------------------------------------------------------------------
+
+RectangleMap::RectangleMap(Grid & grid) :
+	m_grid{ &grid }
+{
+	sf::Vector2i gridSize = grid.getGridSize();
+	sf::Vector2i chunkGridSize = grid.getChunkGridSize();
+	m_tileRectangle.resize(gridSize.x*gridSize.y, -1);
+	m_nodes.resize(gridSize.x*gridSize.y);
+	m_chunkQueued.resize(chunkGridSize.x*chunkGridSize.y, false);
+
+	std::vector<unsigned int> chunks(chunkGridSize.x*chunkGridSize.y);
+	for (unsigned int i = 0u; i < chunks.size(); ++i)
+		chunks[i] = i;
+	buildChunks(chunks);
+
+	m_subscriptionId = grid.subscribe(logic::Delegate<void(const GridChangeSet &)>::factory<RectangleMap, &RectangleMap::onGridChanged>(this));
+}
+
+//--------------------------------------------------------------------------
+
+RectangleMap::~RectangleMap()
+{
+	m_grid->unsubscribe(m_subscriptionId);
+}
+
+//--------------------------------------------------------------------------
+
+std::vector<sf::Vector2i> RectangleMap::findPath(sf::Vector2i startPos, sf::Vector2i targetPos)
+{
+	std::vector<sf::Vector2i> path;
+	unsigned int start = m_grid->getIndex(startPos.x, startPos.y);
+	unsigned int target = m_grid->getIndex(targetPos.x, targetPos.y);
+	m_expandedCount = 0u;
+
+	if (start == target)
+	{
+		path.push_back(startPos);
+		return path;
+	}
+	if (m_tileRectangle[target] < 0)
+		return path;
+
+	// inside rectangle of the cheapest terrain no path can be cheaper than direct walk, on other terrain path around
+	// the rectangle may be cheaper so it's searched as usual
+	int startRectangle = m_tileRectangle[start];
+	if (startRectangle >= 0 && m_rectangles[startRectangle].area.contains(targetPos) && m_rectangles[startRectangle].moveCost == m_grid->getMinMoveCost())
+	{
+		path.push_back(targetPos);
+		appendWalk(path, targetPos, startPos);
+		return path;
+	}
+
+	++m_searchId;
+	m_openSet.clear();
+	m_heuristicCost = m_grid->getMinMoveCost();
+	relax(start, start, 0, false, targetPos);
+
+	sf::Vector2i gridSize = m_grid->getGridSize();
+	while (!m_openSet.empty())
+	{
+		std::pop_heap(m_openSet.begin(), m_openSet.end(), std::greater<std::pair<int64_t, unsigned int>>());
+		unsigned int current = m_openSet.back().second;
+		m_openSet.pop_back();
+
+		SearchNode & node = m_nodes[current];
+		if (node.closed)
+			continue;
+		node.closed = true;
+		++m_expandedCount;
+		if (current == target)
+			break;
+
+		sf::Vector2i pos = getPosition(current);
+		int rectangleId = m_tileRectangle[current];
+		sf::IntRect area;
+		if (rectangleId >= 0)
+		{
+			const Rectangle & rectangle = m_rectangles[rectangleId];
+			area = rectangle.area;
+			if (area.contains(targetPos))
+				relax(target, current, node.gCost + distance(pos, targetPos)*rectangle.moveCost, true, targetPos);
+
+			// tile reached from inside of rectangle can't improve other border tiles, because distance inside rectangle
+			// is never longer than distance through one more tile of it
+			if (!node.throughRectangle)
+			{
+				int right = area.left + area.width - 1;
+				int bottom = area.top + area.height - 1;
+				for (int y = area.top; y <= bottom; ++y)
+				{
+					// only first and last row are fully on the border
+					int step = (y == area.top || y == bottom) ? 1 : std::max(right - area.left, 1);
+					for (int x = area.left; x <= right; x += step)
+					{
+						sf::Vector2i border(x, y);
+						if (border != pos)
+							relax(m_grid->getIndex(x, y), current, node.gCost + distance(pos, border)*rectangle.moveCost, true, targetPos);
+					}
+				}
+			}
+		}
+
+		// step to neighbour rectangles
+		for (int y = pos.y - 1; y <= pos.y + 1; ++y)
+		{
+			for (int x = pos.x - 1; x <= pos.x + 1; ++x)
+			{
+				if (x < 0 || y < 0 || x >= gridSize.x || y >= gridSize.y || (rectangleId >= 0 && area.contains(x, y)))
+					continue;
+
+				unsigned int neighbour = m_grid->getIndex(x, y);
+				int neighbourRectangle = m_tileRectangle[neighbour];
+				if (neighbourRectangle >= 0 && neighbour != current)
+					relax(neighbour, current, node.gCost + m_rectangles[neighbourRectangle].moveCost, false, targetPos);
+			}
+		}
+	}
+
+	if (m_nodes[target].searchId != m_searchId || !m_nodes[target].closed)
+		return path;
+
+	// fill straight and diagonal steps between saved nodes
+	unsigned int current = target;
+	path.push_back(targetPos);
+	while (current != start)
+	{
+		appendWalk(path, getPosition(current), getPosition(m_nodes[current].parent));
+		current = m_nodes[current].parent;
+	}
+
+	return path;
+}
+
+//--------------------------------------------------------------------------
+
+void RectangleMap::appendWalk(std::vector<sf::Vector2i> & path, sf::Vector2i from, sf::Vector2i to)
+{
+	while (from != to)
+	{
+		from.x += (to.x > from.x) - (to.x < from.x);
+		from.y += (to.y > from.y) - (to.y < from.y);
+		path.push_back(from);
+	}
+}
+
+//--------------------------------------------------------------------------
+
+void RectangleMap::onGridChanged(const GridChangeSet & changes)
+{
+	if (changes.dirtyChunks.empty())
+		return;
+
+	// merged rectangles cover whole chunks, so all chunks of removed rectangles are rebuilt too
+	std::vector<unsigned int> chunks;
+	sf::Vector2i chunkGridSize = m_grid->getChunkGridSize();
+	auto queueChunk = [&](unsigned int chunkIndex)
+	{
+		if (!m_chunkQueued[chunkIndex])
+		{
+			m_chunkQueued[chunkIndex] = true;
+			chunks.push_back(chunkIndex);
+		}
+	};
+
+	for (auto chunkIndex : changes.dirtyChunks)
+	{
+		queueChunk(chunkIndex);
+		for (unsigned int tile = 0u; tile < CHUNK_TILES; ++tile)
+		{
+			int rectangleId = m_tileRectangle[chunkIndex*CHUNK_TILES + tile];
+			if (rectangleId < 0)
+				continue;
+
+			sf::IntRect area = m_rectangles[rectangleId].area;
+			for (int y = area.top / CHUNK_SIDE; y <= (area.top + area.height - 1) / CHUNK_SIDE; ++y)
+			{
+				for (int x = area.left / CHUNK_SIDE; x <= (area.left + area.width - 1) / CHUNK_SIDE; ++x)
+					queueChunk(y*chunkGridSize.x + x);
+			}
+			removeRectangle(rectangleId);
+		}
+	}
+
+	// remaining rectangles of queued chunks
+	for (auto chunkIndex : chunks)
+	{
+		for (unsigned int tile = 0u; tile < CHUNK_TILES; ++tile)
+		{
+			int rectangleId = m_tileRectangle[chunkIndex*CHUNK_TILES + tile];
+			if (rectangleId >= 0)
+				removeRectangle(rectangleId);
+		}
+	}
+
+	std::sort(chunks.begin(), chunks.end());
+	buildChunks(chunks);
+	for (auto chunkIndex : chunks)
+		m_chunkQueued[chunkIndex] = false;
+}
+
+//--------------------------------------------------------------------------
+
+void RectangleMap::buildChunks(const std::vector<unsigned int> & chunks)
+{
+	sf::Vector2i chunkGridSize = m_grid->getChunkGridSize();
+
+	// open chunks which can be merged, chunks are assigned to rectangle by clearing the flag
+	std::vector<bool> mergeable(chunkGridSize.x*chunkGridSize.y, false);
+	for (auto chunkIndex : chunks)
+	{
+		if (isOpenChunk(chunkIndex))
+			mergeable[chunkIndex] = true;
+		else
+			splitChunk(chunkIndex);
+	}
+
+	auto terrainOf = [this](unsigned int chunkIndex) { return m_grid->chunk(chunkIndex).terrain[0]; };
+
+	// chunks are sorted, so every merged rectangle grows from it's top left chunk to the right and then down
+	for (auto chunkIndex : chunks)
+	{
+		if (!mergeable[chunkIndex])
+			continue;
+
+		TerrainType terrain = terrainOf(chunkIndex);
+		int left = chunkIndex % chunkGridSize.x;
+		int top = chunkIndex / chunkGridSize.x;
+		auto canMerge = [&](int x, int y)
+		{
+			unsigned int index = y*chunkGridSize.x + x;
+			return mergeable[index] && terrainOf(index) == terrain;
+		};
+
+		int right = left + 1;
+		while (right < chunkGridSize.x && canMerge(right, top))
+			++right;
+
+		int bottom = top + 1;
+		for (; bottom < chunkGridSize.y; ++bottom)
+		{
+			bool rowMergeable = true;
+			for (int x = left; x < right && rowMergeable; ++x)
+				rowMergeable = canMerge(x, bottom);
+			if (!rowMergeable)
+				break;
+		}
+
+		for (int y = top; y < bottom; ++y)
+		{
+			for (int x = left; x < right; ++x)
+				mergeable[y*chunkGridSize.x + x] = false;
+		}
+		addRectangle(sf::IntRect(left*CHUNK_SIDE, top*CHUNK_SIDE, (right - left)*CHUNK_SIDE, (bottom - top)*CHUNK_SIDE),
+			TERRAIN_MOVE_COST[static_cast<int>(terrain)]);
+	}
+}
+
+//--------------------------------------------------------------------------
+
+void RectangleMap::splitChunk(unsigned int chunkIndex)
+{
+	const GridChunk & chunk = m_grid->chunk(chunkIndex);
+	sf::Vector2i chunkGridSize = m_grid->getChunkGridSize();
+	int originX = (chunkIndex % chunkGridSize.x)*CHUNK_SIDE;
+	int originY = (chunkIndex / chunkGridSize.x)*CHUNK_SIDE;
+
+	// tiles which are free and not covered by any rectangle yet
+	uint64_t freeTiles = ~chunk.planes[static_cast<int>(GridPlane::BLOCKED)];
+	while (freeTiles != 0u)
+	{
+		unsigned int first = lowestBit(freeTiles);
+		int left = first % CHUNK_SIDE;
+		int top = first / CHUNK_SIDE;
+		TerrainType terrain = chunk.terrain[first];
+		auto canCover = [&](int x, int y)
+		{
+			unsigned int tile = x + y*CHUNK_SIDE;
+			return ((freeTiles >> tile) & 1u) && chunk.terrain[tile] == terrain;
+		};
+
+		int right = left + 1;
+		while (right < CHUNK_SIDE && canCover(right, top))
+			++right;
+
+		int bottom = top + 1;
+		for (; bottom < CHUNK_SIDE; ++bottom)
+		{
+			bool rowCovered = true;
+			for (int x = left; x < right && rowCovered; ++x)
+				rowCovered = canCover(x, bottom);
+			if (!rowCovered)
+				break;
+		}
+
+		freeTiles &= ~GridView::chunkMask(left, top, right - left, bottom - top);
+		addRectangle(sf::IntRect(originX + left, originY + top, right - left, bottom - top), TERRAIN_MOVE_COST[static_cast<int>(terrain)]);
+	}
+}
+
+//--------------------------------------------------------------------------
+
+bool RectangleMap::isOpenChunk(unsigned int chunkIndex) const
+{
+	const GridChunk & chunk = m_grid->chunk(chunkIndex);
+	if (chunk.planes[static_cast<int>(GridPlane::BLOCKED)] != 0u)
+		return false;
+	return std::all_of(std::begin(chunk.terrain), std::end(chunk.terrain), [&chunk](TerrainType terrain) { return terrain == chunk.terrain[0]; });
+}
+
+//--------------------------------------------------------------------------
+
+void RectangleMap::addRectangle(sf::IntRect area, int moveCost)
+{
+	int rectangleId;
+	if (!m_freeRectangles.empty())
+	{
+		rectangleId = m_freeRectangles.back();
+		m_freeRectangles.pop_back();
+		m_rectangles[rectangleId] = Rectangle{ area, moveCost };
+	}
+	else
+	{
+		rectangleId = static_cast<int>(m_rectangles.size());
+		m_rectangles.push_back(Rectangle{ area, moveCost });
+	}
+
+	for (int y = area.top; y < area.top + area.height; ++y)
+	{
+		for (int x = area.left; x < area.left + area.width; ++x)
+			m_tileRectangle[m_grid->getIndex(x, y)] = rectangleId;
+	}
+}
+
+//--------------------------------------------------------------------------
+
+void RectangleMap::removeRectangle(int rectangleId)
+{
+	sf::IntRect area = m_rectangles[rectangleId].area;
+	for (int y = area.top; y < area.top + area.height; ++y)
+	{
+		for (int x = area.left; x < area.left + area.width; ++x)
+			m_tileRectangle[m_grid->getIndex(x, y)] = -1;
+	}
+	m_freeRectangles.push_back(rectangleId);
+}
+
+//--------------------------------------------------------------------------
+
+void RectangleMap::relax(unsigned int index, unsigned int parent, int gCost, bool throughRectangle, sf::Vector2i targetPos)
+{
+	SearchNode & node = m_nodes[index];
+	if (node.searchId != m_searchId)
+	{
+		node.searchId = m_searchId;
+		node.closed = false;
+	}
+	else if (node.closed || node.gCost <= gCost)
+		return;
+
+	node.gCost = gCost;
+	node.parent = parent;
+	node.throughRectangle = throughRectangle;
+
+	// distance in tiles multiplied by the lowest move cost is admissible heuristic, nodes with the same f cost are
+	// ordered by h cost, so search goes straight to the target on open areas instead of expanding all equal nodes
+	int64_t hCost = distance(getPosition(index), targetPos)*m_heuristicCost;
+	m_openSet.emplace_back(((gCost + hCost) << 32) + hCost, index);
+	std::push_heap(m_openSet.begin(), m_openSet.end(), std::greater<std::pair<int64_t, unsigned int>>());
+}
+
+//--------------------------------------------------------------------------
+
+int RectangleMap::distance(sf::Vector2i a, sf::Vector2i b)
+{
+	return std::max(std::abs(a.x - b.x), std::abs(a.y - b.y));
+}
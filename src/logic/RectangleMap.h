@@ -0,0 +1,193 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <vector>
+#include <cstdint>
+#include <SFML/Graphics.hpp>
+
+//--------------------------------------------------------------------------
+
+#include "Grid.h"
+
+//--------------------------------------------------------------------------
+
+/*!
+* \brief Decomposition of passable tiles of the grid into rectangles used as navigation graph
+*
+* Every free tile belongs to exactly one rectangle and all tiles of one rectangle have the same terrain. Chunks which are
+* completely free and have single terrain are merged with each other into big rectangles, other chunks are split into maximal
+* free rectangles separately. Because move cost inside rectangle is uniform, cost between any two of it's tiles is known
+* without search, so path search expands only border tiles of rectangles. Path between two tiles of one rectangle with
+* the cheapest terrain of the grid is returned without any search. Rectangles are rebuilt for chunks changed in every change
+* set published by the grid.
+*
+* Search supports units of one tile size. Returned paths are equal in cost to paths found by PathingSystem with epsilon 1.
+*
+* Usage example:
+* \code
+* RectangleMap rectangles(grid);
+* auto path = rectangles.findPath(sf::Vector2i(0, 0), sf::Vector2i(120, 80));
+* \endcode
+*
+*/
+class RectangleMap
+{
+public:
+	/*!
+	* \brief Default constructor
+	*
+	* \param grid Decomposed grid, map subscribes to it's change sets so it must outlive the map
+	*
+	*/
+	RectangleMap(Grid & grid);
+	~RectangleMap();
+
+	RectangleMap(const RectangleMap &) = delete;
+	RectangleMap & operator=(const RectangleMap &) = delete;
+
+	/*!
+	* \brief Find the cheapest path between two positions
+	*
+	* \param startPos Starting position of path
+	* \param targetPos Target position of path
+	*
+	* \return Path ordered from target to start position, or empty vector if target can't be reached
+	*
+	*/
+	std::vector<sf::Vector2i> findPath(sf::Vector2i startPos, sf::Vector2i targetPos);
+
+	/*!
+	* \brief Return id of rectangle which contains the tile, or -1 if tile is occupied
+	*
+	* \param index Index of the tile (see Grid::getIndex())
+	*
+	*/
+	inline int getRectangleId(unsigned int index) const { return m_tileRectangle[index]; }
+
+	/*!
+	* \brief Return area of rectangle in grid coordinates
+	*/
+	inline sf::IntRect getRectangle(int rectangleId) const { return m_rectangles[rectangleId].area; }
+
+	/*!
+	* \brief Return amount of rectangles which cover the grid
+	*/
+	inline unsigned int getRectangleCount() const { return m_rectangles.size() - m_freeRectangles.size(); }
+
+	/*!
+	* \brief Return amount of tiles expanded by last search
+	*/
+	inline unsigned int getExpandedCount() const { return m_expandedCount; }
+
+private:
+	/*!
+	* \brief Single rectangle of free tiles with the same terrain
+	*/
+	struct Rectangle
+	{
+		sf::IntRect area;		///< covered tiles in grid coordinates
+		int moveCost;			///< cost of entering any of covered tiles
+	};
+
+	/*!
+	* \brief Remove rectangles from changed chunks and decompose these chunks again
+	*/
+	void onGridChanged(const GridChangeSet & changes);
+
+	/*!
+	* \brief Decompose chunks into rectangles, chunks can't be covered by any rectangle
+	*
+	* \param chunks Indexes of decomposed chunks
+	*
+	*/
+	void buildChunks(const std::vector<unsigned int> & chunks);
+
+	/*!
+	* \brief Split single chunk into maximal free rectangles
+	*/
+	void splitChunk(unsigned int chunkIndex);
+
+	/*!
+	* \brief Return true if chunk is completely free and all it's tiles have the same terrain
+	*/
+	bool isOpenChunk(unsigned int chunkIndex) const;
+
+	/*!
+	* \brief Create rectangle and assign it to all covered tiles
+	*/
+	void addRectangle(sf::IntRect area, int moveCost);
+
+	/*!
+	* \brief Remove rectangle and clear it's id from all covered tiles
+	*/
+	void removeRectangle(int rectangleId);
+
+	/*!
+	* \brief Update cost of the tile if new cost is lower and add tile to open set then
+	*/
+	void relax(unsigned int index, unsigned int parent, int gCost, bool throughRectangle, sf::Vector2i targetPos);
+
+	/*!
+	* \brief Append straight and diagonal steps from one tile to another, first tile is not appended
+	*/
+	static void appendWalk(std::vector<sf::Vector2i> & path, sf::Vector2i from, sf::Vector2i to);
+
+	/*!
+	* \brief Return distance between tiles when moving in 8 directions
+	*/
+	static int distance(sf::Vector2i a, sf::Vector2i b);
+
+	/*!
+	* \brief Return position of the tile in grid coordinates
+	*/
+	inline sf::Vector2i getPosition(unsigned int index) const
+	{
+		unsigned int chunkIndex = index / CHUNK_TILES;
+		unsigned int tile = index % CHUNK_TILES;
+		sf::Vector2i chunkGridSize = m_grid->getChunkGridSize();
+		return sf::Vector2i((chunkIndex % chunkGridSize.x)*CHUNK_SIZE + tile % CHUNK_SIZE, (chunkIndex / chunkGridSize.x)*CHUNK_SIZE + tile / CHUNK_SIZE);
+	}
+
+private:
+	Grid * m_grid;										///< decomposed grid
+	unsigned int m_subscriptionId;						///< id of subscription to grid change sets
+
+	std::vector<Rectangle> m_rectangles;				///< all rectangles, removed rectangles are reused
+	std::vector<int> m_freeRectangles;					///< ids of removed rectangles
+	std::vector<int> m_tileRectangle;					///< id of rectangle which contains the tile, -1 for occupied tiles
+	std::vector<bool> m_chunkQueued;					///< helper flags used to collect rebuilt chunks
+
+	// search data, reset by increasing search id instead of clearing
+	struct SearchNode
+	{
+		unsigned int searchId{ 0u };	///< id of search which touched the node for last time
+		int gCost{ 0 };					///< cost of the best known path from start
+		unsigned int parent{ 0u };		///< previous node on the best known path
+		bool throughRectangle{ false };	///< true if node was reached from other tile of it's rectangle
+		bool closed{ false };			///< true if node was expanded
+	};
+	std::vector<SearchNode> m_nodes;					///< search state of every tile
+	std::vector<std::pair<int64_t, unsigned int>> m_openSet;	///< heap of nodes ordered by f cost and then h cost
+	unsigned int m_searchId{ 0u };						///< id of current search
+	unsigned int m_expandedCount{ 0u };					///< amount of tiles expanded by last search
+	int m_heuristicCost{ 0 };							///< cost per tile used by heuristic
+};
@@ -0,0 +1,203 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//--------------------------------------------------------------------------
+
+#include "TerrainGenerator.h"
+
+//--------------------------------------------------------------------------
+
+#include <algorithm>
+
+//--------------------------------------------------------------------------
+
+constexpr unsigned int TerrainGenerator::BATCH_CHUNKS;
+constexpr std::size_t TerrainGenerator::JOB_CHUNKS;
+
+namespace
+{
+	// salts of independent noises
+	constexpr uint32_t ELEVATION_SALT = 0x1u;
+	constexpr uint32_t FOREST_SALT = 0x2u;
+	constexpr uint32_t TREE_SALT = 0x3u;
+	constexpr uint32_t RESOURCE_SALT = 0x4u;
+
+	constexpr int RESOURCE_MAX_RADIUS = 3;	///< the biggest radius of resource cluster in tiles
+}
+
+//--------------------------------------------------------------------------
+
+TerrainGenerator::TerrainGenerator(const TerrainSettings & settings, Grid & grid) :
+	m_settings{ settings },
+	m_grid(grid)
+{
+	m_chunkCount = grid.getChunkGridSize().x*grid.getChunkGridSize().y;
+	assert(settings.resourceRegion > 2 * RESOURCE_MAX_RADIUS + 2);
+}
+
+//--------------------------------------------------------------------------
+
+bool TerrainGenerator::step(logic::JobSystem & jobs, sf::Time budget)
+{
+	sf::Clock clock;
+	while (!isFinished() && clock.getElapsedTime() < budget)
+		generateBatch(jobs);
+	return isFinished();
+}
+
+//--------------------------------------------------------------------------
+
+void TerrainGenerator::generate(logic::JobSystem & jobs)
+{
+	while (!isFinished())
+		generateBatch(jobs);
+}
+
+//--------------------------------------------------------------------------
+
+void TerrainGenerator::generateBatch(logic::JobSystem & jobs)
+{
+	unsigned int first = m_nextChunk;
+	unsigned int count = std::min(BATCH_CHUNKS, m_chunkCount - first);
+	m_batch.resize(count);
+
+	// every job writes only it's own chunks, grid is changed after all jobs are finished
+	jobs.wait(jobs.parallelFor(0, count, JOB_CHUNKS, [this, first](std::size_t begin, std::size_t end)
+	{
+		for (std::size_t i = begin; i < end; ++i)
+			generateChunk(first + static_cast<unsigned int>(i), m_batch[i]);
+	}));
+
+	for (unsigned int i = 0u; i < count; ++i)
+		m_grid.replaceChunk(first + i, m_batch[i]);
+	m_nextChunk += count;
+}
+
+//--------------------------------------------------------------------------
+
+void TerrainGenerator::generateChunk(unsigned int chunkIndex, GridChunk & chunk) const
+{
+	int originX = (chunkIndex % m_grid.getChunkGridSize().x)*CHUNK_SIZE;
+	int originY = (chunkIndex / m_grid.getChunkGridSize().x)*CHUNK_SIZE;
+	for (unsigned int tile = 0u; tile < CHUNK_TILES; ++tile)
+	{
+		int x = originX + tile % CHUNK_SIZE;
+		int y = originY + tile / CHUNK_SIZE;
+		float elevation = fractalNoise(ELEVATION_SALT, x, y, 64, 4);
+		chunk.height[tile] = static_cast<uint8_t>(elevation*255.f);
+		chunk.objType[tile] = ObjectType::NONE;
+
+		if (elevation < m_settings.waterLevel)
+		{
+			chunk.terrain[tile] = TerrainType::SHALLOW_WATER;
+			continue;
+		}
+
+		if (isResource(x, y))
+		{
+			chunk.terrain[tile] = TerrainType::GRASS;
+			chunk.objType[tile] = ObjectType::RESOURCE;
+		}
+		else if (fractalNoise(FOREST_SALT, x, y, 32, 3) > m_settings.forestLevel)
+		{
+			chunk.terrain[tile] = TerrainType::FOREST_FLOOR;
+			if (hash(TREE_SALT, x, y) % 100u < m_settings.treeDensity)
+				chunk.objType[tile] = ObjectType::TREE;
+		}
+		else
+			chunk.terrain[tile] = TerrainType::GRASS;
+	}
+}
+
+//--------------------------------------------------------------------------
+
+float TerrainGenerator::fractalNoise(uint32_t salt, int x, int y, int cellSize, int octaves) const
+{
+	float sum = 0.f;
+	float weight = 1.f;
+	float weights = 0.f;
+	for (int octave = 0; octave < octaves && cellSize > 0; ++octave)
+	{
+		sum += valueNoise(salt + octave * 0x100u, x, y, cellSize)*weight;
+		weights += weight;
+		weight *= 0.5f;
+		cellSize /= 2;
+	}
+	return sum / weights;
+}
+
+//--------------------------------------------------------------------------
+
+float TerrainGenerator::valueNoise(uint32_t salt, int x, int y, int cellSize) const
+{
+	int cellX = x / cellSize;
+	int cellY = y / cellSize;
+
+	// smoothstep of position inside the cell
+	float fx = static_cast<float>(x % cellSize) / static_cast<float>(cellSize);
+	float fy = static_cast<float>(y % cellSize) / static_cast<float>(cellSize);
+	fx = fx*fx*(3.f - 2.f*fx);
+	fy = fy*fy*(3.f - 2.f*fy);
+
+	auto corner = [this, salt](int cx, int cy)
+	{
+		return static_cast<float>(hash(salt, cx, cy) >> 8) / static_cast<float>(1u << 24);
+	};
+	float top = corner(cellX, cellY) + (corner(cellX + 1, cellY) - corner(cellX, cellY))*fx;
+	float bottom = corner(cellX, cellY + 1) + (corner(cellX + 1, cellY + 1) - corner(cellX, cellY + 1))*fx;
+	return top + (bottom - top)*fy;
+}
+
+//--------------------------------------------------------------------------
+
+bool TerrainGenerator::isResource(int x, int y) const
+{
+	int region = static_cast<int>(m_settings.resourceRegion);
+	int regionX = x / region;
+	int regionY = y / region;
+	uint32_t regionHash = hash(RESOURCE_SALT, regionX, regionY);
+	if (regionHash % 100u >= m_settings.resourceChance)
+		return false;
+
+	// cluster never crosses border of it's region, so other regions don't have to be checked
+	int margin = RESOURCE_MAX_RADIUS + 1;
+	int centerX = regionX*region + margin + static_cast<int>((regionHash >> 8) % static_cast<uint32_t>(region - 2 * margin));
+	int centerY = regionY*region + margin + static_cast<int>((regionHash >> 16) % static_cast<uint32_t>(region - 2 * margin));
+	int radius = 2 + static_cast<int>(regionHash >> 30) % (RESOURCE_MAX_RADIUS - 1);
+
+	int dx = x - centerX;
+	int dy = y - centerY;
+	return dx*dx + dy*dy <= radius*radius;
+}
+
+//--------------------------------------------------------------------------
+
+uint32_t TerrainGenerator::hash(uint32_t salt, int x, int y) const
+{
+	// murmur3 finalizer of combined inputs
+	uint32_t h = m_settings.seed ^ (salt*0x9E3779B9u);
+	h ^= static_cast<uint32_t>(x)*0x85EBCA6Bu;
+	h = (h << 13) | (h >> 19);
+	h ^= static_cast<uint32_t>(y)*0xC2B2AE35u;
+	h ^= h >> 16;
+	h *= 0x85EBCA6Bu;
+	h ^= h >> 13;
+	h *= 0xC2B2AE35u;
+	h ^= h >> 16;
+	return h;
+}
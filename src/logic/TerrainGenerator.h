@@ -0,0 +1,154 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <vector>
+#include <cstdint>
+#include <SFML/System.hpp>
+
+//--------------------------------------------------------------------------
+
+#include "Grid.h"
+#include "JobSystem.h"
+
+//--------------------------------------------------------------------------
+
+/*!
+* \brief Parameters of generated terrain
+*/
+struct TerrainSettings
+{
+	uint32_t seed{ 0u };					///< the same seed always gives the same map
+	float waterLevel{ 0.32f };				///< tiles with lower elevation are shallow water
+	float forestLevel{ 0.6f };				///< tiles with higher forest noise are forest floor
+	unsigned int treeDensity{ 60u };		///< percent of forest tiles with tree
+	unsigned int resourceRegion{ 32u };		///< size of square region which can hold one resource cluster
+	unsigned int resourceChance{ 40u };		///< percent of regions with resource cluster
+};
+
+//--------------------------------------------------------------------------
+
+/*!
+* \brief Seeded generator of elevation, forests and resource clusters
+*
+* Every tile is a pure function of the seed and it's position: elevation and forests come from fractal value noise,
+* resource clusters are placed one per region with centers chosen by hash of the region. Chunks are generated in
+* parallel into separate buffers and installed into the grid on calling thread, so the map doesn't depend on amount
+* of worker threads or order of jobs.
+*
+* Generation can be split into steps, so loading screen can be redrawn between them.
+*
+* Usage example:
+* \code
+* TerrainGenerator generator(settings, grid);
+* while (!generator.step(jobs, sf::milliseconds(10)))
+*     loadingScreen.setStatus("Generating terrain... " + std::to_string(generator.getProgress()) + "%");
+* grid.publishChanges();
+* \endcode
+*
+*/
+class TerrainGenerator
+{
+public:
+	static constexpr unsigned int BATCH_CHUNKS = 256;	///< amount of chunks generated by one batch of parallel jobs
+	static constexpr std::size_t JOB_CHUNKS = 16;		///< amount of chunks generated by one job
+
+	/*!
+	* \brief Default constructor
+	*
+	* \param settings Parameters of terrain
+	* \param grid Filled grid, it must outlive generator
+	*
+	*/
+	TerrainGenerator(const TerrainSettings & settings, Grid & grid);
+
+	/*!
+	* \brief Generate batches of chunks until time budget is used
+	*
+	* \param jobs Job system which executes batches, calling thread helps with the work
+	* \param budget Time after which no new batch is started
+	*
+	* \return True if all chunks are generated
+	*
+	*/
+	bool step(logic::JobSystem & jobs, sf::Time budget);
+
+	/*!
+	* \brief Generate all remaining chunks
+	*/
+	void generate(logic::JobSystem & jobs);
+
+	inline bool isFinished() const { return m_nextChunk == m_chunkCount; }
+
+	/*!
+	* \brief Return percent of generated chunks
+	*/
+	inline unsigned int getProgress() const { return m_nextChunk * 100u / m_chunkCount; }
+
+	inline const TerrainSettings & getSettings() const { return m_settings; }
+
+	/*!
+	* \brief Fill object types, terrain and heights of one chunk
+	*
+	* \param chunkIndex Index of the chunk (chunk_x + chunk_y*chunkGridSize.x)
+	* \param chunk Filled chunk
+	*
+	*/
+	void generateChunk(unsigned int chunkIndex, GridChunk & chunk) const;
+
+private:
+	/*!
+	* \brief Generate one batch of chunks and install it into the grid
+	*/
+	void generateBatch(logic::JobSystem & jobs);
+
+	/*!
+	* \brief Fractal value noise in range [0, 1)
+	*
+	* \param salt Value mixed with seed, different salts give independent noises
+	* \param cellSize Size of the biggest octave in tiles
+	* \param octaves Amount of octaves, every next one has half cell size and half weight
+	*
+	*/
+	float fractalNoise(uint32_t salt, int x, int y, int cellSize, int octaves) const;
+
+	/*!
+	* \brief Value noise of one octave in range [0, 1)
+	*/
+	float valueNoise(uint32_t salt, int x, int y, int cellSize) const;
+
+	/*!
+	* \brief Return true if tile belongs to resource cluster of it's region
+	*/
+	bool isResource(int x, int y) const;
+
+	/*!
+	* \brief Hash of seed, salt and position
+	*/
+	uint32_t hash(uint32_t salt, int x, int y) const;
+
+private:
+	TerrainSettings m_settings;				///< parameters of terrain
+	Grid & m_grid;							///< filled grid
+	unsigned int m_chunkCount;				///< amount of chunks of the grid
+	unsigned int m_nextChunk{ 0u };			///< first chunk which is not generated yet
+	std::vector<GridChunk> m_batch;			///< chunks of current batch
+};
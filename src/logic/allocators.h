@@ -23,10 +23,15 @@
 #include <vector>
 #include <bitset>
 #include <algorithm>
+#include <cassert>
 #include <SFML/Graphics.hpp>
 
 //--------------------------------------------------------------------------
 
+#include "defines.h"
+
+//--------------------------------------------------------------------------
+
 namespace logic
 {
 	/*!
@@ -37,9 +42,10 @@ namespace logic
 	{
 	public:
 		BinaryHeapTiles<T>(sf::Vector2i gridSize) :
-			m_items(gridSize.x*gridSize.y), m_gridSize{ gridSize }
+			m_items(gridSize.x*gridSize.y), m_positions(gridSize.x*gridSize.y), m_gridSize{ gridSize }
 		{
 			static_assert(std::is_pointer<T>::value, "BinaryHeapTiles expects a pointer T* ");
+			assert(static_cast<unsigned int>(gridSize.x*gridSize.y) <= GRID_SIZE*GRID_SIZE); // bitset of tiles has static size
 		}
 
 		/*!
@@ -61,37 +67,41 @@ namespace logic
 		/*!
 		* \brief Adds new element to the heap
 		*
+		* If element is already inside the heap then it's position is updated instead. This should be used
+		* after lowering cost of element which is already in the heap (decrease key operation).
+		*
 		* \param item Pointer to added element
 		*
 		*/
 		void add(T item)
 		{
-			unsigned int index = item->getY()*m_gridSize.x + item->getX();
-			m_isSet[index] = true;
-			m_items[m_index] = item;
+			unsigned int tileIndex = item->getY()*m_gridSize.x + item->getX();
+			unsigned int index;
+			if (m_isSet[tileIndex])
+			{
+				index = m_positions[tileIndex];
+			}
+			else
+			{
+				m_isSet[tileIndex] = true;
+				index = m_index;
+				m_items[index] = item;
+				m_positions[tileIndex] = index;
+				++m_index;
+			}
 
-			// check if new item is not on top of the heap
-			if (m_index != 0)
+			// move item up until it's cost is not lower than it's parent cost
+			while (index != 0)
 			{
-				while (true)
+				unsigned int parentIndex = getParent(index);
+				if (*m_items[index] < *m_items[parentIndex])
 				{
-					unsigned int parentIndex = getParent(m_index);
-					// check if item's cost is lower than it's parent cost
-					if (*m_items[m_index] < *m_items[parentIndex])
-					{
-						std::swap(m_items[m_index], m_items[parentIndex]);
-					}
-					else
-						break;
-
-					if (parentIndex == 0)
-						break;
-					else
-						m_index = parentIndex;
+					swapItems(index, parentIndex);
+					index = parentIndex;
 				}
+				else
+					break;
 			}
-
-			++m_index;
 		}
 
 		/*!
@@ -105,48 +115,32 @@ namespace logic
 			T item = m_items[index];
 			unsigned int idx = item->getY()*m_gridSize.x + item->getX();
 			m_isSet[idx] = false;
-			m_items[index] = m_items[m_index - 1];
+
+			--m_index;
+			if (index == m_index)
+				return;
+
+			m_items[index] = m_items[m_index];
+			m_positions[m_items[index]->getY()*m_gridSize.x + m_items[index]->getX()] = index;
 
 			while (true)
 			{
-				int leftChildIndex = getChildLeft(index);
+				unsigned int leftChildIndex = getChildLeft(index);
 				if (leftChildIndex >= m_index)
 					break;
-				int rightChildIndex = getChildRight(index);
-				if (rightChildIndex >= m_index)
+				unsigned int rightChildIndex = getChildRight(index);
+				unsigned int smallerChild = leftChildIndex;
+				if (rightChildIndex < m_index && *m_items[rightChildIndex] < *m_items[leftChildIndex])
+					smallerChild = rightChildIndex;
+
+				if (*m_items[smallerChild] < *m_items[index])
 				{
-					if ((*m_items[leftChildIndex] < *m_items[index]) == true)
-					{
-						std::swap(m_items[leftChildIndex], m_items[index]);
-					}
-					break;;
+					swapItems(smallerChild, index);
+					index = smallerChild;
 				}
 				else
-				{
-					if ((*m_items[leftChildIndex] < *m_items[index]) == true)
-					{
-						if ((*m_items[leftChildIndex] < *m_items[rightChildIndex]) == true)
-						{
-							std::swap(m_items[leftChildIndex], m_items[index]);
-							index = leftChildIndex;
-						}
-						else
-						{
-							std::swap(m_items[rightChildIndex], m_items[index]);
-							index = rightChildIndex;
-						}
-					}
-					else if ((*m_items[rightChildIndex] < *m_items[index]) == true)
-					{
-						std::swap(m_items[rightChildIndex], m_items[index]);
-						index = rightChildIndex;
-					}
-					else
-						break;
-				}
+					break;
 			}
-
-			--m_index;
 		}
 
 		/*!
@@ -205,8 +199,19 @@ namespace logic
 			return m_items[index];
 		}
 
+		/*!
+		* \brief Swap two elements of the heap and update their saved positions
+		*/
+		void swapItems(unsigned int indexA, unsigned int indexB)
+		{
+			std::swap(m_items[indexA], m_items[indexB]);
+			m_positions[m_items[indexA]->getY()*m_gridSize.x + m_items[indexA]->getX()] = indexA;
+			m_positions[m_items[indexB]->getY()*m_gridSize.x + m_items[indexB]->getX()] = indexB;
+		}
+
 	private:
 		std::vector<T> m_items;						///< main vector container
+		std::vector<unsigned int> m_positions;		///< position inside m_items of every tile which is inside container
 		unsigned int m_index{ 0u };					///< current logic size of the vector container
 		std::bitset<GRID_SIZE*GRID_SIZE> m_isSet;	///< bitset of all tiles - true means that tile is already inside container
 		sf::Vector2i m_gridSize;					///< size of the grid
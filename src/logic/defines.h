@@ -28,10 +28,16 @@ constexpr unsigned int WIN_WIDTH = 800;
 constexpr unsigned int WIN_HEIGHT = 600;
 constexpr unsigned int CHUNK_SIZE = 8;
 constexpr unsigned int GRID_SIZE = 256;
+constexpr unsigned int MAX_CLEARANCE = CHUNK_SIZE;
+constexpr unsigned int MAX_PLAYERS = 8;
 
 constexpr unsigned int WIN_WIDTH_MENU = 800;
 constexpr unsigned int WIN_HEIGHT_MENU = 600;
 
+constexpr unsigned int SIMULATION_RATE = 20;		///< simulation steps per second, independent of frame rate
+constexpr unsigned int MAX_SIMULATION_STEPS = 5;	///< maximum steps simulated in one frame, longer lag is dropped
+constexpr float TILE_PIXELS = 32.f;					///< size of one grid tile on the screen in pixels
+
 //--------------------------------------------------------------------------
 
 /*!
@@ -18,13 +18,168 @@
 
 //--------------------------------------------------------------------------
 
+#include <string>
+
+//--------------------------------------------------------------------------
+
 #include "GameEngine.h"
 #include "gui/EventHandler.h"
+#include "tester/PathingFuzzer.h"
+#include "tester/LockstepTester.h"
+#include "tester/AiTester.h"
+#include "tester/WorldTester.h"
+#include "tester/SightTester.h"
+#include "tester/BlockedAreaTester.h"
+#include "tester/KernelTester.h"
+#include "tester/TerrainTester.h"
+#include "logic/MapFile.h"
 
 //--------------------------------------------------------------------------
 
 int main(int argc, char* argv[])
 {
+	// Path finding regression run, usage: --fuzz-pathing [grid count] [golden file] [--update-golden]
+	if (argc > 1 && std::string(argv[1]) == "--fuzz-pathing")
+	{
+		unsigned int gridCount = argc > 2 ? std::stoul(argv[2]) : 2000u;
+		std::string goldenPath = argc > 3 ? argv[3] : "";
+		bool updateGolden = argc > 4 && std::string(argv[4]) == "--update-golden";
+
+		tester::PathingFuzzer fuzzer(20180u);
+		auto report = fuzzer.run(gridCount, goldenPath, updateGolden);
+		std::cout << "PathingFuzzer: " << report.cases << " cases, " << report.invalidPaths << " invalid, "
+			<< report.suboptimalPaths << " suboptimal, " << report.goldenMismatches << " golden mismatches, " << report.rectangleSearches
+			<< " rectangle searches" << std::endl;
+		return report.passed() ? 0 : 1;
+	}
+
+	// Line of sight regression run, usage: --test-sight [grid count]
+	if (argc > 1 && std::string(argv[1]) == "--test-sight")
+	{
+		unsigned int gridCount = argc > 2 ? std::stoul(argv[2]) : 500u;
+
+		tester::SightTester tester(20180u);
+		auto report = tester.run(gridCount);
+		std::cout << "SightTester: " << report.rays << " rays, " << report.visible << " visible, " << report.mismatches << " mismatches, "
+			<< report.skippedChunks << " skipped chunks" << std::endl;
+		return report.passed() ? 0 : 1;
+	}
+
+	// Blocked area table regression run, usage: --test-areas [grid count]
+	if (argc > 1 && std::string(argv[1]) == "--test-areas")
+	{
+		unsigned int gridCount = argc > 2 ? std::stoul(argv[2]) : 200u;
+
+		tester::BlockedAreaTester tester(20180u);
+		auto report = tester.run(gridCount);
+		std::cout << "BlockedAreaTester: " << report.grids << " grids, " << report.edits << " edits, " << report.rectangles << " rectangles, "
+			<< report.mismatches << " mismatches" << std::endl;
+		return report.passed() ? 0 : 1;
+	}
+
+	// SIMD kernel equivalence run, usage: --test-kernels [crowd count]
+	if (argc > 1 && std::string(argv[1]) == "--test-kernels")
+	{
+		unsigned int caseCount = argc > 2 ? std::stoul(argv[2]) : 200u;
+
+		tester::KernelTester tester(20180u);
+		auto report = tester.run(caseCount);
+		std::cout << "KernelTester: " << report.units << " units, " << report.cells << " cells, " << report.kernels << " vector kernels, "
+			<< report.steeringMismatches << " steering mismatches, " << report.influenceMismatches << " influence mismatches, "
+			<< report.stuckUnits << " stuck units" << std::endl;
+		return report.passed() ? 0 : 1;
+	}
+
+	// Terrain determinism run, usage: --test-terrain [map count]
+	if (argc > 1 && std::string(argv[1]) == "--test-terrain")
+	{
+		unsigned int mapCount = argc > 2 ? std::stoul(argv[2]) : 50u;
+
+		tester::TerrainTester tester(20180u);
+		auto report = tester.run(mapCount);
+		std::cout << "TerrainTester: " << report.maps << " maps, " << report.chunks << " chunks, " << report.workers << " workers, "
+			<< report.mismatchedChunks << " mismatched chunks" << std::endl;
+		return report.passed() ? 0 : 1;
+	}
+
+	// Map conversion, usage: --convert-map <image> <output map> [height image]
+	if (argc > 3 && std::string(argv[1]) == "--convert-map")
+	{
+		try
+		{
+			MapFile::convertImage(argv[2], argc > 4 ? argv[4] : "", argv[3]);
+		}
+		catch (const std::runtime_error & error)
+		{
+			std::cout << error.what() << std::endl;
+			return 1;
+		}
+		std::cout << "Map written to " << argv[3] << std::endl;
+		return 0;
+	}
+
+	// Lockstep synchronization check, usage: --test-lockstep [ticks] [udp base port]
+	if (argc > 1 && std::string(argv[1]) == "--test-lockstep")
+	{
+		unsigned int ticks = argc > 2 ? std::stoul(argv[2]) : 2000u;
+		unsigned short basePort = static_cast<unsigned short>(argc > 3 ? std::stoul(argv[3]) : 47000u);
+		bool passed = true;
+
+		// the same game with different amount of commands per turn shows that input frequency doesn't slow the simulation
+		tester::LockstepTester tester(20180u);
+		auto print = [&passed](const char * transport, unsigned int commandsPerTurn, const tester::LockstepTester::Report & report)
+		{
+			std::cout << "Lockstep " << transport << ": " << report.players << " players, " << commandsPerTurn << " commands per turn, "
+				<< report.commands << " commands, " << report.stalledSteps << " stalled steps, " << report.desyncs << " desyncs, "
+				<< report.hashMismatches << " final hash mismatches, " << report.ticksPerSecond() << " ticks/s"
+				<< (report.finished ? "" : ", timed out") << std::endl;
+			passed &= report.passed();
+		};
+
+		for (unsigned int commandsPerTurn : { 0u, 1u, 8u, 32u })
+			print("loopback", commandsPerTurn, tester.runLoopback(2u, ticks, commandsPerTurn, 7u));
+
+		try
+		{
+			print("udp", 8u, tester.runUdp(2u, ticks, 8u, basePort));
+		}
+		catch (const std::runtime_error & error)
+		{
+			std::cout << error.what() << std::endl;
+			passed = false;
+		}
+		return passed ? 0 : 1;
+	}
+
+	// Time budget check of computer players, usage: --test-ai [ticks]
+	if (argc > 1 && std::string(argv[1]) == "--test-ai")
+	{
+		unsigned int ticks = argc > 2 ? std::stoul(argv[2]) : 6000u;
+
+		tester::AiTester tester(20180u);
+		auto report = tester.run(MAX_PLAYERS, ticks, sf::microseconds(ai::Scheduler::DEFAULT_BUDGET));
+		std::cout << "AI: " << report.players << " players, " << report.ticks << " ticks, budget " << report.budgetMilliseconds << " ms, "
+			<< report.commands << " commands, " << report.units << " units, " << report.resumes << " resumes, average "
+			<< report.averageMilliseconds << " ms, max " << report.maxMilliseconds << " ms, " << report.overruns << " overruns" << std::endl;
+		return report.passed() ? 0 : 1;
+	}
+
+	// Checks of entity systems, usage: --test-world
+	if (argc > 1 && std::string(argv[1]) == "--test-world")
+	{
+		tester::WorldTester tester;
+		auto report = tester.run();
+		std::cout << "World: " << report.checks << " checks, " << report.failures << " failures" << std::endl;
+		return report.passed() ? 0 : 1;
+	}
+
+	// Headless replay verification and benchmark, usage: --play-replay <replay file>
+	if (argc > 2 && std::string(argv[1]) == "--play-replay")
+	{
+		GameEngine engine;
+		return engine.playReplay(argv[2]);
+	}
+
 	GameEngine engine;
 	int code = engine.run();
 
@@ -0,0 +1,323 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//--------------------------------------------------------------------------
+
+#include "Lockstep.h"
+
+//--------------------------------------------------------------------------
+
+#include <algorithm>
+#include <stdexcept>
+
+//--------------------------------------------------------------------------
+
+using namespace network;
+
+constexpr uint8_t Lockstep::PACKET_TURNS;
+constexpr std::size_t Lockstep::PACKET_SIZE;
+
+//--------------------------------------------------------------------------
+
+Lockstep::Lockstep(const LockstepSettings & settings, ecs::Simulation & simulation, Transport & transport) :
+	m_settings(settings),
+	m_simulation(simulation),
+	m_transport(transport)
+{
+	if (settings.playerCount == 0u || settings.playerCount + settings.computerPlayers > MAX_PLAYERS || settings.localPlayer >= settings.playerCount ||
+		settings.turnTicks == 0u)
+		throw std::runtime_error("Lockstep - invalid settings");
+	if (simulation.getTick() % settings.turnTicks != 0u)
+		throw std::runtime_error("Lockstep - simulation must start at the beginning of turn");
+
+	m_firstTurn = simulation.getTick() / settings.turnTicks;
+	m_nextBegun = m_firstTurn;
+	m_nextExecuted = m_firstTurn;
+
+	// peer can be inputDelay turns ahead and sends batches inputDelay turns ahead of itself
+	m_turns.resize(2u * settings.inputDelay + 2u);
+	for (uint32_t i = 0; i < m_turns.size(); ++i)
+	{
+		Turn & turn = m_turns[i];
+		turn.turn = m_firstTurn + i;
+		turn.receivedPlayers = i < settings.inputDelay ? allPlayers() : 0u;
+		turn.commands.resize(settings.playerCount);
+		turn.hashes.resize(settings.playerCount, 0u);
+	}
+
+	m_hashes.resize(settings.inputDelay + 1u, 0u);
+	m_received.resize(settings.playerCount, m_firstTurn + settings.inputDelay);
+	m_acknowledged.resize(settings.playerCount, m_firstTurn + settings.inputDelay);
+}
+
+//--------------------------------------------------------------------------
+
+void Lockstep::issue(const ecs::Command & command)
+{
+	m_issued.push_back(command);
+	m_issued.back().player = m_settings.localPlayer;
+}
+
+//--------------------------------------------------------------------------
+
+void Lockstep::issueComputer(const ecs::Command & command)
+{
+	if (m_settings.localPlayer != 0u || !isComputer(command.player))
+		throw std::runtime_error("Lockstep - only player 0 can issue commands of computer players");
+	m_issued.push_back(command);
+}
+
+//--------------------------------------------------------------------------
+
+bool Lockstep::step(logic::JobSystem & jobs)
+{
+	receivePackets();
+
+	uint32_t tick = m_simulation.getTick();
+	if (tick % m_settings.turnTicks == 0u)
+	{
+		uint32_t turn = tick / m_settings.turnTicks;
+		if (turn == m_nextBegun)
+			beginTurn(turn);
+
+		if (getTurn(turn).receivedPlayers != allPlayers())
+		{
+			// repeat batches, because waiting may be caused by lost acknowledgement
+			++m_stalledSteps;
+			sendBatches();
+			return false;
+		}
+		executeTurn(turn);
+	}
+
+	m_simulation.step(jobs);
+	return true;
+}
+
+//--------------------------------------------------------------------------
+
+void Lockstep::poll()
+{
+	receivePackets();
+	if (!m_outgoing.empty())
+		sendBatches();
+}
+
+//--------------------------------------------------------------------------
+
+void Lockstep::beginTurn(uint32_t turn)
+{
+	// single player has nobody to compare hashes with
+	uint32_t hash = m_settings.playerCount > 1u ? ecs::ReplayWriter::foldHash(m_simulation.computeHash()) : 0u;
+	m_hashes[turn % m_hashes.size()] = hash;
+
+	uint32_t target = turn + m_settings.inputDelay;
+	uint8_t local = m_settings.localPlayer;
+	Turn & slot = getTurn(target);
+	slot.commands[local].swap(m_issued);
+	m_issued.clear();
+	removeSuperseded(slot.commands[local]);
+	slot.hashes[local] = hash;
+	slot.receivedPlayers |= 1u << local;
+	m_received[local] = target + 1u;
+
+	OutgoingBatch batch{ target, {} };
+	logic::ByteWriter writer(batch.data);
+	writer.writeUint32(hash);
+	writer.writeVarint(slot.commands[local].size());
+	for (const ecs::Command & command : slot.commands[local])
+		ecs::writeCommand(writer, command);
+	m_outgoing.push_back(std::move(batch));
+
+	++m_nextBegun;
+	releaseAcknowledged();
+	sendBatches();
+}
+
+//--------------------------------------------------------------------------
+
+void Lockstep::removeSuperseded(std::vector<ecs::Command> & commands)
+{
+	// commands of one batch are executed in the same tick, so only the last order of entities has any effect
+	auto isOrder = [](const ecs::Command & command)
+	{
+		return command.type == ecs::Command::Type::MOVE || command.type == ecs::Command::Type::STOP;
+	};
+
+	std::size_t kept = 0u;
+	for (std::size_t i = 0; i < commands.size(); ++i)
+	{
+		bool superseded = false;
+		for (std::size_t j = i + 1u; j < commands.size() && !superseded && isOrder(commands[i]); ++j)
+			superseded = isOrder(commands[j]) && commands[j].entities == commands[i].entities;
+
+		if (superseded)
+			continue;
+		if (kept != i)
+			commands[kept] = std::move(commands[i]);
+		++kept;
+	}
+	commands.resize(kept);
+}
+
+//--------------------------------------------------------------------------
+
+void Lockstep::executeTurn(uint32_t turn)
+{
+	Turn & slot = getTurn(turn);
+	for (uint8_t player = 0; player < m_settings.playerCount; ++player)
+	{
+		for (ecs::Command & command : slot.commands[player])
+		{
+			// commands of the batch can order only entities of the player who sent it, player 0 orders also computer players
+			if (player != 0u || !isComputer(command.player))
+				command.player = player;
+			if (m_replay != nullptr)
+				m_replay->record(m_simulation.getTick(), command);
+			m_simulation.execute(command);
+		}
+		slot.commands[player].clear();
+	}
+
+	// batch executed in this turn was sent inputDelay turns ago with hash of that turn
+	if (turn >= m_firstTurn + m_settings.inputDelay && !m_desynchronized)
+	{
+		uint32_t sentTurn = turn - m_settings.inputDelay;
+		uint32_t expected = m_hashes[sentTurn % m_hashes.size()];
+		for (uint8_t player = 0; player < m_settings.playerCount; ++player)
+		{
+			if (slot.hashes[player] != expected)
+			{
+				m_desynchronized = true;
+				m_desyncTurn = sentTurn;
+			}
+		}
+	}
+
+	slot.turn = turn + static_cast<uint32_t>(m_turns.size());
+	slot.receivedPlayers = 0u;
+	++m_nextExecuted;
+}
+
+//--------------------------------------------------------------------------
+
+void Lockstep::sendBatches()
+{
+	if (m_settings.playerCount == 1u)
+		return;
+
+	m_packet.clear();
+	logic::ByteWriter writer(m_packet);
+	writer.writeByte(PACKET_TURNS);
+	writer.writeByte(m_settings.localPlayer);
+	writer.writeByte(m_settings.playerCount);
+	for (uint32_t received : m_received)
+		writer.writeVarint(received);
+
+	// batches are consecutive turns, so only the first turn and count are stored
+	std::size_t count = 0u;
+	std::size_t size = m_packet.size();
+	while (count < m_outgoing.size() && (count == 0u || size + m_outgoing[count].data.size() <= PACKET_SIZE))
+		size += m_outgoing[count++].data.size();
+
+	writer.writeVarint(m_outgoing.empty() ? m_received[m_settings.localPlayer] : m_outgoing.front().turn);
+	writer.writeVarint(count);
+	for (std::size_t i = 0; i < count; ++i)
+		m_packet.insert(m_packet.end(), m_outgoing[i].data.begin(), m_outgoing[i].data.end());
+
+	m_transport.send(m_packet);
+}
+
+//--------------------------------------------------------------------------
+
+void Lockstep::receivePackets()
+{
+	while (m_transport.receive(m_packet))
+	{
+		try
+		{
+			readPacket(m_packet);
+		}
+		catch (const std::runtime_error &)
+		{
+			// truncated packet is the same as lost one, valid batches will be repeated
+		}
+	}
+	releaseAcknowledged();
+}
+
+//--------------------------------------------------------------------------
+
+void Lockstep::readPacket(const std::vector<uint8_t> & packet)
+{
+	logic::ByteReader reader(packet.data(), packet.size());
+	if (reader.readByte() != PACKET_TURNS)
+		return;
+
+	uint8_t player = reader.readByte();
+	uint8_t playerCount = reader.readByte();
+	if (playerCount != m_settings.playerCount || player >= playerCount || player == m_settings.localPlayer)
+		return;
+
+	for (uint8_t i = 0; i < playerCount; ++i)
+	{
+		uint32_t received = static_cast<uint32_t>(reader.readVarint());
+		if (i == m_settings.localPlayer)
+			m_acknowledged[player] = std::max(m_acknowledged[player], received);
+	}
+
+	uint32_t turn = static_cast<uint32_t>(reader.readVarint());
+	uint64_t count = reader.readVarint();
+	for (uint64_t i = 0; i < count; ++i, ++turn)
+	{
+		uint32_t hash = reader.readUint32();
+		uint64_t commandCount = reader.readVarint();
+		if (commandCount > reader.getRemaining())
+			throw std::runtime_error("Lockstep - corrupted batch");
+
+		// only the next missing batch is stored, batches after lost ones are repeated by the sender
+		bool accepted = turn == m_received[player] && turn < m_nextExecuted + m_turns.size();
+		std::vector<ecs::Command> & commands = accepted ? getTurn(turn).commands[player] : m_discarded;
+		commands.resize(static_cast<std::size_t>(commandCount));
+		for (ecs::Command & command : commands)
+			ecs::readCommand(reader, command);
+
+		if (accepted)
+		{
+			Turn & slot = getTurn(turn);
+			slot.hashes[player] = hash;
+			slot.receivedPlayers |= 1u << player;
+			++m_received[player];
+		}
+	}
+}
+
+//--------------------------------------------------------------------------
+
+void Lockstep::releaseAcknowledged()
+{
+	uint32_t acknowledged = m_received[m_settings.localPlayer];
+	for (uint8_t player = 0; player < m_settings.playerCount; ++player)
+	{
+		if (player != m_settings.localPlayer)
+			acknowledged = std::min(acknowledged, m_acknowledged[player]);
+	}
+
+	while (!m_outgoing.empty() && m_outgoing.front().turn < acknowledged)
+		m_outgoing.pop_front();
+}
@@ -0,0 +1,220 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <deque>
+#include <vector>
+#include <cstdint>
+
+//--------------------------------------------------------------------------
+
+#include "Transport.h"
+#include "../ecs/Simulation.h"
+#include "../ecs/Replay.h"
+#include "../logic/JobSystem.h"
+
+//--------------------------------------------------------------------------
+
+namespace network
+{
+	/*!
+	* \brief Parameters of lockstep game, must be the same for every player
+	*/
+	struct LockstepSettings
+	{
+		uint8_t playerCount{ 1u };		///< amount of players in the game
+		uint8_t localPlayer{ 0u };		///< player controlled on this computer
+		uint32_t turnTicks{ 2u };		///< simulation ticks in one turn
+		uint32_t inputDelay{ 2u };		///< turns between turn in which command is issued and turn in which it's executed
+		uint8_t computerPlayers{ 0u };	///< amount of computer players, their ids follow human players and player 0 runs their AI
+	};
+
+	//--------------------------------------------------------------------------
+
+	/*!
+	* \brief Executes commands of all players in the same ticks on every computer
+	*
+	* Time is divided into turns of turnTicks ticks. Commands issued during turn T are collected to one batch which is
+	* sent at the beginning of turn T+1 and executed by every player at the first tick of turn T+1+inputDelay, so
+	* batch has inputDelay turns to arrive. Simulation stops at the beginning of turn until batches of all players
+	* for the turn are received, so it never diverges. Amount of packets doesn't depend on amount of commands and orders
+	* which are replaced by later order of the same entities in the same batch are never sent, so a player who clicks
+	* faster than turns pass doesn't make the simulation slower.
+	*
+	* Every batch carries state hash of the turn in which it was sent, hashes of all players are compared when the batch
+	* is executed, so the first desynchronized turn is detected inputDelay turns after it happened.
+	*
+	* Transport can lose packets: every packet repeats all batches not acknowledged by all peers yet and acknowledges
+	* batches received from every player. Batches are resent also while the simulation waits for other players.
+	*
+	* Usage example:
+	* \code
+	* network::Lockstep lockstep(settings, simulation, transport);
+	* lockstep.issue(command);
+	* ...
+	* if (!lockstep.step(jobs))
+	*     ;	// waiting for other players, step is repeated in the next frame
+	* \endcode
+	*
+	*/
+	class Lockstep
+	{
+	public:
+		static constexpr uint8_t PACKET_TURNS = 0x4C;		///< first byte of packets with turn batches
+		static constexpr std::size_t PACKET_SIZE = 1200u;	///< packets stop growing after this size, so they are never fragmented
+
+		/*!
+		* \brief Default constructor
+		*
+		* \throw std::runtime_error if settings are invalid or simulation isn't at the beginning of turn
+		*
+		*/
+		Lockstep(const LockstepSettings & settings, ecs::Simulation & simulation, Transport & transport);
+
+		/*!
+		* \brief Queue command of the local player, it's executed inputDelay turns after the next turn begins
+		*/
+		void issue(const ecs::Command & command);
+
+		/*!
+		* \brief Queue command of computer player, it's sent in batch of local player together with commands of local player
+		*
+		* \throw std::runtime_error if local player isn't player 0 or command.player isn't computer player
+		*
+		*/
+		void issueComputer(const ecs::Command & command);
+
+		/*!
+		* \brief Receive packets and simulate one tick
+		*
+		* \return False if tick can't be simulated, because batches of other players weren't received yet
+		*
+		*/
+		bool step(logic::JobSystem & jobs);
+
+		/*!
+		* \brief Receive packets and repeat not acknowledged batches without simulating
+		*
+		* Used while the game is paused or finished, so other players still get batches they need.
+		*
+		*/
+		void poll();
+
+		/*!
+		* \brief Record executed commands to replay, nullptr stops recording
+		*/
+		inline void setReplay(ecs::ReplayWriter * replay) { m_replay = replay; }
+
+		inline const LockstepSettings & getSettings() const { return m_settings; }
+		inline bool isComputer(uint8_t player) const
+		{
+			return player >= m_settings.playerCount && player - m_settings.playerCount < m_settings.computerPlayers;
+		}
+		inline uint32_t getTurn() const { return m_nextExecuted; }
+		inline unsigned int getStalledSteps() const { return m_stalledSteps; }
+		inline bool isDesynchronized() const { return m_desynchronized; }
+		inline uint32_t getDesyncTurn() const { return m_desyncTurn; }
+
+	private:
+		/*!
+		* \brief Commands of all players executed at the beginning of one turn
+		*/
+		struct Turn
+		{
+			uint32_t turn{ 0u };								///< turn which is kept in the slot
+			uint32_t receivedPlayers{ 0u };						///< bit mask of players whose batches were received
+			std::vector<std::vector<ecs::Command>> commands;	///< batch of every player
+			std::vector<uint32_t> hashes;						///< state hash sent with batch of every player
+		};
+
+		/*!
+		* \brief Encoded batch of local player waiting for acknowledgement
+		*/
+		struct OutgoingBatch
+		{
+			uint32_t turn;					///< turn in which batch is executed
+			std::vector<uint8_t> data;		///< hash and commands
+		};
+
+		/*!
+		* \brief Compute hash of the turn and send batch of commands collected during previous turn
+		*/
+		void beginTurn(uint32_t turn);
+
+		/*!
+		* \brief Remove moves and stops which are replaced by later move or stop of the same entities in the batch
+		*/
+		static void removeSuperseded(std::vector<ecs::Command> & commands);
+
+		/*!
+		* \brief Execute batches of all players and compare their hashes
+		*/
+		void executeTurn(uint32_t turn);
+
+		/*!
+		* \brief Send acknowledgements and all not acknowledged batches
+		*/
+		void sendBatches();
+
+		/*!
+		* \brief Read all waiting packets, malformed packets are ignored
+		*/
+		void receivePackets();
+
+		/*!
+		* \brief Store batches and acknowledgements from the packet
+		*
+		* \throw std::runtime_error if packet is truncated
+		*
+		*/
+		void readPacket(const std::vector<uint8_t> & packet);
+
+		/*!
+		* \brief Remove batches acknowledged by all peers
+		*/
+		void releaseAcknowledged();
+
+		inline Turn & getTurn(uint32_t turn) { return m_turns[turn % m_turns.size()]; }
+		inline uint32_t allPlayers() const { return static_cast<uint32_t>((1ull << m_settings.playerCount) - 1u); }
+
+	private:
+		LockstepSettings m_settings;			///< parameters of the game
+		ecs::Simulation & m_simulation;			///< simulation driven by the lockstep
+		Transport & m_transport;				///< connection to other players
+		ecs::ReplayWriter * m_replay{ nullptr };	///< recorder of executed commands
+
+		std::vector<Turn> m_turns;				///< ring of turns which can be received, starting with m_nextExecuted
+		std::vector<uint32_t> m_hashes;			///< ring of own hashes of last inputDelay + 1 turns
+		std::vector<uint32_t> m_received;		///< next turn expected from every player
+		std::vector<uint32_t> m_acknowledged;	///< next turn which wasn't acknowledged by every player
+		std::deque<OutgoingBatch> m_outgoing;	///< batches of local player which weren't acknowledged by all peers
+		std::vector<ecs::Command> m_issued;		///< commands of local player issued during current turn
+		std::vector<ecs::Command> m_discarded;	///< commands read from repeated batches
+		std::vector<uint8_t> m_packet;			///< packet which is being sent or received
+
+		uint32_t m_firstTurn;					///< turn in which lockstep started, following inputDelay turns are empty
+		uint32_t m_nextBegun;					///< next turn which wasn't begun yet
+		uint32_t m_nextExecuted;				///< next turn which wasn't executed yet
+		unsigned int m_stalledSteps{ 0u };		///< amount of steps which waited for other players
+		bool m_desynchronized{ false };			///< hashes of some turn were different
+		uint32_t m_desyncTurn{ 0u };			///< first turn with different hashes
+	};
+}
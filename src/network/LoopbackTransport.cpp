@@ -0,0 +1,75 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//--------------------------------------------------------------------------
+
+#include "LoopbackTransport.h"
+
+//--------------------------------------------------------------------------
+
+using namespace network;
+
+//--------------------------------------------------------------------------
+
+LoopbackNetwork::LoopbackNetwork(unsigned int endpointCount, unsigned int dropInterval) :
+	m_dropInterval(dropInterval)
+{
+	for (unsigned int i = 0; i < endpointCount; ++i)
+		m_endpoints.push_back(std::make_unique<Endpoint>(*this));
+}
+
+//--------------------------------------------------------------------------
+
+void LoopbackNetwork::Endpoint::send(const std::vector<uint8_t> & packet)
+{
+	for (auto & endpoint : m_network.m_endpoints)
+	{
+		if (endpoint.get() == this)
+			continue;
+
+		unsigned int copied = ++m_network.m_copiedPackets;
+		if (m_network.m_dropInterval != 0u && copied % m_network.m_dropInterval == 0u)
+		{
+			++m_network.m_droppedPackets;
+			continue;
+		}
+
+		endpoint->deliver(packet);
+	}
+}
+
+//--------------------------------------------------------------------------
+
+bool LoopbackNetwork::Endpoint::receive(std::vector<uint8_t> & packet)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_inbox.empty())
+		return false;
+
+	packet.swap(m_inbox.front());
+	m_inbox.pop_front();
+	return true;
+}
+
+//--------------------------------------------------------------------------
+
+void LoopbackNetwork::Endpoint::deliver(const std::vector<uint8_t> & packet)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_inbox.push_back(packet);
+}
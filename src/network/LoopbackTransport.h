@@ -0,0 +1,101 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+//--------------------------------------------------------------------------
+
+#include "Transport.h"
+
+//--------------------------------------------------------------------------
+
+namespace network
+{
+	/*!
+	* \brief In-process network of transports, used by single player games and tests
+	*
+	* Every endpoint is a Transport of one player, packet sent by one endpoint is copied to inboxes of all others.
+	* Endpoints can be used from different threads. Network can drop every n-th packet, so code which
+	* depends on retransmission can be tested without real network.
+	*
+	* Usage example:
+	* \code
+	* network::LoopbackNetwork loopback(2u);
+	* network::Lockstep first(settings, firstSimulation, loopback.getEndpoint(0));
+	* network::Lockstep second(settings, secondSimulation, loopback.getEndpoint(1));
+	* \endcode
+	*
+	*/
+	class LoopbackNetwork
+	{
+	public:
+		/*!
+		* \brief Default constructor
+		*
+		* \param endpointCount Amount of connected transports
+		* \param dropInterval Every dropInterval-th copied packet is lost, 0 means that no packet is lost
+		*
+		*/
+		LoopbackNetwork(unsigned int endpointCount, unsigned int dropInterval = 0u);
+
+		inline Transport & getEndpoint(unsigned int index) { return *m_endpoints.at(index); }
+		inline unsigned int getEndpointCount() const { return static_cast<unsigned int>(m_endpoints.size()); }
+		inline unsigned int getDroppedPackets() const { return m_droppedPackets; }
+
+	private:
+		/*!
+		* \brief Transport of one endpoint
+		*/
+		class Endpoint : public Transport
+		{
+		public:
+			explicit Endpoint(LoopbackNetwork & network) :
+				m_network(network)
+			{
+			}
+
+			virtual void send(const std::vector<uint8_t> & packet) override;
+			virtual bool receive(std::vector<uint8_t> & packet) override;
+
+			/*!
+			* \brief Store copy of packet sent by other endpoint
+			*/
+			void deliver(const std::vector<uint8_t> & packet);
+
+		private:
+			LoopbackNetwork & m_network;					///< network which owns the endpoint
+			std::mutex m_mutex;								///< guards m_inbox
+			std::deque<std::vector<uint8_t>> m_inbox;		///< packets not received yet
+		};
+
+	private:
+		std::vector<std::unique_ptr<Endpoint>> m_endpoints;	///< all connected transports
+		unsigned int m_dropInterval;						///< every dropInterval-th packet is lost, 0 disables losses
+		std::atomic<unsigned int> m_copiedPackets{ 0u };	///< amount of packets copied to inboxes
+		std::atomic<unsigned int> m_droppedPackets{ 0u };	///< amount of lost packets
+	};
+}
@@ -0,0 +1,57 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <vector>
+#include <cstdint>
+
+//--------------------------------------------------------------------------
+
+namespace network
+{
+	/*!
+	* \brief Unreliable delivery of packets between players of one game
+	*
+	* Packets can be lost, duplicated or reordered, users of the transport must handle it themselves. Both calls never
+	* block, so transport can be polled from the game loop.
+	*
+	*/
+	class Transport
+	{
+	public:
+		virtual ~Transport() = default;
+
+		/*!
+		* \brief Send packet to all other players
+		*/
+		virtual void send(const std::vector<uint8_t> & packet) = 0;
+
+		/*!
+		* \brief Take next received packet
+		*
+		* \param packet Filled with received packet, its capacity is reused
+		*
+		* \return False if no packet is waiting
+		*
+		*/
+		virtual bool receive(std::vector<uint8_t> & packet) = 0;
+	};
+}
@@ -0,0 +1,90 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//--------------------------------------------------------------------------
+
+#include "UdpTransport.h"
+
+//--------------------------------------------------------------------------
+
+#include <string>
+#include <stdexcept>
+
+//--------------------------------------------------------------------------
+
+using namespace network;
+
+//--------------------------------------------------------------------------
+
+UdpTransport::UdpTransport(unsigned short localPort, const std::vector<UdpPeer> & peers) :
+	m_peers(peers),
+	m_buffer(sf::UdpSocket::MaxDatagramSize)
+{
+	if (m_socket.bind(localPort) != sf::Socket::Done)
+		throw std::runtime_error("UdpTransport - can't bind port " + std::to_string(localPort));
+	m_socket.setBlocking(false);
+}
+
+//--------------------------------------------------------------------------
+
+UdpTransport::~UdpTransport()
+{
+	m_socket.unbind();
+}
+
+//--------------------------------------------------------------------------
+
+void UdpTransport::send(const std::vector<uint8_t> & packet)
+{
+	if (packet.size() > sf::UdpSocket::MaxDatagramSize)
+		throw std::runtime_error("UdpTransport - packet is too big " + std::to_string(packet.size()));
+
+	// failed send is the same as lost datagram, which must be handled by user of the transport anyway
+	for (const UdpPeer & peer : m_peers)
+		m_socket.send(packet.data(), packet.size(), peer.address, peer.port);
+}
+
+//--------------------------------------------------------------------------
+
+bool UdpTransport::receive(std::vector<uint8_t> & packet)
+{
+	std::size_t received = 0u;
+	sf::IpAddress sender;
+	unsigned short port = 0;
+	while (m_socket.receive(m_buffer.data(), m_buffer.size(), received, sender, port) == sf::Socket::Done)
+	{
+		if (!isPeer(sender, port))
+			continue;
+
+		packet.assign(m_buffer.begin(), m_buffer.begin() + received);
+		return true;
+	}
+	return false;
+}
+
+//--------------------------------------------------------------------------
+
+bool UdpTransport::isPeer(const sf::IpAddress & address, unsigned short port) const
+{
+	for (const UdpPeer & peer : m_peers)
+	{
+		if (peer.port == port && peer.address == address)
+			return true;
+	}
+	return false;
+}
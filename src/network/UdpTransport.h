@@ -0,0 +1,99 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <vector>
+#include <cstdint>
+#include <SFML/Network.hpp>
+
+//--------------------------------------------------------------------------
+
+#include "Transport.h"
+
+//--------------------------------------------------------------------------
+
+namespace network
+{
+	/*!
+	* \brief Address of other player
+	*/
+	struct UdpPeer
+	{
+		sf::IpAddress address;		///< address of the computer
+		unsigned short port;		///< port of UdpTransport on the computer
+	};
+
+	//--------------------------------------------------------------------------
+
+	/*!
+	* \brief Transport over non-blocking UDP socket
+	*
+	* Every packet is one datagram sent to every peer. Datagrams from addresses which aren't peers are ignored.
+	*
+	* Usage example:
+	* \code
+	* network::UdpTransport transport(7000, { { sf::IpAddress::LocalHost, 7001 } });
+	* \endcode
+	*
+	*/
+	class UdpTransport : public Transport
+	{
+	public:
+		/*!
+		* \brief Bind socket to local port
+		*
+		* \param localPort Port of this transport, sf::Socket::AnyPort chooses free port
+		* \param peers Transports of other players
+		*
+		* \throw std::runtime_error if socket can't be bound
+		*
+		*/
+		UdpTransport(unsigned short localPort, const std::vector<UdpPeer> & peers);
+		~UdpTransport();
+
+		/*!
+		* \brief Send packet to every peer, lost datagrams aren't reported
+		*
+		* \throw std::runtime_error if packet doesn't fit into one datagram
+		*
+		*/
+		virtual void send(const std::vector<uint8_t> & packet) override;
+		virtual bool receive(std::vector<uint8_t> & packet) override;
+
+		/*!
+		* \brief Add peer, can be used when port of peer is known after it was bound
+		*/
+		inline void addPeer(const UdpPeer & peer) { m_peers.push_back(peer); }
+
+		inline unsigned short getLocalPort() const { return m_socket.getLocalPort(); }
+
+	private:
+		/*!
+		* \brief Check if datagram was sent by one of peers
+		*/
+		bool isPeer(const sf::IpAddress & address, unsigned short port) const;
+
+	private:
+		sf::UdpSocket m_socket;				///< non-blocking socket bound to local port
+		std::vector<UdpPeer> m_peers;		///< other players
+		std::vector<uint8_t> m_buffer;		///< datagram which is being received
+	};
+}
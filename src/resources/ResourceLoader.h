@@ -35,4 +35,13 @@ namespace Resource
 
         return resource;
     }
+
+    template<typename T>
+    std::unique_ptr<T> loadFromImage(const sf::Image& image)
+    {
+        auto resource = std::make_unique<T>();
+        resource->loadFromImage(image);
+
+        return resource;
+    }
 }
@@ -44,7 +44,20 @@ public:
     virtual void pause() = 0;
     virtual void shutdown() = 0;
     virtual void handleEvents(sf::Event& event) = 0;
-    virtual void update(sf::Time& delta) = 0;
+
+    /*!
+    * \brief Advance state by one fixed simulation step (see SIMULATION_RATE)
+    */
+    virtual void simulate(sf::Time& step) = 0;
+
+    /*!
+    * \brief Draw state, called once per frame
+    *
+    * \param alpha Part of simulation step elapsed since last simulate() call, in range [0, 1). Used to interpolate
+    * between previous and current simulation state, so movement is smooth at any frame rate.
+    *
+    */
+    virtual void render(float alpha) = 0;
 
 protected:
     GameEngine& engine;
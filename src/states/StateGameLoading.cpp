@@ -19,6 +19,7 @@
 //--------------------------------------------------------------------------
 
 #include <random>
+#include <string>
 
 //--------------------------------------------------------------------------
 
@@ -46,6 +47,13 @@ void GameLoading::init()
     m_loadingScreen.setTexture(*textures.at(texId));
     m_loadingScreen.updateView(size.x, size.y);
     m_loadingScreen.setStatus("Generating terrain...");
+
+    TerrainSettings settings;
+    settings.seed = std::random_device{}();
+
+    sf::Vector2i gridSize(GRID_SIZE, GRID_SIZE);
+    m_grid = std::make_shared<Grid>(gridSize);
+    m_generator = std::make_unique<TerrainGenerator>(settings, *m_grid);
 }
 
 //--------------------------------------------------------------------------
@@ -59,13 +67,31 @@ void GameLoading::handleEvents(sf::Event& event)
 
 void GameLoading::shutdown()
 {
+    m_generator.reset();
 }
 
 //--------------------------------------------------------------------------
 
-void GameLoading::update(sf::Time& delta)
+void GameLoading::simulate(sf::Time& /*step*/)
 {
-    engine.window()->draw(m_loadingScreen);
-	// !! skip to menu asap for debug !!
+    // generate part of the map in every step, so loading screen stays responsive
+    if (!m_generator->step(engine.jobs, sf::milliseconds(10)))
+    {
+        m_loadingScreen.setStatus("Generating terrain... " + std::to_string(m_generator->getProgress()) + "%");
+        return;
+    }
+
+    m_grid->publishChanges();
+    engine.grid = m_grid;
+    engine.terrainSeed = m_generator->getSettings().seed;
+    m_generator.reset();
+
     engine.machine.changeState(std::make_shared<state::Menu>(engine));
 }
+
+//--------------------------------------------------------------------------
+
+void GameLoading::render(float /*alpha*/)
+{
+    engine.window()->draw(m_loadingScreen);
+}
@@ -25,6 +25,7 @@
 
 #include "GameState.h"
 #include "../LoadingScreen.h"
+#include "../logic/TerrainGenerator.h"
 
 //--------------------------------------------------------------------------
 
@@ -39,10 +40,13 @@ namespace state
         virtual void pause() override {}
         virtual void handleEvents(sf::Event& event) override;
 		virtual void shutdown() override;
-		virtual void update(sf::Time& delta) override;
+		virtual void simulate(sf::Time& step) override;
+		virtual void render(float alpha) override;
 
 	private:
         LoadingScreen m_loadingScreen;
 		sf::Time m_elapsed;
+        std::shared_ptr<Grid> m_grid;                       ///< map filled by generator
+        std::unique_ptr<TerrainGenerator> m_generator;      ///< generator of terrain, released after map is finished
 	};
 }
@@ -19,6 +19,8 @@
 //--------------------------------------------------------------------------
 
 #include <random>
+#include <string>
+#include <iostream>
 
 //--------------------------------------------------------------------------
 
@@ -29,10 +31,57 @@
 
 using namespace state;
 
+constexpr unsigned int Gameplay::AUTOSAVE_INTERVAL;
+constexpr unsigned int Gameplay::AUTOSAVE_CHAIN;
+constexpr unsigned int Gameplay::REPLAY_HASH_INTERVAL;
+constexpr unsigned int Gameplay::COMPUTER_PLAYERS;
+
 //--------------------------------------------------------------------------
 
 void Gameplay::init()
 {
+    if (engine.grid)
+    {
+        m_gridSubscription = engine.grid->subscribe(logic::Delegate<void(const GridChangeSet &)>::factory<Minimap, &Minimap::invalidate>(&m_minimap));
+        m_blockedAreas = std::make_unique<BlockedAreaTable>(*engine.grid);
+
+        uint32_t seed = std::random_device{}();
+        m_simulation = std::make_unique<ecs::Simulation>(*engine.grid, seed);
+
+        // the only player doesn't wait for anybody, so commands are executed in the next tick
+        network::LockstepSettings settings{ 1u, static_cast<uint8_t>(m_localPlayer), 1u, 0u, static_cast<uint8_t>(COMPUTER_PLAYERS) };
+        m_lockstep = std::make_unique<network::Lockstep>(settings, *m_simulation, m_network.getEndpoint(0));
+
+        // computer players start near corners of the map
+        m_ai = std::make_unique<ai::Scheduler>(*engine.grid, engine.jobs);
+        sf::Vector2i gridSize = engine.grid->getGridSize();
+        for (unsigned int i = 0; i < COMPUTER_PLAYERS; ++i)
+        {
+            unsigned int corner = (i + 3u) % 4u;
+            sf::Vector2i home(corner % 2u == 0u ? gridSize.x / 8 : gridSize.x * 7 / 8, corner / 2u == 0u ? gridSize.y / 8 : gridSize.y * 7 / 8);
+            m_ai->addPlayer(static_cast<uint8_t>(settings.playerCount + i), home);
+        }
+
+        ecs::ReplayHeader header{};
+        header.terrainSeed = engine.terrainSeed;
+        header.gridWidth = engine.grid->getGridSize().x;
+        header.gridHeight = engine.grid->getGridSize().y;
+        header.simulationSeed = seed;
+        header.hashInterval = REPLAY_HASH_INTERVAL;
+        try
+        {
+            m_replay = std::make_unique<ecs::ReplayWriter>("replay.rpl", header);
+            m_lockstep->setReplay(m_replay.get());
+        }
+        catch (const std::exception & exception)
+        {
+            // game can be played without replay
+            std::cout << exception.what() << std::endl;
+        }
+    }
+
+    auto size = engine.window()->getSize();
+    m_minimap.setPosition(10.f, static_cast<float>(size.y) - static_cast<float>(GRID_SIZE) - 10.f);
 }
 
 //--------------------------------------------------------------------------
@@ -46,11 +95,94 @@ void Gameplay::handleEvents(sf::Event& event)
 
 void Gameplay::shutdown()
 {
+    if (m_lockstep)
+        m_lockstep->setReplay(nullptr);
+    if (m_replay)
+        m_replay->finish(m_simulation->getTick());
+    m_replay.reset();
+
+    m_ai.reset();
+    m_blockedAreas.reset();
+    if (engine.grid)
+        engine.grid->unsubscribe(m_gridSubscription);
+}
+
+//--------------------------------------------------------------------------
+
+void Gameplay::issueCommand(const ecs::Command & command)
+{
+    if (m_lockstep)
+        m_lockstep->issue(command);
+}
+
+//--------------------------------------------------------------------------
+
+bool Gameplay::isAreaFree(sf::IntRect area) const
+{
+    // area must be whole inside the map, parts outside are ignored by the table
+    if (!m_blockedAreas || area.left < 0 || area.top < 0 || area.left + area.width > engine.grid->getGridSize().x ||
+        area.top + area.height > engine.grid->getGridSize().y)
+        return false;
+
+    return m_blockedAreas->isAreaClear(area);
+}
+
+//--------------------------------------------------------------------------
+
+void Gameplay::simulate(sf::Time& /*step*/)
+{
+    // lockstep advances simulation by whole ticks of Simulation::TICK_TIME, which is the engine step
+    if (!m_simulation)
+        return;
+
+    // positions stored before waiting tick aren't changed, so units just stand still while the game waits
+    m_render.storePositions(m_simulation->getWorld());
+    if (!m_lockstep->step(engine.jobs))
+        return;
+
+    // edits made by commands of the tick reach minimap and placement table as one change set
+    engine.grid->publishChanges();
+    m_minimap.update(*engine.grid, m_simulation->getFog(), m_localPlayer, m_simulation->getSpatialHash(), m_simulation->getWorld());
+
+    m_ai->update(*m_simulation, m_aiCommands);
+    for (const ecs::Command & command : m_aiCommands)
+        m_lockstep->issueComputer(command);
+    m_aiCommands.clear();
+
+    uint32_t tick = m_simulation->getTick();
+    if (m_replay && tick % REPLAY_HASH_INTERVAL == 0)
+        m_replay->recordHash(tick, m_simulation->computeHash());
+    if (tick % AUTOSAVE_INTERVAL == 0)
+        autosave();
+}
+
+//--------------------------------------------------------------------------
+
+void Gameplay::autosave()
+{
+    unsigned int index = m_autosaveCount++ % AUTOSAVE_CHAIN;
+    ecs::SimulationState state = m_simulation->getState();
+    auto mode = index == 0 ? ecs::SaveGame::Mode::FULL : ecs::SaveGame::Mode::DELTA;
+
+    try
+    {
+        m_saveGame.save("autosave" + std::to_string(index) + ".sav", state, mode);
+    }
+    catch (const std::exception & exception)
+    {
+        // failed autosave can't stop the game, next chain starts with full save
+        std::cout << exception.what() << std::endl;
+        m_autosaveCount = 0u;
+    }
 }
 
 //--------------------------------------------------------------------------
 
-void Gameplay::update(sf::Time& delta)
+void Gameplay::render(float alpha)
 {
+    if (!m_simulation)
+        return;
 
+    m_render.render(m_simulation->getWorld(), *engine.window(), alpha);
+    engine.window()->draw(m_minimap);
 }
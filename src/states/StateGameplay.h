@@ -19,11 +19,21 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 #include <SFML/Graphics.hpp>
 
 //--------------------------------------------------------------------------
 
 #include "GameState.h"
+#include "../Minimap.h"
+#include "../ecs/Systems.h"
+#include "../ecs/SaveGame.h"
+#include "../ecs/Simulation.h"
+#include "../ecs/Replay.h"
+#include "../network/Lockstep.h"
+#include "../network/LoopbackTransport.h"
+#include "../logic/BlockedAreaTable.h"
+#include "../ai/Scheduler.h"
 
 //--------------------------------------------------------------------------
 
@@ -32,15 +42,51 @@ namespace state
     class Gameplay : public GameState
     {
     public:
+        static constexpr unsigned int AUTOSAVE_INTERVAL = 60 * SIMULATION_RATE;    ///< ticks between autosaves
+        static constexpr unsigned int AUTOSAVE_CHAIN = 10;                          ///< every AUTOSAVE_CHAIN-th autosave is full, others are deltas
+        static constexpr unsigned int REPLAY_HASH_INTERVAL = 1;                     ///< ticks between state hashes written to replay
+        static constexpr unsigned int COMPUTER_PLAYERS = 1;                         ///< computer players following the local player
+
         Gameplay(GameEngine& engine) : GameState(engine) {}
 
         virtual void init();
         virtual void pause() override {}
         virtual void handleEvents(sf::Event& event) override;
         virtual void shutdown() override;
-        virtual void update(sf::Time& delta) override;
+        virtual void simulate(sf::Time& step) override;
+        virtual void render(float alpha) override;
+
+        /*!
+        * \brief Queue command of the local player, lockstep executes it and records it to replay
+        */
+        void issueCommand(const ecs::Command & command);
+
+        /*!
+        * \brief Check if building or wall can be placed on the area, cost doesn't depend on size of the area
+        */
+        bool isAreaFree(sf::IntRect area) const;
+
+    private:
+        /*!
+        * \brief Write autosave, files autosave0.sav ... autosave9.sav are full save followed by deltas
+        */
+        void autosave();
 
     private:
         sf::Time m_elapsed;
+
+        std::unique_ptr<ecs::Simulation> m_simulation;     ///< simulated game, exists only if engine has a grid
+        std::unique_ptr<ecs::ReplayWriter> m_replay;        ///< recorder of commands and state hashes
+        network::LoopbackNetwork m_network{ 1u };           ///< single player game doesn't need real network
+        std::unique_ptr<network::Lockstep> m_lockstep;      ///< scheduler of commands of all players
+        std::unique_ptr<BlockedAreaTable> m_blockedAreas;   ///< occupied tiles summed for placement previews
+        std::unique_ptr<ai::Scheduler> m_ai;                ///< computer players, their commands are sent by lockstep
+        std::vector<ecs::Command> m_aiCommands;             ///< commands issued by computer players in current tick
+        ecs::RenderSystem m_render;
+        Minimap m_minimap{ sf::Vector2i(GRID_SIZE, GRID_SIZE) };   ///< terrain, fog and units seen by local player
+        unsigned int m_localPlayer{ 0u };                           ///< player controlled on this computer
+        unsigned int m_gridSubscription{ 0u };                      ///< id of minimap subscription to grid changes
+        ecs::SaveGame m_saveGame;                                   ///< writer of autosaves
+        unsigned int m_autosaveCount{ 0u };                         ///< amount of written autosaves
     };
 }
@@ -52,9 +52,15 @@ namespace state
 
 	//--------------------------------------------------------------------------
 
-	void Menu::update(sf::Time& delta)
+	void Menu::simulate(sf::Time& step)
+	{
+		m_guiObject->update(step);
+	}
+
+	//--------------------------------------------------------------------------
+
+	void Menu::render(float /*alpha*/)
 	{
-		m_guiObject->update(delta);
 		m_guiObject->draw(*engine.window());
 
 		//-- Timers for fps/frame time
@@ -50,7 +50,8 @@ namespace state
 		virtual void pause() override {}
 		virtual void handleEvents(sf::Event& event) override;
 		virtual void shutdown() override;
-		virtual void update(sf::Time& delta) override;
+		virtual void simulate(sf::Time& step) override;
+		virtual void render(float alpha) override;
 
 	private:
 		std::unique_ptr<gui::ProgramGUI> m_guiObject;	///< gui for menu
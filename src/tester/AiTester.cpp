@@ -0,0 +1,100 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//--------------------------------------------------------------------------
+
+#include "AiTester.h"
+#include "../logic/TerrainGenerator.h"
+
+//--------------------------------------------------------------------------
+
+#include <vector>
+#include <algorithm>
+
+//--------------------------------------------------------------------------
+
+namespace tester
+{
+	namespace
+	{
+		/*!
+		* \brief Start tile of the player, corners first and then middles of edges
+		*/
+		sf::Vector2i startPosition(sf::Vector2i gridSize, unsigned int player)
+		{
+			static const int POSITIONS[MAX_PLAYERS][2] = { { 1, 1 }, { 7, 7 }, { 7, 1 }, { 1, 7 }, { 4, 1 }, { 4, 7 }, { 1, 4 }, { 7, 4 } };
+			return sf::Vector2i(gridSize.x * POSITIONS[player][0] / 8, gridSize.y * POSITIONS[player][1] / 8);
+		}
+	}
+
+	//--------------------------------------------------------------------------
+
+	AiTester::AiTester(unsigned int seed) :
+		m_seed(seed)
+	{
+	}
+
+	//--------------------------------------------------------------------------
+
+	AiTester::Report AiTester::run(unsigned int playerCount, unsigned int ticks, sf::Time budget)
+	{
+		Report report;
+		report.players = std::min(playerCount, MAX_PLAYERS);
+		report.ticks = ticks;
+		report.budgetMilliseconds = budget.asSeconds() * 1000.f;
+
+		// queries are asynchronous only if there is at least one worker
+		logic::JobSystem jobs(std::max(1u, logic::JobSystem::defaultWorkerCount()));
+		sf::Vector2i gridSize(GRID_SIZE, GRID_SIZE);
+		Grid grid(gridSize);
+		TerrainSettings settings;
+		settings.seed = m_seed;
+		TerrainGenerator(settings, grid).generate(jobs);
+		grid.publishChanges();
+
+		ecs::Simulation simulation(grid, m_seed);
+		ai::Scheduler scheduler(grid, jobs, budget);
+		for (unsigned int player = 0; player < report.players; ++player)
+			scheduler.addPlayer(static_cast<uint8_t>(player), startPosition(gridSize, player));
+
+		// commands are executed in the next tick like in single player lockstep game
+		std::vector<ecs::Command> commands;
+		for (unsigned int tick = 0; tick < ticks; ++tick)
+		{
+			for (const ecs::Command & command : commands)
+				simulation.execute(command);
+			report.commands += static_cast<unsigned int>(commands.size());
+			commands.clear();
+
+			simulation.step(jobs);
+			scheduler.update(simulation, commands);
+		}
+
+		simulation.getWorld().forEach<ecs::Owner>([&report](std::size_t count, const ecs::Entity *, ecs::Owner *)
+		{
+			report.units += static_cast<unsigned int>(count);
+		});
+
+		const ai::Scheduler::Statistics & statistics = scheduler.getStatistics();
+		report.resumes = statistics.resumes;
+		report.overruns = statistics.overruns;
+		report.maxMilliseconds = statistics.maxTime.asSeconds() * 1000.f;
+		report.averageMilliseconds = statistics.ticks > 0u ? statistics.totalTime.asSeconds() * 1000.f / static_cast<float>(statistics.ticks) : 0.f;
+		return report;
+	}
+}
@@ -0,0 +1,89 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <SFML/System.hpp>
+
+//--------------------------------------------------------------------------
+
+#include "../ai/Scheduler.h"
+
+//--------------------------------------------------------------------------
+
+namespace tester
+{
+	/*!
+	* \brief Plays game of computer players only and measures time taken by their scheduler
+	*
+	* Map is generated from the seed, every player starts in its own part of the map and commands issued in a tick are
+	* executed in the next one. Game passes if players created units and no tick of scheduler took much longer than its
+	* budget, so computer players can't cause frame spikes.
+	*
+	* Usage example:
+	* \code
+	* tester::AiTester tester(1234u);
+	* auto report = tester.run(8u, 6000u, sf::microseconds(1000));
+	* \endcode
+	*
+	*/
+	class AiTester
+	{
+	public:
+		/*!
+		* \brief Summary of one game
+		*/
+		struct Report
+		{
+			unsigned int players{ 0u };				///< amount of computer players
+			unsigned int ticks{ 0u };				///< amount of simulated ticks
+			unsigned int commands{ 0u };			///< amount of commands issued by all players
+			unsigned int units{ 0u };				///< amount of units at the end of the game
+			unsigned int resumes{ 0u };				///< amount of resumed tasks
+			unsigned int overruns{ 0u };			///< amount of ticks in which scheduler exceeded budget
+			float budgetMilliseconds{ 0.f };		///< budget of scheduler in one tick
+			float maxMilliseconds{ 0.f };			///< the longest tick of scheduler
+			float averageMilliseconds{ 0.f };		///< average tick of scheduler
+
+			bool passed() const { return units > 0u && maxMilliseconds <= budgetMilliseconds + 0.5f; }
+		};
+
+		/*!
+		* \brief Default constructor
+		*
+		* \param seed Seed of the map and the simulation
+		*
+		*/
+		AiTester(unsigned int seed);
+
+		/*!
+		* \brief Play the game
+		*
+		* \param playerCount Amount of computer players, at most MAX_PLAYERS
+		* \param ticks Amount of simulated ticks
+		* \param budget Time of all players in one tick
+		*
+		*/
+		Report run(unsigned int playerCount, unsigned int ticks, sf::Time budget);
+
+	private:
+		unsigned int m_seed;		///< seed of the map and the simulation
+	};
+}
@@ -0,0 +1,182 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+//--------------------------------------------------------------------------
+
+#include "BlockedAreaTester.h"
+
+//--------------------------------------------------------------------------
+
+#include <memory>
+#include <iostream>
+
+//--------------------------------------------------------------------------
+
+namespace tester
+{
+	namespace
+	{
+		constexpr int MIN_GRID_CHUNKS = 8;			///< minimum amount of chunks in x and y direction of random grid
+		constexpr int MAX_GRID_CHUNKS = 32;			///< maximum amount of chunks in x and y direction of random grid
+		constexpr unsigned int ROUNDS = 10u;		///< amount of rounds of edits on one grid
+		constexpr unsigned int RECTANGLES = 30u;	///< amount of rectangles compared after every round
+		constexpr int MAX_EDITED_CHUNKS = 3;		///< maximum amount of chunks edited by one ordinary round
+		constexpr unsigned int MAX_EDITS = 12u;		///< maximum amount of edits of one chunk in ordinary round
+		constexpr int CHUNK_SIDE = static_cast<int>(CHUNK_SIZE);
+		constexpr unsigned int PLANE_COUNT = static_cast<unsigned int>(GridPlane::COUNT);
+	}
+
+	//--------------------------------------------------------------------------
+
+	BlockedAreaTester::BlockedAreaTester(unsigned int seed) :
+		m_random{ seed }
+	{
+	}
+
+	//--------------------------------------------------------------------------
+
+	BlockedAreaTester::Report BlockedAreaTester::run(unsigned int gridCount)
+	{
+		Report report;
+		std::uniform_int_distribution<int> chunkDist(MIN_GRID_CHUNKS, MAX_GRID_CHUNKS);
+		std::uniform_int_distribution<int> editedChunksDist(1, MAX_EDITED_CHUNKS);
+		std::uniform_int_distribution<unsigned int> editDist(1u, MAX_EDITS);
+		std::uniform_int_distribution<unsigned int> percentDist(0u, 99u);
+
+		for (unsigned int caseId = 0u; caseId < gridCount; ++caseId)
+		{
+			sf::Vector2i gridSize(chunkDist(m_random) * CHUNK_SIDE, chunkDist(m_random) * CHUNK_SIDE);
+			sf::IntRect wholeGrid(0, 0, gridSize.x, gridSize.y);
+			Grid grid(gridSize);
+			editRegion(grid, wholeGrid, static_cast<unsigned int>(gridSize.x*gridSize.y / 16));
+			grid.publishChanges();
+			++report.grids;
+
+			// tables are built once, all later edits reach them only through change sets
+			std::unique_ptr<BlockedAreaTable> tables[PLANE_COUNT];
+			for (unsigned int plane = 0u; plane < PLANE_COUNT; ++plane)
+				tables[plane] = std::make_unique<BlockedAreaTable>(grid, static_cast<GridPlane>(plane));
+
+			for (unsigned int round = 0u; round < ROUNDS; ++round)
+			{
+				// tables rebuild everything when change set has many chunks, so only some rounds change the whole grid
+				if (percentDist(m_random) < 10u)
+					report.edits += editRegion(grid, wholeGrid, static_cast<unsigned int>(gridSize.x*gridSize.y / 64));
+				else
+				{
+					std::uniform_int_distribution<int> chunkXDist(0, gridSize.x / CHUNK_SIDE - 1);
+					std::uniform_int_distribution<int> chunkYDist(0, gridSize.y / CHUNK_SIDE - 1);
+					for (int chunk = editedChunksDist(m_random); chunk > 0; --chunk)
+					{
+						sf::IntRect region(chunkXDist(m_random) * CHUNK_SIDE, chunkYDist(m_random) * CHUNK_SIDE, CHUNK_SIDE, CHUNK_SIDE);
+						report.edits += editRegion(grid, region, editDist(m_random));
+					}
+				}
+				grid.publishChanges();
+
+				for (unsigned int i = 0u; i < RECTANGLES; ++i)
+				{
+					sf::IntRect area = randomRectangle(gridSize);
+					++report.rectangles;
+					for (unsigned int plane = 0u; plane < PLANE_COUNT; ++plane)
+					{
+						unsigned int expected = grid.countTiles(area, static_cast<GridPlane>(plane));
+						unsigned int counted = tables[plane]->countTiles(area);
+						if (counted == expected)
+							continue;
+						++report.mismatches;
+						std::cout << "BlockedAreaTester: case " << caseId << " round " << round << " plane " << plane << " area " << area.left << ","
+							<< area.top << " " << area.width << "x" << area.height << " counted " << counted << " instead of " << expected << std::endl;
+					}
+				}
+			}
+		}
+
+		return report;
+	}
+
+	//--------------------------------------------------------------------------
+
+	unsigned int BlockedAreaTester::editRegion(Grid & grid, sf::IntRect region, unsigned int editCount)
+	{
+		std::uniform_int_distribution<int> xDist(region.left, region.left + region.width - 1);
+		std::uniform_int_distribution<int> yDist(region.top, region.top + region.height - 1);
+		std::uniform_int_distribution<int> sizeDist(1, CHUNK_SIDE);
+		std::uniform_int_distribution<int> typeDist(0, static_cast<int>(ObjectType::COUNT) - 1);
+		std::uniform_int_distribution<unsigned int> percentDist(0u, 99u);
+
+		for (unsigned int i = 0u; i < editCount; ++i)
+		{
+			sf::IntRect area(xDist(m_random), yDist(m_random), 1, 1);
+			ObjectType type = static_cast<ObjectType>(typeDist(m_random));
+			unsigned int kind = percentDist(m_random);
+			if (kind < 20u)
+			{
+				// rectangles cross chunk borders and grid border
+				area.width = sizeDist(m_random);
+				area.height = sizeDist(m_random);
+			}
+			else if (kind < 30u)
+			{
+				// tile keeps it's type, chunk is changed but its word isn't
+				type = grid.getObjectType(grid.getIndex(area.left, area.top));
+			}
+			grid.setObjectType(area, type);
+		}
+		return editCount;
+	}
+
+	//--------------------------------------------------------------------------
+
+	sf::IntRect BlockedAreaTester::randomRectangle(sf::Vector2i gridSize)
+	{
+		std::uniform_int_distribution<int> xDist(0, gridSize.x - 1);
+		std::uniform_int_distribution<int> yDist(0, gridSize.y - 1);
+		std::uniform_int_distribution<int> outsideDist(-CHUNK_SIDE, CHUNK_SIDE);
+		std::uniform_int_distribution<int> smallDist(0, CHUNK_SIDE);
+		std::uniform_int_distribution<int> kindDist(0, 4);
+
+		switch (kindDist(m_random))
+		{
+		case 0:
+			// single tile or empty rectangle
+			return sf::IntRect(xDist(m_random), yDist(m_random), smallDist(m_random) % 2, smallDist(m_random) % 2);
+		case 1:
+			// small rectangle, usually inside one or two chunks
+			return sf::IntRect(xDist(m_random), yDist(m_random), smallDist(m_random), smallDist(m_random));
+		case 2:
+		{
+			// rectangle aligned to chunk borders
+			int left = xDist(m_random) / CHUNK_SIDE * CHUNK_SIDE;
+			int top = yDist(m_random) / CHUNK_SIDE * CHUNK_SIDE;
+			return sf::IntRect(left, top, (smallDist(m_random) % 4 + 1) * CHUNK_SIDE, (smallDist(m_random) % 4 + 1) * CHUNK_SIDE);
+		}
+		case 3:
+			// rectangle reaching outside of the grid
+			return sf::IntRect(outsideDist(m_random), outsideDist(m_random), gridSize.x + outsideDist(m_random), gridSize.y + outsideDist(m_random));
+		default:
+		{
+			// rectangle between two random tiles, width or height is negative if second tile is left or above the first one
+			int left = xDist(m_random);
+			int top = yDist(m_random);
+			return sf::IntRect(left, top, xDist(m_random) - left + 1, yDist(m_random) - top + 1);
+		}
+		}
+	}
+}
@@ -0,0 +1,103 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <random>
+#include <SFML/Graphics.hpp>
+
+//--------------------------------------------------------------------------
+
+#include "../logic/Grid.h"
+#include "../logic/BlockedAreaTable.h"
+
+//--------------------------------------------------------------------------
+
+namespace tester
+{
+	/*!
+	* \brief Regression runner for BlockedAreaTable
+	*
+	* Every grid gets one table for every GridPlane, tables are built from randomly filled grid and then updated only from
+	* published change sets. Most rounds edit few chunks, so tables update strips of changed chunks incrementally, some
+	* rounds change the whole grid, so tables are rebuilt. Edits set single tiles and rectangles to random object types,
+	* also back to the same type. After every round counts of random rectangles, including empty ones and ones reaching
+	* outside the grid, are compared with GridView::countTiles().
+	*
+	* Usage example:
+	* \code
+	* tester::BlockedAreaTester tester(1234u);
+	* auto report = tester.run(200u);
+	* \endcode
+	*
+	*/
+	class BlockedAreaTester
+	{
+	public:
+		/*!
+		* \brief Summary of all tested rectangles
+		*/
+		struct Report
+		{
+			unsigned int grids{ 0u };			///< amount of tested grids
+			unsigned int edits{ 0u };			///< amount of edits published to tables
+			unsigned int rectangles{ 0u };		///< amount of compared rectangles, every rectangle is compared on all planes
+			unsigned int mismatches{ 0u };		///< amount of counts which differ from GridView::countTiles()
+
+			bool passed() const { return rectangles > 0u && mismatches == 0u; }
+		};
+
+		/*!
+		* \brief Default constructor
+		*
+		* \param seed Seed used to generate all grids, edits and rectangles, the same seed always generates the same cases
+		*
+		*/
+		BlockedAreaTester(unsigned int seed);
+
+		/*!
+		* \brief Test tables on random grids
+		*
+		* \param gridCount Amount of random grids
+		*
+		*/
+		Report run(unsigned int gridCount);
+
+	private:
+		/*!
+		* \brief Make random edits of tiles inside region, edits are not published
+		*
+		* \param region Area of edited tiles, rectangles starting inside it can reach outside
+		*
+		* \return Amount of edits
+		*
+		*/
+		unsigned int editRegion(Grid & grid, sf::IntRect region, unsigned int editCount);
+
+		/*!
+		* \brief Generate rectangle of random kind, parts of it can be outside of the grid
+		*/
+		sf::IntRect randomRectangle(sf::Vector2i gridSize);
+
+	private:
+		std::mt19937 m_random;		///< generator of all grids, edits and rectangles
+	};
+}
@@ -0,0 +1,296 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+//--------------------------------------------------------------------------
+
+#include "KernelTester.h"
+
+//--------------------------------------------------------------------------
+
+#include <cstring>
+#include <iostream>
+
+//--------------------------------------------------------------------------
+
+#include "../ecs/SpatialHash.h"
+
+//--------------------------------------------------------------------------
+
+namespace tester
+{
+	namespace
+	{
+		constexpr int MAX_GRID_CHUNKS = 8;			///< maximum amount of chunks in x and y direction of random grid
+		constexpr int MAX_UNITS = 600;				///< maximum amount of randomly placed units of one crowd
+		constexpr int MAX_STACKS = 8;				///< maximum amount of stacked groups of one crowd
+		constexpr int MAX_STACK_SIZE = 5;			///< maximum amount of units of one stacked group
+		constexpr int CHUNK_SIDE = static_cast<int>(CHUNK_SIZE);
+
+		constexpr ecs::SteeringSystem::Kernel STEERING_KERNELS[] = { ecs::SteeringSystem::Kernel::SSE, ecs::SteeringSystem::Kernel::AVX };
+		constexpr ecs::InfluenceMap::Kernel INFLUENCE_KERNELS[] = { ecs::InfluenceMap::Kernel::SSE, ecs::InfluenceMap::Kernel::AVX };
+
+		const char * kernelName(unsigned int kernel)
+		{
+			static const char * NAMES[] = { "scalar", "SSE", "AVX" };
+			return NAMES[kernel];
+		}
+
+		/*!
+		* \brief Compare representation of floats, so also signs of zeros and payloads of NaNs have to match
+		*/
+		inline bool sameBits(float left, float right)
+		{
+			uint32_t leftBits;
+			uint32_t rightBits;
+			std::memcpy(&leftBits, &left, sizeof(float));
+			std::memcpy(&rightBits, &right, sizeof(float));
+			return leftBits == rightBits;
+		}
+	}
+
+	//--------------------------------------------------------------------------
+
+	KernelTester::KernelTester(unsigned int seed) :
+		m_random{ seed }
+	{
+	}
+
+	//--------------------------------------------------------------------------
+
+	KernelTester::Report KernelTester::run(unsigned int caseCount)
+	{
+		Report report;
+		for (auto kernel : STEERING_KERNELS)
+		{
+			ecs::SteeringSystem steering;
+			report.kernels += steering.setKernel(kernel) ? 1u : 0u;
+		}
+
+		for (unsigned int caseId = 0u; caseId < caseCount; ++caseId)
+		{
+			std::uniform_int_distribution<int> chunkDist(1, MAX_GRID_CHUNKS);
+			sf::Vector2i gridSize(chunkDist(m_random) * CHUNK_SIDE, chunkDist(m_random) * CHUNK_SIDE);
+			Grid grid(gridSize);
+			randomizeResources(grid);
+
+			ecs::World world;
+			std::vector<std::vector<ecs::Entity>> stacks;
+			randomizeCrowd(world, gridSize, stacks);
+
+			testSteering(caseId, world, grid.getChunkGridSize(), stacks, report);
+			testInfluence(caseId, grid, world, report);
+		}
+
+		return report;
+	}
+
+	//--------------------------------------------------------------------------
+
+	void KernelTester::randomizeCrowd(ecs::World & world, sf::Vector2i gridSize, std::vector<std::vector<ecs::Entity>> & stacks)
+	{
+		std::uniform_real_distribution<float> xDist(0.f, static_cast<float>(gridSize.x));
+		std::uniform_real_distribution<float> yDist(0.f, static_cast<float>(gridSize.y));
+		std::uniform_real_distribution<float> velocityDist(-2.f, 2.f);
+		std::uniform_real_distribution<float> speedDist(0.5f, 3.f);
+		std::uniform_real_distribution<float> clusterDist(-1.f, 1.f);
+		std::uniform_int_distribution<int> unitDist(1, MAX_UNITS);
+		std::uniform_int_distribution<int> stackDist(0, MAX_STACKS);
+		std::uniform_int_distribution<int> stackSizeDist(2, MAX_STACK_SIZE);
+		std::uniform_int_distribution<int> playerDist(0, MAX_PLAYERS - 1);
+		std::uniform_int_distribution<int> healthDist(1, 100);
+		std::uniform_int_distribution<int> percentDist(0, 99);
+
+		auto randomHealth = [&]()
+		{
+			int16_t current = static_cast<int16_t>(healthDist(m_random));
+			return ecs::Health{ current, 100 };
+		};
+		auto randomCursor = [&]()
+		{
+			// steering checks only validity of the path, so any valid handle works
+			ecs::PathCursor cursor;
+			if (percentDist(m_random) < 50)
+				cursor.path.index = 0u;
+			cursor.speed = speedDist(m_random);
+			return cursor;
+		};
+
+		// units are placed around few cluster centers, so many of them have full neighbour slots
+		int unitCount = unitDist(m_random);
+		sf::Vector2f center(xDist(m_random), yDist(m_random));
+		for (int i = 0; i < unitCount; ++i)
+		{
+			if (percentDist(m_random) < 5)
+				center = sf::Vector2f(xDist(m_random), yDist(m_random));
+			ecs::Position position{ center.x + clusterDist(m_random), center.y + clusterDist(m_random) };
+			if (position.x < 0.f || position.y < 0.f || position.x >= gridSize.x || position.y >= gridSize.y)
+				position = ecs::Position{ xDist(m_random), yDist(m_random) };
+			ecs::Velocity velocity{ velocityDist(m_random), velocityDist(m_random) };
+			ecs::Owner owner{ static_cast<uint8_t>(playerDist(m_random)) };
+
+			// units without path cursor are skipped by steering but still counted by influence map
+			if (percentDist(m_random) < 10)
+				world.create(position, velocity, owner, randomHealth());
+			else
+				world.create(position, velocity, randomCursor(), owner, randomHealth());
+		}
+
+		int stackCount = stackDist(m_random);
+		for (int i = 0; i < stackCount; ++i)
+		{
+			ecs::Position position{ xDist(m_random), yDist(m_random) };
+			stacks.emplace_back();
+			for (int j = stackSizeDist(m_random); j > 0; --j)
+			{
+				ecs::Owner owner{ static_cast<uint8_t>(playerDist(m_random)) };
+				stacks.back().push_back(world.create(position, ecs::Velocity{}, randomCursor(), owner, randomHealth()));
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------
+
+	void KernelTester::randomizeResources(Grid & grid)
+	{
+		sf::Vector2i gridSize = grid.getGridSize();
+		std::uniform_int_distribution<int> percentDist(0, 99);
+		int density = percentDist(m_random) / 4;
+		for (int y = 0; y < gridSize.y; ++y)
+		{
+			for (int x = 0; x < gridSize.x; ++x)
+			{
+				if (percentDist(m_random) < density)
+					grid.setObjectType(sf::IntRect(x, y, 1, 1), ObjectType::RESOURCE);
+			}
+		}
+		grid.publishChanges();
+	}
+
+	//--------------------------------------------------------------------------
+
+	void KernelTester::testSteering(unsigned int caseId, ecs::World & world, sf::Vector2i chunkGridSize,
+		const std::vector<std::vector<ecs::Entity>> & stacks, Report & report)
+	{
+		std::vector<ecs::Entity> units;
+		std::vector<ecs::Velocity> desired;
+		world.forEach<ecs::Velocity, ecs::PathCursor>([&units, &desired](std::size_t count, const ecs::Entity * entities, ecs::Velocity * velocity,
+			ecs::PathCursor *)
+		{
+			units.insert(units.end(), entities, entities + count);
+			desired.insert(desired.end(), velocity, velocity + count);
+		});
+		report.units += static_cast<unsigned int>(units.size());
+
+		ecs::SpatialHash neighbors(chunkGridSize);
+		neighbors.rebuild(world);
+
+		// every kernel starts from the same desired velocities
+		auto steer = [&](ecs::SteeringSystem & steering, std::vector<ecs::Velocity> & result)
+		{
+			for (std::size_t i = 0; i < units.size(); ++i)
+				*world.get<ecs::Velocity>(units[i]) = desired[i];
+			steering.update(world, neighbors);
+			result.clear();
+			for (ecs::Entity unit : units)
+				result.push_back(*world.get<ecs::Velocity>(unit));
+		};
+
+		ecs::SteeringSystem scalar;
+		scalar.setKernel(ecs::SteeringSystem::Kernel::SCALAR);
+		std::vector<ecs::Velocity> expected;
+		steer(scalar, expected);
+
+		// stacked units have no desired velocity, so only separation can move them apart
+		for (const auto & stack : stacks)
+		{
+			for (std::size_t i = 0; i < stack.size(); ++i)
+			{
+				const ecs::Velocity & velocity = *world.get<ecs::Velocity>(stack[i]);
+				for (std::size_t j = 0; j < stack.size(); ++j)
+				{
+					const ecs::Velocity & other = *world.get<ecs::Velocity>(stack[j]);
+					if (i == j || !sameBits(velocity.x, other.x) || !sameBits(velocity.y, other.y))
+						continue;
+					++report.stuckUnits;
+					std::cout << "KernelTester: case " << caseId << " stacked unit " << stack[i].index << " has the same velocity "
+						<< velocity.x << "," << velocity.y << " as unit " << stack[j].index << std::endl;
+					break;
+				}
+			}
+		}
+
+		std::vector<ecs::Velocity> velocities;
+		for (auto kernel : STEERING_KERNELS)
+		{
+			ecs::SteeringSystem steering;
+			if (!steering.setKernel(kernel))
+				continue;
+			steer(steering, velocities);
+			for (std::size_t i = 0; i < units.size(); ++i)
+			{
+				if (sameBits(velocities[i].x, expected[i].x) && sameBits(velocities[i].y, expected[i].y))
+					continue;
+				++report.steeringMismatches;
+				std::cout << "KernelTester: case " << caseId << " unit " << i << " " << kernelName(static_cast<unsigned int>(kernel)) << " velocity "
+					<< velocities[i].x << "," << velocities[i].y << " scalar velocity " << expected[i].x << "," << expected[i].y << std::endl;
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------
+
+	void KernelTester::testInfluence(unsigned int caseId, const Grid & grid, ecs::World & world, Report & report)
+	{
+		ecs::InfluenceMap scalar(grid.getGridSize());
+		scalar.setKernel(ecs::InfluenceMap::Kernel::SCALAR);
+		scalar.update(grid, world, m_jobs);
+
+		for (auto kernel : INFLUENCE_KERNELS)
+		{
+			ecs::InfluenceMap influence(grid.getGridSize());
+			if (!influence.setKernel(kernel))
+				continue;
+			influence.update(grid, world, m_jobs);
+
+			// layer index LAYER_COUNT stands for sum of strength layers
+			for (unsigned int layer = 0u; layer <= ecs::InfluenceMap::LAYER_COUNT; ++layer)
+			{
+				bool total = (layer == ecs::InfluenceMap::LAYER_COUNT);
+				const std::vector<float> & expected = total ? scalar.getTotalStrength() : scalar.getLayer(layer);
+				const std::vector<float> & cells = total ? influence.getTotalStrength() : influence.getLayer(layer);
+				report.cells += static_cast<unsigned int>(expected.size());
+				if (cells.size() != expected.size())
+				{
+					++report.influenceMismatches;
+					std::cout << "KernelTester: case " << caseId << " layer " << layer << " " << kernelName(static_cast<unsigned int>(kernel))
+						<< " has " << cells.size() << " cells instead of " << expected.size() << std::endl;
+					continue;
+				}
+				for (std::size_t cell = 0; cell < cells.size(); ++cell)
+				{
+					if (sameBits(cells[cell], expected[cell]))
+						continue;
+					++report.influenceMismatches;
+					std::cout << "KernelTester: case " << caseId << " layer " << layer << " cell " << cell << " " << kernelName(static_cast<unsigned int>(kernel))
+						<< " value " << cells[cell] << " scalar value " << expected[cell] << std::endl;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,119 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <random>
+#include <vector>
+#include <cstdint>
+#include <SFML/Graphics.hpp>
+
+//--------------------------------------------------------------------------
+
+#include "../ecs/World.h"
+#include "../ecs/Steering.h"
+#include "../ecs/InfluenceMap.h"
+#include "../logic/Grid.h"
+#include "../logic/JobSystem.h"
+
+//--------------------------------------------------------------------------
+
+namespace tester
+{
+	/*!
+	* \brief Equivalence runner of SIMD kernels
+	*
+	* SteeringSystem and InfluenceMap promise bit identical results of all their kernels, otherwise lockstep games of players
+	* with different processors desync. Every case is a seeded random crowd on a random grid: SteeringSystem runs every
+	* supported kernel on the same crowd and InfluenceMap blurs the same units and resources with every supported kernel,
+	* then all velocities and all cells are compared with the scalar kernel bit for bit.
+	*
+	* Crowds contain groups of units standing at exactly the same position without desired velocity, every unit of such group
+	* must get velocity different from all other units of the group, so stacked units separate.
+	*
+	* Usage example:
+	* \code
+	* tester::KernelTester tester(1234u);
+	* auto report = tester.run(200u);
+	* \endcode
+	*
+	*/
+	class KernelTester
+	{
+	public:
+		/*!
+		* \brief Summary of all tested cases
+		*/
+		struct Report
+		{
+			unsigned int units{ 0u };					///< amount of steered units
+			unsigned int cells{ 0u };					///< amount of compared influence cells
+			unsigned int kernels{ 0u };					///< amount of kernels supported by processor and compared with scalar one
+			unsigned int steeringMismatches{ 0u };		///< amount of velocities which differ from scalar kernel
+			unsigned int influenceMismatches{ 0u };		///< amount of influence cells which differ from scalar kernel
+			unsigned int stuckUnits{ 0u };				///< amount of stacked units with the same velocity as other unit of the stack
+
+			bool passed() const { return steeringMismatches == 0u && influenceMismatches == 0u && stuckUnits == 0u; }
+		};
+
+		/*!
+		* \brief Default constructor
+		*
+		* \param seed Seed used to generate all crowds, the same seed always generates the same cases
+		*
+		*/
+		KernelTester(unsigned int seed);
+
+		/*!
+		* \brief Compare kernels on random crowds
+		*
+		* \param caseCount Amount of random crowds
+		*
+		*/
+		Report run(unsigned int caseCount);
+
+	private:
+		/*!
+		* \brief Create random units in the world, entities of every stacked group are added to stacks
+		*/
+		void randomizeCrowd(ecs::World & world, sf::Vector2i gridSize, std::vector<std::vector<ecs::Entity>> & stacks);
+
+		/*!
+		* \brief Put random resources on the grid
+		*/
+		void randomizeResources(Grid & grid);
+
+		/*!
+		* \brief Run steering with every kernel and compare velocities
+		*/
+		void testSteering(unsigned int caseId, ecs::World & world, sf::Vector2i chunkGridSize,
+			const std::vector<std::vector<ecs::Entity>> & stacks, Report & report);
+
+		/*!
+		* \brief Run influence blur with every kernel and compare layers
+		*/
+		void testInfluence(unsigned int caseId, const Grid & grid, ecs::World & world, Report & report);
+
+	private:
+		std::mt19937 m_random;		///< generator of all crowds
+		logic::JobSystem m_jobs;	///< workers used by InfluenceMap
+	};
+}
@@ -0,0 +1,283 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//--------------------------------------------------------------------------
+
+#include "LockstepTester.h"
+#include "../logic/TerrainGenerator.h"
+#include "../network/LoopbackTransport.h"
+#include "../network/UdpTransport.h"
+
+//--------------------------------------------------------------------------
+
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+//--------------------------------------------------------------------------
+
+namespace tester
+{
+	namespace
+	{
+		constexpr uint32_t TURN_TICKS = 2u;				///< ticks in one turn of tested games
+		constexpr uint32_t INPUT_DELAY = 2u;			///< input delay of tested games
+		constexpr std::size_t MAX_UNITS = 64u;			///< units of one player, commands create units until this amount
+		constexpr unsigned int MAX_GROUP = 8u;			///< maximum amount of units in one command
+		constexpr int MOVE_RANGE = 8;					///< maximum distance of move target from the first unit
+		constexpr int SPAWN_RANGE = 16;					///< maximum distance of new units from start position of the player
+		constexpr unsigned int MAX_IDLE_ROUNDS = 1000u;	///< rounds without progress after which loopback game is deadlocked
+		constexpr float UDP_TIMEOUT = 60.f;				///< seconds after which UDP game is stopped
+	}
+
+	//--------------------------------------------------------------------------
+
+	LockstepTester::LockstepTester(unsigned int seed) :
+		m_seed(seed)
+	{
+	}
+
+	//--------------------------------------------------------------------------
+
+	LockstepTester::Report LockstepTester::runLoopback(unsigned int playerCount, unsigned int ticks, unsigned int commandsPerTurn, unsigned int dropInterval)
+	{
+		Report report;
+		report.players = playerCount;
+		report.ticks = ticks;
+
+		logic::JobSystem jobs(0u);
+		network::LoopbackNetwork loopback(playerCount, dropInterval);
+		std::vector<std::unique_ptr<Player>> players;
+		for (unsigned int i = 0; i < playerCount; ++i)
+		{
+			players.push_back(createPlayer(i, jobs));
+			network::LockstepSettings settings{ static_cast<uint8_t>(playerCount), static_cast<uint8_t>(i), TURN_TICKS, INPUT_DELAY };
+			players.back()->lockstep = std::make_unique<network::Lockstep>(settings, *players.back()->simulation, loopback.getEndpoint(i));
+		}
+
+		// players take turns in stepping, so waiting players are stepped again after others sent their batches
+		sf::Clock clock;
+		unsigned int idleRounds = 0u;
+		while (idleRounds < MAX_IDLE_ROUNDS)
+		{
+			bool finished = true;
+			bool progressed = false;
+			for (auto & player : players)
+			{
+				if (player->simulation->getTick() < ticks)
+				{
+					finished = false;
+					progressed |= stepPlayer(*player, commandsPerTurn, jobs);
+				}
+				else
+				{
+					player->lockstep->poll();
+				}
+			}
+
+			if (finished)
+			{
+				report.finished = true;
+				break;
+			}
+			idleRounds = progressed ? 0u : idleRounds + 1u;
+		}
+		report.seconds = clock.getElapsedTime().asSeconds();
+
+		summarize(report, players);
+		return report;
+	}
+
+	//--------------------------------------------------------------------------
+
+	LockstepTester::Report LockstepTester::runUdp(unsigned int playerCount, unsigned int ticks, unsigned int commandsPerTurn, unsigned short basePort)
+	{
+		Report report;
+		report.players = playerCount;
+		report.ticks = ticks;
+
+		std::vector<std::unique_ptr<Player>> players;
+		std::vector<std::unique_ptr<network::UdpTransport>> transports;
+		{
+			logic::JobSystem jobs;
+			for (unsigned int i = 0; i < playerCount; ++i)
+			{
+				std::vector<network::UdpPeer> peers;
+				for (unsigned int j = 0; j < playerCount; ++j)
+				{
+					if (j != i)
+						peers.push_back(network::UdpPeer{ sf::IpAddress::LocalHost, static_cast<unsigned short>(basePort + j) });
+				}
+				transports.push_back(std::make_unique<network::UdpTransport>(static_cast<unsigned short>(basePort + i), peers));
+
+				players.push_back(createPlayer(i, jobs));
+				network::LockstepSettings settings{ static_cast<uint8_t>(playerCount), static_cast<uint8_t>(i), TURN_TICKS, INPUT_DELAY };
+				players.back()->lockstep = std::make_unique<network::Lockstep>(settings, *players.back()->simulation, *transports.back());
+			}
+		}
+
+		// every player is a separate computer with its own job system, finished players keep answering others
+		std::atomic<unsigned int> finishedPlayers{ 0u };
+		std::atomic<bool> timeout{ false };
+		sf::Clock clock;
+		std::vector<std::thread> threads;
+		for (auto & player : players)
+		{
+			threads.emplace_back([&, current = player.get()]()
+			{
+				logic::JobSystem jobs(0u);
+				while (current->simulation->getTick() < ticks && !timeout)
+				{
+					if (!stepPlayer(*current, commandsPerTurn, jobs))
+						std::this_thread::sleep_for(std::chrono::milliseconds(1));
+					if (clock.getElapsedTime().asSeconds() > UDP_TIMEOUT)
+						timeout = true;
+				}
+
+				++finishedPlayers;
+				while (finishedPlayers < players.size() && !timeout)
+				{
+					current->lockstep->poll();
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+			});
+		}
+		for (auto & thread : threads)
+			thread.join();
+		report.seconds = clock.getElapsedTime().asSeconds();
+		report.finished = !timeout;
+
+		summarize(report, players);
+		return report;
+	}
+
+	//--------------------------------------------------------------------------
+
+	std::unique_ptr<LockstepTester::Player> LockstepTester::createPlayer(unsigned int player, logic::JobSystem & jobs)
+	{
+		auto result = std::make_unique<Player>();
+		sf::Vector2i gridSize(GRID_SIZE, GRID_SIZE);
+		result->grid = std::make_unique<Grid>(gridSize);
+
+		TerrainSettings settings;
+		settings.seed = m_seed;
+		TerrainGenerator(settings, *result->grid).generate(jobs);
+		result->grid->publishChanges();
+
+		result->simulation = std::make_unique<ecs::Simulation>(*result->grid, m_seed);
+		result->random.seed(m_seed + player);
+		return result;
+	}
+
+	//--------------------------------------------------------------------------
+
+	bool LockstepTester::stepPlayer(Player & player, unsigned int commandsPerTurn, logic::JobSystem & jobs)
+	{
+		uint32_t tick = player.simulation->getTick();
+		uint32_t turn = tick / TURN_TICKS;
+		if (tick % TURN_TICKS == 0u && player.issuedTurn != turn)
+		{
+			player.issuedTurn = turn;
+			issueCommands(player, commandsPerTurn);
+		}
+		return player.lockstep->step(jobs);
+	}
+
+	//--------------------------------------------------------------------------
+
+	void LockstepTester::issueCommands(Player & player, unsigned int count)
+	{
+		if (count == 0u)
+			return;
+
+		uint8_t id = player.lockstep->getSettings().localPlayer;
+		player.entities.clear();
+		player.tiles.clear();
+		player.simulation->getWorld().forEach<ecs::Owner, ecs::Position>([&player, id](std::size_t size, const ecs::Entity * entities,
+			ecs::Owner * owners, ecs::Position * positions)
+		{
+			for (std::size_t i = 0; i < size; ++i)
+			{
+				if (owners[i].player != id)
+					continue;
+				player.entities.push_back(entities[i]);
+				player.tiles.push_back(sf::Vector2i(static_cast<int>(std::floor(positions[i].x)), static_cast<int>(std::floor(positions[i].y))));
+			}
+		});
+
+		// every player starts in its own quarter of the map
+		sf::Vector2i gridSize = player.grid->getGridSize();
+		sf::Vector2i start(gridSize.x / 4 + (id % 2) * gridSize.x / 2, gridSize.y / 4 + (id / 2 % 2) * gridSize.y / 2);
+		auto clamp = [gridSize](sf::Vector2i tile)
+		{
+			return sf::Vector2i(std::min(std::max(tile.x, 0), gridSize.x - 1), std::min(std::max(tile.y, 0), gridSize.y - 1));
+		};
+
+		// player selects one group in every turn and keeps giving it orders, like a player who clicks faster than turns pass
+		std::size_t first = player.entities.empty() ? 0u : player.random() % player.entities.size();
+		std::size_t groupSize = std::min<std::size_t>(1u + player.random() % MAX_GROUP, player.entities.size());
+		std::vector<ecs::Entity> group;
+		for (std::size_t j = 0; j < groupSize; ++j)
+			group.push_back(player.entities[(first + j) % player.entities.size()]);
+
+		std::uniform_int_distribution<int> spawnDist(-SPAWN_RANGE, SPAWN_RANGE);
+		std::uniform_int_distribution<int> moveDist(-MOVE_RANGE, MOVE_RANGE);
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			ecs::Command command;
+			unsigned int roll = player.random() % 8u;
+			if (group.empty() || (roll == 0u && player.entities.size() < MAX_UNITS))
+			{
+				command.type = ecs::Command::Type::CREATE_UNIT;
+				command.target = clamp(start + sf::Vector2i(spawnDist(player.random), spawnDist(player.random)));
+			}
+			else
+			{
+				// blocked target makes search visit whole reachable area, so such move becomes stop
+				command.entities = group;
+				command.target = clamp(player.tiles[first] + sf::Vector2i(moveDist(player.random), moveDist(player.random)));
+				bool blocked = player.grid->isBlocked(player.grid->getIndex(command.target.x, command.target.y));
+				command.type = roll < 6u && !blocked ? ecs::Command::Type::MOVE : ecs::Command::Type::STOP;
+			}
+
+			player.lockstep->issue(command);
+			++player.commands;
+		}
+	}
+
+	//--------------------------------------------------------------------------
+
+	void LockstepTester::summarize(Report & report, const std::vector<std::unique_ptr<Player>> & players)
+	{
+		if (players.empty())
+			return;
+
+		uint64_t reference = players.front()->simulation->computeHash();
+		for (auto & player : players)
+		{
+			report.commands += player->commands;
+			report.stalledSteps += player->lockstep->getStalledSteps();
+			if (player->lockstep->isDesynchronized())
+				++report.desyncs;
+			if (player->simulation->computeHash() != reference)
+				++report.hashMismatches;
+		}
+	}
+}
@@ -0,0 +1,144 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <memory>
+#include <vector>
+#include <random>
+#include <cstdint>
+
+//--------------------------------------------------------------------------
+
+#include "../logic/Grid.h"
+#include "../logic/JobSystem.h"
+#include "../ecs/Simulation.h"
+#include "../network/Lockstep.h"
+
+//--------------------------------------------------------------------------
+
+namespace tester
+{
+	/*!
+	* \brief Runs several lockstep players of one game and checks that they stay synchronized
+	*
+	* Every player has its own map generated from the same seed and its own simulation, players issue random commands
+	* (create units, move and stop them) every turn. Game passes if no player detected different turn hashes and final
+	* states of all players are equal. Loopback run steps all players on one thread and can drop packets, UDP run
+	* steps every player on its own thread and connects them over localhost.
+	*
+	* Usage example:
+	* \code
+	* tester::LockstepTester tester(1234u);
+	* auto report = tester.runLoopback(2u, 2000u, 8u, 7u);
+	* \endcode
+	*
+	*/
+	class LockstepTester
+	{
+	public:
+		/*!
+		* \brief Summary of one game
+		*/
+		struct Report
+		{
+			unsigned int players{ 0u };				///< amount of players
+			unsigned int ticks{ 0u };				///< amount of ticks simulated by every player
+			unsigned int commands{ 0u };			///< amount of commands issued by all players
+			unsigned int stalledSteps{ 0u };		///< amount of steps in which players waited for others
+			unsigned int desyncs{ 0u };				///< amount of players which detected different hashes
+			unsigned int hashMismatches{ 0u };		///< amount of players whose final state differs from the first player
+			bool finished{ false };					///< all players reached the last tick before timeout
+			float seconds{ 0.f };					///< wall time of the game
+
+			bool passed() const { return finished && desyncs == 0u && hashMismatches == 0u; }
+			float ticksPerSecond() const { return seconds > 0.f ? static_cast<float>(ticks) / seconds : 0.f; }
+		};
+
+		/*!
+		* \brief Default constructor
+		*
+		* \param seed Seed of maps and commands, the same seed always gives the same loopback game
+		*
+		*/
+		LockstepTester(unsigned int seed);
+
+		/*!
+		* \brief Run game of players connected by LoopbackNetwork on the calling thread
+		*
+		* \param playerCount Amount of players
+		* \param ticks Amount of ticks simulated by every player
+		* \param commandsPerTurn Amount of commands issued by every player in every turn
+		* \param dropInterval Every dropInterval-th packet is lost, 0 means that no packet is lost
+		*
+		*/
+		Report runLoopback(unsigned int playerCount, unsigned int ticks, unsigned int commandsPerTurn, unsigned int dropInterval);
+
+		/*!
+		* \brief Run game of players connected by UdpTransport over localhost, every player on its own thread
+		*
+		* \param basePort Port of the first player, other players use following ports
+		*
+		*/
+		Report runUdp(unsigned int playerCount, unsigned int ticks, unsigned int commandsPerTurn, unsigned short basePort);
+
+	private:
+		/*!
+		* \brief One simulated player
+		*/
+		struct Player
+		{
+			std::unique_ptr<Grid> grid;						///< map of the player
+			std::unique_ptr<ecs::Simulation> simulation;	///< game simulated by the player
+			std::unique_ptr<network::Lockstep> lockstep;	///< scheduler of commands
+			std::mt19937 random;							///< generator of commands
+			uint32_t issuedTurn{ UINT32_MAX };				///< last turn in which commands were issued
+			unsigned int commands{ 0u };					///< amount of issued commands
+			std::vector<ecs::Entity> entities;				///< own entities, used to create commands
+			std::vector<sf::Vector2i> tiles;				///< tiles of own entities
+		};
+
+		/*!
+		* \brief Generate map and create simulation of the player
+		*/
+		std::unique_ptr<Player> createPlayer(unsigned int player, logic::JobSystem & jobs);
+
+		/*!
+		* \brief Simulate one tick of the player, commands are issued at the beginning of every turn
+		*
+		* \return False if player waits for others
+		*
+		*/
+		bool stepPlayer(Player & player, unsigned int commandsPerTurn, logic::JobSystem & jobs);
+
+		/*!
+		* \brief Issue random commands
+		*/
+		void issueCommands(Player & player, unsigned int count);
+
+		/*!
+		* \brief Compare final states and fill report
+		*/
+		void summarize(Report & report, const std::vector<std::unique_ptr<Player>> & players);
+
+	private:
+		unsigned int m_seed;		///< seed of maps and commands
+	};
+}
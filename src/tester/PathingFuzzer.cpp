@@ -0,0 +1,367 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//--------------------------------------------------------------------------
+
+#include "PathingFuzzer.h"
+
+//--------------------------------------------------------------------------
+
+#include <queue>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <limits>
+#include <functional>
+#include <algorithm>
+
+//--------------------------------------------------------------------------
+
+namespace tester
+{
+	namespace
+	{
+		/*!
+		* \brief All algorithms which are checked by fuzzer
+		*/
+		const PF_ALGORITHM ALGORITHMS[] =
+		{
+			PF_ALGORITHM::A_STAR_HEAP,
+			PF_ALGORITHM::A_STAR_HEAP_BIDIRECTIONAL,
+		};
+
+		/*!
+		* \brief Weights of heuristic which are checked by fuzzer, paths found with weight higher than 1 can be more
+		* expensive than reference path, but not more than weight times
+		*/
+		const float EPSILONS[] = { 1.f, 1.5f };
+
+		constexpr int MAX_GRID_CHUNKS = 8;			///< maximum amount of chunks in x and y direction of random grid
+		constexpr unsigned int MAX_UNIT_SIZE = 3u;	///< biggest checked unit size
+	}
+
+	//--------------------------------------------------------------------------
+
+	PathingFuzzer::PathingFuzzer(unsigned int seed) :
+		m_random{ seed }
+	{
+	}
+
+	//--------------------------------------------------------------------------
+
+	PathingFuzzer::Report PathingFuzzer::run(unsigned int gridCount, const std::string & goldenPath, bool updateGolden)
+	{
+		Report report;
+		std::vector<std::string> results;
+
+		for (unsigned int caseId = 0u; caseId < gridCount; ++caseId)
+		{
+			std::uniform_int_distribution<int> chunkDist(1, MAX_GRID_CHUNKS);
+			sf::Vector2i gridSize(chunkDist(m_random) * CHUNK_SIZE, chunkDist(m_random) * CHUNK_SIZE);
+			Grid grid(gridSize);
+			randomizeGrid(grid);
+			// searches run on snapshot just like searches of the game running outside of the main thread
+			auto snapshot = grid.snapshot();
+			PathingSystem pathing(snapshot.get());
+
+			std::uniform_int_distribution<int> xDist(0, gridSize.x - 1);
+			std::uniform_int_distribution<int> yDist(0, gridSize.y - 1);
+			sf::Vector2i startPos(xDist(m_random), yDist(m_random));
+			sf::Vector2i targetPos(xDist(m_random), yDist(m_random));
+
+			int unitExpectedCost = -1;
+			for (unsigned int unitSize = 1u; unitSize <= MAX_UNIT_SIZE; ++unitSize)
+			{
+				int expectedCost = referenceCost(grid, startPos, targetPos, unitSize);
+				if (unitSize == 1u)
+					unitExpectedCost = expectedCost;
+				for (auto algorithm : ALGORITHMS)
+				{
+					for (auto epsilon : EPSILONS)
+					{
+						++report.cases;
+						auto path = pathing.findPath(startPos, targetPos, algorithm, unitSize, epsilon);
+						int cost = validatePath(grid, path, startPos, targetPos, unitSize);
+						if (!path.empty() && cost < 0)
+						{
+							++report.invalidPaths;
+							std::cout << "PathingFuzzer: case " << caseId << " algorithm " << static_cast<int>(algorithm) << " unit size " << unitSize
+								<< " epsilon " << epsilon << " returned broken path" << std::endl;
+						}
+						else if ((path.empty() && expectedCost >= 0) || (!path.empty() && (cost < expectedCost || cost > expectedCost * epsilon)))
+						{
+							++report.suboptimalPaths;
+							std::cout << "PathingFuzzer: case " << caseId << " algorithm " << static_cast<int>(algorithm) << " unit size " << unitSize
+								<< " epsilon " << epsilon << " cost " << (path.empty() ? -1 : cost) << " expected " << expectedCost << std::endl;
+						}
+						results.push_back(describeResult(caseId, algorithm, unitSize, epsilon, path, path.empty() ? -1 : cost));
+					}
+				}
+			}
+
+			// rectangle map is checked on the same grid and once more after incremental update, edits use their own
+			// generator so golden results of next cases don't depend on them
+			RectangleMap rectangles(grid);
+			checkRectangleMap(report, caseId, rectangles, grid, startPos, targetPos, unitExpectedCost);
+			checkSameRectangle(report, caseId, rectangles, grid, startPos);
+
+			std::mt19937 editRandom(caseId);
+			std::uniform_int_distribution<int> editDist(0, 3);
+			for (int i = 0; i < 4; ++i)
+			{
+				std::uniform_int_distribution<int> xEditDist(0, gridSize.x - 1);
+				std::uniform_int_distribution<int> yEditDist(0, gridSize.y - 1);
+				sf::Vector2i pos(xEditDist(editRandom), yEditDist(editRandom));
+				sf::IntRect area(pos.x, pos.y, editDist(editRandom) + 1, editDist(editRandom) + 1);
+				grid.setObjectType(area, editDist(editRandom) == 0 ? ObjectType::NONE : ObjectType::BUILDING);
+			}
+			grid.publishChanges();
+			checkRectangleMap(report, caseId, rectangles, grid, startPos, targetPos, referenceCost(grid, startPos, targetPos, 1u));
+		}
+
+		if (goldenPath.empty())
+			return report;
+
+		if (updateGolden)
+		{
+			std::ofstream file(goldenPath, std::ios::trunc);
+			if (!file.is_open())
+				throw std::runtime_error("PathingFuzzer - Failed to write golden file " + goldenPath);
+			for (auto & line : results)
+				file << line << '\n';
+		}
+		else
+		{
+			std::ifstream file(goldenPath);
+			if (!file.is_open())
+				throw std::runtime_error("PathingFuzzer - Failed to open golden file " + goldenPath);
+			std::string line;
+			unsigned int i = 0u;
+			while (std::getline(file, line) && i < results.size())
+			{
+				if (line != results[i])
+				{
+					++report.goldenMismatches;
+					std::cout << "PathingFuzzer: golden mismatch\n  expected: " << line << "\n  actual:   " << results[i] << std::endl;
+				}
+				++i;
+			}
+			// missing lines in golden file are also mismatches
+			report.goldenMismatches += results.size() - i;
+		}
+
+		return report;
+	}
+
+	//--------------------------------------------------------------------------
+
+	void PathingFuzzer::checkRectangleMap(Report & report, unsigned int caseId, RectangleMap & rectangles, const Grid & grid, sf::Vector2i startPos,
+		sf::Vector2i targetPos, int expectedCost)
+	{
+		++report.cases;
+		auto path = rectangles.findPath(startPos, targetPos);
+		int cost = validatePath(grid, path, startPos, targetPos, 1u);
+		if (!path.empty() && cost < 0)
+		{
+			++report.invalidPaths;
+			std::cout << "PathingFuzzer: case " << caseId << " rectangle map returned broken path" << std::endl;
+		}
+		else if ((path.empty() ? -1 : cost) != expectedCost)
+		{
+			++report.suboptimalPaths;
+			std::cout << "PathingFuzzer: case " << caseId << " rectangle map cost " << (path.empty() ? -1 : cost) << " expected " << expectedCost << std::endl;
+		}
+	}
+
+	//--------------------------------------------------------------------------
+
+	void PathingFuzzer::checkSameRectangle(Report & report, unsigned int caseId, RectangleMap & rectangles, const Grid & grid, sf::Vector2i startPos)
+	{
+		unsigned int start = grid.getIndex(startPos.x, startPos.y);
+		int rectangleId = rectangles.getRectangleId(start);
+		if (rectangleId < 0)
+			return;
+
+		// the farthest corner of the rectangle, so the path crosses as much of it as possible
+		sf::IntRect area = rectangles.getRectangle(rectangleId);
+		sf::Vector2i targetPos(startPos.x - area.left < area.width / 2 ? area.left + area.width - 1 : area.left,
+			startPos.y - area.top < area.height / 2 ? area.top + area.height - 1 : area.top);
+		checkRectangleMap(report, caseId, rectangles, grid, startPos, targetPos, referenceCost(grid, startPos, targetPos, 1u));
+
+		if (grid.getMoveCost(start) == grid.getMinMoveCost() && rectangles.getExpandedCount() != 0u)
+		{
+			++report.rectangleSearches;
+			std::cout << "PathingFuzzer: case " << caseId << " rectangle map expanded " << rectangles.getExpandedCount() << " tiles inside single rectangle" << std::endl;
+		}
+	}
+
+	//--------------------------------------------------------------------------
+
+	void PathingFuzzer::randomizeGrid(Grid & grid)
+	{
+		static const ObjectType OBSTACLES[] = { ObjectType::UNIT, ObjectType::TREE, ObjectType::BUILDING };
+
+		sf::Vector2i gridSize = grid.getGridSize();
+		std::uniform_int_distribution<int> densityDist(0, 45);
+		std::uniform_int_distribution<int> percentDist(0, 99);
+		std::uniform_int_distribution<int> typeDist(0, 2);
+		std::uniform_int_distribution<int> terrainDist(0, static_cast<int>(TerrainType::COUNT) - 1);
+		int density = densityDist(m_random);
+
+		// terrain is placed in random rectangular patches
+		int patchCount = (gridSize.x*gridSize.y) / 64;
+		for (int i = 0; i < patchCount; ++i)
+		{
+			std::uniform_int_distribution<int> xDist(0, gridSize.x - 1);
+			std::uniform_int_distribution<int> yDist(0, gridSize.y - 1);
+			std::uniform_int_distribution<int> sizeDist(1, 8);
+			TerrainType terrain = static_cast<TerrainType>(terrainDist(m_random));
+			int left = xDist(m_random);
+			int top = yDist(m_random);
+			int right = std::min(left + sizeDist(m_random), gridSize.x);
+			int bottom = std::min(top + sizeDist(m_random), gridSize.y);
+			for (int y = top; y < bottom; ++y)
+			{
+				for (int x = left; x < right; ++x)
+					grid.setTerrainType(grid.getIndex(x, y), terrain);
+			}
+		}
+
+		for (int y = 0; y < gridSize.y; ++y)
+		{
+			for (int x = 0; x < gridSize.x; ++x)
+			{
+				if (percentDist(m_random) < density)
+					grid.setObjectType(grid.getIndex(x, y), OBSTACLES[typeDist(m_random)]);
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------
+
+	int PathingFuzzer::referenceCost(const Grid & grid, sf::Vector2i startPos, sf::Vector2i targetPos, unsigned int unitSize)
+	{
+		sf::Vector2i gridSize = grid.getGridSize();
+		std::vector<int> cost(gridSize.x*gridSize.y, std::numeric_limits<int>::max());
+
+		using Node = std::pair<int, int>; // cost, row major tile index
+		std::priority_queue<Node, std::vector<Node>, std::greater<Node>> openSet;
+		cost[startPos.y*gridSize.x + startPos.x] = 0;
+		openSet.emplace(0, startPos.y*gridSize.x + startPos.x);
+
+		while (!openSet.empty())
+		{
+			Node node = openSet.top();
+			openSet.pop();
+			sf::Vector2i pos(node.second % gridSize.x, node.second / gridSize.x);
+			if (node.first != cost[node.second])
+				continue;
+			if (pos == targetPos)
+				return node.first;
+
+			for (int y = -1; y <= 1; ++y)
+			{
+				for (int x = -1; x <= 1; ++x)
+				{
+					sf::Vector2i next(pos.x + x, pos.y + y);
+					if ((x == 0 && y == 0) || next.x < 0 || next.y < 0 || next.x >= gridSize.x || next.y >= gridSize.y)
+						continue;
+					if (!isFootprintFree(grid, next, unitSize))
+						continue;
+
+					int newCost = node.first + stepCost(grid, next);
+					if (newCost < cost[next.y*gridSize.x + next.x])
+					{
+						cost[next.y*gridSize.x + next.x] = newCost;
+						openSet.emplace(newCost, next.y*gridSize.x + next.x);
+					}
+				}
+			}
+		}
+
+		return -1;
+	}
+
+	//--------------------------------------------------------------------------
+
+	int PathingFuzzer::validatePath(const Grid & grid, const std::vector<sf::Vector2i> & path, sf::Vector2i startPos, sf::Vector2i targetPos, unsigned int unitSize)
+	{
+		// path is saved from target to start
+		if (path.empty() || path.front() != targetPos || path.back() != startPos)
+			return -1;
+
+		int cost = 0;
+		for (unsigned int i = path.size() - 1; i > 0; --i)
+		{
+			sf::Vector2i from = path[i];
+			sf::Vector2i to = path[i - 1];
+			if (std::abs(to.x - from.x) > 1 || std::abs(to.y - from.y) > 1 || to == from)
+				return -1;
+			if (!isFootprintFree(grid, to, unitSize))
+				return -1;
+			cost += stepCost(grid, to);
+		}
+
+		return cost;
+	}
+
+	//--------------------------------------------------------------------------
+
+	bool PathingFuzzer::isFootprintFree(const Grid & grid, sf::Vector2i pos, unsigned int unitSize) const
+	{
+		sf::Vector2i gridSize = grid.getGridSize();
+		if (pos.x < 0 || pos.y < 0 || pos.x + static_cast<int>(unitSize) > gridSize.x || pos.y + static_cast<int>(unitSize) > gridSize.y)
+			return false;
+
+		for (int y = pos.y; y < pos.y + static_cast<int>(unitSize); ++y)
+		{
+			for (int x = pos.x; x < pos.x + static_cast<int>(unitSize); ++x)
+			{
+				if (grid.getObjectType(grid.getIndex(x, y)) != ObjectType::NONE)
+					return false;
+			}
+		}
+		return true;
+	}
+
+	//--------------------------------------------------------------------------
+
+	int PathingFuzzer::stepCost(const Grid & grid, sf::Vector2i to) const
+	{
+		// straight and diagonal steps have the same cost which depends only on terrain of entered tile
+		return grid.getMoveCost(grid.getIndex(to.x, to.y));
+	}
+
+	//--------------------------------------------------------------------------
+
+	std::string PathingFuzzer::describeResult(unsigned int caseId, PF_ALGORITHM algorithm, unsigned int unitSize, float epsilon, const std::vector<sf::Vector2i> & path,
+		int cost) const
+	{
+		// FNV-1a hash of all path positions
+		uint64_t hash = 14695981039346656037ull;
+		for (auto & pos : path)
+		{
+			hash = (hash ^ static_cast<uint32_t>(pos.x)) * 1099511628211ull;
+			hash = (hash ^ static_cast<uint32_t>(pos.y)) * 1099511628211ull;
+		}
+
+		std::ostringstream stream;
+		stream << caseId << ' ' << static_cast<int>(algorithm) << ' ' << unitSize << ' ' << epsilon << ' ' << cost << ' ' << path.size() << ' ' << std::hex << hash;
+		return stream.str();
+	}
+}
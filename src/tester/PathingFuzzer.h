@@ -0,0 +1,143 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <vector>
+#include <string>
+#include <random>
+#include <cstdint>
+#include <SFML/Graphics.hpp>
+
+//--------------------------------------------------------------------------
+
+#include "../logic/Grid.h"
+#include "../logic/PathingSystem.h"
+#include "../logic/RectangleMap.h"
+
+//--------------------------------------------------------------------------
+
+namespace tester
+{
+	/*!
+	* \brief Regression runner for PathingSystem and RectangleMap
+	*
+	* Runs every PF_ALGORITHM for several unit sizes and heuristic weights on seeded random grids with random terrain and checks
+	* that returned paths are valid (starts and ends on requested tiles, every step goes to adjacent free tile) and optimal (cost
+	* is equal to cost found by reference Dijkstra search, or not higher than weight times this cost for weighted search).
+	* RectangleMap is checked on every grid before and after random edits, it must always return optimal path and it must not
+	* expand any tile for path inside single rectangle of the cheapest terrain.
+	* Results of every case can be written to golden file or compared with previously saved golden file, so any change
+	* of path finding behaviour is reported.
+	*
+	* Usage example:
+	* \code
+	* tester::PathingFuzzer fuzzer(1234u);
+	* auto report = fuzzer.run(2000u, "resources/golden/pathing.golden", false);
+	* \endcode
+	*
+	*/
+	class PathingFuzzer
+	{
+	public:
+		/*!
+		* \brief Summary of all executed cases
+		*/
+		struct Report
+		{
+			unsigned int cases{ 0u };				///< amount of executed cases (one case is one algorithm, unit size and weight on one grid)
+			unsigned int invalidPaths{ 0u };		///< amount of paths which are broken or go through occupied tiles
+			unsigned int suboptimalPaths{ 0u };		///< amount of paths which cost is outside of bounds given by reference cost
+			unsigned int goldenMismatches{ 0u };	///< amount of results different than results saved in golden file
+			unsigned int rectangleSearches{ 0u };	///< amount of paths inside single rectangle for which rectangle map expanded any tile
+
+			bool passed() const { return invalidPaths == 0u && suboptimalPaths == 0u && goldenMismatches == 0u && rectangleSearches == 0u; }
+		};
+
+		/*!
+		* \brief Default constructor
+		*
+		* \param seed Seed used to generate all random grids, the same seed always generates the same cases
+		*
+		*/
+		PathingFuzzer(unsigned int seed);
+
+		/*!
+		* \brief Run all cases
+		*
+		* \param gridCount Amount of random grids, every algorithm is executed on every grid
+		* \param goldenPath Path to golden file, no comparison is performed if it's empty
+		* \param updateGolden If true then golden file is overwritten with new results instead of comparison
+		*
+		* \return Summary of executed cases
+		*
+		*/
+		Report run(unsigned int gridCount, const std::string & goldenPath, bool updateGolden);
+
+	private:
+		/*!
+		* \brief Check path found by rectangle map, which must be always optimal
+		*/
+		void checkRectangleMap(Report & report, unsigned int caseId, RectangleMap & rectangles, const Grid & grid, sf::Vector2i startPos,
+			sf::Vector2i targetPos, int expectedCost);
+
+		/*!
+		* \brief Check path from start position to the farthest tile of it's rectangle, which must be found without search
+		*/
+		void checkSameRectangle(Report & report, unsigned int caseId, RectangleMap & rectangles, const Grid & grid, sf::Vector2i startPos);
+
+		/*!
+		* \brief Fill grid with random obstacles
+		*/
+		void randomizeGrid(Grid & grid);
+
+		/*!
+		* \brief Reference cost of the path found by plain Dijkstra search, negative value means that no path exist
+		*/
+		int referenceCost(const Grid & grid, sf::Vector2i startPos, sf::Vector2i targetPos, unsigned int unitSize);
+
+		/*!
+		* \brief Check path returned by PathingSystem and compute it's cost
+		*
+		* \return Cost of the path or -1 if path is broken
+		*
+		*/
+		int validatePath(const Grid & grid, const std::vector<sf::Vector2i> & path, sf::Vector2i startPos, sf::Vector2i targetPos, unsigned int unitSize);
+
+		/*!
+		* \brief Check if all tiles covered by unit placed on the position are inside the grid and free
+		*/
+		bool isFootprintFree(const Grid & grid, sf::Vector2i pos, unsigned int unitSize) const;
+
+		/*!
+		* \brief Cost of single step to the tile from any adjacent tile
+		*/
+		int stepCost(const Grid & grid, sf::Vector2i to) const;
+
+		/*!
+		* \brief Create one line of golden file describing result of the case
+		*/
+		std::string describeResult(unsigned int caseId, PF_ALGORITHM algorithm, unsigned int unitSize, float epsilon, const std::vector<sf::Vector2i> & path,
+			int cost) const;
+
+	private:
+		std::mt19937 m_random;		///< generator of all random cases
+	};
+}
@@ -0,0 +1,201 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+//--------------------------------------------------------------------------
+
+#include "SightTester.h"
+
+//--------------------------------------------------------------------------
+
+#include <vector>
+#include <cstdlib>
+#include <iostream>
+
+//--------------------------------------------------------------------------
+
+namespace tester
+{
+	namespace
+	{
+		constexpr int MAX_GRID_CHUNKS = 8;			///< maximum amount of chunks in x and y direction of random grid
+		constexpr int RAYS_PER_KIND = 64;			///< amount of rays of every kind generated on one grid
+		constexpr int CHUNK_SIDE = static_cast<int>(CHUNK_SIZE);
+	}
+
+	//--------------------------------------------------------------------------
+
+	SightTester::SightTester(unsigned int seed) :
+		m_random{ seed }
+	{
+	}
+
+	//--------------------------------------------------------------------------
+
+	SightTester::Report SightTester::run(unsigned int gridCount)
+	{
+		Report report;
+		std::vector<SightQuery> queries;
+		std::vector<uint8_t> visible;
+
+		for (unsigned int caseId = 0u; caseId < gridCount; ++caseId)
+		{
+			std::uniform_int_distribution<int> chunkDist(1, MAX_GRID_CHUNKS);
+			sf::Vector2i gridSize(chunkDist(m_random) * CHUNK_SIDE, chunkDist(m_random) * CHUNK_SIDE);
+			Grid grid(gridSize);
+			randomizeGrid(grid);
+
+			queries.clear();
+			generateRays(gridSize, queries);
+			visible.assign(queries.size(), 0u);
+
+			LineOfSight sight(&grid);
+			sight.testBatch(queries.data(), queries.size(), visible.data());
+			report.skippedChunks += sight.getCounters().skippedChunks;
+
+			for (std::size_t i = 0; i < queries.size(); ++i)
+			{
+				bool expected = referenceTest(grid, queries[i].from, queries[i].to);
+				++report.rays;
+				report.visible += expected ? 1u : 0u;
+				if ((visible[i] != 0u) != expected)
+				{
+					++report.mismatches;
+					std::cout << "SightTester: case " << caseId << " ray " << queries[i].from.x << "," << queries[i].from.y << " -> " << queries[i].to.x
+						<< "," << queries[i].to.y << " returned " << (visible[i] != 0u ? "visible" : "blocked") << std::endl;
+				}
+			}
+		}
+
+		return report;
+	}
+
+	//--------------------------------------------------------------------------
+
+	void SightTester::randomizeGrid(Grid & grid)
+	{
+		static const ObjectType OBSTACLES[] = { ObjectType::UNIT, ObjectType::TREE, ObjectType::BUILDING };
+
+		sf::Vector2i chunkGridSize = grid.getChunkGridSize();
+		std::uniform_int_distribution<int> percentDist(0, 99);
+		std::uniform_int_distribution<int> densityDist(1, 20);
+		std::uniform_int_distribution<int> typeDist(0, 2);
+		int emptyChunks = percentDist(m_random);
+
+		// units don't block sight, so they are placed only to check that they are ignored
+		for (int chunkY = 0; chunkY < chunkGridSize.y; ++chunkY)
+		{
+			for (int chunkX = 0; chunkX < chunkGridSize.x; ++chunkX)
+			{
+				if (percentDist(m_random) < emptyChunks)
+					continue;
+
+				int density = densityDist(m_random);
+				for (int y = 0; y < CHUNK_SIDE; ++y)
+				{
+					for (int x = 0; x < CHUNK_SIDE; ++x)
+					{
+						if (percentDist(m_random) < density)
+							grid.setObjectType(sf::IntRect(chunkX*CHUNK_SIDE + x, chunkY*CHUNK_SIDE + y, 1, 1), OBSTACLES[typeDist(m_random)]);
+					}
+				}
+			}
+		}
+		grid.publishChanges();
+	}
+
+	//--------------------------------------------------------------------------
+
+	void SightTester::generateRays(sf::Vector2i gridSize, std::vector<SightQuery> & queries)
+	{
+		std::uniform_int_distribution<int> xDist(0, gridSize.x - 1);
+		std::uniform_int_distribution<int> yDist(0, gridSize.y - 1);
+		std::uniform_int_distribution<int> signDist(0, 1);
+		auto randomTile = [&]() { return sf::Vector2i(xDist(m_random), yDist(m_random)); };
+		auto inside = [gridSize](sf::Vector2i tile) { return tile.x >= 0 && tile.y >= 0 && tile.x < gridSize.x && tile.y < gridSize.y; };
+		auto add = [&](sf::Vector2i from, sf::Vector2i to)
+		{
+			if (inside(from) && inside(to))
+				queries.push_back(SightQuery{ from, to });
+		};
+
+		for (int i = 0; i < RAYS_PER_KIND; ++i)
+		{
+			// random rays
+			add(randomTile(), randomTile());
+
+			// axis aligned rays
+			sf::Vector2i from = randomTile();
+			add(from, sf::Vector2i(xDist(m_random), from.y));
+			add(from, sf::Vector2i(from.x, yDist(m_random)));
+
+			// diagonal rays pass through corners of every tile
+			std::uniform_int_distribution<int> lengthDist(0, std::max(gridSize.x, gridSize.y));
+			int length = lengthDist(m_random);
+			add(from, from + sf::Vector2i(signDist(m_random) ? length : -length, signDist(m_random) ? length : -length));
+
+			// rays with odd multiples of the same step on both axes cross exact corners of tiles
+			std::uniform_int_distribution<int> oddDist(0, 7);
+			std::uniform_int_distribution<int> repeatDist(1, 4);
+			sf::Vector2i step(2 * oddDist(m_random) + 1, 2 * oddDist(m_random) + 1);
+			int repeat = repeatDist(m_random);
+			add(from, from + sf::Vector2i((signDist(m_random) ? 1 : -1) * step.x * repeat, (signDist(m_random) ? 1 : -1) * step.y * repeat));
+
+			// rays starting and ending on chunk border
+			sf::Vector2i border(xDist(m_random) / CHUNK_SIDE * CHUNK_SIDE + (signDist(m_random) ? CHUNK_SIDE - 1 : 0), yDist(m_random));
+			add(border, randomTile());
+			add(randomTile(), border);
+
+			// zero length rays
+			add(from, from);
+		}
+	}
+
+	//--------------------------------------------------------------------------
+
+	bool SightTester::referenceTest(const GridView & grid, sf::Vector2i from, sf::Vector2i to)
+	{
+		// ray leaves i-th tile on x axis at time (2i + 1) / (2*dx), the same on y axis, times are compared after multiplication
+		int64_t dx = std::abs(to.x - from.x);
+		int64_t dy = std::abs(to.y - from.y);
+		sf::Vector2i step((to.x > from.x) - (to.x < from.x), (to.y > from.y) - (to.y < from.y));
+		int64_t crossedX = 0;
+		int64_t crossedY = 0;
+		sf::Vector2i tile = from;
+		while (tile != to)
+		{
+			bool crossX = crossedX < dx && (crossedY >= dy || (2 * crossedX + 1) * dy <= (2 * crossedY + 1) * dx);
+			bool crossY = crossedY < dy && (crossedX >= dx || (2 * crossedY + 1) * dx <= (2 * crossedX + 1) * dy);
+			if (crossX)
+			{
+				tile.x += step.x;
+				++crossedX;
+			}
+			if (crossY)
+			{
+				tile.y += step.y;
+				++crossedY;
+			}
+
+			unsigned int index = grid.getIndex(tile.x, tile.y);
+			if (tile != to && (grid.isSet(GridPlane::TREE, index) || grid.isSet(GridPlane::BUILDING, index)))
+				return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,106 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <random>
+#include <cstdint>
+#include <SFML/Graphics.hpp>
+
+//--------------------------------------------------------------------------
+
+#include "../logic/Grid.h"
+#include "../logic/LineOfSight.h"
+
+//--------------------------------------------------------------------------
+
+namespace tester
+{
+	/*!
+	* \brief Regression runner for LineOfSight
+	*
+	* Every ray of LineOfSight::testBatch() is compared with plain tile by tile walk, which checks every tile of the ray and
+	* never skips chunks. Grids are seeded random grids where chunks are either empty or filled with random trees and
+	* buildings, so rays pass empty chunks in one step as well as walk through occupied ones. Random rays are mixed with
+	* axis aligned rays, diagonal rays, rays crossing exact corners of tiles and rays starting or ending on chunk border.
+	*
+	* Usage example:
+	* \code
+	* tester::SightTester tester(1234u);
+	* auto report = tester.run(500u);
+	* \endcode
+	*
+	*/
+	class SightTester
+	{
+	public:
+		/*!
+		* \brief Summary of all tested rays
+		*/
+		struct Report
+		{
+			unsigned int rays{ 0u };			///< amount of tested rays
+			unsigned int visible{ 0u };			///< amount of rays which reached target
+			unsigned int mismatches{ 0u };		///< amount of rays which result differs from plain walk
+			uint64_t skippedChunks{ 0u };		///< amount of chunks passed by LineOfSight in one step
+
+			bool passed() const { return mismatches == 0u && skippedChunks > 0u; }
+		};
+
+		/*!
+		* \brief Default constructor
+		*
+		* \param seed Seed used to generate all grids and rays, the same seed always generates the same cases
+		*
+		*/
+		SightTester(unsigned int seed);
+
+		/*!
+		* \brief Test rays on random grids
+		*
+		* \param gridCount Amount of random grids
+		*
+		*/
+		Report run(unsigned int gridCount);
+
+	private:
+		/*!
+		* \brief Fill random chunks of the grid with trees and buildings
+		*/
+		void randomizeGrid(Grid & grid);
+
+		/*!
+		* \brief Generate all kinds of rays inside the grid
+		*/
+		void generateRays(sf::Vector2i gridSize, std::vector<SightQuery> & queries);
+
+		/*!
+		* \brief Plain tile by tile walk from center of the first tile to center of the last one
+		*
+		* Ray goes diagonally through exact corners of tiles, every visited tile except the first and the last one is checked.
+		*
+		*/
+		static bool referenceTest(const GridView & grid, sf::Vector2i from, sf::Vector2i to);
+
+	private:
+		std::mt19937 m_random;		///< generator of all grids and rays
+	};
+}
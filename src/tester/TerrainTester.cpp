@@ -0,0 +1,106 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+//--------------------------------------------------------------------------
+
+#include "TerrainTester.h"
+
+//--------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+//--------------------------------------------------------------------------
+
+namespace tester
+{
+	namespace
+	{
+		constexpr int MAX_GRID_CHUNKS = 48;		///< maximum amount of chunks in x and y direction of random grid
+	}
+
+	//--------------------------------------------------------------------------
+
+	TerrainTester::TerrainTester(unsigned int seed) :
+		m_random{ seed },
+		m_serial{ 0u },
+		m_parallel{ std::max(2u, logic::JobSystem::defaultWorkerCount()) }
+	{
+	}
+
+	//--------------------------------------------------------------------------
+
+	TerrainTester::Report TerrainTester::run(unsigned int mapCount)
+	{
+		Report report;
+		report.workers = std::max(2u, logic::JobSystem::defaultWorkerCount());
+
+		for (unsigned int caseId = 0u; caseId < mapCount; ++caseId)
+		{
+			std::uniform_int_distribution<int> chunkDist(1, MAX_GRID_CHUNKS);
+			sf::Vector2i gridSize(chunkDist(m_random) * CHUNK_SIZE, chunkDist(m_random) * CHUNK_SIZE);
+			TerrainSettings settings = randomSettings();
+
+			Grid serial(gridSize);
+			TerrainGenerator(settings, serial).generate(m_serial);
+			serial.publishChanges();
+
+			Grid parallel(gridSize);
+			TerrainGenerator(settings, parallel).generate(m_parallel);
+			parallel.publishChanges();
+
+			++report.maps;
+			unsigned int chunkCount = serial.getChunkGridSize().x*serial.getChunkGridSize().y;
+			for (unsigned int chunkIndex = 0u; chunkIndex < chunkCount; ++chunkIndex)
+			{
+				++report.chunks;
+				const uint8_t * expected = reinterpret_cast<const uint8_t*>(&serial.chunk(chunkIndex));
+				const uint8_t * generated = reinterpret_cast<const uint8_t*>(&parallel.chunk(chunkIndex));
+				if (std::memcmp(expected, generated, sizeof(GridChunk)) == 0)
+					continue;
+
+				++report.mismatchedChunks;
+				std::size_t offset = std::mismatch(expected, expected + sizeof(GridChunk), generated).first - expected;
+				std::cout << "TerrainTester: case " << caseId << " seed " << settings.seed << " chunk " << chunkIndex << " differs at byte "
+					<< offset << std::endl;
+			}
+		}
+
+		return report;
+	}
+
+	//--------------------------------------------------------------------------
+
+	TerrainSettings TerrainTester::randomSettings()
+	{
+		std::uniform_real_distribution<float> levelDist(0.f, 1.f);
+		std::uniform_int_distribution<unsigned int> percentDist(0u, 100u);
+		std::uniform_int_distribution<unsigned int> regionDist(16u, 64u);
+
+		TerrainSettings settings;
+		settings.seed = m_random();
+		settings.waterLevel = levelDist(m_random);
+		settings.forestLevel = levelDist(m_random);
+		settings.treeDensity = percentDist(m_random);
+		settings.resourceRegion = regionDist(m_random);
+		settings.resourceChance = percentDist(m_random);
+		return settings;
+	}
+}
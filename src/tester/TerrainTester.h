@@ -0,0 +1,95 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include <random>
+#include <cstdint>
+
+//--------------------------------------------------------------------------
+
+#include "../logic/Grid.h"
+#include "../logic/JobSystem.h"
+#include "../logic/TerrainGenerator.h"
+
+//--------------------------------------------------------------------------
+
+namespace tester
+{
+	/*!
+	* \brief Determinism runner of TerrainGenerator
+	*
+	* Replays and lockstep peers regenerate the map from it's seed, so the map must not depend on amount of worker threads.
+	* Every case generates the same seeded random settings once without workers and once with all workers, then all
+	* chunks of both grids are compared byte for byte, including clearance computed after changes are published. Grid
+	* sizes go over several batches of TerrainGenerator::BATCH_CHUNKS chunks.
+	*
+	* Usage example:
+	* \code
+	* tester::TerrainTester tester(1234u);
+	* auto report = tester.run(20u);
+	* \endcode
+	*
+	*/
+	class TerrainTester
+	{
+	public:
+		/*!
+		* \brief Summary of all generated maps
+		*/
+		struct Report
+		{
+			unsigned int maps{ 0u };				///< amount of maps generated by both job systems
+			unsigned int chunks{ 0u };				///< amount of compared chunks
+			unsigned int workers{ 0u };				///< amount of workers of the parallel job system
+			unsigned int mismatchedChunks{ 0u };	///< amount of chunks which differ between both maps
+
+			bool passed() const { return chunks > 0u && mismatchedChunks == 0u; }
+		};
+
+		/*!
+		* \brief Default constructor
+		*
+		* \param seed Seed used to generate all settings, the same seed always generates the same cases
+		*
+		*/
+		TerrainTester(unsigned int seed);
+
+		/*!
+		* \brief Compare maps generated without and with workers
+		*
+		* \param mapCount Amount of random maps
+		*
+		*/
+		Report run(unsigned int mapCount);
+
+	private:
+		/*!
+		* \brief Random terrain settings, always with new seed
+		*/
+		TerrainSettings randomSettings();
+
+	private:
+		std::mt19937 m_random;			///< generator of all settings
+		logic::JobSystem m_serial;		///< job system without workers, every job runs on calling thread
+		logic::JobSystem m_parallel;	///< job system with all workers
+	};
+}
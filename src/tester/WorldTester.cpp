@@ -0,0 +1,78 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+//--------------------------------------------------------------------------
+
+#include "WorldTester.h"
+
+//--------------------------------------------------------------------------
+
+#include <iostream>
+
+//--------------------------------------------------------------------------
+
+namespace tester
+{
+	WorldTester::Report WorldTester::run()
+	{
+		Report report;
+		checkHealth(report);
+		return report;
+	}
+
+	//--------------------------------------------------------------------------
+
+	void WorldTester::checkHealth(Report & report)
+	{
+		ecs::World world;
+		ecs::HealthSystem health;
+
+		// components of entity created from mask are default constructed, so it has zero health and zero max health
+		ecs::Entity fromMask = world.create(ecs::componentMask<ecs::Position, ecs::Health>());
+		ecs::Entity alive = world.create(ecs::Position{}, ecs::Health{ 100, 100 });
+		ecs::Entity killed = world.create(ecs::Position{}, ecs::Health{ 100, 100 });
+		world.get<ecs::Health>(killed)->current = 0;
+
+		unsigned int destroyed = health.update(world);
+		expect(report, world.isAlive(fromMask), "entity created from mask was destroyed by HealthSystem");
+		expect(report, world.isAlive(alive), "entity with full health was destroyed by HealthSystem");
+		expect(report, !world.isAlive(killed), "entity with zero health was not destroyed by HealthSystem");
+		expect(report, destroyed == 1u, "HealthSystem reported wrong amount of destroyed entities");
+
+		// entity created from mask dies like any other once it's health is initialized and drops to zero
+		if (world.isAlive(fromMask))
+		{
+			*world.get<ecs::Health>(fromMask) = ecs::Health{ 0, 100 };
+			health.update(world);
+			expect(report, !world.isAlive(fromMask), "initialized entity with zero health was not destroyed by HealthSystem");
+		}
+	}
+
+	//--------------------------------------------------------------------------
+
+	void WorldTester::expect(Report & report, bool condition, const char * message)
+	{
+		++report.checks;
+		if (!condition)
+		{
+			++report.failures;
+			std::cout << "WorldTester: " << message << std::endl;
+		}
+	}
+}
@@ -0,0 +1,74 @@
+/*
+* TzarRemake
+* Copyright (C) 2018
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+//--------------------------------------------------------------------------
+
+#include "../ecs/World.h"
+#include "../ecs/Systems.h"
+
+//--------------------------------------------------------------------------
+
+namespace tester
+{
+	/*!
+	* \brief Checks of World and entity systems on hand made entities
+	*
+	* Every check creates its own entities, runs one system and compares the result with expected one, so behaviour
+	* of systems which doesn't show up in whole game runs (like handling of default constructed components) is covered.
+	*
+	* Usage example:
+	* \code
+	* tester::WorldTester tester;
+	* auto report = tester.run();
+	* \endcode
+	*
+	*/
+	class WorldTester
+	{
+	public:
+		/*!
+		* \brief Summary of all checks
+		*/
+		struct Report
+		{
+			unsigned int checks{ 0u };		///< amount of executed checks
+			unsigned int failures{ 0u };	///< amount of checks which gave unexpected result
+
+			bool passed() const { return failures == 0u; }
+		};
+
+		/*!
+		* \brief Run all checks
+		*/
+		Report run();
+
+	private:
+		/*!
+		* \brief HealthSystem destroys only entities which health dropped to zero
+		*/
+		void checkHealth(Report & report);
+
+		/*!
+		* \brief Count the check and print message if it failed
+		*/
+		void expect(Report & report, bool condition, const char * message);
+	};
+}